@@ -0,0 +1,212 @@
+/** 
+ * @file llmemorybudget.cpp
+ * @brief Process wide memory budget shared by the caches of the viewer
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmemorybudget.h"
+
+#include <algorithm>
+
+//static
+const F32 LLMemoryBudget::UPDATE_INTERVAL = 0.25f;
+const F32 LLMemoryBudget::TRIM_TARGET = 0.95f;
+const F32 LLMemoryBudget::RELAX_FRACTION = 0.85f;
+
+LLMemoryBudget::pool_list_t LLMemoryBudget::sPools;
+S64 LLMemoryBudget::sBudget = 0;
+S64 LLMemoryBudget::sTotalUsage = 0;
+LLTimer LLMemoryBudget::sUpdateTimer;
+
+static const F64 BYTES_PER_MB = 1024.0 * 1024.0;
+
+//============================================================================
+
+LLMemoryBudget::Pool::Pool(const std::string& name, S32 priority)
+	: mName(name),
+	  mPriority(priority),
+	  mLimit(0),
+	  mUsage(0),
+	  mPeak(0),
+	  mTrimmed(0),
+	  mTrimmedTo(0),
+	  mTrimCount(0),
+	  mTrimming(false)
+{
+	LLMemoryBudget::addPool(this);
+}
+
+LLMemoryBudget::Pool::~Pool()
+{
+	LLMemoryBudget::removePool(this);
+}
+
+//============================================================================
+
+//static
+void LLMemoryBudget::addPool(Pool* pool)
+{
+	pool_list_t::iterator iter = sPools.begin();
+	while (iter != sPools.end() && (*iter)->getPriority() <= pool->getPriority())
+	{
+		++iter;
+	}
+	sPools.insert(iter, pool);
+}
+
+//static
+void LLMemoryBudget::removePool(Pool* pool)
+{
+	pool_list_t::iterator iter = std::find(sPools.begin(), sPools.end(), pool);
+	if (iter != sPools.end())
+	{
+		sPools.erase(iter);
+	}
+}
+
+//static
+void LLMemoryBudget::setBudget(S64 bytes)
+{
+	sBudget = llmax(bytes, (S64)0);
+	llinfos << "Memory budget set to " << llformat("%.0f", sBudget / BYTES_PER_MB) << " MB" << llendl;
+}
+
+//static
+S64 LLMemoryBudget::trimPool(Pool* pool, S64 bytes)
+{
+	S64 freed = pool->trim(bytes);
+	pool->mTrimmed += freed;
+	pool->mTrimCount++;
+	pool->mTrimming = true;
+	return freed;
+}
+
+//static
+void LLMemoryBudget::update(bool force)
+{
+	if (!force && sUpdateTimer.getElapsedTimeF32() < UPDATE_INTERVAL)
+	{
+		return;
+	}
+	sUpdateTimer.reset();
+
+	S64 total = 0;
+	for (pool_list_t::iterator iter = sPools.begin(); iter != sPools.end(); ++iter)
+	{
+		Pool* pool = *iter;
+		pool->mUsage = llmax(pool->getUsage(), (S64)0);
+		pool->mPeak = llmax(pool->mPeak, pool->mUsage);
+		total += pool->mUsage;
+	}
+	sTotalUsage = total;
+
+	// Pools over their own limit give back the excess
+	for (pool_list_t::iterator iter = sPools.begin(); iter != sPools.end(); ++iter)
+	{
+		Pool* pool = *iter;
+		if (pool->mLimit > 0 && pool->mUsage > pool->mLimit)
+		{
+			total -= trimPool(pool, pool->mUsage - pool->mLimit);
+		}
+	}
+
+	// Pools trimmed for their own limit relax even without a total budget
+	if (sBudget > 0 && total > sBudget)
+	{
+		// Each pool gives back its share of the excess, once while usage
+		// stays over the budget and again only for what it has grown since.
+		// A pool that releases over the next frames (textures) keeps its
+		// share, rather than having the others emptied every update in its
+		// place without getting usage under the budget.
+		S64 excess = total - (S64)(sBudget * TRIM_TARGET);
+		for (pool_list_t::iterator iter = sPools.begin(); iter != sPools.end(); ++iter)
+		{
+			Pool* pool = *iter;
+			if (pool->mTrimming && pool->mUsage <= pool->mTrimmedTo)
+			{
+				continue;
+			}
+			S64 share = (S64)((F64)excess * pool->mUsage / total);
+			if (share > 0)
+			{
+				pool->mTrimmedTo = pool->mUsage - trimPool(pool, share);
+			}
+		}
+	}
+	else if (sBudget <= 0 || total < (S64)(sBudget * RELAX_FRACTION))
+	{
+		for (pool_list_t::iterator iter = sPools.begin(); iter != sPools.end(); ++iter)
+		{
+			Pool* pool = *iter;
+			if (pool->mTrimming && (pool->mLimit <= 0 || pool->mUsage < (S64)(pool->mLimit * RELAX_FRACTION)))
+			{
+				pool->relax();
+				pool->mTrimming = false;
+			}
+		}
+	}
+}
+
+//static
+LLSD LLMemoryBudget::getStats()
+{
+	LLSD stats;
+	stats["budget"] = (F64)sBudget;
+	stats["total"] = (F64)sTotalUsage;
+	LLSD& pools = stats["pools"];
+	pools = LLSD::emptyMap();
+	for (pool_list_t::iterator iter = sPools.begin(); iter != sPools.end(); ++iter)
+	{
+		Pool* pool = *iter;
+		LLSD& entry = pools[pool->getName()];
+		entry["usage"] = (F64)pool->mUsage;
+		entry["peak"] = (F64)pool->mPeak;
+		entry["limit"] = (F64)pool->mLimit;
+		entry["trimmed"] = (F64)pool->mTrimmed;
+		entry["trim_count"] = (S32)pool->mTrimCount;
+		entry["trimming"] = pool->mTrimming;
+	}
+	return stats;
+}
+
+//static
+void LLMemoryBudget::dump()
+{
+	llinfos << llformat("Memory budget: %.1f MB used of %.1f MB", sTotalUsage / BYTES_PER_MB, sBudget / BYTES_PER_MB) << llendl;
+	for (pool_list_t::iterator iter = sPools.begin(); iter != sPools.end(); ++iter)
+	{
+		Pool* pool = *iter;
+		llinfos << llformat("  %-16s %8.1f MB (peak %.1f MB) trimmed %.1f MB in %u calls%s",
+							pool->getName().c_str(), pool->mUsage / BYTES_PER_MB, pool->mPeak / BYTES_PER_MB,
+							pool->mTrimmed / BYTES_PER_MB, pool->mTrimCount,
+							pool->mTrimming ? " [trimming]" : "") << llendl;
+	}
+}
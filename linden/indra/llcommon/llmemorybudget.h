@@ -0,0 +1,123 @@
+/** 
+ * @file llmemorybudget.h
+ * @brief Process wide memory budget shared by the caches of the viewer
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMEMORYBUDGET_H
+#define LL_LLMEMORYBUDGET_H
+
+#include <string>
+#include <vector>
+
+#include "llsd.h"
+#include "lltimer.h"
+
+// One budget for the memory held by the subsystems that cache things on
+// their own terms (textures, vertex buffers, object caches...), so that
+// together they do not over-commit a 32 bit or low RAM machine.
+//
+// Each subsystem registers a Pool that reports the bytes it holds and can
+// be asked to give some back. update() polls the pools, and when the total
+// goes over the budget asks each of them, in order of increasing priority,
+// to trim its share of the excess (in proportion to its usage), once per
+// stretch over the budget. Pools can also have a limit of their own.
+// MAIN THREAD only.
+class LL_COMMON_API LLMemoryBudget
+{
+public:
+	class LL_COMMON_API Pool
+	{
+	public:
+		// Pools with a lower priority are asked to trim first
+		Pool(const std::string& name, S32 priority);
+		virtual ~Pool();
+
+		// Bytes held right now
+		virtual S64 getUsage() = 0;
+		// Release about bytes, returns what was actually released. Pools
+		// that can only act over the next frames (e.g. by raising a
+		// discard bias) return 0 and keep doing so until relax().
+		virtual S64 trim(S64 bytes) = 0;
+		// Usage is back well under the budget, undo whatever trim() set up
+		virtual void relax() {}
+
+		const std::string& getName() const { return mName; }
+		S32 getPriority() const { return mPriority; }
+		void setLimit(S64 bytes) { mLimit = bytes; } // 0 = only the total budget
+		S64 getLimit() const { return mLimit; }
+		S64 getLastUsage() const { return mUsage; } // as of the last update()
+		bool isTrimming() const { return mTrimming; }
+
+	private:
+		friend class LLMemoryBudget;
+		std::string mName;
+		S32 mPriority;
+		S64 mLimit;
+		S64 mUsage;
+		S64 mPeak;
+		S64 mTrimmed; // total released by trim()
+		S64 mTrimmedTo; // usage right after the last over budget trim()
+		U32 mTrimCount;
+		bool mTrimming;
+	};
+
+	static void setBudget(S64 bytes); // 0 = unlimited
+	static S64 getBudget() { return sBudget; }
+	static S64 getTotalUsage() { return sTotalUsage; }
+	static bool isOverBudget() { return sBudget > 0 && sTotalUsage > sBudget; }
+
+	// Polls the pools and applies pressure, at most every UPDATE_INTERVAL
+	// seconds unless force is set
+	static void update(bool force = false);
+
+	// { "budget", "total", "pools": { "<name>": { "usage", "peak", "limit",
+	//   "trimmed", "trim_count", "trimming" } } }, byte counts as reals
+	static LLSD getStats();
+	static void dump();
+
+	static const F32 UPDATE_INTERVAL;
+	// Trimming aims for TRIM_TARGET of the budget, pools relax once usage
+	// drops under RELAX_FRACTION of it
+	static const F32 TRIM_TARGET;
+	static const F32 RELAX_FRACTION;
+
+private:
+	static void addPool(Pool* pool);
+	static void removePool(Pool* pool);
+	static S64 trimPool(Pool* pool, S64 bytes);
+
+	typedef std::vector<Pool*> pool_list_t; // sorted by priority
+	static pool_list_t sPools;
+	static S64 sBudget;
+	static S64 sTotalUsage;
+	static LLTimer sUpdateTimer;
+};
+
+#endif // LL_LLMEMORYBUDGET_H
@@ -32,6 +32,7 @@
 #include "linden_common.h"
 #include "llqueuedthread.h"
 #include "llstl.h"
+#include "llthreadpool.h"
 #include "lltimer.h"
 
 //============================================================================
@@ -40,7 +41,10 @@
 LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded) :
 	LLThread(name),
 	mThreaded(threaded),
+	mThreadPool(NULL),
 	mIdleThread(TRUE),
+	mIncoming(NULL),
+	mPending(0),
 	mNextHandle(0)
 {
 	if (mThreaded)
@@ -61,7 +65,15 @@ void LLQueuedThread::shutdown()
 	setQuitting();
 
 	unpause(); // MAIN THREAD
-	if (mThreaded)
+	if (mThreadPool)
+	{
+		// Once removed no pool thread is inside processNextRequest()
+		mThreadPool->removeQueue(this);
+		mThreadPool = NULL;
+		endThread();
+		mStatus = STOPPED;
+	}
+	else if (mThreaded)
 	{
 		S32 timeout = 100;
 		for ( ; timeout>0; timeout--)
@@ -93,6 +105,12 @@ void LLQueuedThread::shutdown()
 		}
 		req->deleteRequest();
 	}
+	// Everything in the queue was also in the hash
+	mQueueMutex.lock();
+	takeIncoming();
+	mRequestQueue.clear();
+	mPending = 0;
+	mQueueMutex.unlock();
 	if (active_count)
 	{
 		llwarns << "~LLQueuedThread() called with active requests: " << active_count << llendl;
@@ -119,6 +137,10 @@ S32 LLQueuedThread::updateQueue(U32 max_time_ms)
 	{
 		pending = getPending();
 		unpause();
+		if (mThreadPool && pending > 0)
+		{
+			mThreadPool->wake();
+		}
 	}
 	else
 	{
@@ -137,7 +159,11 @@ void LLQueuedThread::incQueue()
 	// Something has been added to the queue
 	if (!isPaused())
 	{
-		if (mThreaded)
+		if (mThreadPool)
+		{
+			mThreadPool->wake();
+		}
+		else if (mThreaded)
 		{
 			wake(); // Wake the thread up if necessary.
 		}
@@ -148,11 +174,7 @@ void LLQueuedThread::incQueue()
 // May be called from any thread
 S32 LLQueuedThread::getPending()
 {
-	S32 res;
-	lockData();
-	res = mRequestQueue.size();
-	unlockData();
-	return res;
+	return mPending;
 }
 
 // MAIN thread
@@ -177,7 +199,8 @@ void LLQueuedThread::waitOnPending()
 // MAIN thread
 void LLQueuedThread::printQueueStats()
 {
-	lockData();
+	mQueueMutex.lock();
+	drainIncoming();
 	if (!mRequestQueue.empty())
 	{
 		QueuedRequest *req = *mRequestQueue.begin();
@@ -187,7 +210,7 @@ void LLQueuedThread::printQueueStats()
 	{
 		llinfos << "Queued Thread Idle" << llendl;
 	}
-	unlockData();
+	mQueueMutex.unlock();
 }
 
 // MAIN thread
@@ -213,8 +236,8 @@ bool LLQueuedThread::addRequest(QueuedRequest* req)
 	
 	lockData();
 	req->setStatus(STATUS_QUEUED);
-	mRequestQueue.insert(req);
 	mRequestHash.insert(req);
+	pushRequest(req);
 #if _DEBUG
 // 	llinfos << llformat("LLQueuedThread::Added req [%08d]",handle) << llendl;
 #endif
@@ -321,19 +344,50 @@ void LLQueuedThread::setPriority(handle_t handle, U32 priority)
 	QueuedRequest* req = (QueuedRequest*)mRequestHash.find(handle);
 	if (req)
 	{
-		if(req->getStatus() == STATUS_INPROGRESS)
+		mQueueMutex.lock();
+		drainIncoming();
+		if (req->mInQueue)
 		{
-			// not in list
+			// remove from list then re-insert
+			llverify(mRequestQueue.erase(req) == 1);
 			req->setPriority(priority);
+			mRequestQueue.insert(req);
 		}
-		else if(req->getStatus() == STATUS_QUEUED)
+		else if (req->getStatus() == STATUS_QUEUED || req->getStatus() == STATUS_INPROGRESS)
 		{
-			// remove from list then re-insert
-			llverify(mRequestQueue.erase(req) == 1);
+			// not in list (being processed, or just popped)
 			req->setPriority(priority);
+		}
+		mQueueMutex.unlock();
+	}
+	unlockData();
+}
+
+void LLQueuedThread::setPriorities(const priority_list_t& priorities)
+{
+	lockData();
+	mQueueMutex.lock();
+	drainIncoming();
+	for (priority_list_t::const_iterator iter = priorities.begin();
+		 iter != priorities.end(); ++iter)
+	{
+		QueuedRequest* req = (QueuedRequest*)mRequestHash.find(iter->first);
+		if (!req || req->getPriority() == iter->second)
+		{
+			continue;
+		}
+		if (req->mInQueue)
+		{
+			llverify(mRequestQueue.erase(req) == 1);
+			req->setPriority(iter->second);
 			mRequestQueue.insert(req);
 		}
+		else if (req->getStatus() == STATUS_QUEUED || req->getStatus() == STATUS_INPROGRESS)
+		{
+			req->setPriority(iter->second);
+		}
 	}
+	mQueueMutex.unlock();
 	unlockData();
 }
 
@@ -351,7 +405,7 @@ bool LLQueuedThread::completeRequest(handle_t handle)
 #endif
 		//re insert to the queue to schedule for a delete later
 		req->setStatus(STATUS_DELETE);
-		mRequestQueue.insert(req);
+		pushRequest(req);
 		res = true;
 	}
 	unlockData();
@@ -385,26 +439,26 @@ S32 LLQueuedThread::processNextRequest()
 {
 	QueuedRequest *req;
 	// Get next request from pool
-	lockData();
 	while(1)
 	{
-		req = NULL;
-		if (mRequestQueue.empty())
+		req = popRequest();
+		if (!req)
 		{
 			break;
 		}
-		req = *mRequestQueue.begin();
-		mRequestQueue.erase(mRequestQueue.begin());
 
 		if(req->getStatus() == STATUS_DELETE)
 		{
-				mRequestHash.erase(req);
-				req->deleteRequest();
-				continue;
+			lockData();
+			mRequestHash.erase(req);
+			req->deleteRequest();
+			unlockData();
+			continue;
 		}
 
 		if ((req->getFlags() & FLAG_ABORT) || (mStatus == QUITTING))
 		{
+			lockData();
 			req->setStatus(STATUS_ABORTED);
 			req->finishRequest(false);
 			if ((req->getFlags() & FLAG_AUTO_COMPLETE))
@@ -413,6 +467,7 @@ S32 LLQueuedThread::processNextRequest()
 				req->deleteRequest();
 // 				check();
 			}
+			unlockData();
 			continue;
 		}
 		llassert_always(req->getStatus() == STATUS_QUEUED);
@@ -422,7 +477,6 @@ S32 LLQueuedThread::processNextRequest()
 	{
 		req->setStatus(STATUS_INPROGRESS);
 	}
-	unlockData();
 
 	// This is the only place we will call req->setStatus() after
 	// it has initially been seet to STATUS_QUEUED, so it is
@@ -450,10 +504,11 @@ S32 LLQueuedThread::processNextRequest()
 		}
 		else
 		{
+			// read the priority before the request becomes visible to other threads
+			U32 priority = req->getPriority();
 			lockData();
 			req->setStatus(STATUS_QUEUED);
-			mRequestQueue.insert(req);
-			U32 priority = req->getPriority();
+			pushRequest(req);
 			unlockData();
 			if (priority < PRIORITY_NORMAL)
 			{
@@ -467,11 +522,109 @@ S32 LLQueuedThread::processNextRequest()
 	return pending;
 }
 
+// Lock free: producers only contend on a single compare and swap
+void LLQueuedThread::pushRequest(QueuedRequest* req)
+{
+	mPending++;
+	void* head;
+	do
+	{
+		head = (void*)mIncoming;
+		req->mNextIncoming = (QueuedRequest*)head;
+	}
+	while (apr_atomic_casptr(&mIncoming, req, head) != head);
+}
+
+// Detaches the whole incoming stack. apr_atomic_xchgptr() needs APR 1.3,
+// so the exchange is a compare and swap loop like pushRequest().
+LLQueuedThread::QueuedRequest* LLQueuedThread::takeIncoming()
+{
+	void* head;
+	do
+	{
+		head = (void*)mIncoming;
+	}
+	while (head && apr_atomic_casptr(&mIncoming, NULL, head) != head);
+	return (QueuedRequest*)head;
+}
+
+// mQueueMutex must be locked
+void LLQueuedThread::drainIncoming()
+{
+	// Taking the whole stack at once means popped nodes are never reused
+	// by a concurrent push, so there is no ABA problem.
+	QueuedRequest* req = takeIncoming();
+	while (req)
+	{
+		QueuedRequest* next = req->mNextIncoming;
+		req->mNextIncoming = NULL;
+		req->mInQueue = true;
+		mRequestQueue.insert(req);
+		req = next;
+	}
+}
+
+// Removes and returns the highest priority request, or NULL if there is none
+LLQueuedThread::QueuedRequest* LLQueuedThread::popRequest()
+{
+	QueuedRequest* req = NULL;
+	mQueueMutex.lock();
+	drainIncoming();
+	if (!mRequestQueue.empty())
+	{
+		req = *mRequestQueue.begin();
+		mRequestQueue.erase(mRequestQueue.begin());
+		req->mInQueue = false;
+		mPending--;
+	}
+	mQueueMutex.unlock();
+	return req;
+}
+
+// MAIN THREAD
+void LLQueuedThread::attachThreadPool(LLThreadPool* pool)
+{
+	llassert_always(!mThreaded && !mThreadPool);
+	mThreadPool = pool;
+	mThreaded = TRUE;
+	mStatus = RUNNING;
+	// Pooled queues are started (and ended in shutdown()) on the thread
+	// that attaches them, there is no single thread they belong to.
+	startThread();
+}
+
+// Called by pool threads to pick the queue to service next
+bool LLQueuedThread::getNextPriority(U32& priority)
+{
+	if (mPending == 0)
+	{
+		return false;
+	}
+	bool res = false;
+	mQueueMutex.lock();
+	drainIncoming();
+	if (!mRequestQueue.empty())
+	{
+		priority = (*mRequestQueue.begin())->getPriority();
+		res = true;
+	}
+	mQueueMutex.unlock();
+	return res;
+}
+
+// POOL THREAD
+// One iteration of run()
+S32 LLQueuedThread::processPooled()
+{
+	threadedUpdate();
+	return processNextRequest();
+}
+
 // virtual
 bool LLQueuedThread::runCondition()
 {
 	// mRunCondition must be locked here
-	if (mRequestQueue.empty() && mIdleThread)
+	if (mPending == 0 && mIdleThread)
 		return false;
 	else
 		return true;
@@ -531,7 +684,9 @@ LLQueuedThread::QueuedRequest::QueuedRequest(LLQueuedThread::handle_t handle, U3
 	LLSimpleHashEntry<LLQueuedThread::handle_t>(handle),
 	mStatus(STATUS_UNKNOWN),
 	mPriority(priority),
-	mFlags(flags)
+	mFlags(flags),
+	mNextIncoming(NULL),
+	mInQueue(false)
 {
 }
 
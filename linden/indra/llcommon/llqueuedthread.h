@@ -37,12 +37,15 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "llapr.h"
 
 #include "llthread.h"
 #include "llsimplehash.h"
 
+class LLThreadPool;
+
 //============================================================================
 // Note: ~LLQueuedThread is O(N) N=# of queued threads, assumed to be small
 //   It is assumed that LLQueuedThreads are rarely created/destroyed.
@@ -137,6 +140,11 @@ public:
 		LLAtomic32<status_t> mStatus;
 		U32 mPriority;
 		U32 mFlags;
+
+	private:
+		// Queue bookkeeping, owned by LLQueuedThread
+		QueuedRequest* mNextIncoming; // link in the lock free incoming stack
+		bool mInQueue; // in mRequestQueue, guarded by mQueueMutex
 	};
 
 protected:
@@ -175,6 +183,23 @@ protected:
 	S32  processNextRequest(void);
 	void incQueue();
 
+private:
+	// Shared pool support. A queue constructed without a thread of its own
+	// can be attached to an LLThreadPool, whose workers then do what run()
+	// would have done; see llthreadpool.h
+	friend class LLThreadPool;
+	void attachThreadPool(LLThreadPool* pool); // called by LLThreadPool::addQueue()
+	bool getNextPriority(U32& priority); // false if nothing is queued
+	S32 processPooled(); // WORKER THREAD
+
+
+	// Lock free push onto the incoming stack; requests are moved into
+	// mRequestQueue by whoever takes mQueueMutex next.
+	void pushRequest(QueuedRequest* req);
+	void drainIncoming(); // mQueueMutex must be locked
+	QueuedRequest* takeIncoming();
+	QueuedRequest* popRequest();
+
 public:
 	bool waitForResult(handle_t handle, bool auto_complete = true);
 
@@ -186,12 +211,16 @@ public:
 
 	S32 getPending();
 	bool getThreaded() { return mThreaded ? true : false; }
+	LLThreadPool* getThreadPool() const { return mThreadPool; }
 
 	// Request accessors
 	status_t getRequestStatus(handle_t handle);
 	void abortRequest(handle_t handle, bool autocomplete);
 	void setFlags(handle_t handle, U32 flags);
 	void setPriority(handle_t handle, U32 priority);
+	// Reprioritizes a batch of requests, taking the locks once
+	typedef std::vector<std::pair<handle_t, U32> > priority_list_t;
+	void setPriorities(const priority_list_t& priorities);
 	bool completeRequest(handle_t handle);
 	// This is public for support classes like LLWorkerThread,
 	// but generally the methods above should be used.
@@ -202,12 +231,20 @@ public:
 	
 protected:
 	BOOL mThreaded;  // if false, run on main thread and do updates during update()
+	LLThreadPool* mThreadPool; // if set, run on the pool's threads instead of our own
 	LLAtomic32<BOOL> mIdleThread; // request queue is empty (or we are quitting) and the thread is idle
 	
+	// Locking: the data lock guards mRequestHash and request status
+	// transitions, mQueueMutex guards mRequestQueue and request priorities.
+	// When both are needed the data lock is taken first. Producers never
+	// take mQueueMutex; they push onto mIncoming instead.
 	typedef std::set<QueuedRequest*, queued_request_less> request_queue_t;
 	request_queue_t mRequestQueue;
+	LLMutex mQueueMutex;
+	volatile void* mIncoming; // QueuedRequest* stack, linked through mNextIncoming
+	LLAtomicS32 mPending; // requests in mRequestQueue or mIncoming
 
-	enum { REQUEST_HASH_SIZE = 512 }; // must be power of 2
+	enum { REQUEST_HASH_SIZE = 4096 }; // must be power of 2, large enough to keep chains short
 	typedef LLSimpleHash<handle_t, REQUEST_HASH_SIZE> request_hash_t;
 	request_hash_t mRequestHash;
 
@@ -52,6 +52,7 @@
 #	include <sys/sysctl.h>
 #	include <sys/utsname.h>
 #	include <stdint.h>
+#	include <unistd.h>
 #elif LL_LINUX
 #	include <errno.h>
 #	include <sys/utsname.h>
@@ -547,6 +548,16 @@ LLCPUInfo::LLCPUInfo()
 	mFamily.assign( info->strFamily );
 	mCPUString = "Unknown";
 
+#if LL_WINDOWS
+	SYSTEM_INFO sys_info;
+	GetSystemInfo(&sys_info);
+	mNumCPUs = (U32)sys_info.dwNumberOfProcessors;
+#else
+	long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	mNumCPUs = num_cpus > 0 ? (U32)num_cpus : 1;
+#endif
+	mNumCPUs = llmax(mNumCPUs, (U32)1);
+
 #if LL_WINDOWS || LL_DARWIN || LL_SOLARIS
 	out << proc.strCPUName;
 	if (200 < mCPUMHz && mCPUMHz < 10000)           // *NOTE: cpu speed is often way wrong, do a sanity check
@@ -624,6 +635,11 @@ F64 LLCPUInfo::getMHz() const
 	return mCPUMHz;
 }
 
+U32 LLCPUInfo::getNumCPUs() const
+{
+	return mNumCPUs;
+}
+
 std::string LLCPUInfo::getCPUString() const
 {
 	return mCPUString;
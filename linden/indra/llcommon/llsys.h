@@ -82,6 +82,8 @@ public:
 	bool hasSSE() const;
 	bool hasSSE2() const;
 	F64 getMHz() const;
+	// Number of logical processors online, at least 1
+	U32 getNumCPUs() const;
 
 	// Family is "AMD Duron" or "Intel Pentium Pro"
 	const std::string& getFamily() const { return mFamily; }
@@ -91,6 +93,7 @@ private:
 	bool mHasSSE2;
 	bool mHasAltivec;
 	F64 mCPUMHz;
+	U32 mNumCPUs;
 	std::string mFamily;
 	std::string mCPUString;
 };
@@ -0,0 +1,279 @@
+/** 
+ * @file llthreadpool.cpp
+ * @brief Shared worker thread pool for LLQueuedThread request queues
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llthreadpool.h"
+#include "llqueuedthread.h"
+#include "llsys.h"
+#include "lltimer.h"
+
+//static
+LLThreadPool* LLThreadPool::sShared = NULL;
+
+//============================================================================
+
+// MAIN THREAD
+LLThreadPool::LLThreadPool(const std::string& name, U32 size)
+	: mName(name),
+	  mNextScan(0),
+	  mQuitting(false),
+	  mProcessedCount(0),
+	  mStolenCount(0)
+{
+	if (size == 0)
+	{
+		size = getDefaultSize();
+	}
+	size = llclamp(size, (U32)1, (U32)MAX_WORKERS);
+	for (U32 i = 0; i < size; ++i)
+	{
+		Worker* worker = new Worker(this, i, llformat("%s %d", name.c_str(), i));
+		mWorkers.push_back(worker);
+		worker->start();
+	}
+	llinfos << "Thread pool " << mName << " started with " << size << " thread(s)" << llendl;
+}
+
+// MAIN THREAD
+LLThreadPool::~LLThreadPool()
+{
+	mCondition.lock();
+	if (!mQueues.empty())
+	{
+		llwarns << "Thread pool " << mName << " destroyed with " << mQueues.size() << " queue(s) attached" << llendl;
+	}
+	mQuitting = true;
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	// LLThread::shutdown() waits for a running thread to exit its run loop
+	for (worker_list_t::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		delete *iter;
+	}
+	mWorkers.clear();
+}
+
+//static
+U32 LLThreadPool::getDefaultSize()
+{
+	U32 cpus = gSysCPU.getNumCPUs();
+	return llmax((U32)2, cpus > 1 ? cpus - 1 : 1);
+}
+
+//static
+void LLThreadPool::initClass(U32 size)
+{
+	llassert(sShared == NULL);
+	sShared = new LLThreadPool("pool", size);
+}
+
+//static
+void LLThreadPool::cleanupClass()
+{
+	if (sShared)
+	{
+		sShared->logStats();
+		delete sShared;
+		sShared = NULL;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+// MAIN THREAD
+void LLThreadPool::addQueue(LLQueuedThread* queue, U32 affinity, U32 max_workers)
+{
+	queue->attachThreadPool(this);
+
+	QueueEntry entry;
+	entry.mQueue = queue;
+	entry.mAffinity = affinity;
+	entry.mMaxWorkers = max_workers;
+	entry.mActiveWorkers = 0;
+	entry.mRemoving = false;
+
+	mCondition.lock();
+	mQueues.push_back(entry);
+	mCondition.signal(); // in case requests were added before attaching
+	mCondition.unlock();
+}
+
+// MAIN THREAD
+void LLThreadPool::removeQueue(LLQueuedThread* queue)
+{
+	mCondition.lock();
+	queue_list_t::iterator iter;
+	for (iter = mQueues.begin(); iter != mQueues.end(); ++iter)
+	{
+		if (iter->mQueue == queue)
+		{
+			break;
+		}
+	}
+	if (iter == mQueues.end())
+	{
+		mCondition.unlock();
+		llwarns << "Queue is not attached to thread pool " << mName << llendl;
+		return;
+	}
+	// No new claims, then wait for the workers inside the queue to leave it.
+	// Workers sleep on mCondition, so poll rather than wait on it and steal
+	// their wake ups. mQueues is only resized by the main thread, so iter
+	// stays valid.
+	iter->mRemoving = true;
+	while (iter->mActiveWorkers > 0)
+	{
+		mCondition.unlock();
+		ms_sleep(1);
+		mCondition.lock();
+	}
+	mQueues.erase(iter);
+	mCondition.unlock();
+}
+
+// ANY THREAD
+void LLThreadPool::wake()
+{
+	mCondition.lock();
+	mCondition.signal();
+	mCondition.unlock();
+}
+
+void LLThreadPool::logStats()
+{
+	llinfos << llformat("Thread pool %s: %d thread(s), %d requests processed, %d stolen",
+						mName.c_str(), getSize(), (U32)mProcessedCount, (U32)mStolenCount) << llendl;
+}
+
+//----------------------------------------------------------------------------
+
+// WORKER THREAD
+LLQueuedThread* LLThreadPool::claimQueue(U32 index)
+{
+	const U32 mask = index < MAX_WORKERS ? ((U32)1 << index) : 0;
+	mCondition.lock();
+	while (!mQuitting)
+	{
+		// Highest priority request among the queues we have affinity with,
+		// or failing that among all the others.
+		S32 best = -1;
+		bool best_home = false;
+		U32 best_priority = 0;
+		const U32 count = mQueues.size();
+		for (U32 i = 0; i < count; ++i)
+		{
+			const U32 idx = (mNextScan + i) % count;
+			QueueEntry& entry = mQueues[idx];
+			if (entry.mRemoving || entry.mQueue->isPaused() ||
+				(entry.mMaxWorkers && entry.mActiveWorkers >= entry.mMaxWorkers))
+			{
+				continue;
+			}
+			U32 priority;
+			if (!entry.mQueue->getNextPriority(priority))
+			{
+				continue;
+			}
+			const bool home = (entry.mAffinity == AFFINITY_ANY) || (entry.mAffinity & mask);
+			if (best < 0 || (home && !best_home) || (home == best_home && priority > best_priority))
+			{
+				best = (S32)idx;
+				best_home = home;
+				best_priority = priority;
+			}
+		}
+		if (best >= 0)
+		{
+			QueueEntry& entry = mQueues[best];
+			entry.mActiveWorkers++;
+			entry.mQueue->mIdleThread = FALSE;
+			mNextScan = (U32)best + 1;
+			mProcessedCount++;
+			if (!best_home)
+			{
+				mStolenCount++;
+			}
+			mCondition.unlock();
+			return entry.mQueue;
+		}
+		mCondition.wait();
+	}
+	mCondition.unlock();
+	return NULL;
+}
+
+// WORKER THREAD
+void LLThreadPool::releaseQueue(LLQueuedThread* queue)
+{
+	mCondition.lock();
+	for (queue_list_t::iterator iter = mQueues.begin(); iter != mQueues.end(); ++iter)
+	{
+		if (iter->mQueue == queue)
+		{
+			if (--iter->mActiveWorkers == 0 && queue->getPending() == 0)
+			{
+				queue->mIdleThread = TRUE; // for waitOnPending()
+			}
+			break;
+		}
+	}
+	mCondition.unlock();
+}
+
+//============================================================================
+
+LLThreadPool::Worker::Worker(LLThreadPool* pool, U32 index, const std::string& name)
+	: LLThread(name),
+	  mPool(pool),
+	  mIndex(index)
+{
+}
+
+// virtual
+void LLThreadPool::Worker::run()
+{
+	LLQueuedThread* queue;
+	while ((queue = mPool->claimQueue(mIndex)))
+	{
+		mPool->processQueue(queue);
+	}
+	llinfos << "LLThreadPool::Worker " << mName << " EXITING." << llendl;
+}
+
+// WORKER THREAD
+void LLThreadPool::processQueue(LLQueuedThread* queue)
+{
+	queue->processPooled();
+	releaseQueue(queue);
+}
@@ -0,0 +1,158 @@
+/** 
+ * @file llthreadpool.h
+ * @brief Shared worker thread pool for LLQueuedThread request queues
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTHREADPOOL_H
+#define LL_LLTHREADPOOL_H
+
+#include <string>
+#include <vector>
+
+#include "llthread.h"
+
+class LLQueuedThread;
+
+//============================================================================
+// A fixed set of worker threads shared by several LLQueuedThread request
+// queues, so that the subsystems together keep every core busy without each
+// of them spinning up its own thread(s).
+//
+// A queue attached to the pool is serviced one request at a time by
+// whichever worker claims it. Each worker prefers the queues it has affinity
+// with, taking the one whose next request has the highest priority; when
+// none of those has work it steals from the other queues. max_workers limits
+// how many workers may be inside one queue at once; queues whose requests
+// are not safe to run concurrently (or which keep thread affine state, like
+// the curl handles in LLTextureFetch) are attached with max_workers = 1.
+//
+// Usage:
+//   LLTextureCache* cache = new LLTextureCache(false); // not threaded
+//   pool->addQueue(cache, LLThreadPool::AFFINITY_ANY, 1);
+//   ...
+//   cache->shutdown(); // detaches from the pool
+// 
+// Note: this is the same scheduling LLQueuedThread::run() does for a single
+//   queue, so requests see no difference except for the thread they run on.
+
+class LL_COMMON_API LLThreadPool
+{
+public:
+	enum
+	{
+		AFFINITY_ANY = 0, // any worker, no preference
+		MAX_WORKERS = 32  // affinities are a bit mask of worker indices
+	};
+
+	// size is the number of worker threads; 0 sizes the pool for the machine,
+	// see getDefaultSize()
+	LLThreadPool(const std::string& name, U32 size = 0);
+	~LLThreadPool(); // all queues must have been removed
+
+	// One worker per core, leaving a core to the main thread, but never fewer
+	// than two so that a blocking disk read can not stall the other queues.
+	static U32 getDefaultSize();
+
+	// MAIN THREAD
+	// queue must have been constructed without a thread of its own.
+	// affinity is a mask of preferred worker indices (bit i = worker i),
+	// max_workers = 0 does not limit concurrency.
+	void addQueue(LLQueuedThread* queue, U32 affinity = AFFINITY_ANY, U32 max_workers = 1);
+	// Blocks until no worker is processing a request from queue.
+	// Called by LLQueuedThread::shutdown().
+	void removeQueue(LLQueuedThread* queue);
+
+	// ANY THREAD
+	// Something was queued or unpaused, wake up an idle worker
+	void wake();
+
+	U32 getSize() const { return (U32)mWorkers.size(); }
+	const std::string& getName() const { return mName; }
+
+	// Requests processed by workers, and how many of those were taken from
+	// a queue outside of the worker's affinity
+	U32 getProcessedCount() const { return mProcessedCount; }
+	U32 getStolenCount() const { return mStolenCount; }
+	void logStats();
+
+	// The pool shared by the viewer subsystems, NULL if they run their own threads
+	static void initClass(U32 size = 0);
+	static void cleanupClass();
+	static LLThreadPool* getShared() { return sShared; }
+
+private:
+	// No copy constructor or copy assignment
+	LLThreadPool(const LLThreadPool&);
+	LLThreadPool& operator=(const LLThreadPool&);
+
+	class Worker : public LLThread
+	{
+	public:
+		Worker(LLThreadPool* pool, U32 index, const std::string& name);
+	protected:
+		/*virtual*/ void run();
+	private:
+		LLThreadPool* mPool;
+		U32 mIndex;
+	};
+	friend class Worker;
+
+	struct QueueEntry
+	{
+		LLQueuedThread* mQueue;
+		U32 mAffinity;
+		U32 mMaxWorkers;
+		U32 mActiveWorkers;
+		bool mRemoving;
+	};
+	typedef std::vector<QueueEntry> queue_list_t;
+
+	// WORKER THREAD
+	// Blocks until there is a queue to service, returns NULL when quitting
+	LLQueuedThread* claimQueue(U32 index);
+	void releaseQueue(LLQueuedThread* queue);
+	void processQueue(LLQueuedThread* queue); // friendship does not extend to Worker
+
+	std::string mName;
+	typedef std::vector<Worker*> worker_list_t;
+	worker_list_t mWorkers;
+
+	// mCondition guards everything below, workers sleep on it while idle
+	LLCondition mCondition;
+	queue_list_t mQueues;
+	U32 mNextScan; // rotates the scan start so equal priorities take turns
+	bool mQuitting;
+	LLAtomicU32 mProcessedCount;
+	LLAtomicU32 mStolenCount;
+
+	static LLThreadPool* sShared;
+};
+
+#endif // LL_LLTHREADPOOL_H
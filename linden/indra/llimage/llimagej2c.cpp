@@ -175,7 +175,13 @@ LLImageJ2C::LLImageJ2C() : 	LLImageFormatted(IMG_CODEC_J2C),
 							mRawDiscardLevel(-1),
 							mRate(0.0f),
 							mReversible(FALSE),
-							mAreaUsedForDataSizeCalcs(0)
+							mAreaUsedForDataSizeCalcs(0),
+							mKeepDecodeState(FALSE),
+							mDecodeState(NULL),
+							mDecodeStateDestroyFunc(NULL),
+							mDecodeStateData(NULL),
+							mDecodeStateDataSize(0),
+							mDecodeStateDiscard(-1)
 {
 	//We assume here that if we wanted to create via
 	//a dynamic library that the approriate open calls were made
@@ -215,6 +221,8 @@ LLImageJ2C::~LLImageJ2C()
 		j2cimpl_destroy_func = fallbackDestroyLLImageJ2CImpl;
 	}
 
+	releaseDecodeState();
+
 	if ( mImpl )
 	{
 		j2cimpl_destroy_func(mImpl);
@@ -539,6 +547,51 @@ void LLImageJ2C::updateRawDiscardLevel()
 	mRawDiscardLevel = mMaxBytes ? calcDiscardLevelBytes(mMaxBytes) : mDiscardLevel;
 }
 
+void LLImageJ2C::setKeepDecodeState(BOOL keep)
+{
+	mKeepDecodeState = keep;
+	if (!keep)
+	{
+		releaseDecodeState();
+	}
+}
+
+void LLImageJ2C::setDecodeState(void* state, decode_state_destroy_func_t destroy_func, S8 discard)
+{
+	if (state != mDecodeState)
+	{
+		releaseDecodeState();
+	}
+	mDecodeState = state;
+	mDecodeStateDestroyFunc = destroy_func;
+	mDecodeStateData = getData();
+	mDecodeStateDataSize = getDataSize();
+	mDecodeStateDiscard = discard;
+}
+
+void* LLImageJ2C::getDecodeState(S8 discard) const
+{
+	if (mDecodeState && mDecodeStateDiscard == discard
+		&& mDecodeStateData == getData() && mDecodeStateDataSize == getDataSize())
+	{
+		return mDecodeState;
+	}
+	return NULL;
+}
+
+void LLImageJ2C::releaseDecodeState()
+{
+	if (mDecodeState && mDecodeStateDestroyFunc)
+	{
+		mDecodeStateDestroyFunc(mDecodeState);
+	}
+	mDecodeState = NULL;
+	mDecodeStateDestroyFunc = NULL;
+	mDecodeStateData = NULL;
+	mDecodeStateDataSize = 0;
+	mDecodeStateDiscard = -1;
+}
+
 LLImageJ2CImpl::~LLImageJ2CImpl()
 {
 }
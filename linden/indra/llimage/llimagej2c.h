@@ -78,6 +78,16 @@ public:
 	static void openDSO();
 	static void closeDSO();
 	static std::string getEngineInfo();
+
+	// While set, the decoder keeps its intermediate state after a decode so
+	// that another decode of the same data at the same discard level (e.g.
+	// the aux channel after the color channels) skips the codestream
+	// decode. Clearing it releases the state. The state is dropped as soon
+	// as the data or the discard level changes: a texture sharpening to a
+	// lower discard level as more data arrives is still decoded from
+	// scratch, since OpenJPEG cannot resume a decode.
+	void setKeepDecodeState(BOOL keep);
+	BOOL getKeepDecodeState() const { return mKeepDecodeState; }
 	
 protected:
 	friend class LLImageJ2CImpl;
@@ -86,6 +96,14 @@ protected:
 	void decodeFailed();
 	void updateRawDiscardLevel();
 
+	// Decoder state is opaque to LLImageJ2C; the impl hands over ownership
+	// along with the function that frees it. getDecodeState() returns NULL
+	// unless the state was made from the current data at discard level.
+	typedef void (*decode_state_destroy_func_t)(void* state);
+	void setDecodeState(void* state, decode_state_destroy_func_t destroy_func, S8 discard);
+	void* getDecodeState(S8 discard) const;
+	void releaseDecodeState();
+
 	S32 mMaxBytes; // Maximum number of bytes of data to use...
 	
 	S32 mDataSizes[MAX_DISCARD_LEVEL+1];		// Size of data required to reach a given level
@@ -96,6 +114,14 @@ protected:
 	BOOL mReversible;
 	LLImageJ2CImpl *mImpl;
 	std::string mLastError;
+
+	// Added at the end so the layout seen by an optional decoder DSO is unchanged
+	BOOL mKeepDecodeState;
+	void* mDecodeState;
+	decode_state_destroy_func_t mDecodeStateDestroyFunc;
+	const U8* mDecodeStateData;
+	S32 mDecodeStateDataSize;
+	S8 mDecodeStateDiscard;
 };
 
 // Derive from this class to implement JPEG2000 decoding
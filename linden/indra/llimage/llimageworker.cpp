@@ -34,13 +34,67 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "llimagej2c.h"
+#include "llsys.h"
+#include "llthreadpool.h"
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, U32 pool_size)
+	: LLQueuedThread("imagedecode", threaded),
+	  mPoolQuitting(false),
+	  mDecodedPixels(0.0),
+	  mDecodeTime(0.0),
+	  mBusyTime(0.0)
 {
+	if (threaded)
+	{
+		if (pool_size == 0)
+		{
+			pool_size = gSysCPU.getNumCPUs();
+		}
+		for (U32 i = 1; i < pool_size; ++i)
+		{
+			PoolThread* thread = new PoolThread(this, llformat("imagedecode %d", i));
+			mPool.push_back(thread);
+			thread->start();
+		}
+		llinfos << "Image decode pool started with " << getPoolSize() << " thread(s)" << llendl;
+	}
+}
+
+// MAIN THREAD
+LLImageDecodeThread::~LLImageDecodeThread()
+{
+	shutdown();
+}
+
+// MAIN THREAD
+// virtual
+void LLImageDecodeThread::shutdown()
+{
+	if (getThreadPool())
+	{
+		logStats();
+	}
+	else if (!mPool.empty())
+	{
+		mPoolCondition.lock();
+		mPoolQuitting = true;
+		mPoolCondition.broadcast();
+		mPoolCondition.unlock();
+
+		// LLThread::shutdown() waits for a running thread to exit its run loop
+		for (pool_list_t::iterator iter = mPool.begin(); iter != mPool.end(); ++iter)
+		{
+			delete *iter;
+		}
+		mPool.clear();
+
+		logStats();
+	}
+	LLQueuedThread::shutdown();
 }
 
 // MAIN THREAD
@@ -54,7 +108,7 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 		creation_info& info = *iter;
 		ImageRequest* req = new ImageRequest(info.handle, info.image,
 						     info.priority, info.discard, info.needs_aux,
-						     info.responder);
+						     info.responder, this);
 
 		bool res = addRequest(req);
 		if (!res)
@@ -64,9 +118,93 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 	}
 	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
+
+	F64 elapsed = mBusyTimer.getElapsedTimeAndResetF64();
+	if (res > 0)
+	{
+		// Time spent with work pending counts towards the throughput figure
+		LLMutexLock stats_lock(&mStatsMutex);
+		mBusyTime += elapsed;
+	}
+	if (res > 0 && !mPool.empty())
+	{
+		mPoolCondition.lock();
+		mPoolCondition.broadcast();
+		mPoolCondition.unlock();
+	}
 	return res;
 }
 
+// POOL THREAD
+bool LLImageDecodeThread::waitForWork()
+{
+	mPoolCondition.lock();
+	while (!mPoolQuitting && (isPaused() || getPending() == 0))
+	{
+		mPoolCondition.wait();
+	}
+	bool quitting = mPoolQuitting;
+	mPoolCondition.unlock();
+	return !quitting;
+}
+
+U32 LLImageDecodeThread::getPoolSize() const
+{
+	LLThreadPool* pool = getThreadPool();
+	return pool ? pool->getSize() : (U32)mPool.size() + 1;
+}
+
+// ANY THREAD
+void LLImageDecodeThread::addDecodeStats(U32 pixels, F64 decode_time)
+{
+	LLMutexLock lock(&mStatsMutex);
+	mDecodedPixels += (F64)pixels;
+	mDecodeTime += decode_time;
+}
+
+F64 LLImageDecodeThread::getDecodedMegapixels()
+{
+	LLMutexLock lock(&mStatsMutex);
+	return mDecodedPixels / 1000000.0;
+}
+
+F64 LLImageDecodeThread::getMegapixelsPerSecond()
+{
+	LLMutexLock lock(&mStatsMutex);
+	return mBusyTime > 0.0 ? mDecodedPixels / 1000000.0 / mBusyTime : 0.0;
+}
+
+void LLImageDecodeThread::logStats()
+{
+	F64 megapixels = getDecodedMegapixels();
+	F64 rate = getMegapixelsPerSecond();
+	F64 decode_time;
+	{
+		LLMutexLock lock(&mStatsMutex);
+		decode_time = mDecodeTime;
+	}
+	llinfos << llformat("Image decode: %d thread(s), %.1f MP decoded, %.2f MP/s, %.1f s decode time",
+						getPoolSize(), megapixels, rate, decode_time) << llendl;
+}
+
+//----------------------------------------------------------------------------
+
+LLImageDecodeThread::PoolThread::PoolThread(LLImageDecodeThread* decode_thread, const std::string& name)
+	: LLThread(name),
+	  mDecodeThread(decode_thread)
+{
+}
+
+// virtual
+void LLImageDecodeThread::PoolThread::run()
+{
+	while (mDecodeThread->waitForWork())
+	{
+		mDecodeThread->processNextRequest();
+	}
+	llinfos << "LLImageDecodeThread::PoolThread " << mName << " EXITING." << llendl;
+}
+
 LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(LLImageFormatted* image, 
 	U32 priority, S32 discard, BOOL needs_aux, Responder* responder)
 {
@@ -93,14 +231,17 @@ LLImageDecodeThread::Responder::~Responder()
 
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
-												LLImageDecodeThread::Responder* responder)
+												LLImageDecodeThread::Responder* responder,
+												LLImageDecodeThread* decode_thread)
 	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
 	  mFormattedImage(image),
 	  mDiscardLevel(discard),
 	  mNeedsAux(needs_aux),
 	  mDecodedRaw(FALSE),
 	  mDecodedAux(FALSE),
-	  mResponder(responder)
+	  mResponder(responder),
+	  mDecodeThread(decode_thread),
+	  mDecodeTime(0.0)
 {
 }
 
@@ -118,6 +259,7 @@ LLImageDecodeThread::ImageRequest::~ImageRequest()
 bool LLImageDecodeThread::ImageRequest::processRequest()
 {
 	const F32 decode_time_slice = .1f;
+	LLTimer decode_timer;
 	bool done = true;
 	if (!mDecodedRaw && mFormattedImage.notNull())
 	{
@@ -137,6 +279,11 @@ bool LLImageDecodeThread::ImageRequest::processRequest()
 			{
 				mFormattedImage->setDiscardLevel(mDiscardLevel);
 			}
+			if (mNeedsAux && mFormattedImage->getCodec() == IMG_CODEC_J2C)
+			{
+				// Let the aux pass reuse the codestream decode of the color pass
+				((LLImageJ2C*)mFormattedImage.get())->setKeepDecodeState(TRUE);
+			}
 			mDecodedImageRaw = new LLImageRaw(mFormattedImage->getWidth(),
 											  mFormattedImage->getHeight(),
 											  mFormattedImage->getComponents());
@@ -157,11 +304,20 @@ bool LLImageDecodeThread::ImageRequest::processRequest()
 		mDecodedAux = done;
 	}
 
+	mDecodeTime += decode_timer.getElapsedTimeF64();
+	if (done && mDecodeThread && mDecodedRaw && mDecodedImageRaw.notNull())
+	{
+		mDecodeThread->addDecodeStats(mDecodedImageRaw->getWidth() * mDecodedImageRaw->getHeight(), mDecodeTime);
+	}
 	return done;
 }
 
 void LLImageDecodeThread::ImageRequest::finishRequest(bool completed)
 {
+	if (mNeedsAux && mFormattedImage.notNull() && mFormattedImage->getCodec() == IMG_CODEC_J2C)
+	{
+		((LLImageJ2C*)mFormattedImage.get())->setKeepDecodeState(FALSE);
+	}
 	if (mResponder.notNull())
 	{
 		bool success = completed && mDecodedRaw && mDecodedImageRaw->getDataSize() && (!mNeedsAux || mDecodedAux);
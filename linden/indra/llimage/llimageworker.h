@@ -33,7 +33,10 @@
 #ifndef LL_LLIMAGEWORKER_H
 #define LL_LLIMAGEWORKER_H
 
+#include <vector>
+
 #include "llimage.h"
+#include "lltimer.h"
 #include "llworkerthread.h"
 
 class LLImageDecodeThread : public LLQueuedThread
@@ -55,7 +58,8 @@ public:
 	public:
 		ImageRequest(handle_t handle, LLImageFormatted* image,
 					 U32 priority, S32 discard, BOOL needs_aux,
-					 LLImageDecodeThread::Responder* responder);
+					 LLImageDecodeThread::Responder* responder,
+					 LLImageDecodeThread* decode_thread = NULL);
 
 		/*virtual*/ bool processRequest();
 		/*virtual*/ void finishRequest(bool completed);
@@ -74,19 +78,61 @@ public:
 		BOOL mDecodedRaw;
 		BOOL mDecodedAux;
 		LLPointer<LLImageDecodeThread::Responder> mResponder;
+		LLImageDecodeThread* mDecodeThread; // for throughput stats, may be NULL
+		F64 mDecodeTime;
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// pool_size is the total number of threads pulling from the decode
+	// queue; 0 uses one per CPU core. Ignored when not threaded, which is
+	// also how to construct it for use with a shared LLThreadPool.
+	LLImageDecodeThread(bool threaded = true, U32 pool_size = 1);
+	~LLImageDecodeThread();
+	/*virtual*/ void shutdown();
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
 						 Responder* responder);
 	S32 update(U32 max_time_ms);
 
+	U32 getPoolSize() const;
+	// Decode throughput, measured against wall clock time spent with work
+	// pending so that it scales with the pool size.
+	F64 getDecodedMegapixels();
+	F64 getMegapixelsPerSecond();
+	void logStats();
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
 	
 private:
+	// Additional decode threads. They pull requests from the same queue as
+	// the main decode thread and sleep on mPoolCondition while it is empty.
+	class PoolThread : public LLThread
+	{
+	public:
+		PoolThread(LLImageDecodeThread* decode_thread, const std::string& name);
+	protected:
+		/*virtual*/ void run();
+	private:
+		LLImageDecodeThread* mDecodeThread;
+	};
+	friend class PoolThread;
+	friend class ImageRequest;
+
+	bool waitForWork(); // called by pool threads, returns false when quitting
+	void addDecodeStats(U32 pixels, F64 decode_time);
+
+	typedef std::vector<PoolThread*> pool_list_t;
+	pool_list_t mPool;
+	LLCondition mPoolCondition;
+	bool mPoolQuitting;
+
+	LLMutex mStatsMutex;
+	F64 mDecodedPixels;
+	F64 mDecodeTime;
+	F64 mBusyTime;
+	LLTimer mBusyTimer;
+
 	struct creation_info
 	{
 		handle_t handle;
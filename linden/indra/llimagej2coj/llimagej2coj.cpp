@@ -108,6 +108,12 @@ LLImageJ2COJ::~LLImageJ2COJ()
 }
 
 
+// Frees an image kept by LLImageJ2C between decodes
+static void destroy_decode_state(void* state)
+{
+	opj_image_destroy((opj_image_t*)state);
+}
+
 BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decode_time, S32 first_channel, S32 max_channel_count)
 {
 	//
@@ -116,53 +122,19 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 
 	LLTimer decode_timer;
 
-	opj_dparameters_t parameters;	/* decompression parameters */
-	opj_event_mgr_t event_mgr;		/* event manager */
-	opj_image_t *image = NULL;
-
-	opj_dinfo_t* dinfo = NULL;	/* handle to a decompressor */
-	opj_cio_t *cio = NULL;
-
-
-	/* configure the event callbacks (not required) */
-	memset(&event_mgr, 0, sizeof(opj_event_mgr_t));
-	event_mgr.error_handler = error_callback;
-	event_mgr.warning_handler = warning_callback;
-	event_mgr.info_handler = info_callback;
-
-	/* set decoding parameters to default values */
-	opj_set_default_decoder_parameters(&parameters);
-
-	parameters.cp_reduce = base.getRawDiscardLevel();
-
-	/* decode the code-stream */
-	/* ---------------------- */
-
-	/* JPEG-2000 codestream */
-
-	/* get a decoder handle */
-	dinfo = opj_create_decompress(CODEC_J2K);
-
-	/* catch events using our callbacks and give a local context */
-	opj_set_event_mgr((opj_common_ptr)dinfo, &event_mgr, stderr);			
-
-	/* setup the decoder decoding parameters using user parameters */
-	opj_setup_decoder(dinfo, &parameters);
-
-	/* open a byte stream */
-	cio = opj_cio_open((opj_common_ptr)dinfo, base.getData(), base.getDataSize());
-
-	/* decode the stream and fill the image structure */
-	image = opj_decode(dinfo, cio);
-
-	/* close the byte stream */
-	opj_cio_close(cio);
-
-	/* free remaining structures */
-	if(dinfo)
+	// Reuse the image from the previous pass if the data and discard level
+	// are unchanged, e.g. when extracting the aux channel
+	opj_image_t *image = (opj_image_t*)base.getDecodeState(base.getRawDiscardLevel());
+	if (!image)
 	{
-		opj_destroy_decompress(dinfo);
+		image = decodeCodestream(base);
+		if (image && base.getKeepDecodeState())
+		{
+			base.setDecodeState(image, destroy_decode_state, base.getRawDiscardLevel());
+		}
 	}
+	// Kept images are owned (and destroyed) by base
+	bool owned = image && !base.getDecodeState(base.getRawDiscardLevel());
 
 	// The image decode failed if the return was NULL or the component
 	// count was zero.  The latter is just a sanity check before we
@@ -179,11 +151,7 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	if( !img_components ) // < 1 ||img_components > 4 )
 	{
 		LL_DEBUGS("Openjpeg") << "ERROR -> decodeImpl: failed to decode image wrong number of components: " << img_components << LL_ENDL;
-		if (image)
-		{
-			opj_image_destroy(image);
-		}
-
+		destroyImage(base, image, owned);
 		base.decodeFailed();
 		return TRUE; // done
 	}
@@ -194,8 +162,7 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 		if (image->comps[i].factor != base.getRawDiscardLevel())
 		{
 			// if we didn't get the discard level we're expecting, fail
-			if (image) //anyway somthing odd with the image, better check than crash
-				opj_image_destroy(image);
+			destroyImage(base, image, owned);
 			base.decodeFailed();
 			return TRUE;
 		}
@@ -204,11 +171,7 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	if(img_components <= first_channel)
 	{
 		LL_DEBUGS("Openjpeg") << "trying to decode more channels than are present in image: numcomps: " << img_components << " first_channel: " << first_channel << LL_ENDL;
-		if (image)
-		{
-			opj_image_destroy(image);
-		}
-			
+		destroyImage(base, image, owned);
 		base.decodeFailed();
 		return TRUE;
 	}
@@ -255,15 +218,14 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 		else // Some rare OpenJPEG versions have this bug.
 		{
 			llwarns << "ERROR -> decodeImpl: failed to decode image! (NULL comp data - OpenJPEG bug)" << llendl;
-			opj_image_destroy(image);
-
+			destroyImage(base, image, owned);
 			base.decodeFailed();
 			return TRUE; // done
 		}
 	}
 
 	/* free image data structure */
-	if (image)
+	if (owned)
 	{
 		opj_image_destroy(image);
 	}
@@ -271,6 +233,72 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	return TRUE; // done
 }
 
+opj_image_t* LLImageJ2COJ::decodeCodestream(LLImageJ2C &base)
+{
+	opj_dparameters_t parameters;	/* decompression parameters */
+	opj_event_mgr_t event_mgr;		/* event manager */
+	opj_image_t *image = NULL;
+
+	opj_dinfo_t* dinfo = NULL;	/* handle to a decompressor */
+	opj_cio_t *cio = NULL;
+
+
+	/* configure the event callbacks (not required) */
+	memset(&event_mgr, 0, sizeof(opj_event_mgr_t));
+	event_mgr.error_handler = error_callback;
+	event_mgr.warning_handler = warning_callback;
+	event_mgr.info_handler = info_callback;
+
+	/* set decoding parameters to default values */
+	opj_set_default_decoder_parameters(&parameters);
+
+	parameters.cp_reduce = base.getRawDiscardLevel();
+
+	/* decode the code-stream */
+	/* ---------------------- */
+
+	/* JPEG-2000 codestream */
+
+	/* get a decoder handle */
+	dinfo = opj_create_decompress(CODEC_J2K);
+
+	/* catch events using our callbacks and give a local context */
+	opj_set_event_mgr((opj_common_ptr)dinfo, &event_mgr, stderr);			
+
+	/* setup the decoder decoding parameters using user parameters */
+	opj_setup_decoder(dinfo, &parameters);
+
+	/* open a byte stream */
+	cio = opj_cio_open((opj_common_ptr)dinfo, base.getData(), base.getDataSize());
+
+	/* decode the stream and fill the image structure */
+	image = opj_decode(dinfo, cio);
+
+	/* close the byte stream */
+	opj_cio_close(cio);
+
+	/* free remaining structures */
+	if(dinfo)
+	{
+		opj_destroy_decompress(dinfo);
+	}
+
+	return image;
+}
+
+// Frees an image after a failed decode, wherever it is owned
+void LLImageJ2COJ::destroyImage(LLImageJ2C &base, opj_image_t* image, bool owned)
+{
+	if (owned)
+	{
+		opj_image_destroy(image);
+	}
+	else
+	{
+		base.releaseDecodeState();
+	}
+}
+
 
 BOOL LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, const char* comment_text, F32 encode_time, BOOL reversible)
 {
@@ -35,6 +35,8 @@
 
 #include "llimagej2c.h"
 
+typedef struct opj_image opj_image_t;
+
 class LLImageJ2COJ : public LLImageJ2CImpl
 {	
 public:
@@ -46,6 +48,9 @@ protected:
 	/*virtual*/ BOOL decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decode_time, S32 first_channel, S32 max_channel_count);
 	/*virtual*/ BOOL encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, const char* comment_text, F32 encode_time=0.0,
 								BOOL reversible = FALSE);
+	// Runs the decoder over the whole codestream at the raw discard level of base
+	opj_image_t* decodeCodestream(LLImageJ2C &base);
+	void destroyImage(LLImageJ2C &base, opj_image_t* image, bool owned);
 	int ceildivpow2(int a, int b)
 	{
 		// Divide a by b to the power of 2 and round upwards.
@@ -160,6 +160,8 @@ public:
 	}
 
 	const LLPlane& getWorldPlane(S32 index) const	{ return mWorldPlanes[index]; }
+	const LLPlane& getAgentPlane(U32 index) const	{ return mAgentPlanes[index].p; }
+	U32 getPlaneCount() const						{ return mPlaneCount; }
 	const LLVector3& getWorldPlanePos() const		{ return mWorldPlanePos; }
 	
 	// Copy mView, mAspect, mNearPlane, and mFarPlane to buffer.
@@ -0,0 +1,509 @@
+/**
+ * @file llocclusionbuffer.cpp
+ * @brief Software depth buffer for CPU occlusion culling
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llocclusionbuffer.h"
+
+#include <algorithm>
+
+#include "llcamera.h"
+#include "llmath.h"
+
+// Most vertices a polygon may have, and that clipping can add to one
+static const U32 MAX_POLYGON_VERTS = 16;
+static const U32 MAX_CLIP_VERTS = 5;
+static const U32 MAX_OUTLINE_VERTS = 3 * (4 + MAX_CLIP_VERTS);
+
+// Polygons are clipped to a frustum this many times wider than the camera's,
+// which keeps screen coordinates small without clipping most of them at all
+static const F32 GUARD_BAND = 2.f;
+
+LLOcclusionBuffer::LLOcclusionBuffer()
+:	mWidth(0),
+	mHeight(0),
+	mOccluderCount(0),
+	mNear(0.f),
+	mTanX(0.f),
+	mTanY(0.f),
+	mScaleX(0.f),
+	mScaleY(0.f)
+{
+}
+
+void LLOcclusionBuffer::clear(const LLCamera& camera, U32 width, U32 height)
+{
+	width = llmax(width, (U32) 1);
+	height = llmax(height, (U32) 1);
+
+	if (width != mWidth || height != mHeight)
+	{
+		mWidth = width;
+		mHeight = height;
+		mLevels.clear();
+		while (true)
+		{
+			Level level;
+			level.mWidth = width;
+			level.mHeight = height;
+			level.mDepth.resize(width * height);
+			mLevels.push_back(level);
+			if (width == 1 && height == 1)
+			{
+				break;
+			}
+			width = (width + 1) / 2;
+			height = (height + 1) / 2;
+		}
+	}
+
+	std::fill(mLevels[0].mDepth.begin(), mLevels[0].mDepth.end(), 0.f);
+	mOccluderCount = 0;
+
+	mOrigin = camera.getOrigin();
+	mRight = -camera.getLeftAxis();
+	mUp = camera.getUpAxis();
+	mAt = camera.getAtAxis();
+	mNear = camera.getNear();
+	mTanY = tanf(camera.getView() * 0.5f);
+	mTanX = mTanY * camera.getAspect();
+	mScaleX = mWidth / (2.f * mTanX);
+	mScaleY = mHeight / (2.f * mTanY);
+}
+
+LLVector3 LLOcclusionBuffer::toView(const LLVector3& p) const
+{
+	LLVector3 d = p - mOrigin;
+	return LLVector3(d * mRight, d * mUp, d * mAt);
+}
+
+// Sutherland-Hodgman against the half space dot(plane, v) >= offset
+static U32 clip_polygon(const LLVector3* in, U32 count, LLVector3* out, const LLVector3& plane, F32 offset)
+{
+	U32 out_count = 0;
+	for (U32 i = 0; i < count; i++)
+	{
+		const LLVector3& a = in[i];
+		const LLVector3& b = in[(i + 1) % count];
+		F32 da = a * plane - offset;
+		F32 db = b * plane - offset;
+		if (da >= 0.f)
+		{
+			out[out_count++] = a;
+		}
+		if ((da >= 0.f) != (db >= 0.f))
+		{
+			out[out_count++] = a + (b - a) * (da / (da - db));
+		}
+	}
+	return out_count;
+}
+
+U32 LLOcclusionBuffer::projectPolygon(const LLVector3* verts, U32 count, Vertex* out) const
+{
+	LLVector3 buffer[2][MAX_POLYGON_VERTS + MAX_CLIP_VERTS];
+	for (U32 i = 0; i < count; i++)
+	{
+		buffer[0][i] = toView(verts[i]);
+	}
+
+	// Near plane, then the guard band
+	const F32 gx = GUARD_BAND * mTanX;
+	const F32 gy = GUARD_BAND * mTanY;
+	const LLVector3 planes[MAX_CLIP_VERTS] =
+	{
+		LLVector3(0.f, 0.f, 1.f),
+		LLVector3(-1.f, 0.f, gx),
+		LLVector3(1.f, 0.f, gx),
+		LLVector3(0.f, -1.f, gy),
+		LLVector3(0.f, 1.f, gy)
+	};
+	U32 cur = 0;
+	for (U32 i = 0; i < MAX_CLIP_VERTS && count > 0; i++)
+	{
+		count = clip_polygon(buffer[cur], count, buffer[1 - cur], planes[i], i == 0 ? mNear : 0.f);
+		cur = 1 - cur;
+	}
+
+	const F32 half_width = mWidth * 0.5f;
+	const F32 half_height = mHeight * 0.5f;
+	for (U32 i = 0; i < count; i++)
+	{
+		const LLVector3& v = buffer[cur][i];
+		F32 inv_z = 1.f / llmax(v.mV[VZ], mNear);
+		out[i].mX = v.mV[VX] * inv_z * mScaleX + half_width;
+		out[i].mY = v.mV[VY] * inv_z * mScaleY + half_height;
+	}
+	return count;
+}
+
+LLOcclusionBuffer::Plane LLOcclusionBuffer::getPlane(const LLVector3& normal, F32 distance) const
+{
+	// A ray t * (x, y, 1) in view space meets the plane at
+	// 1 / t = dot(normal, (x, y, 1)) / distance, which is linear in x and y
+	LLVector3 n(normal * mRight, normal * mUp, normal * mAt);
+	Plane plane;
+	plane.mA = n.mV[VX] / (distance * mScaleX);
+	plane.mB = n.mV[VY] / (distance * mScaleY);
+	plane.mC = n.mV[VZ] / distance - plane.mA * mWidth * 0.5f - plane.mB * mHeight * 0.5f;
+
+	// Farthest the plane gets over a texel, given its center
+	plane.mC -= 0.5f * (fabsf(plane.mA) + fabsf(plane.mB));
+	return plane;
+}
+
+void LLOcclusionBuffer::addPolygon(const LLVector3* verts, U32 count)
+{
+	if (count < 3 || count > MAX_POLYGON_VERTS || mLevels.empty())
+	{
+		llassert(count <= MAX_POLYGON_VERTS);
+		return;
+	}
+
+	// Newell's method, robust for slightly non-planar quads
+	LLVector3 normal;
+	for (U32 i = 0; i < count; i++)
+	{
+		const LLVector3& a = verts[i];
+		const LLVector3& b = verts[(i + 1) % count];
+		normal.mV[VX] += (a.mV[VY] - b.mV[VY]) * (a.mV[VZ] + b.mV[VZ]);
+		normal.mV[VY] += (a.mV[VZ] - b.mV[VZ]) * (a.mV[VX] + b.mV[VX]);
+		normal.mV[VZ] += (a.mV[VX] - b.mV[VX]) * (a.mV[VY] + b.mV[VY]);
+	}
+	F32 distance = normal * (verts[0] - mOrigin);
+	if (distance >= 0.f)
+	{
+		// Seen from behind or edge on
+		return;
+	}
+
+	Vertex outline[MAX_POLYGON_VERTS + MAX_CLIP_VERTS];
+	U32 outline_count = projectPolygon(verts, count, outline);
+	Plane plane = getPlane(normal, distance);
+	rasterize(outline, outline_count, &plane, 1);
+}
+
+void LLOcclusionBuffer::addBox(const LLVector3& center, const LLVector3* axes)
+{
+	if (mLevels.empty())
+	{
+		return;
+	}
+
+	// Faces are wound for a right handed set of axes, and mirroring one
+	// axis leaves the box the same
+	LLVector3 a[3] = { axes[0], axes[1], axes[2] };
+	if (((a[0] % a[1]) * a[2]) < 0.f)
+	{
+		a[2] = -a[2];
+	}
+
+	// The box's outline is made up of the faces towards the camera, and
+	// along any ray through it the box starts at the farthest of their
+	// planes
+	Vertex outline[MAX_OUTLINE_VERTS];
+	U32 outline_count = 0;
+	Plane planes[3];
+	U32 plane_count = 0;
+	for (U32 k = 0; k < 3; k++)
+	{
+		const LLVector3& u = a[(k + 1) % 3];
+		const LLVector3& v = a[(k + 2) % 3];
+		for (S32 side = -1; side <= 1; side += 2)
+		{
+			LLVector3 normal = a[k] * (F32) side;
+			LLVector3 face = center + normal;
+			F32 distance = normal * (face - mOrigin);
+			if (distance >= 0.f)
+			{
+				continue;
+			}
+
+			LLVector3 quad[4];
+			quad[0] = face - u - v;
+			quad[1] = face + u - v;
+			quad[2] = face + u + v;
+			quad[3] = face - u + v;
+			outline_count += projectPolygon(quad, 4, outline + outline_count);
+			planes[plane_count++] = getPlane(normal, distance);
+		}
+	}
+
+	if (plane_count > 0)
+	{
+		rasterize(outline, outline_count, planes, plane_count);
+	}
+}
+
+// static
+bool LLOcclusionBuffer::vertexLess(const Vertex& a, const Vertex& b)
+{
+	return a.mX < b.mX || (a.mX == b.mX && a.mY < b.mY);
+}
+
+// static
+F32 LLOcclusionBuffer::vertexCross(const Vertex& o, const Vertex& a, const Vertex& b)
+{
+	return (a.mX - o.mX) * (b.mY - o.mY) - (a.mY - o.mY) * (b.mX - o.mX);
+}
+
+void LLOcclusionBuffer::rasterize(Vertex* points, U32 count, const Plane* planes, U32 plane_count)
+{
+	if (count < 3)
+	{
+		return;
+	}
+
+	// Convex hull, counter clockwise (monotone chain)
+	Vertex hull[MAX_OUTLINE_VERTS + 1];
+	std::sort(points, points + count, vertexLess);
+	U32 hull_count = 0;
+	for (U32 i = 0; i < count; i++)
+	{
+		while (hull_count >= 2 && vertexCross(hull[hull_count - 2], hull[hull_count - 1], points[i]) <= 0.f)
+		{
+			hull_count--;
+		}
+		hull[hull_count++] = points[i];
+	}
+	for (S32 i = (S32) count - 2, lower = hull_count + 1; i >= 0; i--)
+	{
+		while ((S32) hull_count >= lower && vertexCross(hull[hull_count - 2], hull[hull_count - 1], points[i]) <= 0.f)
+		{
+			hull_count--;
+		}
+		hull[hull_count++] = points[i];
+	}
+	hull_count--;
+	if (hull_count < 3)
+	{
+		return;
+	}
+
+	// Texels lying wholly inside the bounding box
+	F32 min_x = hull[0].mX;
+	F32 max_x = hull[0].mX;
+	F32 min_y = hull[0].mY;
+	F32 max_y = hull[0].mY;
+	for (U32 i = 1; i < hull_count; i++)
+	{
+		min_x = llmin(min_x, hull[i].mX);
+		max_x = llmax(max_x, hull[i].mX);
+		min_y = llmin(min_y, hull[i].mY);
+		max_y = llmax(max_y, hull[i].mY);
+	}
+	S32 x0 = llmax((S32) ceilf(min_x), 0);
+	S32 x1 = llmin((S32) floorf(max_x) - 1, (S32) mWidth - 1);
+	S32 y0 = llmax((S32) ceilf(min_y), 0);
+	S32 y1 = llmin((S32) floorf(max_y) - 1, (S32) mHeight - 1);
+	if (x0 > x1 || y0 > y1)
+	{
+		return;
+	}
+
+	// Edge functions, positive inside, offset so that a texel is inside
+	// when its center is at least half a texel in from every edge
+	F32 edge_dx[MAX_OUTLINE_VERTS];
+	F32 edge_dy[MAX_OUTLINE_VERTS];
+	F32 edge_c[MAX_OUTLINE_VERTS];
+	for (U32 i = 0; i < hull_count; i++)
+	{
+		const Vertex& p = hull[i];
+		const Vertex& q = hull[(i + 1) % hull_count];
+		edge_dx[i] = p.mY - q.mY;
+		edge_dy[i] = q.mX - p.mX;
+		edge_c[i] = -edge_dx[i] * p.mX - edge_dy[i] * p.mY - 0.5f * (fabsf(edge_dx[i]) + fabsf(edge_dy[i]));
+	}
+
+	std::vector<F32>& depth = mLevels[0].mDepth;
+	for (S32 y = y0; y <= y1; y++)
+	{
+		// Span of texel centers inside every edge on this row
+		F32 cy = y + 0.5f;
+		F32 left = (F32) x0;
+		F32 right = (F32) x1;
+		for (U32 i = 0; i < hull_count && left <= right; i++)
+		{
+			// edge_dx * (x + 0.5) + e >= 0
+			F32 e = edge_dy[i] * cy + edge_c[i] + 0.5f * edge_dx[i];
+			if (edge_dx[i] > 0.f)
+			{
+				left = llmax(left, ceilf(-e / edge_dx[i]));
+			}
+			else if (edge_dx[i] < 0.f)
+			{
+				right = llmin(right, floorf(-e / edge_dx[i]));
+			}
+			else if (e < 0.f)
+			{
+				right = left - 1.f;
+			}
+		}
+		if (left > right)
+		{
+			continue;
+		}
+
+		S32 xl = (S32) left;
+		S32 xr = (S32) right;
+		F32* row = &depth[y * mWidth];
+		for (S32 x = xl; x <= xr; x++)
+		{
+			F32 cx = x + 0.5f;
+			F32 z = planes[0].mA * cx + planes[0].mB * cy + planes[0].mC;
+			for (U32 p = 1; p < plane_count; p++)
+			{
+				z = llmin(z, planes[p].mA * cx + planes[p].mB * cy + planes[p].mC);
+			}
+			if (z > row[x])
+			{
+				row[x] = z;
+			}
+		}
+	}
+	mOccluderCount++;
+}
+
+void LLOcclusionBuffer::build()
+{
+	// Each coarser texel keeps the farthest of the (up to) four below it
+	for (U32 l = 1; l < mLevels.size(); l++)
+	{
+		const Level& fine = mLevels[l - 1];
+		Level& coarse = mLevels[l];
+		for (U32 y = 0; y < coarse.mHeight; y++)
+		{
+			const F32* row0 = &fine.mDepth[y * 2 * fine.mWidth];
+			const F32* row1 = &fine.mDepth[llmin(y * 2 + 1, fine.mHeight - 1) * fine.mWidth];
+			F32* dst = &coarse.mDepth[y * coarse.mWidth];
+			for (U32 x = 0; x < coarse.mWidth; x++)
+			{
+				U32 fx0 = x * 2;
+				U32 fx1 = llmin(fx0 + 1, fine.mWidth - 1);
+				dst[x] = llmin(row0[fx0], row0[fx1], row1[fx0], row1[fx1]);
+			}
+		}
+	}
+}
+
+F32 LLOcclusionBuffer::getDepth(U32 x, U32 y, U32 level) const
+{
+	const Level& l = mLevels[level];
+	return l.mDepth[y * l.mWidth + x];
+}
+
+bool LLOcclusionBuffer::isOccluded(const LLVector3& center, const LLVector3& radius) const
+{
+	if (mOccluderCount == 0)
+	{
+		return false;
+	}
+
+	F32 min_x = F32_MAX;
+	F32 max_x = -F32_MAX;
+	F32 min_y = F32_MAX;
+	F32 max_y = -F32_MAX;
+	F32 min_z = F32_MAX;
+	for (U32 i = 0; i < 8; i++)
+	{
+		LLVector3 corner(center.mV[VX] + ((i & 1) ? radius.mV[VX] : -radius.mV[VX]),
+						 center.mV[VY] + ((i & 2) ? radius.mV[VY] : -radius.mV[VY]),
+						 center.mV[VZ] + ((i & 4) ? radius.mV[VZ] : -radius.mV[VZ]));
+		LLVector3 v = toView(corner);
+		if (v.mV[VZ] < mNear)
+		{
+			return false;
+		}
+		F32 sx = v.mV[VX] / v.mV[VZ];
+		F32 sy = v.mV[VY] / v.mV[VZ];
+		min_x = llmin(min_x, sx);
+		max_x = llmax(max_x, sx);
+		min_y = llmin(min_y, sy);
+		max_y = llmax(max_y, sy);
+		min_z = llmin(min_z, v.mV[VZ]);
+	}
+
+	// Every texel the box's outline touches
+	S32 x0 = (S32) floorf(min_x * mScaleX + mWidth * 0.5f);
+	S32 x1 = (S32) floorf(max_x * mScaleX + mWidth * 0.5f);
+	S32 y0 = (S32) floorf(min_y * mScaleY + mHeight * 0.5f);
+	S32 y1 = (S32) floorf(max_y * mScaleY + mHeight * 0.5f);
+	if (x1 < 0 || y1 < 0 || x0 >= (S32) mWidth || y0 >= (S32) mHeight)
+	{
+		return false;
+	}
+	x0 = llmax(x0, 0);
+	y0 = llmax(y0, 0);
+	x1 = llmin(x1, (S32) mWidth - 1);
+	y1 = llmin(y1, (S32) mHeight - 1);
+
+	// Start from the finest level the box spans at most 2x2 texels of
+	U32 level = 0;
+	while (level < mLevels.size() - 1 && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+	{
+		level++;
+	}
+
+	return isRectOccluded(x0, y0, x1, y1, level, 1.f / min_z);
+}
+
+bool LLOcclusionBuffer::isRectOccluded(S32 x0, S32 y0, S32 x1, S32 y1, U32 level, F32 depth) const
+{
+	const Level& l = mLevels[level];
+	for (S32 ty = y0 >> level; ty <= (y1 >> level); ty++)
+	{
+		for (S32 tx = x0 >> level; tx <= (x1 >> level); tx++)
+		{
+			if (l.mDepth[ty * l.mWidth + tx] > depth)
+			{
+				continue;
+			}
+			if (level == 0)
+			{
+				return false;
+			}
+
+			// Not hidden by the farthest depth under this texel, look at
+			// the part of the box over each of its children
+			S32 sx0 = llmax(x0, tx << level);
+			S32 sx1 = llmin(x1, ((tx + 1) << level) - 1);
+			S32 sy0 = llmax(y0, ty << level);
+			S32 sy1 = llmin(y1, ((ty + 1) << level) - 1);
+			if (!isRectOccluded(sx0, sy0, sx1, sy1, level - 1, depth))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file llocclusionbuffer.h
+ * @brief Software depth buffer for CPU occlusion culling
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOCCLUSIONBUFFER_H
+#define LL_LLOCCLUSIONBUFFER_H
+
+#include <vector>
+
+#include "v3math.h"
+
+class LLCamera;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// LLOcclusionBuffer
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+// A small depth buffer that a frame's large, simple occluders are rasterized
+// into on the CPU, with a pyramid of coarser levels built over it so a box
+// can usually be tested against a handful of texels.
+//
+// Depth is stored as 1 / (distance along the view axis), which is linear in
+// screen space and needs no far plane: larger is nearer, 0 is empty. An
+// occluder only covers the texels that lie wholly inside its outline, at a
+// depth no nearer than any point of it over the texel, so a box reported as
+// occluded is hidden by the occluders as given rather than just at the
+// resolution of the buffer.
+
+class LLOcclusionBuffer
+{
+public:
+	LLOcclusionBuffer();
+
+	// Empties the buffer and points it along camera's view, width x height
+	// texels across the camera's field of view.
+	void clear(const LLCamera& camera, U32 width, U32 height);
+
+	// Rasterizes a planar convex polygon given in agent space, counter
+	// clockwise seen from its front. Polygons seen from behind are skipped.
+	void addPolygon(const LLVector3* verts, U32 count);
+
+	// Rasterizes a solid box. axes are the box's three half extents, rotated
+	// into agent space.
+	void addBox(const LLVector3& center, const LLVector3* axes);
+
+	// Builds the coarser levels. Must be called after the last occluder is
+	// added and before isOccluded().
+	void build();
+
+	// Returns true if the axis aligned box (center, half extents) is hidden
+	// behind the occluders. Boxes reaching the near plane or lying off screen
+	// are never occluded.
+	bool isOccluded(const LLVector3& center, const LLVector3& radius) const;
+
+	bool isEmpty() const						{ return mOccluderCount == 0; }
+	U32 getWidth() const						{ return mWidth; }
+	U32 getHeight() const						{ return mHeight; }
+	U32 getLevelCount() const					{ return mLevels.size(); }
+	U32 getOccluderCount() const				{ return mOccluderCount; }
+
+	// Depth stored at texel (x, y) of level, see above for units
+	F32 getDepth(U32 x, U32 y, U32 level = 0) const;
+
+private:
+	struct Vertex
+	{
+		F32 mX;
+		F32 mY;
+	};
+
+	// Depth of a plane across the screen, a * x + b * y + c
+	struct Plane
+	{
+		F32 mA;
+		F32 mB;
+		F32 mC;
+	};
+
+	// Agent space point to view space: x right, y up, z along the view axis
+	LLVector3 toView(const LLVector3& p) const;
+	// Clips an agent space polygon to the view and appends it in screen space
+	U32 projectPolygon(const LLVector3* verts, U32 count, Vertex* out) const;
+	// normal and distance are the plane's, relative to the camera
+	Plane getPlane(const LLVector3& normal, F32 distance) const;
+	static bool vertexLess(const Vertex& a, const Vertex& b);
+	static F32 vertexCross(const Vertex& o, const Vertex& a, const Vertex& b);
+	// Fills the convex hull of points at the farthest of planes
+	void rasterize(Vertex* points, U32 count, const Plane* planes, U32 plane_count);
+	bool isRectOccluded(S32 x0, S32 y0, S32 x1, S32 y1, U32 level, F32 depth) const;
+
+	struct Level
+	{
+		U32 mWidth;
+		U32 mHeight;
+		std::vector<F32> mDepth;
+	};
+
+	std::vector<Level> mLevels;
+	U32 mWidth;
+	U32 mHeight;
+	U32 mOccluderCount;
+
+	LLVector3 mOrigin;
+	LLVector3 mRight;
+	LLVector3 mUp;
+	LLVector3 mAt;
+	F32 mNear;
+	F32 mTanX;
+	F32 mTanY;
+	F32 mScaleX;
+	F32 mScaleY;
+};
+
+#endif // LL_LLOCCLUSIONBUFFER_H
@@ -36,7 +36,6 @@
 #include "lltreenode.h"
 #include "v3math.h"
 #include <vector>
-#include <set>
 
 #if LL_RELEASE_WITH_DEBUG_INFO || LL_DEBUG
 #define OCT_ERRS LL_ERRS("OctreeErrors")
@@ -51,6 +50,9 @@
 #define LL_OCTREE_MAX_CAPACITY 128
 #endif
 
+// Nodes are carved out of blocks of this many at a time
+#define LL_OCTREE_POOL_BLOCK_SIZE 64
+
 template <class T> class LLOctreeNode;
 
 template <class T>
@@ -78,9 +80,9 @@ class LLOctreeNode : public LLTreeNode<T>
 public:
 	typedef LLOctreeTraveler<T>									oct_traveler;
 	typedef LLTreeTraveler<T>									tree_traveler;
-	typedef typename std::set<LLPointer<T> >					element_list;
-	typedef typename std::set<LLPointer<T> >::iterator			element_iter;
-	typedef typename std::set<LLPointer<T> >::const_iterator	const_element_iter;
+	typedef typename std::vector<LLPointer<T> >					element_list;
+	typedef typename element_list::iterator						element_iter;
+	typedef typename element_list::const_iterator				const_element_iter;
 	typedef typename std::vector<LLTreeListener<T>*>::iterator	tree_listener_iter;
 	typedef typename std::vector<LLOctreeNode<T>* >				child_list;
 	typedef LLTreeNode<T>		BaseType;
@@ -119,6 +121,42 @@ public:
 		} 
 	}
 
+	// Nodes come and go constantly as drawables move around the octree, so
+	// they are recycled through a free list instead of going back to the
+	// heap. Nodes are only created and destroyed on the main thread.
+	static void* operator new(size_t size)
+	{
+		if (size != sizeof(oct_node))
+		{
+			return ::operator new(size);
+		}
+		if (sFreeNodes.empty())
+		{
+			U8* block = (U8*) ::operator new(size * LL_OCTREE_POOL_BLOCK_SIZE);
+			for (S32 i = LL_OCTREE_POOL_BLOCK_SIZE - 1; i >= 0; --i)
+			{
+				sFreeNodes.push_back(block + i * size);
+			}
+			sPoolSize += LL_OCTREE_POOL_BLOCK_SIZE;
+		}
+		void* ptr = sFreeNodes.back();
+		sFreeNodes.pop_back();
+		return ptr;
+	}
+
+	static void operator delete(void* ptr, size_t size)
+	{
+		if (size != sizeof(oct_node))
+		{
+			::operator delete(ptr);
+			return;
+		}
+		sFreeNodes.push_back(ptr);
+	}
+
+	static U32 getPoolSize()							{ return sPoolSize; }
+	static U32 getPoolFreeCount()						{ return sFreeNodes.size(); }
+
 	inline const BaseType* getParent()	const			{ return mParent; }
 	inline void setParent(BaseType* parent)			{ mParent = (oct_node*) parent; }
 	inline const LLVector3d& getCenter() const			{ return mCenter; }
@@ -298,15 +336,14 @@ public:
 			{ //it belongs here
 #if LL_OCTREE_PARANOIA_CHECK
 				//if this is a redundant insertion, error out (should never happen)
-				if (mData.find(data) != mData.end())
+				if (hasElement(data))
 				{
 					llwarns << "Redundant octree insertion detected. " << data << llendl;
 					return false;
 				}
 #endif
 
-				mData.insert(data);
-				BaseType::insert(data);
+				addElement(data);
 				return true;
 			}
 			else
@@ -335,8 +372,7 @@ public:
 					llabs(center.mdV[1] - getCenter().mdV[1]) < F_APPROXIMATELY_ZERO &&
 					llabs(center.mdV[2] - getCenter().mdV[2]) < F_APPROXIMATELY_ZERO)
 				{
-					mData.insert(data);
-					BaseType::insert(data);
+					addElement(data);
 					return true;
 				}
 
@@ -387,9 +423,9 @@ public:
 
 	bool remove(T* data)
 	{
-		if (mData.find(data) != mData.end())
+		if (hasElement(data))
 		{	//we have data
-			mData.erase(data);
+			removeElement(data);
 			notifyRemoval(data);
 			checkAlive();
 			return true;
@@ -424,9 +460,9 @@ public:
 
 	void removeByAddress(T* data)
 	{
-        if (mData.find(data) != mData.end())
+		if (hasElement(data))
 		{
-			mData.erase(data);
+			removeElement(data);
 			notifyRemoval(data);
 			llwarns << "FOUND!" << llendl;
 			checkAlive();
@@ -440,6 +476,14 @@ public:
 		}
 	}
 
+	// Elements know their slot in mData, so membership tests and removal
+	// don't have to search.
+	bool hasElement(T* data) const
+	{
+		S32 index = data->getBinIndex();
+		return index >= 0 && index < (S32) mData.size() && mData[index] == data;
+	}
+
 	void clearChildren()
 	{
 		mChild.clear();
@@ -551,7 +595,31 @@ public:
 		//OCT_ERRS << "Octree failed to delete requested child." << llendl;
 	}
 
-protected:	
+protected:
+	void addElement(T* data)
+	{
+		data->setBinIndex(mData.size());
+		mData.push_back(data);
+		BaseType::insert(data);
+	}
+
+	// Swap the last element into the hole left by data
+	void removeElement(T* data)
+	{
+		U32 index = data->getBinIndex();
+		U32 last = mData.size() - 1;
+		data->setBinIndex(-1);
+		if (index != last)
+		{
+			mData[last]->setBinIndex(index);
+			mData[index] = mData[last];
+		}
+		mData.pop_back();
+	}
+
+	static std::vector<void*> sFreeNodes;
+	static U32 sPoolSize;
+
 	child_list mChild;
 	element_list mData;
 	oct_node* mParent;
@@ -700,6 +768,12 @@ public:
 };
 
 
+template <class T>
+std::vector<void*> LLOctreeNode<T>::sFreeNodes;
+
+template <class T>
+U32 LLOctreeNode<T>::sPoolSize = 0;
+
 //========================
 //		LLOctreeTraveler
 //========================
@@ -0,0 +1,95 @@
+/**
+ * @file llskinning.h
+ * @brief Vertex skinning and a queue that skins on a shared thread pool
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSKINNING_H
+#define LL_LLSKINNING_H
+
+#include <string>
+
+#include "llqueuedthread.h"
+#include "llstrider.h"
+
+class LLMatrix3;
+class LLMatrix4;
+class LLVector3;
+
+// Skins num_vertices vertices and normals of a mesh. The integer part of a
+// vertex's weight is the first of the two joints it is blended between and
+// the fraction is how far it is toward the next one. joint_mat must already
+// include the skin pivots and joint_rot holds their rotations. Only writes
+// to the striders, so meshes can be skinned on several threads at once.
+void ll_skin_vertices(const LLMatrix4* joint_mat, const LLMatrix3* joint_rot,
+					  const F32* weights, const LLVector3* coords, const LLVector3* normals,
+					  U32 num_vertices,
+					  LLStrider<LLVector3> o_vertices, LLStrider<LLVector3> o_normals);
+
+// Skins a batch of characters on an LLThreadPool. skinAll() deals the
+// indices out to the workers as strided requests, helps out on the calling
+// thread and returns once every one of them has been skinned, so it is the
+// barrier before anything is drawn from the results. Without a pool it
+// skins them all on the calling thread.
+class LLSkinQueue : public LLQueuedThread
+{
+public:
+	// Has no thread of its own, attach it to an LLThreadPool
+	LLSkinQueue(const std::string& name);
+	virtual ~LLSkinQueue();
+
+	// MAIN THREAD
+	// Calls skinOne() once for every index below count
+	void skinAll(U32 count);
+
+protected:
+	// ANY THREAD
+	// Must only write to what belongs to that index
+	virtual void skinOne(U32 index) = 0;
+
+	class SkinRequest : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		SkinRequest(handle_t handle, LLSkinQueue* queue, U32 first, U32 stride);
+		/*virtual*/ bool processRequest();
+	protected:
+		/*virtual*/ ~SkinRequest() { }
+	private:
+		LLSkinQueue* mQueue;
+		U32 mFirst;
+		U32 mStride;
+	};
+	friend class SkinRequest;
+
+	U32 mCount;
+	LLAtomicU32 mCompleted;
+};
+
+#endif // LL_LLSKINNING_H
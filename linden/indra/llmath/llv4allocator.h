@@ -0,0 +1,118 @@
+/** 
+ * @file llv4allocator.h
+ * @brief LLV4Allocator class header file - vector processor aligned storage
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLV4ALLOCATOR_H
+#define LL_LLV4ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+
+#if LL_WINDOWS
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// LLV4Allocator
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+// STL allocator returning storage aligned for LLV4 loads and stores, so a
+// std::vector<LLVector3, LLV4Allocator<LLVector3> > can be read four
+// elements (three aligned registers) at a time.
+
+template <class T>
+class LLV4Allocator
+{
+public:
+	enum {
+		ALIGNMENT = 16
+	};
+
+	typedef T				value_type;
+	typedef T*				pointer;
+	typedef const T*		const_pointer;
+	typedef T&				reference;
+	typedef const T&		const_reference;
+	typedef std::size_t		size_type;
+	typedef std::ptrdiff_t	difference_type;
+
+	template <class U> struct rebind { typedef LLV4Allocator<U> other; };
+
+	LLV4Allocator() { }
+	LLV4Allocator(const LLV4Allocator&) { }
+	template <class U> LLV4Allocator(const LLV4Allocator<U>&) { }
+
+	pointer address(reference x) const				{ return &x; }
+	const_pointer address(const_reference x) const	{ return &x; }
+	size_type max_size() const						{ return size_type(-1) / sizeof(T); }
+
+	void construct(pointer p, const T& val)			{ new((void*) p) T(val); }
+	void destroy(pointer p)							{ p->~T(); }
+
+	pointer allocate(size_type n, const void* hint = 0)
+	{
+		void* p = NULL;
+#if LL_WINDOWS
+		p = _aligned_malloc(n * sizeof(T), ALIGNMENT);
+#else
+		if (posix_memalign(&p, ALIGNMENT, n * sizeof(T)) != 0)
+		{
+			p = NULL;
+		}
+#endif
+		if (!p && n)
+		{
+			throw std::bad_alloc();
+		}
+		return (pointer) p;
+	}
+
+	void deallocate(pointer p, size_type n)
+	{
+#if LL_WINDOWS
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+};
+
+template <class T, class U>
+inline bool operator==(const LLV4Allocator<T>&, const LLV4Allocator<U>&) { return true; }
+
+template <class T, class U>
+inline bool operator!=(const LLV4Allocator<T>&, const LLV4Allocator<U>&) { return false; }
+
+#endif
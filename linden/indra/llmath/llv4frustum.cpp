@@ -0,0 +1,315 @@
+/** 
+ * @file llv4frustum.cpp
+ * @brief LLV4Frustum class implementation - batched AABB frustum tests
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llv4frustum.h"
+
+#include "llcamera.h"
+#include "v3math.h"
+
+LLV4Frustum::LLV4Frustum()
+	: mPlaneCount(0),
+	  mFarClip(FALSE),
+	  mCamera(NULL)
+{
+}
+
+void LLV4Frustum::setCamera(LLCamera& camera, BOOL far_clip)
+{
+	mCamera = &camera;
+	mFarClip = far_clip;
+	mPlaneCount = 0;
+
+	for (U32 i = 0; i < camera.getPlaneCount(); i++)
+	{
+		if (!far_clip && i == FAR_PLANE)
+		{
+			continue;
+		}
+
+		const LLPlane& p = camera.getAgentPlane(i);
+		plane& dst = mPlanes[mPlaneCount++];
+		for (U32 j = 0; j < 3; j++)
+		{
+			dst.mN[j].setVec(p.mV[j]);
+			// same test as LLCamera::calcPlaneMask()
+			dst.mSign[j].setVec(p.mV[j] >= 0 ? 1.f : -1.f);
+		}
+		dst.mNegD.setVec(-p.mV[3]);
+	}
+
+	const LLVector3& origin = camera.getOrigin();
+	for (U32 j = 0; j < 3; j++)
+	{
+		mOrigin[j].setVec(origin.mV[j]);
+	}
+	mCornerDistSquared.setVec(camera.mFrustumCornerDist * camera.mFrustumCornerDist);
+}
+
+//-----------------------------------------------------------------------------
+// Scalar versions
+//-----------------------------------------------------------------------------
+
+// Mirrors LLCamera::AABBInFrustum() operation for operation, so results
+// match it exactly and not just to within rounding
+S32 LLV4Frustum::AABBInFrustumScalar(const LLVector3& center, const LLVector3& radius) const
+{
+	if (mFarClip && radius.magVecSquared() > mCornerDistSquared.mV[VX])
+	{	// box is larger than frustum, needs the camera's corner test
+		return mCamera->AABBInFrustum(center, radius);
+	}
+
+	S32 result = 2;
+	for (U32 i = 0; i < mPlaneCount; i++)
+	{
+		const plane& p = mPlanes[i];
+		LLVector3 rscale(radius.mV[VX] * p.mSign[VX].mV[VX],
+						 radius.mV[VY] * p.mSign[VY].mV[VX],
+						 radius.mV[VZ] * p.mSign[VZ].mV[VX]);
+		LLVector3 n(p.mN[VX].mV[VX], p.mN[VY].mV[VX], p.mN[VZ].mV[VX]);
+
+		if (n * (center - rscale) > p.mNegD.mV[VX])
+		{
+			return 0;
+		}
+		if (n * (center + rscale) > p.mNegD.mV[VX])
+		{
+			result = 1;
+		}
+	}
+	return result;
+}
+
+void LLV4Frustum::AABBInFrustumScalar(const LLVector3* const* bounds, U32 count, S32* results) const
+{
+	for (U32 i = 0; i < count; i++)
+	{
+		results[i] = AABBInFrustumScalar(bounds[i][0], bounds[i][1]);
+	}
+}
+
+S32 LLV4Frustum::AABBSphereIntersectScalar(const LLVector3& min, const LLVector3& max) const
+{
+	const LLVector3 origin(mOrigin[VX].mV[VX], mOrigin[VY].mV[VX], mOrigin[VZ].mV[VX]);
+	const F32 r = mCornerDistSquared.mV[VX];
+
+	if ((min - origin).magVecSquared() < r &&
+		(max - origin).magVecSquared() < r)
+	{
+		return 2;
+	}
+
+	F32 d = 0.f;
+	for (U32 i = 0; i < 3; i++)
+	{
+		F32 t;
+		if (origin.mV[i] < min.mV[i])
+		{
+			t = min.mV[i] - origin.mV[i];
+			d += t*t;
+		}
+		else if (origin.mV[i] > max.mV[i])
+		{
+			t = origin.mV[i] - max.mV[i];
+			d += t*t;
+		}
+
+		if (d > r)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void LLV4Frustum::AABBSphereIntersectScalar(const LLVector3* const* extents, U32 count, S32* results) const
+{
+	for (U32 i = 0; i < count; i++)
+	{
+		results[i] = AABBSphereIntersectScalar(extents[i][0], extents[i][1]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Vectorized versions
+//-----------------------------------------------------------------------------
+
+#if LL_VECTORIZE
+
+// Gathers component axis of the first (or second, if second) vector of
+// four boxes into one register
+static inline __m128 llv4gather(const LLVector3* const* boxes, U32 second, U32 axis)
+{
+	return _mm_set_ps(boxes[3][second].mV[axis], boxes[2][second].mV[axis],
+					  boxes[1][second].mV[axis], boxes[0][second].mV[axis]);
+}
+
+// Fills the last batch of a list with copies of its last box
+static inline const LLVector3* const* llv4batch(const LLVector3* const* boxes, U32 i, U32 count, const LLVector3* tail[LLV4_NUM_AXIS])
+{
+	if (i + LLV4_NUM_AXIS <= count)
+	{
+		return boxes + i;
+	}
+	for (U32 j = 0; j < LLV4_NUM_AXIS; j++)
+	{
+		tail[j] = boxes[llmin(i + j, count - 1)];
+	}
+	return tail;
+}
+
+void LLV4Frustum::AABBInFrustum(const LLVector3* const* bounds, U32 count, S32* results) const
+{
+	const LLVector3* tail[LLV4_NUM_AXIS];
+
+	for (U32 i = 0; i < count; i += LLV4_NUM_AXIS)
+	{
+		const LLVector3* const* boxes = llv4batch(bounds, i, count, tail);
+
+		__m128 cx = llv4gather(boxes, 0, VX);
+		__m128 cy = llv4gather(boxes, 0, VY);
+		__m128 cz = llv4gather(boxes, 0, VZ);
+		__m128 rx = llv4gather(boxes, 1, VX);
+		__m128 ry = llv4gather(boxes, 1, VY);
+		__m128 rz = llv4gather(boxes, 1, VZ);
+
+		__m128 outside = _mm_setzero_ps();
+		__m128 partial = _mm_setzero_ps();
+
+		for (U32 p = 0; p < mPlaneCount; p++)
+		{
+			const plane& pl = mPlanes[p];
+			__m128 sx = _mm_mul_ps(rx, pl.mSign[VX].v);
+			__m128 sy = _mm_mul_ps(ry, pl.mSign[VY].v);
+			__m128 sz = _mm_mul_ps(rz, pl.mSign[VZ].v);
+
+			// n * (center - rscale) > -d
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl.mN[VX].v, _mm_sub_ps(cx, sx)),
+												_mm_mul_ps(pl.mN[VY].v, _mm_sub_ps(cy, sy))),
+									 _mm_mul_ps(pl.mN[VZ].v, _mm_sub_ps(cz, sz)));
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(dist, pl.mNegD.v));
+			if (_mm_movemask_ps(outside) == 0xf)
+			{
+				break;
+			}
+
+			// n * (center + rscale) > -d
+			dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl.mN[VX].v, _mm_add_ps(cx, sx)),
+										 _mm_mul_ps(pl.mN[VY].v, _mm_add_ps(cy, sy))),
+							  _mm_mul_ps(pl.mN[VZ].v, _mm_add_ps(cz, sz)));
+			partial = _mm_or_ps(partial, _mm_cmpgt_ps(dist, pl.mNegD.v));
+		}
+
+		S32 outside_mask = _mm_movemask_ps(outside);
+		S32 partial_mask = _mm_movemask_ps(partial);
+		S32 large_mask = 0;
+		if (mFarClip)
+		{
+			__m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz));
+			large_mask = _mm_movemask_ps(_mm_cmpgt_ps(r2, mCornerDistSquared.v));
+		}
+
+		U32 lanes = llmin(count - i, (U32) LLV4_NUM_AXIS);
+		for (U32 j = 0; j < lanes; j++)
+		{
+			S32 bit = 1 << j;
+			if (large_mask & bit)
+			{
+				results[i + j] = mCamera->AABBInFrustum(boxes[j][0], boxes[j][1]);
+			}
+			else
+			{
+				results[i + j] = (outside_mask & bit) ? 0 : ((partial_mask & bit) ? 1 : 2);
+			}
+		}
+	}
+}
+
+void LLV4Frustum::AABBSphereIntersect(const LLVector3* const* extents, U32 count, S32* results) const
+{
+	const LLVector3* tail[LLV4_NUM_AXIS];
+
+	for (U32 i = 0; i < count; i += LLV4_NUM_AXIS)
+	{
+		const LLVector3* const* boxes = llv4batch(extents, i, count, tail);
+
+		__m128 d = _mm_setzero_ps();
+		__m128 min_dist = _mm_setzero_ps();
+		__m128 max_dist = _mm_setzero_ps();
+		for (U32 axis = 0; axis < 3; axis++)
+		{
+			__m128 o = mOrigin[axis].v;
+			__m128 mn = llv4gather(boxes, 0, axis);
+			__m128 mx = llv4gather(boxes, 1, axis);
+
+			__m128 t = _mm_sub_ps(mn, o);
+			min_dist = (axis == 0) ? _mm_mul_ps(t, t) : _mm_add_ps(min_dist, _mm_mul_ps(t, t));
+			__m128 below = _mm_cmplt_ps(o, mn);
+			__m128 t_below = t;
+
+			t = _mm_sub_ps(mx, o);
+			max_dist = (axis == 0) ? _mm_mul_ps(t, t) : _mm_add_ps(max_dist, _mm_mul_ps(t, t));
+			__m128 above = _mm_andnot_ps(below, _mm_cmpgt_ps(o, mx));
+			__m128 t_above = _mm_sub_ps(o, mx);
+
+			// distance from origin to the box along this axis, 0 if inside
+			t = _mm_or_ps(_mm_and_ps(below, t_below), _mm_and_ps(above, t_above));
+			d = _mm_add_ps(d, _mm_mul_ps(t, t));
+		}
+
+		S32 inside_mask = _mm_movemask_ps(_mm_and_ps(_mm_cmplt_ps(min_dist, mCornerDistSquared.v),
+													 _mm_cmplt_ps(max_dist, mCornerDistSquared.v)));
+		S32 outside_mask = _mm_movemask_ps(_mm_cmpgt_ps(d, mCornerDistSquared.v));
+
+		U32 lanes = llmin(count - i, (U32) LLV4_NUM_AXIS);
+		for (U32 j = 0; j < lanes; j++)
+		{
+			S32 bit = 1 << j;
+			results[i + j] = (inside_mask & bit) ? 2 : ((outside_mask & bit) ? 0 : 1);
+		}
+	}
+}
+
+#else // LL_VECTORIZE
+
+void LLV4Frustum::AABBInFrustum(const LLVector3* const* bounds, U32 count, S32* results) const
+{
+	AABBInFrustumScalar(bounds, count, results);
+}
+
+void LLV4Frustum::AABBSphereIntersect(const LLVector3* const* extents, U32 count, S32* results) const
+{
+	AABBSphereIntersectScalar(extents, count, results);
+}
+
+#endif // LL_VECTORIZE
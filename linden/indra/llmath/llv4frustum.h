@@ -0,0 +1,102 @@
+/** 
+ * @file llv4frustum.h
+ * @brief LLV4Frustum class header file - batched AABB frustum tests
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLV4FRUSTUM_H
+#define LL_LLV4FRUSTUM_H
+
+#include "llv4math.h"
+#include "llv4vector3.h"
+
+class LLCamera;
+class LLVector3;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// LLV4Frustum
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+// Copy of an LLCamera's agent space frustum planes, laid out so that boxes
+// can be tested LLV4_NUM_AXIS at a time. Results are identical to the
+// LLCamera::AABBInFrustum() and AABBInFrustumNoFarClip() they stand in for:
+// 0 if outside, 1 if partly in, 2 if fully in.
+//
+// Boxes are passed as pointers to LLVector3[2] pairs, center then radius,
+// which is the layout of LLSpatialGroup::mBounds and mObjectBounds.
+
+LL_LLV4MATH_ALIGN_PREFIX
+
+class LLV4Frustum
+{
+public:
+	enum {
+		MAX_PLANES = 7,
+		FAR_PLANE = 5
+	};
+
+	LLV4Frustum();
+
+	// Snapshots the planes of camera. The camera must outlive this object,
+	// boxes too large for the plane test are handed back to it.
+	void setCamera(LLCamera& camera, BOOL far_clip);
+
+	void AABBInFrustum(const LLVector3* const* bounds, U32 count, S32* results) const;
+	void AABBInFrustumScalar(const LLVector3* const* bounds, U32 count, S32* results) const;
+
+	// Intersects boxes given as min/max extents with the sphere of radius
+	// mFrustumCornerDist around the camera. Same results as
+	// AABBSphereIntersect() in llspatialpartition.cpp.
+	void AABBSphereIntersect(const LLVector3* const* extents, U32 count, S32* results) const;
+	void AABBSphereIntersectScalar(const LLVector3* const* extents, U32 count, S32* results) const;
+
+protected:
+	S32 AABBInFrustumScalar(const LLVector3& center, const LLVector3& radius) const;
+	S32 AABBSphereIntersectScalar(const LLVector3& min, const LLVector3& max) const;
+
+	struct plane
+	{
+		LLV4Vector3	mN[3];		// normal components, splatted
+		LLV4Vector3	mSign[3];	// +1 or -1 per normal component, picks the box corner to test
+		LLV4Vector3	mNegD;		// -d, splatted
+	};
+
+	plane		mPlanes[MAX_PLANES];
+	LLV4Vector3	mOrigin[3];
+	LLV4Vector3	mCornerDistSquared;
+	U32			mPlaneCount;
+	BOOL		mFarClip;
+	LLCamera*	mCamera;
+}
+
+LL_LLV4MATH_ALIGN_POSTFIX;
+
+#endif
@@ -0,0 +1,197 @@
+/** 
+ * @file llv4transform.cpp
+ * @brief Batched vertex transforms - vector processor enabled math
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llv4transform.h"
+
+#include "llv4math.h"
+#include "m3math.h"
+#include "m4math.h"
+#include "v3math.h"
+
+void llv4transform_positions_scalar(const LLMatrix4& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out)
+{
+	for (U32 i = 0; i < count; i++)
+	{
+		*out++ = in[i] * mat;
+	}
+}
+
+void llv4transform_normals_scalar(const LLMatrix3& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out)
+{
+	for (U32 i = 0; i < count; i++)
+	{
+		LLVector3 normal = in[i] * mat;
+		normal.normVec();
+		*out++ = normal;
+	}
+}
+
+#if LL_VECTORIZE
+
+// Loads four packed LLVector3s (three aligned registers) as x, y and z
+// registers
+static inline void llv4load_soa(const LLVector3* in, __m128& x, __m128& y, __m128& z)
+{
+	const F32* f = in->mV;
+	__m128 a = _mm_load_ps(f);		// x0 y0 z0 x1
+	__m128 b = _mm_load_ps(f + 4);	// y1 z1 x2 y2
+	__m128 c = _mm_load_ps(f + 8);	// z2 x3 y3 z3
+
+	x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+					   _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+					   _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+// Stores x, y and z registers as four LLVector3s at the strider's stride
+static inline void llv4store_soa(__m128 x, __m128 y, __m128 z, LLStrider<LLVector3>& out)
+{
+	__m128 w = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	__m128 v[4] = { x, y, z, w };
+	for (U32 i = 0; i < 4; i++)
+	{
+		F32* o = (out++)->mV;
+		_mm_storel_pi((__m64*) o, v[i]);
+		_mm_store_ss(o + 2, _mm_movehl_ps(v[i], v[i]));
+	}
+}
+
+static inline bool llv4is_aligned(const void* p)
+{
+	return ((size_t) p & 15) == 0;
+}
+
+void llv4transform_positions(const LLMatrix4& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out)
+{
+	if (!llv4is_aligned(in))
+	{
+		llv4transform_positions_scalar(mat, in, count, out);
+		return;
+	}
+
+	__m128 m[4][3];
+	for (U32 r = 0; r < 4; r++)
+	{
+		for (U32 c = 0; c < 3; c++)
+		{
+			m[r][c] = _mm_set1_ps(mat.mMatrix[r][c]);
+		}
+	}
+
+	U32 batched = count & ~3;
+	for (U32 i = 0; i < batched; i += 4)
+	{
+		__m128 x, y, z;
+		llv4load_soa(in + i, x, y, z);
+
+		// same order of operations as operator*(LLVector3, LLMatrix4)
+		__m128 o[3];
+		for (U32 c = 0; c < 3; c++)
+		{
+			o[c] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m[0][c]),
+													_mm_mul_ps(y, m[1][c])),
+										 _mm_mul_ps(z, m[2][c])),
+							  m[3][c]);
+		}
+		llv4store_soa(o[0], o[1], o[2], out);
+	}
+
+	llv4transform_positions_scalar(mat, in + batched, count - batched, out);
+}
+
+void llv4transform_normals(const LLMatrix3& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out)
+{
+	if (!llv4is_aligned(in))
+	{
+		llv4transform_normals_scalar(mat, in, count, out);
+		return;
+	}
+
+	__m128 m[3][3];
+	for (U32 r = 0; r < 3; r++)
+	{
+		for (U32 c = 0; c < 3; c++)
+		{
+			m[r][c] = _mm_set1_ps(mat.mMatrix[r][c]);
+		}
+	}
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 threshold = _mm_set1_ps(FP_MAG_THRESHOLD);
+
+	U32 batched = count & ~3;
+	for (U32 i = 0; i < batched; i += 4)
+	{
+		__m128 x, y, z;
+		llv4load_soa(in + i, x, y, z);
+
+		// same order of operations as operator*(LLVector3, LLMatrix3)
+		__m128 o[3];
+		for (U32 c = 0; c < 3; c++)
+		{
+			o[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m[0][c]),
+										 _mm_mul_ps(y, m[1][c])),
+							  _mm_mul_ps(z, m[2][c]));
+		}
+
+		// and as LLVector3::normVec(), degenerate normals become zero
+		__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(o[0], o[0]),
+													   _mm_mul_ps(o[1], o[1])),
+											_mm_mul_ps(o[2], o[2])));
+		__m128 valid = _mm_cmpgt_ps(mag, threshold);
+		__m128 oomag = _mm_div_ps(one, mag);
+		for (U32 c = 0; c < 3; c++)
+		{
+			o[c] = _mm_and_ps(valid, _mm_mul_ps(o[c], oomag));
+		}
+		llv4store_soa(o[0], o[1], o[2], out);
+	}
+
+	llv4transform_normals_scalar(mat, in + batched, count - batched, out);
+}
+
+#else // LL_VECTORIZE
+
+void llv4transform_positions(const LLMatrix4& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out)
+{
+	llv4transform_positions_scalar(mat, in, count, out);
+}
+
+void llv4transform_normals(const LLMatrix3& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out)
+{
+	llv4transform_normals_scalar(mat, in, count, out);
+}
+
+#endif // LL_VECTORIZE
@@ -0,0 +1,56 @@
+/** 
+ * @file llv4transform.h
+ * @brief Batched vertex transforms - vector processor enabled math
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLV4TRANSFORM_H
+#define LL_LLV4TRANSFORM_H
+
+#include "llstrider.h"
+
+class LLMatrix3;
+class LLMatrix4;
+class LLVector3;
+
+// Transforms count vertices from a packed stream into a (possibly
+// interleaved) vertex buffer. Results match the scalar
+// "in[i] * mat" and "(in[i] * mat).normVec()" loops they replace exactly.
+//
+// When LL_VECTORIZE is set and in is LLV4Allocator aligned, vertices are
+// processed four at a time; otherwise this is the scalar loop.
+
+void llv4transform_positions(const LLMatrix4& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out);
+void llv4transform_normals(const LLMatrix3& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out);
+
+// Plain per vertex versions, for comparison
+void llv4transform_positions_scalar(const LLMatrix4& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out);
+void llv4transform_normals_scalar(const LLMatrix3& mat, const LLVector3* in, U32 count, LLStrider<LLVector3>& out);
+
+#endif
@@ -34,6 +34,7 @@
 
 #include <set>
 
+#include "llcrc.h"
 #include "llerror.h"
 #include "llmemtype.h"
 
@@ -1661,7 +1662,8 @@ LLProfile::~LLProfile()
 }
 
 
-S32 LLVolume::sNumMeshPoints = 0;
+LLAtomicS32 LLVolume::sNumMeshPoints;
+LLVolumeGeometryCache* LLVolume::sGeometryCache = NULL;
 
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
 	: mParams(params)
@@ -1686,10 +1688,15 @@ LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL ge
 
 	mGenerateSingleFace = generate_single_face;
 
-	generate();
-	if (mParams.getSculptID().isNull())
+	if (mParams.getSculptID().notNull())
+	{
+		generate(); // until sculpt() is called with the sculpt map
+	}
+	else if (!loadCachedGeometry(mSculptLevel, 0))
 	{
+		generate();
 		createVolumeFaces();
+		storeCachedGeometry(0);
 	}
 }
 
@@ -1705,6 +1712,254 @@ void LLVolume::regen()
 	createVolumeFaces();
 }
 
+void LLVolume::swapGeometry(LLVolume& other)
+{
+	llassert(mParams == other.mParams && mDetail == other.mDetail);
+	std::swap(mPathp, other.mPathp);
+	std::swap(mProfilep, other.mProfilep);
+	mMesh.swap(other.mMesh);
+	mVolumeFaces.swap(other.mVolumeFaces);
+	std::swap(mFaceMask, other.mFaceMask);
+	std::swap(mSculptLevel, other.mSculptLevel);
+}
+
+//-----------------------------------------------------------------------------
+// Geometry serialization, for LLVolumeGeometryCache
+
+namespace
+{
+	template <class T>
+	void pack_value(std::vector<U8>& data, const T& value)
+	{
+		const U8* bytes = (const U8*)&value;
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <class V>
+	void pack_vector(std::vector<U8>& data, const V& vec)
+	{
+		U32 count = (U32)vec.size();
+		pack_value(data, count);
+		if (count)
+		{
+			const U8* bytes = (const U8*)&vec[0];
+			data.insert(data.end(), bytes, bytes + count * sizeof(typename V::value_type));
+		}
+	}
+
+	// Reads back what pack_value() and pack_vector() wrote, failing rather
+	// than reading past the end of the data
+	class geometry_reader
+	{
+	public:
+		geometry_reader(const U8* data, U32 size) : mData(data), mLeft(size) { }
+
+		template <class T>
+		bool read(T& value)
+		{
+			if (mLeft < sizeof(T))
+			{
+				return false;
+			}
+			memcpy(&value, mData, sizeof(T));		/* Flawfinder: ignore */
+			mData += sizeof(T);
+			mLeft -= sizeof(T);
+			return true;
+		}
+
+		template <class V>
+		bool readVector(V& vec)
+		{
+			U32 count;
+			if (!read(count) || count > mLeft / sizeof(typename V::value_type))
+			{
+				return false;
+			}
+			vec.resize(count);
+			if (count)
+			{
+				U32 bytes = count * sizeof(typename V::value_type);
+				memcpy(&vec[0], mData, bytes);		/* Flawfinder: ignore */
+				mData += bytes;
+				mLeft -= bytes;
+			}
+			return true;
+		}
+
+		bool atEnd() const { return mLeft == 0; }
+
+	private:
+		const U8* mData;
+		U32 mLeft;
+	};
+}
+
+void LLVolume::packGeometry(std::vector<U8>& data) const
+{
+	data.clear();
+	pack_value(data, mFaceMask);
+	pack_value(data, mSculptLevel);
+	pack_value(data, mLODScaleBias);
+
+	pack_vector(data, mPathp->mPath);
+	pack_value(data, mPathp->mOpen);
+	pack_value(data, mPathp->mTotal);
+	pack_value(data, mPathp->mStep);
+
+	pack_vector(data, mProfilep->mProfile);
+	pack_vector(data, mProfilep->mNormals);
+	pack_vector(data, mProfilep->mFaces);
+	pack_vector(data, mProfilep->mEdgeNormals);
+	pack_vector(data, mProfilep->mEdgeCenters);
+	pack_value(data, mProfilep->mOpen);
+	pack_value(data, mProfilep->mConcave);
+	pack_value(data, mProfilep->mTotalOut);
+	pack_value(data, mProfilep->mTotal);
+
+	pack_vector(data, mMesh);
+
+	pack_value(data, (U32)mVolumeFaces.size());
+	for (face_list_t::const_iterator iter = mVolumeFaces.begin(); iter != mVolumeFaces.end(); ++iter)
+	{
+		const LLVolumeFace& face = *iter;
+		pack_value(data, face.mID);
+		pack_value(data, face.mTypeMask);
+		pack_value(data, face.mCenter);
+		pack_value(data, face.mHasBinormals);
+		pack_value(data, face.mBeginS);
+		pack_value(data, face.mBeginT);
+		pack_value(data, face.mNumS);
+		pack_value(data, face.mNumT);
+		pack_value(data, face.mExtents[0]);
+		pack_value(data, face.mExtents[1]);
+		pack_vector(data, face.mPositions);
+		pack_vector(data, face.mNormals);
+		pack_vector(data, face.mBinormals);
+		pack_vector(data, face.mTexCoords);
+		pack_vector(data, face.mIndices);
+		pack_vector(data, face.mEdge);
+	}
+}
+
+BOOL LLVolume::unpackGeometry(const U8* data, U32 size)
+{
+	LLMemType m1(LLMemType::MTYPE_VOLUME);
+	geometry_reader reader(data, size);
+
+	// Read everything aside first, so that bad data leaves us as we were
+	U32 face_mask;
+	S32 sculpt_level;
+	LLVector3 lod_scale_bias;
+	std::vector<LLPath::PathPt> path;
+	BOOL path_open;
+	S32 path_total;
+	F32 path_step;
+	std::vector<LLVector3> profile;
+	std::vector<LLVector2> profile_normals;
+	std::vector<LLProfile::Face> profile_faces;
+	std::vector<LLVector3> edge_normals;
+	std::vector<LLVector3> edge_centers;
+	BOOL profile_open;
+	BOOL profile_concave;
+	S32 profile_total_out;
+	S32 profile_total;
+	std::vector<Point> mesh;
+	U32 num_faces;
+	if (!reader.read(face_mask) || !reader.read(sculpt_level) || !reader.read(lod_scale_bias) ||
+		!reader.readVector(path) || !reader.read(path_open) || !reader.read(path_total) || !reader.read(path_step) ||
+		!reader.readVector(profile) || !reader.readVector(profile_normals) || !reader.readVector(profile_faces) ||
+		!reader.readVector(edge_normals) || !reader.readVector(edge_centers) ||
+		!reader.read(profile_open) || !reader.read(profile_concave) ||
+		!reader.read(profile_total_out) || !reader.read(profile_total) ||
+		!reader.readVector(mesh) || !reader.read(num_faces) ||
+		mesh.size() != path.size() * profile.size() ||
+		(!mGenerateSingleFace && num_faces != profile_faces.size()))
+	{
+		return FALSE;
+	}
+
+	face_list_t faces(num_faces);
+	for (U32 i = 0; i < num_faces; i++)
+	{
+		LLVolumeFace& face = faces[i];
+		if (!reader.read(face.mID) || !reader.read(face.mTypeMask) || !reader.read(face.mCenter) ||
+			!reader.read(face.mHasBinormals) || !reader.read(face.mBeginS) || !reader.read(face.mBeginT) ||
+			!reader.read(face.mNumS) || !reader.read(face.mNumT) ||
+			!reader.read(face.mExtents[0]) || !reader.read(face.mExtents[1]) ||
+			!reader.readVector(face.mPositions) || !reader.readVector(face.mNormals) ||
+			!reader.readVector(face.mBinormals) || !reader.readVector(face.mTexCoords) ||
+			!reader.readVector(face.mIndices) || !reader.readVector(face.mEdge))
+		{
+			return FALSE;
+		}
+		U32 num_vertices = face.getNumVertices();
+		if (face.mNormals.size() != num_vertices || face.mBinormals.size() != num_vertices ||
+			face.mTexCoords.size() != num_vertices || face.mEdge.size() > face.mIndices.size())
+		{
+			return FALSE;
+		}
+		for (U32 j = 0; j < face.mIndices.size(); j++)
+		{
+			if (face.mIndices[j] >= num_vertices)
+			{
+				return FALSE;
+			}
+		}
+	}
+	if (!reader.atEnd())
+	{
+		return FALSE;
+	}
+
+	mFaceMask = face_mask;
+	mSculptLevel = sculpt_level;
+	mLODScaleBias = lod_scale_bias;
+
+	mPathp->mPath.swap(path);
+	mPathp->mOpen = path_open;
+	mPathp->mTotal = path_total;
+	mPathp->mStep = path_step;
+	mPathp->mDirty = FALSE;
+
+	mProfilep->mProfile.swap(profile);
+	mProfilep->mNormals.swap(profile_normals);
+	mProfilep->mFaces.swap(profile_faces);
+	mProfilep->mEdgeNormals.swap(edge_normals);
+	mProfilep->mEdgeCenters.swap(edge_centers);
+	mProfilep->mOpen = profile_open;
+	mProfilep->mConcave = profile_concave;
+	mProfilep->mTotalOut = profile_total_out;
+	mProfilep->mTotal = profile_total;
+	mProfilep->mDirty = FALSE;
+
+	sNumMeshPoints -= mMesh.size();
+	mMesh.swap(mesh);
+	sNumMeshPoints += mMesh.size();
+
+	mVolumeFaces.swap(faces);
+	return TRUE;
+}
+
+BOOL LLVolume::isCacheable() const
+{
+	// Unique and flexible volumes are regenerated whenever they change
+	return sGeometryCache && !mUnique && !mGenerateSingleFace &&
+		mParams.getPathParams().getCurveType() != LL_PCODE_PATH_FLEXIBLE;
+}
+
+BOOL LLVolume::loadCachedGeometry(S32 sculpt_level, U32 sculpt_crc)
+{
+	return isCacheable() && sGeometryCache->loadGeometry(this, sculpt_level, sculpt_crc);
+}
+
+void LLVolume::storeCachedGeometry(U32 sculpt_crc) const
+{
+	if (isCacheable())
+	{
+		sGeometryCache->storeGeometry(this, sculpt_crc);
+	}
+}
+
 void LLVolume::genBinormals(S32 face)
 {
 	mVolumeFaces[face].createBinormals();
@@ -2205,6 +2460,21 @@ void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
 		data_is_empty = TRUE;
 	}
 
+	// The sculpt map identifies the geometry better than the sculpt
+	// texture ID and level alone, which a local texture may keep across edits
+	U32 sculpt_crc = 0;
+	BOOL cacheable = !data_is_empty && isCacheable();
+	if (cacheable)
+	{
+		LLCRC crc;
+		crc.update(sculpt_data, (size_t)sculpt_width * sculpt_height * sculpt_components);
+		sculpt_crc = crc.getCRC();
+		if (loadCachedGeometry(sculpt_level, sculpt_crc))
+		{
+			return;
+		}
+	}
+
 	S32 requested_sizeS = 0;
 	S32 requested_sizeT = 0;
 
@@ -2261,6 +2531,11 @@ void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
 	mVolumeFaces.clear();
 	
 	createVolumeFaces();
+
+	if (cacheable)
+	{
+		storeCachedGeometry(sculpt_crc);
+	}
 }
 
 
@@ -3416,9 +3691,9 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				S32 v3 = face.mIndices[j*3+2];
 
 				//get current face center
-				LLVector3 cCenter = (face.mVertices[v1].mPosition + 
-									face.mVertices[v2].mPosition + 
-									face.mVertices[v3].mPosition) / 3.0f;
+				LLVector3 cCenter = (face.mPositions[v1] + 
+									face.mPositions[v2] + 
+									face.mPositions[v3]) / 3.0f;
 
 				//for each edge
 				for (S32 k = 0; k < 3; k++) {
@@ -3436,9 +3711,9 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 					v3 = face.mIndices[nIndex*3+2];
 
 					//get neighbor face center
-					LLVector3 nCenter = (face.mVertices[v1].mPosition + 
-									face.mVertices[v2].mPosition + 
-									face.mVertices[v3].mPosition) / 3.0f;
+					LLVector3 nCenter = (face.mPositions[v1] + 
+									face.mPositions[v2] + 
+									face.mPositions[v3]) / 3.0f;
 
 					//draw line
 					vertices.push_back(cCenter);
@@ -3461,15 +3736,15 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 #elif DEBUG_SILHOUETTE_NORMALS
 
 			//for each vertex
-			for (U32 j = 0; j < face.mVertices.size(); j++) {
-				vertices.push_back(face.mVertices[j].mPosition);
-				vertices.push_back(face.mVertices[j].mPosition + face.mVertices[j].mNormal*0.1f);
+			for (U32 j = 0; j < face.mPositions.size(); j++) {
+				vertices.push_back(face.mPositions[j]);
+				vertices.push_back(face.mPositions[j] + face.mNormals[j]*0.1f);
 				normals.push_back(LLVector3(0,0,1));
 				normals.push_back(LLVector3(0,0,1));
 				segments.push_back(vertices.size());
 #if DEBUG_SILHOUETTE_BINORMALS
-				vertices.push_back(face.mVertices[j].mPosition);
-				vertices.push_back(face.mVertices[j].mPosition + face.mVertices[j].mBinormal*0.1f);
+				vertices.push_back(face.mPositions[j]);
+				vertices.push_back(face.mPositions[j] + face.mBinormals[j]*0.1f);
 				normals.push_back(LLVector3(0,0,1));
 				normals.push_back(LLVector3(0,0,1));
 				segments.push_back(vertices.size());
@@ -3495,8 +3770,8 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				S32 v2 = face.mIndices[j*3+1];
 				S32 v3 = face.mIndices[j*3+2];
 
-				LLVector3 norm = (face.mVertices[v1].mPosition - face.mVertices[v2].mPosition) % 
-					(face.mVertices[v2].mPosition - face.mVertices[v3].mPosition);
+				LLVector3 norm = (face.mPositions[v1] - face.mPositions[v2]) % 
+					(face.mPositions[v2] - face.mPositions[v3]);
 				
 				if (norm.magVecSquared() < 0.00000001f) 
 				{
@@ -3505,7 +3780,7 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				else 
 				{
 					//get view vector
-					LLVector3 view = (obj_cam_vec-face.mVertices[v1].mPosition);
+					LLVector3 view = (obj_cam_vec-face.mPositions[v1]);
 					bool away = view * norm > 0.0f; 
 					if (away) 
 					{
@@ -3552,13 +3827,13 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 						S32 v1 = face.mIndices[j*3+k];
 						S32 v2 = face.mIndices[j*3+((k+1)%3)];
 						
-						vertices.push_back(face.mVertices[v1].mPosition*mat);
-						LLVector3 norm1 = face.mVertices[v1].mNormal * norm_mat;
+						vertices.push_back(face.mPositions[v1]*mat);
+						LLVector3 norm1 = face.mNormals[v1] * norm_mat;
 						norm1.normVec();
 						normals.push_back(norm1);
 
-						vertices.push_back(face.mVertices[v2].mPosition*mat);
-						LLVector3 norm2 = face.mVertices[v2].mNormal * norm_mat;
+						vertices.push_back(face.mPositions[v2]*mat);
+						LLVector3 norm2 = face.mNormals[v2] * norm_mat;
 						norm2.normVec();
 						normals.push_back(norm2);
 
@@ -3617,9 +3892,9 @@ S32 LLVolume::lineSegmentIntersect(const LLVector3& start, const LLVector3& end,
 
 				F32 a, b, t;
 			
-				if (LLTriangleRayIntersect(face.mVertices[index1].mPosition,
-										   face.mVertices[index2].mPosition,
-										   face.mVertices[index3].mPosition,
+				if (LLTriangleRayIntersect(face.mPositions[index1],
+										   face.mPositions[index2],
+										   face.mPositions[index3],
 										   start, dir, &a, &b, &t, FALSE))
 				{
 					if ((t >= 0.f) &&      // if hit is after start
@@ -3636,24 +3911,24 @@ S32 LLVolume::lineSegmentIntersect(const LLVector3& start, const LLVector3& end,
 			
 						if (tex_coord != NULL)
 			{
-							*tex_coord = ((1.f - a - b)  * face.mVertices[index1].mTexCoord +
-										  a              * face.mVertices[index2].mTexCoord +
-										  b              * face.mVertices[index3].mTexCoord);
+							*tex_coord = ((1.f - a - b)  * face.mTexCoords[index1] +
+										  a              * face.mTexCoords[index2] +
+										  b              * face.mTexCoords[index3]);
 
 						}
 
 						if (normal != NULL)
 				{
-							*normal    = ((1.f - a - b)  * face.mVertices[index1].mNormal + 
-										  a              * face.mVertices[index2].mNormal +
-										  b              * face.mVertices[index3].mNormal);
+							*normal    = ((1.f - a - b)  * face.mNormals[index1] + 
+										  a              * face.mNormals[index2] +
+										  b              * face.mNormals[index3]);
 						}
 
 						if (bi_normal != NULL)
 					{
-							*bi_normal = ((1.f - a - b)  * face.mVertices[index1].mBinormal + 
-										  a              * face.mVertices[index2].mBinormal +
-										  b              * face.mVertices[index3].mBinormal);
+							*bi_normal = ((1.f - a - b)  * face.mBinormals[index1] + 
+										  a              * face.mBinormals[index2] +
+										  b              * face.mBinormals[index3]);
 						}
 
 					}
@@ -4416,6 +4691,30 @@ BOOL LLVolumeFace::create(LLVolume* volume, BOOL partial_build)
 	}
 }
 
+void LLVolumeFace::resizeVertices(U32 count)
+{
+	mPositions.resize(count);
+	mNormals.resize(count);
+	mBinormals.resize(count);
+	mTexCoords.resize(count);
+}
+
+void LLVolumeFace::clearVertices()
+{
+	mPositions.clear();
+	mNormals.clear();
+	mBinormals.clear();
+	mTexCoords.clear();
+}
+
+void LLVolumeFace::pushVertex(const VertexData& v)
+{
+	mPositions.push_back(v.mPosition);
+	mNormals.push_back(v.mNormal);
+	mBinormals.push_back(v.mBinormal);
+	mTexCoords.push_back(v.mTexCoord);
+}
+
 void	LerpPlanarVertex(LLVolumeFace::VertexData& v0,
 				   LLVolumeFace::VertexData& v1,
 				   LLVolumeFace::VertexData& v2,
@@ -4490,10 +4789,10 @@ BOOL LLVolumeFace::createUnCutCubeCap(LLVolume* volume, BOOL partial_build)
 
 	if (partial_build)
 	{
-		mVertices.clear();
+		clearVertices();
 	}
 
-	S32	vtop = mVertices.size();
+	S32	vtop = mPositions.size();
 	for(int gx = 0;gx<grid_size+1;gx++){
 		for(int gy = 0;gy<grid_size+1;gy++){
 			VertexData newVert;
@@ -4504,7 +4803,7 @@ BOOL LLVolumeFace::createUnCutCubeCap(LLVolume* volume, BOOL partial_build)
 				newVert,
 				(F32)gx/(F32)grid_size,
 				(F32)gy/(F32)grid_size);
-			mVertices.push_back(newVert);
+			pushVertex(newVert);
 
 			if (gx == 0 && gy == 0)
 			{
@@ -4560,7 +4859,7 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	num_vertices = profile.size();
 	num_indices = (profile.size() - 2)*3;
 
-	mVertices.resize(num_vertices);
+	resizeVertices(num_vertices);
 
 	if (!partial_build)
 	{
@@ -4596,27 +4895,27 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	{
 		if (mTypeMask & TOP_MASK)
 		{
-			mVertices[i].mTexCoord.mV[0] = profile[i].mV[0]+0.5f;
-			mVertices[i].mTexCoord.mV[1] = profile[i].mV[1]+0.5f;
+			mTexCoords[i].mV[0] = profile[i].mV[0]+0.5f;
+			mTexCoords[i].mV[1] = profile[i].mV[1]+0.5f;
 		}
 		else
 		{
 			// Mirror for underside.
-			mVertices[i].mTexCoord.mV[0] = profile[i].mV[0]+0.5f;
-			mVertices[i].mTexCoord.mV[1] = 0.5f - profile[i].mV[1];
+			mTexCoords[i].mV[0] = profile[i].mV[0]+0.5f;
+			mTexCoords[i].mV[1] = 0.5f - profile[i].mV[1];
 		}
 
-		mVertices[i].mPosition = mesh[i + offset].mPos;
+		mPositions[i] = mesh[i + offset].mPos;
 		
 		if (i == 0)
 		{
-			min = max = mVertices[i].mPosition;
-			min_uv = max_uv = mVertices[i].mTexCoord;
+			min = max = mPositions[i];
+			min_uv = max_uv = mTexCoords[i];
 		}
 		else
 		{
-			update_min_max(min,max, mVertices[i].mPosition);
-			update_min_max(min_uv, max_uv, mVertices[i].mTexCoord);
+			update_min_max(min,max, mPositions[i]);
+			update_min_max(min_uv, max_uv, mTexCoords[i]);
 		}
 	}
 
@@ -4625,16 +4924,16 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 
 	LLVector3 binormal = calc_binormal_from_triangle( 
 		mCenter, cuv,
-		mVertices[0].mPosition, mVertices[0].mTexCoord,
-		mVertices[1].mPosition, mVertices[1].mTexCoord);
+		mPositions[0], mTexCoords[0],
+		mPositions[1], mTexCoords[1]);
 	binormal.normVec();
 
 	LLVector3 d0;
 	LLVector3 d1;
 	LLVector3 normal;
 
-	d0 = mCenter-mVertices[0].mPosition;
-	d1 = mCenter-mVertices[1].mPosition;
+	d0 = mCenter-mPositions[0];
+	d1 = mCenter-mPositions[1];
 
 	normal = (mTypeMask & TOP_MASK) ? (d0%d1) : (d1%d0);
 	normal.normVec();
@@ -4647,7 +4946,7 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	
 	if (!(mTypeMask & HOLLOW_MASK) && !(mTypeMask & OPEN_MASK))
 	{
-		mVertices.push_back(vd);
+		pushVertex(vd);
 		num_vertices++;
 		if (!partial_build)
 		{
@@ -4658,8 +4957,8 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	
 	for (S32 i = 0; i < num_vertices; i++)
 	{
-		mVertices[i].mBinormal = binormal;
-		mVertices[i].mNormal = normal;
+		mBinormals[i] = binormal;
+		mNormals[i] = normal;
 	}
 
 	mHasBinormals = TRUE;
@@ -4945,36 +5244,36 @@ void LLVolumeFace::createBinormals()
 		//generate binormals
 		for (U32 i = 0; i < mIndices.size()/3; i++) 
 		{	//for each triangle
-			const VertexData& v0 = mVertices[mIndices[i*3+0]];
-			const VertexData& v1 = mVertices[mIndices[i*3+1]];
-			const VertexData& v2 = mVertices[mIndices[i*3+2]];
+			const S32 i0 = mIndices[i*3+0];
+			const S32 i1 = mIndices[i*3+1];
+			const S32 i2 = mIndices[i*3+2];
 						
 			//calculate binormal
-			LLVector3 binorm = calc_binormal_from_triangle(v0.mPosition, v0.mTexCoord,
-															v1.mPosition, v1.mTexCoord,
-															v2.mPosition, v2.mTexCoord);
+			LLVector3 binorm = calc_binormal_from_triangle(mPositions[i0], mTexCoords[i0],
+															mPositions[i1], mTexCoords[i1],
+															mPositions[i2], mTexCoords[i2]);
 
 			for (U32 j = 0; j < 3; j++) 
 			{ //add triangle normal to vertices
-				mVertices[mIndices[i*3+j]].mBinormal += binorm; // * (weight_sum - d[j])/weight_sum;
+				mBinormals[mIndices[i*3+j]] += binorm; // * (weight_sum - d[j])/weight_sum;
 			}
 
 			//even out quad contributions
 			if (i % 2 == 0) 
 			{
-				mVertices[mIndices[i*3+2]].mBinormal += binorm;
+				mBinormals[mIndices[i*3+2]] += binorm;
 			}
 			else 
 			{
-				mVertices[mIndices[i*3+1]].mBinormal += binorm;
+				mBinormals[mIndices[i*3+1]] += binorm;
 			}
 		}
 
 		//normalize binormals
-		for (U32 i = 0; i < mVertices.size(); i++) 
+		for (U32 i = 0; i < mPositions.size(); i++) 
 		{
-			mVertices[i].mBinormal.normVec();
-			mVertices[i].mNormal.normVec();
+			mBinormals[i].normVec();
+			mNormals[i].normVec();
 		}
 
 		mHasBinormals = TRUE;
@@ -5007,7 +5306,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 	num_vertices = mNumS*mNumT;
 	num_indices = (mNumS-1)*(mNumT-1)*6;
 
-	mVertices.resize(num_vertices);
+	resizeVertices(num_vertices);
 
 	if (!partial_build)
 	{
@@ -5075,11 +5374,11 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 				i = mBeginS + s + max_s*t;
 			}
 
-			mVertices[cur_vertex].mPosition = mesh[i].mPos;
-			mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
+			mPositions[cur_vertex] = mesh[i].mPos;
+			mTexCoords[cur_vertex] = LLVector2(ss,tt);
 		
-			mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-			mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
+			mNormals[cur_vertex] = LLVector3(0,0,0);
+			mBinormals[cur_vertex] = LLVector3(0,0,0);
 			
 			if (cur_vertex == 0)
 			{
@@ -5094,11 +5393,11 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 
 			if ((mTypeMask & INNER_MASK) && (mTypeMask & FLAT_MASK) && mNumS > 2 && s > 0)
 			{
-				mVertices[cur_vertex].mPosition = mesh[i].mPos;
-				mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
+				mPositions[cur_vertex] = mesh[i].mPos;
+				mTexCoords[cur_vertex] = LLVector2(ss,tt);
 			
-				mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-				mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
+				mNormals[cur_vertex] = LLVector3(0,0,0);
+				mBinormals[cur_vertex] = LLVector3(0,0,0);
 				cur_vertex++;
 			}
 		}
@@ -5116,11 +5415,11 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 
 			i = mBeginS + s + max_s*t;
 			ss = profile[mBeginS + s].mV[2] - begin_stex;
-			mVertices[cur_vertex].mPosition = mesh[i].mPos;
-			mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
+			mPositions[cur_vertex] = mesh[i].mPos;
+			mTexCoords[cur_vertex] = LLVector2(ss,tt);
 		
-			mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-			mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
+			mNormals[cur_vertex] = LLVector3(0,0,0);
+			mBinormals[cur_vertex] = LLVector3(0,0,0);
 
 			update_min_max(face_min,face_max,mesh[i].mPos);
 
@@ -5197,43 +5496,41 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		const S32 i0 = mIndices[i*3+0];
 		const S32 i1 = mIndices[i*3+1];
 		const S32 i2 = mIndices[i*3+2];
-		const VertexData& v0 = mVertices[i0];
-		const VertexData& v1 = mVertices[i1];
-		const VertexData& v2 = mVertices[i2];
+		const LLVector3& p0 = mPositions[i0];
 					
 		//calculate triangle normal
-		LLVector3 norm = (v0.mPosition-v1.mPosition) % (v0.mPosition-v2.mPosition);
+		LLVector3 norm = (p0-mPositions[i1]) % (p0-mPositions[i2]);
 
 		for (U32 j = 0; j < 3; j++) 
 		{ //add triangle normal to vertices
 			const S32 idx = mIndices[i*3+j];
-			mVertices[idx].mNormal += norm; // * (weight_sum - d[j])/weight_sum;
+			mNormals[idx] += norm; // * (weight_sum - d[j])/weight_sum;
 		}
 
 		//even out quad contributions
 		if ((i & 1) == 0) 
 		{
-			mVertices[i2].mNormal += norm;
+			mNormals[i2] += norm;
 		}
 		else 
 		{
-			mVertices[i1].mNormal += norm;
+			mNormals[i1] += norm;
 		}
 	}
 	
 	// adjust normals based on wrapping and stitching
 	
-	BOOL s_bottom_converges = ((mVertices[0].mPosition - mVertices[mNumS*(mNumT-2)].mPosition).magVecSquared() < 0.000001f);
-	BOOL s_top_converges = ((mVertices[mNumS-1].mPosition - mVertices[mNumS*(mNumT-2)+mNumS-1].mPosition).magVecSquared() < 0.000001f);
+	BOOL s_bottom_converges = ((mPositions[0] - mPositions[mNumS*(mNumT-2)]).magVecSquared() < 0.000001f);
+	BOOL s_top_converges = ((mPositions[mNumS-1] - mPositions[mNumS*(mNumT-2)+mNumS-1]).magVecSquared() < 0.000001f);
 	if (sculpt_stitching == LL_SCULPT_TYPE_NONE)  // logic for non-sculpt volumes
 	{
 		if (volume->getPath().isOpen() == FALSE)
 		{ //wrap normals on T
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				LLVector3 norm = mVertices[i].mNormal + mVertices[mNumS*(mNumT-1)+i].mNormal;
-				mVertices[i].mNormal = norm;
-				mVertices[mNumS*(mNumT-1)+i].mNormal = norm;
+				LLVector3 norm = mNormals[i] + mNormals[mNumS*(mNumT-1)+i];
+				mNormals[i] = norm;
+				mNormals[mNumS*(mNumT-1)+i] = norm;
 			}
 		}
 
@@ -5241,9 +5538,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{ //wrap normals on S
 			for (S32 i = 0; i < mNumT; i++)
 			{
-				LLVector3 norm = mVertices[mNumS*i].mNormal + mVertices[mNumS*i+mNumS-1].mNormal;
-				mVertices[mNumS * i].mNormal = norm;
-				mVertices[mNumS * i+mNumS-1].mNormal = norm;
+				LLVector3 norm = mNormals[mNumS*i] + mNormals[mNumS*i+mNumS-1];
+				mNormals[mNumS * i] = norm;
+				mNormals[mNumS * i+mNumS-1] = norm;
 			}
 		}
 	
@@ -5254,7 +5551,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			{ //all lower S have same normal
 				for (S32 i = 0; i < mNumT; i++)
 				{
-					mVertices[mNumS*i].mNormal = LLVector3(1,0,0);
+					mNormals[mNumS*i] = LLVector3(1,0,0);
 				}
 			}
 
@@ -5262,7 +5559,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			{ //all upper S have same normal
 				for (S32 i = 0; i < mNumT; i++)
 				{
-					mVertices[mNumS*i+mNumS-1].mNormal = LLVector3(-1,0,0);
+					mNormals[mNumS*i+mNumS-1] = LLVector3(-1,0,0);
 				}
 			}
 		}
@@ -5293,13 +5590,13 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			LLVector3 average(0.0, 0.0, 0.0);
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				average += mVertices[i].mNormal;
+				average += mNormals[i];
 			}
 
 			// set average
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				mVertices[i].mNormal = average;
+				mNormals[i] = average;
 			}
 
 			// average normals for south pole
@@ -5307,13 +5604,13 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			average = LLVector3(0.0, 0.0, 0.0);
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				average += mVertices[i + mNumS * (mNumT - 1)].mNormal;
+				average += mNormals[i + mNumS * (mNumT - 1)];
 			}
 
 			// set average
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				mVertices[i + mNumS * (mNumT - 1)].mNormal = average;
+				mNormals[i + mNumS * (mNumT - 1)] = average;
 			}
 
 		}
@@ -5323,9 +5620,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{
 			for (S32 i = 0; i < mNumT; i++)
 			{
-				LLVector3 norm = mVertices[mNumS*i].mNormal + mVertices[mNumS*i+mNumS-1].mNormal;
-				mVertices[mNumS * i].mNormal = norm;
-				mVertices[mNumS * i+mNumS-1].mNormal = norm;
+				LLVector3 norm = mNormals[mNumS*i] + mNormals[mNumS*i+mNumS-1];
+				mNormals[mNumS * i] = norm;
+				mNormals[mNumS * i+mNumS-1] = norm;
 			}
 		}
 
@@ -5335,9 +5632,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				LLVector3 norm = mVertices[i].mNormal + mVertices[mNumS*(mNumT-1)+i].mNormal;
-				mVertices[i].mNormal = norm;
-				mVertices[mNumS*(mNumT-1)+i].mNormal = norm;
+				LLVector3 norm = mNormals[i] + mNormals[mNumS*(mNumT-1)+i];
+				mNormals[i] = norm;
+				mNormals[mNumS*(mNumT-1)+i] = norm;
 			}
 			
 		}
@@ -44,6 +44,7 @@ class LLVolumeFace;
 class LLVolume;
 
 #include "lldarray.h"
+#include "llapr.h"
 #include "lluuid.h"
 #include "v4color.h"
 //#include "vmath.h"
@@ -54,6 +55,7 @@ class LLVolume;
 #include "v4coloru.h"
 #include "llmemory.h"
 #include "llfile.h"
+#include "llv4allocator.h"
 
 //============================================================================
 
@@ -707,6 +709,7 @@ public:
 	std::vector<LLVector3> mEdgeCenters;
 
 	friend std::ostream& operator<<(std::ostream &s, const LLProfile &profile);
+	friend class LLVolume; // for packGeometry()/unpackGeometry()
 
 protected:
 	void genNormals(const LLProfileParams& params);
@@ -765,6 +768,7 @@ public:
 	void resizePath(S32 length) { mPath.resize(length); }
 
 	friend std::ostream& operator<<(std::ostream &s, const LLPath &path);
+	friend class LLVolume; // for packGeometry()/unpackGeometry()
 
 public:
 	std::vector<PathPt> mPath;
@@ -802,6 +806,7 @@ public:
 	BOOL create(LLVolume* volume, BOOL partial_build = FALSE);
 	void createBinormals();
 
+	// One vertex gathered from (or to be scattered into) the streams below
 	class VertexData
 	{
 	public:
@@ -811,6 +816,14 @@ public:
 		LLVector2 mTexCoord;
 	};
 
+	typedef std::vector<LLVector3, LLV4Allocator<LLVector3> > vector3_stream_t;
+	typedef std::vector<LLVector2, LLV4Allocator<LLVector2> > vector2_stream_t;
+
+	U32 getNumVertices() const						{ return (U32) mPositions.size(); }
+	void resizeVertices(U32 count);
+	void clearVertices();
+	void pushVertex(const VertexData& v);
+
 	enum
 	{
 		SINGLE_MASK =	0x0001,
@@ -840,7 +853,13 @@ public:
 
 	LLVector3 mExtents[2]; //minimum and maximum point of face
 
-	std::vector<VertexData> mVertices;
+	// Vertex attributes, one stream each so that they can be transformed in
+	// bulk. All four always have getNumVertices() entries.
+	vector3_stream_t	mPositions;
+	vector3_stream_t	mNormals;
+	vector3_stream_t	mBinormals;
+	vector2_stream_t	mTexCoords;
+
 	std::vector<U16>	mIndices;
 	std::vector<S32>	mEdge;
 
@@ -850,6 +869,21 @@ private:
 	BOOL createSide(LLVolume* volume, BOOL partial_build = FALSE);
 };
 
+// Keeps generated volume geometry across sessions, see LLVolumeCache in the
+// viewer. Volumes are generated on worker threads too, so implementations
+// must be thread safe.
+class LLVolumeGeometryCache
+{
+public:
+	virtual ~LLVolumeGeometryCache() { }
+
+	// Fills in the geometry of volume from an earlier volume with the same
+	// parameters and detail, sculpted at sculpt_level from a sculpt map with
+	// CRC sculpt_crc (both unused for plain prims). FALSE on a miss.
+	virtual BOOL loadGeometry(LLVolume* volume, S32 sculpt_level, U32 sculpt_crc) = 0;
+	virtual void storeGeometry(const LLVolume* volume, U32 sculpt_crc) = 0;
+};
+
 class LLVolume : public LLRefCount
 {
 	friend class LLVolumeLODGroup;
@@ -891,6 +925,19 @@ public:
 	void setDirty() { mPathp->setDirty(); mProfilep->setDirty(); }
 
 	void regen();
+	// Exchanges the generated path, profile, mesh and faces with a volume
+	// built from the same parameters, so that geometry generated off the
+	// main thread can replace that of a volume in use.
+	void swapGeometry(LLVolume& other);
+
+	// Serialized path, profile, mesh and faces, for LLVolumeGeometryCache.
+	// Bump GEOMETRY_VERSION when the layout changes.
+	enum { GEOMETRY_VERSION = 1 };
+	void packGeometry(std::vector<U8>& data) const;
+	// Returns FALSE, leaving the volume untouched, if data is malformed
+	BOOL unpackGeometry(const U8* data, U32 size);
+
+	static void setGeometryCache(LLVolumeGeometryCache* cache)	{ sGeometryCache = cache; }
 	void genBinormals(S32 face);
 
 	BOOL isConvex() const;
@@ -938,7 +985,7 @@ public:
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
+	static LLAtomicS32 sNumMeshPoints; // volumes may be generated on worker threads
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -961,6 +1008,9 @@ private:
 protected:
 	BOOL generate();
 	void createVolumeFaces();
+	BOOL isCacheable() const;
+	BOOL loadCachedGeometry(S32 sculpt_level, U32 sculpt_crc);
+	void storeCachedGeometry(U32 sculpt_crc) const;
 
  protected:
 	BOOL mUnique;
@@ -975,6 +1025,8 @@ protected:
 	BOOL mGenerateSingleFace;
 	typedef std::vector<LLVolumeFace> face_list_t;
 	face_list_t mVolumeFaces;
+
+	static LLVolumeGeometryCache* sGeometryCache;
 };
 
 std::ostream& operator<<(std::ostream &s, const LLVolumeParams &volume_params);
@@ -179,6 +179,44 @@ void LLVolumeMgr::unrefVolume(LLVolume *volumep)
 
 }
 
+BOOL LLVolumeMgr::hasVolume(const LLVolumeParams &volume_params, const S32 detail) const
+{
+	BOOL res = FALSE;
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	volume_lod_group_map_t::const_iterator iter = mVolumeLODGroups.find(&volume_params);
+	if (iter != mVolumeLODGroups.end())
+	{
+		res = iter->second->hasLOD(detail);
+	}
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+	return res;
+}
+
+BOOL LLVolumeMgr::insertVolume(LLVolume *volumep, const S32 detail)
+{
+	BOOL res = FALSE;
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	volume_lod_group_map_t::iterator iter = mVolumeLODGroups.find(&volumep->getParams());
+	if (iter != mVolumeLODGroups.end())
+	{
+		res = iter->second->insertLOD(detail, volumep);
+	}
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+	return res;
+}
+
 // protected
 void LLVolumeMgr::insertGroup(LLVolumeLODGroup* volgroup)
 {
@@ -310,6 +348,17 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	return mVolumeLODs[detail];
 }
 
+BOOL LLVolumeLODGroup::insertLOD(const S32 detail, LLVolume* volumep)
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	if (mVolumeLODs[detail].notNull())
+	{
+		return FALSE;
+	}
+	mVolumeLODs[detail] = volumep;
+	return TRUE;
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
@@ -62,6 +62,10 @@ public:
 
 	LLVolume* refLOD(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
+	BOOL hasLOD(const S32 detail) const { return mVolumeLODs[detail].notNull(); }
+	// Takes a volume built elsewhere (e.g. off the main thread) for an empty
+	// LOD slot. Returns FALSE if the slot has been filled in the meantime.
+	BOOL insertLOD(const S32 detail, LLVolume* volumep);
 	S32 getNumRefs() const { return mRefs; }
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
@@ -95,6 +99,12 @@ public:
 	LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail);
 	void unrefVolume(LLVolume *volumep);
 
+	// TRUE if the LOD is already generated, so that refVolume() is cheap
+	BOOL hasVolume(const LLVolumeParams &volume_params, const S32 detail) const;
+	// Hands a volume generated outside refVolume() to its LOD group. Fails
+	// if nothing references the group any more or the LOD exists already.
+	BOOL insertVolume(LLVolume *volumep, const S32 detail);
+
 	void dump();
 
 	// manually call this for mutex magic
@@ -137,11 +137,9 @@ LLCircuitData::~LLCircuitData()
 
 	// remove all pending reliable messages on this circuit
 	std::vector<TPACKETID> doomed;
-	reliable_iter iter;
-	reliable_iter end = mUnackedPackets.end();
-	for(iter = mUnackedPackets.begin(); iter != end; ++iter)
+	while ((packetp = mUnackedPackets.getFirst()))
 	{
-		packetp = iter->second;
+		mUnackedPackets.remove(packetp->mPacketID);
 		gMessageSystem->mFailedResendPackets++;
 		if(gMessageSystem->mVerboseLog)
 		{
@@ -156,14 +154,13 @@ LLCircuitData::~LLCircuitData()
 		mUnackedPacketCount--;
 		mUnackedPacketBytes -= packetp->mBufferLength;
 
-		delete packetp;
+		LLReliablePacket::release(packetp);
 	}
 
 	// remove all pending final retry reliable messages on this circuit
-	end = mFinalRetryPackets.end();
-	for(iter = mFinalRetryPackets.begin(); iter != end; ++iter)
+	while ((packetp = mFinalRetryPackets.getFirst()))
 	{
-		packetp = iter->second;
+		mFinalRetryPackets.remove(packetp->mPacketID);
 		gMessageSystem->mFailedResendPackets++;
 		if(gMessageSystem->mVerboseLog)
 		{
@@ -178,7 +175,7 @@ LLCircuitData::~LLCircuitData()
 		mUnackedPacketCount--;
 		mUnackedPacketBytes -= packetp->mBufferLength;
 
-		delete packetp;
+		LLReliablePacket::release(packetp);
 	}
 
 	// log aborted reliable packets for this circuit.
@@ -195,49 +192,28 @@ LLCircuitData::~LLCircuitData()
 
 void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 {
-	reliable_iter iter;
-	LLReliablePacket *packetp;
+	ackReliablePackets(&packet_num, 1);
+}
 
-	iter = mUnackedPackets.find(packet_num);
-	if (iter != mUnackedPackets.end())
-	{
-		packetp = iter->second;
 
-		if(gMessageSystem->mVerboseLog)
+void LLCircuitData::ackReliablePackets(const TPACKETID* packet_nums, S32 count)
+{
+	BOOL verbose = gMessageSystem->mVerboseLog;
+	for (S32 i = 0; i < count; i++)
+	{
+		LLReliablePacket *packetp = mUnackedPackets.remove(packet_nums[i]);
+		if (!packetp)
 		{
-			std::ostringstream str;
-			str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
-				<< packetp->mPacketID;
-			llinfos << str.str() << llendl;
+			packetp = mFinalRetryPackets.remove(packet_nums[i]);
 		}
-		if (packetp->mCallback)
+		if (!packetp)
 		{
-			if (packetp->mTimeout < 0.f)   // negative timeout will always return timeout even for successful ack, for debugging
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);					
-			}
-			else
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
-			}
+			// Couldn't find this packet on either of the unacked lists.
+			// maybe it's a duplicate ack?
+			continue;
 		}
 
-		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
-
-		// Cleanup
-		delete packetp;
-		mUnackedPackets.erase(iter);
-		return;
-	}
-
-	iter = mFinalRetryPackets.find(packet_num);
-	if (iter != mFinalRetryPackets.end())
-	{
-		packetp = iter->second;
-		// llinfos << "Packet " << packet_num << " removed from the pending list" << llendl;
-		if(gMessageSystem->mVerboseLog)
+		if(verbose)
 		{
 			std::ostringstream str;
 			str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
@@ -261,13 +237,7 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 		mUnackedPacketBytes -= packetp->mBufferLength;
 
 		// Cleanup
-		delete packetp;
-		mFinalRetryPackets.erase(iter);
-	}
-	else
-	{
-		// Couldn't find this packet on either of the unacked lists.
-		// maybe it's a duplicate ack?
+		LLReliablePacket::release(packetp);
 	}
 }
 
@@ -279,18 +249,14 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 	LLReliablePacket *packetp;
 
 
-	//
-	// Theoretically we should search through the list for the packet with the oldest
-	// packet ID, as otherwise when we WRAP we will resend reliable packets out of order.
-	// Since resends are ALREADY out of order, and wrapping is highly rare (16+million packets),
-	// I'm not going to worry about this for now - djs
-	//
-
-	reliable_iter iter;
+	// The rings are walked oldest packet first, also when the packet ids wrap.
+	// Walks step by packet id, so packets may move between the rings
+	// (or be added by callbacks) as they go.
+	TPACKETID packet_id = 0;
 	BOOL have_resend_overflow = FALSE;
-	for (iter = mUnackedPackets.begin(); iter != mUnackedPackets.end();)
+	for (packetp = mUnackedPackets.getFirst(); packetp; packetp = mUnackedPackets.getNext(packet_id))
 	{
-		packetp = iter->second;
+		packet_id = packetp->mPacketID;
 
 		// Only check overflow if we haven't had one yet.
 		if (!have_resend_overflow)
@@ -311,12 +277,8 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 					// This circuit has overflowed.  Do not retry.  Do not pass go.
 					packetp->mRetries = 0;
 					// Remove it from this list and add it to the final list.
-					mUnackedPackets.erase(iter++);
-					mFinalRetryPackets[packetp->mPacketID] = packetp;
-				}
-				else
-				{
-					++iter;
+					mUnackedPackets.remove(packet_id);
+					mFinalRetryPackets.insert(packetp);
 				}
 				// Move on to the next unacked packet.
 				continue;
@@ -371,27 +333,18 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 			if (!packetp->mRetries)
 			{
 				// Last resend, remove it from this list and add it to the final list.
-				mUnackedPackets.erase(iter++);
-				mFinalRetryPackets[packetp->mPacketID] = packetp;
-			}
-			else
-			{
-				// Don't remove it yet, it still gets to try to resend at least once.
-				++iter;
+				mUnackedPackets.remove(packet_id);
+				mFinalRetryPackets.insert(packetp);
 			}
+			// else don't remove it yet, it still gets to try to resend at least once.
 			resent_packets++;
 		}
-		else
-		{
-			// Don't need to do anything with this packet, keep iterating.
-			++iter;
-		}
 	}
 
 
-	for (iter = mFinalRetryPackets.begin(); iter != mFinalRetryPackets.end();)
+	for (packetp = mFinalRetryPackets.getFirst(); packetp; packetp = mFinalRetryPackets.getNext(packet_id))
 	{
-		packetp = iter->second;
+		packet_id = packetp->mPacketID;
 		if (now > packetp->mExpirationTime)
 		{
 			// fail (too many retries)
@@ -410,6 +363,7 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 				llinfos << str.str() << llendl;
 			}
 
+			mFinalRetryPackets.remove(packet_id);
 			if (packetp->mCallback)
 			{
 				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);
@@ -419,12 +373,7 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 			mUnackedPacketCount--;
 			mUnackedPacketBytes -= packetp->mBufferLength;
 
-			mFinalRetryPackets.erase(iter++);
-			delete packetp;
-		}
-		else
-		{
-			++iter;
+			LLReliablePacket::release(packetp);
 		}
 	}
 
@@ -571,18 +520,18 @@ void LLCircuitData::addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLR
 {
 	LLReliablePacket *packet_info;
 
-	packet_info = new LLReliablePacket(mSocket, buf_ptr, buf_len, params);
+	packet_info = LLReliablePacket::create(mSocket, buf_ptr, buf_len, params);
 
 	mUnackedPacketCount++;
 	mUnackedPacketBytes += packet_info->mBufferLength;
 
 	if (params && params->mRetries)
 	{
-		mUnackedPackets[packet_info->mPacketID] = packet_info;
+		mUnackedPackets.insert(packet_info);
 	}
 	else
 	{
-		mFinalRetryPackets[packet_info->mPacketID] = packet_info;
+		mFinalRetryPackets.insert(packet_info);
 	}
 }
 
@@ -867,92 +816,33 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 	// for the packet that it was out of order with was received BEFORE
 	// the ping was sent.
 
-	// Find the current oldest reliable packetID
-	// This is to handle the case if we actually manage to wrap our
-	// packet IDs - the oldest will actually have a higher packet ID
-	// than the current.
-	BOOL wrapped = FALSE;
-	reliable_iter iter;
-	iter = mUnackedPackets.upper_bound(getPacketOutID());
-	if (iter == mUnackedPackets.end())
+	// Find the current oldest reliable packetID, the one furthest behind
+	// the next outgoing ID across both rings, so a wrap of the packet IDs
+	// doesn't make the oldest look like the newest.
+	TPACKETID packet_id;
+	if (mUnackedPackets.isEmpty() && mFinalRetryPackets.isEmpty())
 	{
-		// Nothing AFTER this one, so we want the lowest packet ID
-		// then.
-		iter = mUnackedPackets.begin();
-		wrapped = TRUE;
+		// Wow!  No unacked packets at all!
+		// Send the ID of the last packet we sent out.
+		// This will flush all of the destination's
+		// unacked packets, theoretically.
+		packet_id = getPacketOutID();
 	}
-
-	TPACKETID packet_id = 0;
-
-	// Check against the "final" packets
-	BOOL wrapped_final = FALSE;
-	reliable_iter iter_final;
-	iter_final = mFinalRetryPackets.upper_bound(getPacketOutID());
-	if (iter_final == mFinalRetryPackets.end())
+	else if (mFinalRetryPackets.isEmpty())
 	{
-		iter_final = mFinalRetryPackets.begin();
-		wrapped_final = TRUE;
+		packet_id = mUnackedPackets.getOldestID();
 	}
-
-	//llinfos << mHost << " - unacked count " << mUnackedPackets.size() << llendl;
-	//llinfos << mHost << " - final count " << mFinalRetryPackets.size() << llendl;
-	if (wrapped != wrapped_final)
+	else if (mUnackedPackets.isEmpty())
 	{
-		// One of the "unacked" or "final" lists hasn't wrapped.  Whichever one
-		// hasn't has the oldest packet.
-		if (!wrapped)
-		{
-			// Hasn't wrapped, so the one on the
-			// unacked packet list is older
-			packet_id = iter->first;
-			//llinfos << mHost << ": nowrapped unacked" << llendl;
-		}
-		else
-		{
-			packet_id = iter_final->first;
-			//llinfos << mHost << ": nowrapped final" << llendl;
-		}
+		packet_id = mFinalRetryPackets.getOldestID();
 	}
 	else
 	{
-		// They both wrapped, we can just use the minimum of the two.
-		if ((iter == mUnackedPackets.end()) && (iter_final == mFinalRetryPackets.end()))
-		{
-			// Wow!  No unacked packets at all!
-			// Send the ID of the last packet we sent out.
-			// This will flush all of the destination's
-			// unacked packets, theoretically.
-			//llinfos << mHost << ": No unacked!" << llendl;
-			packet_id = getPacketOutID();
-		}
-		else
-		{
-			BOOL had_unacked = FALSE;
-			if (iter != mUnackedPackets.end())
-			{
-				// Unacked list has the lowest so far
-				packet_id = iter->first;
-				had_unacked = TRUE;
-				//llinfos << mHost << ": Unacked" << llendl;
-			}
-
-			if (iter_final != mFinalRetryPackets.end())
-			{
-				// Use the lowest of the unacked list and the final list
-				if (had_unacked)
-				{
-					// Both had a packet, use the lowest.
-					packet_id = llmin(packet_id, iter_final->first);
-					//llinfos << mHost << ": Min of unacked/final" << llendl;
-				}
-				else
-				{
-					// Only the final had a packet, use it.
-					packet_id = iter_final->first;
-					//llinfos << mHost << ": Final!" << llendl;
-				}
-			}
-		}
+		TPACKETID unacked_id = mUnackedPackets.getOldestID();
+		TPACKETID final_id = mFinalRetryPackets.getOldestID();
+		TPACKETID out_id = getPacketOutID();
+		packet_id = (((out_id - unacked_id) & LL_PACKET_ID_MASK) >= ((out_id - final_id) & LL_PACKET_ID_MASK))
+					? unacked_id : final_id;
 	}
 
 	// Send off the another ping.
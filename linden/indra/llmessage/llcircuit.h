@@ -98,6 +98,8 @@ public:
 	void		pingTimerStart();
 	void		pingTimerStop(const U8 ping_id);
 	void			ackReliablePacket(TPACKETID packet_num);
+	// Acks count packets at once, e.g. all the acks carried by one packet
+	void			ackReliablePackets(const TPACKETID* packet_nums, S32 count);
 
 	// remote computer information
 	const LLUUID& getRemoteID() const { return mRemoteID; }
@@ -245,11 +247,8 @@ protected:
 	packet_time_map							mRecentlyReceivedReliablePackets;
 	std::vector<TPACKETID> mAcks;
 
-	typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
-	typedef reliable_map::iterator					reliable_iter;
-
-	reliable_map							mUnackedPackets;
-	reliable_map							mFinalRetryPackets;
+	LLReliablePacketRing					mUnackedPackets;
+	LLReliablePacketRing					mFinalRetryPackets;
 
 	S32										mUnackedPacketCount;
 	S32										mUnackedPacketBytes;
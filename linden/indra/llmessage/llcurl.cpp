@@ -68,10 +68,11 @@
 	rather than create and destroy them with each request.  This
 	code does this.
 
-	Furthermore, it would behoove us to keep track of which
-	hosts an easy handle was used for and pick an easy handle
-	that matches the next request.  This code does not current
-	do this.
+	Furthermore, each easy handle remembers the host it was last
+	used for, and LLCurl::Multi::allocEasy() prefers a free handle
+	that matches the next request.  LLCurlRequest keeps its multi
+	handle (and with it the connection cache) for as long as it
+	works, rather than starting a new one every few requests.
  */
 
 //////////////////////////////////////////////////////////////////////////////
@@ -85,6 +86,19 @@ static const S32 MAX_ACTIVE_REQUEST_COUNT = 100;
 S32 gCurlEasyCount = 0;
 S32 gCurlMultiCount = 0;
 
+// Connection reuse, see LLCurl::getRequestCount()
+static LLAtomicU32 sCurlRequestCount;
+static LLAtomicU32 sCurlConnectCount;
+static LLAtomicU32 sCurlReuseCount;
+
+// "http://host:port" part of a url
+static std::string get_url_host(const std::string& url)
+{
+	size_t start = url.find("://");
+	start = (start == std::string::npos) ? 0 : start + 3;
+	return url.substr(0, url.find('/', start));
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 //static
@@ -226,6 +240,8 @@ public:
 	
 	const char* getErrorBuffer();
 
+	const std::string& getHost() const { return mHost; }
+
 	std::stringstream& getInput() { return mInput; }
 	std::stringstream& getHeaderOutput() { return mHeaderOutput; }
 	LLIOPipe::buffer_ptr_t& getOutput() { return mOutput; }
@@ -248,6 +264,9 @@ private:
 	std::vector<char*>	mStrings;
 	
 	ResponderPtr		mResponder;
+
+	// host of the last request, its connection may still be open
+	std::string			mHost;
 };
 
 LLCurl::Easy::Easy()
@@ -370,6 +389,18 @@ U32 LLCurl::Easy::report(CURLcode code)
 	{
 		curl_easy_getinfo(mCurlEasyHandle, CURLINFO_RESPONSE_CODE, &responseCode);
 		//*TODO: get reason from first line of mHeaderOutput
+
+		long connects = 0;
+		curl_easy_getinfo(mCurlEasyHandle, CURLINFO_NUM_CONNECTS, &connects);
+		sCurlRequestCount++;
+		if (connects > 0)
+		{
+			sCurlConnectCount++;
+		}
+		else
+		{
+			sCurlReuseCount++;
+		}
 	}
 	else
 	{
@@ -499,6 +530,7 @@ void LLCurl::Easy::prepRequest(const std::string& url,
 	setopt(CURLOPT_TIMEOUT, CURL_REQUEST_TIMEOUT);
 
 	setoptString(CURLOPT_URL, url);
+	mHost = get_url_host(url);
 
 	mResponder = responder;
 
@@ -525,7 +557,9 @@ public:
 	Multi();
 	~Multi();
 
-	Easy* allocEasy();
+	void setConnectionOptions(bool pipelining, S32 max_connections);
+
+	Easy* allocEasy(const std::string& host = LLStringUtil::null);
 	bool addEasy(Easy* easy);
 	
 	void removeEasy(Easy* easy);
@@ -535,8 +569,11 @@ public:
 	
 	CURLMsg* info_read(S32* msgs_in_queue);
 
+	S32 getActiveCount() const { return (S32)mEasyActiveList.size(); }
+
 	S32 mQueued;
 	S32 mErrorCount;
+	S32 mTransferErrorCount; // failures below HTTP, the multi may be broken
 	
 private:
 	void easyFree(Easy*);
@@ -549,11 +586,14 @@ private:
 	easy_active_map_t mEasyActiveMap;
 	typedef std::set<Easy*> easy_free_list_t;
 	easy_free_list_t mEasyFreeList;
+	S32 mMaxFreeEasy;
 };
 
 LLCurl::Multi::Multi()
 	: mQueued(0),
-	  mErrorCount(0)
+	  mErrorCount(0),
+	  mTransferErrorCount(0),
+	  mMaxFreeEasy(EASY_HANDLE_POOL_SIZE)
 {
 	mCurlMultiHandle = curl_multi_init();
 	if (!mCurlMultiHandle)
@@ -586,6 +626,17 @@ LLCurl::Multi::~Multi()
 	--gCurlMultiCount;
 }
 
+void LLCurl::Multi::setConnectionOptions(bool pipelining, S32 max_connections)
+{
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_PIPELINING, pipelining ? 1L : 0L);
+	if (max_connections > 0)
+	{
+		curl_multi_setopt(mCurlMultiHandle, CURLMOPT_MAXCONNECTS, (long)max_connections);
+		// keep an easy handle around for each connection
+		mMaxFreeEasy = llmax(max_connections, EASY_HANDLE_POOL_SIZE);
+	}
+}
+
 CURLMsg* LLCurl::Multi::info_read(S32* msgs_in_queue)
 {
 	CURLMsg* curlmsg = curl_multi_info_read(mCurlMultiHandle, msgs_in_queue);
@@ -639,15 +690,20 @@ S32 LLCurl::Multi::process()
 			}
 			if (response >= 400)
 			{
-				// failure of some sort, inc mErrorCount for debugging and flagging multi for destruction
+				// failure of some sort, inc mErrorCount for debugging
 				++mErrorCount;
 			}
+			if (msg->data.result != CURLE_OK)
+			{
+				// flags the multi for destruction
+				++mTransferErrorCount;
+			}
 		}
 	}
 	return processed;
 }
 
-LLCurl::Easy* LLCurl::Multi::allocEasy()
+LLCurl::Easy* LLCurl::Multi::allocEasy(const std::string& host)
 {
 	Easy* easy = 0;
 
@@ -657,7 +713,17 @@ LLCurl::Easy* LLCurl::Multi::allocEasy()
 	}
 	else
 	{
+		// Prefer a handle that last talked to the same host
 		easy = *(mEasyFreeList.begin());
+		for (easy_free_list_t::iterator iter = mEasyFreeList.begin();
+			 iter != mEasyFreeList.end(); ++iter)
+		{
+			if ((*iter)->getHost() == host)
+			{
+				easy = *iter;
+				break;
+			}
+		}
 		mEasyFreeList.erase(easy);
 	}
 	if (easy)
@@ -683,7 +749,7 @@ void LLCurl::Multi::easyFree(Easy* easy)
 {
 	mEasyActiveList.erase(easy);
 	mEasyActiveMap.erase(easy->getCurlHandle());
-	if (mEasyFreeList.size() < EASY_HANDLE_POOL_SIZE)
+	if ((S32)mEasyFreeList.size() < mMaxFreeEasy)
 	{
 		easy->resetState();
 		mEasyFreeList.insert(easy);
@@ -700,6 +766,24 @@ void LLCurl::Multi::removeEasy(Easy* easy)
 	easyFree(easy);
 }
 
+//static
+U32 LLCurl::getRequestCount()
+{
+	return sCurlRequestCount;
+}
+
+//static
+U32 LLCurl::getConnectCount()
+{
+	return sCurlConnectCount;
+}
+
+//static
+U32 LLCurl::getReuseCount()
+{
+	return sCurlReuseCount;
+}
+
 //static
 std::string LLCurl::strerror(CURLcode errorcode)
 {
@@ -720,37 +804,50 @@ std::string LLCurl::strerror(CURLcode errorcode)
 
 LLCurlRequest::LLCurlRequest() :
 	mActiveMulti(NULL),
-	mActiveRequestCount(0)
+	mPipelining(false),
+	mMaxConnections(0)
 {
 	mThreadID = LLThread::currentID();
 }
 
 LLCurlRequest::~LLCurlRequest()
 {
-	llassert_always(mThreadID == LLThread::currentID());
+	llassert_always(!mThreadID || mThreadID == LLThread::currentID());
 	for_each(mMultiSet.begin(), mMultiSet.end(), DeletePointer());
 }
 
+void LLCurlRequest::setConnectionOptions(bool pipelining, S32 max_connections)
+{
+	llassert_always(!mThreadID || mThreadID == LLThread::currentID());
+	mPipelining = pipelining;
+	mMaxConnections = max_connections;
+	if (mActiveMulti)
+	{
+		mActiveMulti->setConnectionOptions(mPipelining, mMaxConnections);
+	}
+}
+
 void LLCurlRequest::addMulti()
 {
-	llassert_always(mThreadID == LLThread::currentID());
+	llassert_always(!mThreadID || mThreadID == LLThread::currentID());
 	LLCurl::Multi* multi = new LLCurl::Multi();
+	multi->setConnectionOptions(mPipelining, mMaxConnections);
 	mMultiSet.insert(multi);
 	mActiveMulti = multi;
-	mActiveRequestCount = 0;
 }
 
-LLCurl::Easy* LLCurlRequest::allocEasy()
+LLCurl::Easy* LLCurlRequest::allocEasy(const std::string& url)
 {
+	// The connection cache belongs to the multi, so only start a new one
+	// when this one is full or broken
 	if (!mActiveMulti ||
-		mActiveRequestCount	>= MAX_ACTIVE_REQUEST_COUNT ||
-		mActiveMulti->mErrorCount > 0)
+		mActiveMulti->getActiveCount() >= MAX_ACTIVE_REQUEST_COUNT ||
+		mActiveMulti->mTransferErrorCount > 0)
 	{
 		addMulti();
 	}
 	llassert_always(mActiveMulti);
-	++mActiveRequestCount;
-	LLCurl::Easy* easy = mActiveMulti->allocEasy();
+	LLCurl::Easy* easy = mActiveMulti->allocEasy(get_url_host(url));
 	return easy;
 }
 
@@ -771,7 +868,7 @@ bool LLCurlRequest::getByteRange(const std::string& url,
 								 S32 offset, S32 length,
 								 LLCurl::ResponderPtr responder)
 {
-	LLCurl::Easy* easy = allocEasy();
+	LLCurl::Easy* easy = allocEasy(url);
 	if (!easy)
 	{
 		return false;
@@ -794,7 +891,7 @@ bool LLCurlRequest::post(const std::string& url,
 						 const LLSD& data,
 						 LLCurl::ResponderPtr responder)
 {
-	LLCurl::Easy* easy = allocEasy();
+	LLCurl::Easy* easy = allocEasy(url);
 	if (!easy)
 	{
 		return false;
@@ -819,7 +916,7 @@ bool LLCurlRequest::post(const std::string& url,
 // Note: call once per frame
 S32 LLCurlRequest::process()
 {
-	llassert_always(mThreadID == LLThread::currentID());
+	llassert_always(!mThreadID || mThreadID == LLThread::currentID());
 	S32 res = 0;
 	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
 		 iter != mMultiSet.end(); )
@@ -839,7 +936,7 @@ S32 LLCurlRequest::process()
 
 S32 LLCurlRequest::getQueued()
 {
-	llassert_always(mThreadID == LLThread::currentID());
+	llassert_always(!mThreadID || mThreadID == LLThread::currentID());
 	S32 queued = 0;
 	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
 		 iter != mMultiSet.end(); )
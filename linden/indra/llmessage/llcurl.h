@@ -165,6 +165,14 @@ public:
 	 * @ brief curl error code -> string
 	 */
 	static std::string strerror(CURLcode errorcode);
+
+	/**
+	 * @ brief Completed requests, and how many of them had to open a new
+	 * connection rather than reuse a kept alive one.
+	 */
+	static U32 getRequestCount();
+	static U32 getConnectCount();
+	static U32 getReuseCount();
 	
 	// For OpenSSL callbacks
 	static std::vector<LLMutex*> sSSLMutex;
@@ -193,6 +201,17 @@ public:
 	LLCurlRequest();
 	~LLCurlRequest();
 
+	// Requests go out over a shared pool of kept alive connections, at most
+	// max_connections of them (0 = curl default). With pipelining, requests
+	// to a host that has no idle connection are queued behind the ones in
+	// flight instead of opening a new connection.
+	void setConnectionOptions(bool pipelining, S32 max_connections);
+
+	// Turns off the check that the request is only used by the thread that
+	// created it, for owners that serialize access some other way (a serial
+	// LLThreadPool queue hops between pool threads).
+	void detachThread() { mThreadID = 0; }
+
 	void get(const std::string& url, LLCurl::ResponderPtr responder);
 	bool getByteRange(const std::string& url, const headers_t& headers, S32 offset, S32 length, LLCurl::ResponderPtr responder);
 	bool post(const std::string& url, const headers_t& headers, const LLSD& data, LLCurl::ResponderPtr responder);
@@ -201,14 +220,15 @@ public:
 
 private:
 	void addMulti();
-	LLCurl::Easy* allocEasy();
+	LLCurl::Easy* allocEasy(const std::string& url);
 	bool addEasy(LLCurl::Easy* easy);
 	
 private:
 	typedef std::set<LLCurl::Multi*> curlmulti_set_t;
 	curlmulti_set_t mMultiSet;
 	LLCurl::Multi* mActiveMulti;
-	S32 mActiveRequestCount;
+	bool mPipelining;
+	S32 mMaxConnections;
 	U32 mThreadID; // debug
 };
 
@@ -0,0 +1,162 @@
+/**
+ * @file llmessagedecoder.cpp
+ * @brief Support for the message decoders generated from the message template
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmessagedecoder.h"
+
+// static
+F32 LLMessageDecoder::readF32(const U8* p, const char* block, const char* var)
+{
+	F32 v;
+	htonmemcpy(&v, p, MVT_F32, sizeof(v));
+	if (!llfinite(v))
+	{
+		llwarns << "non-finite in readF32 " << block << " " << var << llendl;
+		v = 0.f;
+	}
+	return v;
+}
+
+// static
+F64 LLMessageDecoder::readF64(const U8* p, const char* block, const char* var)
+{
+	F64 v;
+	htonmemcpy(&v, p, MVT_F64, sizeof(v));
+	if (!llfinite(v))
+	{
+		llwarns << "non-finite in readF64 " << block << " " << var << llendl;
+		v = 0.0;
+	}
+	return v;
+}
+
+// static
+LLVector3 LLMessageDecoder::readVector3(const U8* p, const char* block, const char* var)
+{
+	LLVector3 v;
+	htonmemcpy(v.mV, p, MVT_LLVector3, sizeof(v.mV));
+	if (!v.isFinite())
+	{
+		llwarns << "non-finite in readVector3 " << block << " " << var << llendl;
+		v.zeroVec();
+	}
+	return v;
+}
+
+// static
+LLVector3d LLMessageDecoder::readVector3d(const U8* p, const char* block, const char* var)
+{
+	LLVector3d v;
+	htonmemcpy(v.mdV, p, MVT_LLVector3d, sizeof(v.mdV));
+	if (!v.isFinite())
+	{
+		llwarns << "non-finite in readVector3d " << block << " " << var << llendl;
+		v.zeroVec();
+	}
+	return v;
+}
+
+// static
+LLVector4 LLMessageDecoder::readVector4(const U8* p, const char* block, const char* var)
+{
+	LLVector4 v;
+	htonmemcpy(v.mV, p, MVT_LLVector4, sizeof(v.mV));
+	if (!v.isFinite())
+	{
+		llwarns << "non-finite in readVector4 " << block << " " << var << llendl;
+		v.zeroVec();
+	}
+	return v;
+}
+
+// static
+LLQuaternion LLMessageDecoder::readQuat(const U8* p, const char* block, const char* var)
+{
+	// Only x, y and z are sent
+	LLVector3 vec;
+	htonmemcpy(vec.mV, p, MVT_LLQuaternion, sizeof(vec.mV));
+	LLQuaternion q;
+	if (vec.isFinite())
+	{
+		q.unpackFromVector3(vec);
+	}
+	else
+	{
+		llwarns << "non-finite in readQuat " << block << " " << var << llendl;
+		q.loadIdentity();
+	}
+	return q;
+}
+
+// static
+S32 LLMessageDecoder::readVariableSize(const U8* p, S32 size_bytes)
+{
+	switch (size_bytes)
+	{
+	case 1:
+		return *p;
+	case 2:
+		return readU16(p);
+	default:
+		return (S32)readU32(p);
+	}
+}
+
+// static
+void LLMessageDecoder::readString(const U8* p, S32 size, std::string& str)
+{
+	S32 max_length = llmin(size, MTUBYTES - 1);
+	S32 length = 0;
+	while (length < max_length && p[length])
+	{
+		length++;
+	}
+	str.assign((const char*)p, length);
+}
+
+// static
+BOOL LLMessageDecoder::getMessageBody(LLMessageSystem* msg, U32 message_number, const U8*& body, S32& size)
+{
+	return msg && msg->getTemplateMessageBody(message_number, body, size);
+}
+
+const U8* LLMessageDecoder::padBody(const U8* body, S32 size, S32 padding)
+{
+	mPadded.assign(size + padding, 0);
+	if (size > 0)
+	{
+		memcpy(&mPadded[0], body, size);
+	}
+	return &mPadded[0];
+}
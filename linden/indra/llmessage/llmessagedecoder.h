@@ -0,0 +1,123 @@
+/**
+ * @file llmessagedecoder.h
+ * @brief Support for the message decoders generated from the message template
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGEDECODER_H
+#define LL_LLMESSAGEDECODER_H
+
+#include <vector>
+
+#include "llquaternion.h"
+#include "lluuid.h"
+#include "message.h"
+#include "v3dmath.h"
+#include "v3math.h"
+#include "v4math.h"
+
+// Base of the decoders in llmessagedecoders.h, which LLMessageDecoderGenerator
+// writes from message_template.msg. A decoder walks a message once, noting
+// where each block starts and where its variable length fields end, and
+// then reads fields straight out of the packet at offsets fixed when it was
+// generated. LLTemplateMessageReader instead copies every field into its
+// own buffer and finds it again by name on each get.
+//
+// Decoders point into the packet, so they are only good while the handler
+// that made them runs.
+class LLMessageDecoder
+{
+public:
+	// Field readers, with the same conversions and checks as the
+	// LLTemplateMessageReader getters.
+	static U8 readU8(const U8* p)			{ return *p; }
+	static S8 readS8(const U8* p)			{ return (S8)*p; }
+	static BOOL readBOOL(const U8* p)		{ return (BOOL)*p; }
+	static U16 readU16(const U8* p)			{ U16 v; htonmemcpy(&v, p, MVT_U16, sizeof(v)); return v; }
+	static S16 readS16(const U8* p)			{ S16 v; htonmemcpy(&v, p, MVT_S16, sizeof(v)); return v; }
+	static U32 readU32(const U8* p)			{ U32 v; htonmemcpy(&v, p, MVT_U32, sizeof(v)); return v; }
+	static S32 readS32(const U8* p)			{ S32 v; htonmemcpy(&v, p, MVT_S32, sizeof(v)); return v; }
+	static U64 readU64(const U8* p)			{ U64 v; htonmemcpy(&v, p, MVT_U64, sizeof(v)); return v; }
+	static S64 readS64(const U8* p)			{ S64 v; htonmemcpy(&v, p, MVT_S64, sizeof(v)); return v; }
+	static U32 readIPAddr(const U8* p)		{ U32 v; memcpy(&v, p, sizeof(v)); return v; }
+	static U16 readIPPort(const U8* p)		{ U16 v; memcpy(&v, p, sizeof(v)); return ntohs(v); }
+	static LLUUID readUUID(const U8* p)		{ LLUUID v; memcpy(v.mData, p, sizeof(v.mData)); return v; }
+
+	static F32 readF32(const U8* p, const char* block, const char* var);
+	static F64 readF64(const U8* p, const char* block, const char* var);
+	static LLVector3 readVector3(const U8* p, const char* block, const char* var);
+	static LLVector3d readVector3d(const U8* p, const char* block, const char* var);
+	static LLVector4 readVector4(const U8* p, const char* block, const char* var);
+	static LLQuaternion readQuat(const U8* p, const char* block, const char* var);
+
+	// Length of a variable field, from its size_bytes long length prefix
+	static S32 readVariableSize(const U8* p, S32 size_bytes);
+	// Copies a variable field holding a string like getString() does
+	static void readString(const U8* p, S32 size, std::string& str);
+
+protected:
+	LLMessageDecoder() {}
+
+	// The body of the message msg is currently dispatching, if it is a
+	// template message with the given number
+	static BOOL getMessageBody(LLMessageSystem* msg, U32 message_number, const U8*& body, S32& size);
+
+	// Steps pos over the variable field there, FALSE if it runs past size
+	static BOOL skipVariable(const U8* body, S32 size, S32& pos, S32 size_bytes)
+	{
+		if (pos + size_bytes > size)
+		{
+			return FALSE;
+		}
+		S32 length = readVariableSize(body + pos, size_bytes);
+		pos += size_bytes;
+		if (length < 0 || length > size - pos)
+		{
+			return FALSE;
+		}
+		pos += length;
+		return TRUE;
+	}
+
+	// Returns a copy of body followed by padding zero bytes, for messages
+	// cut short by senders with older templates. The reader treats missing
+	// fields as zero and missing blocks as absent, which is what decoding
+	// the copy gives.
+	const U8* padBody(const U8* body, S32 size, S32 padding);
+
+private:
+	// Decoded offsets can point into mPadded
+	LLMessageDecoder(const LLMessageDecoder&);
+	LLMessageDecoder& operator=(const LLMessageDecoder&);
+
+	std::vector<U8> mPadded;
+};
+
+#endif // LL_LLMESSAGEDECODER_H
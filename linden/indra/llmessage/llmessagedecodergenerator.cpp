@@ -0,0 +1,569 @@
+/**
+ * @file llmessagedecodergenerator.cpp
+ * @brief Writes llmessagedecoders.h/.cpp from the message template
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmessagedecodergenerator.h"
+
+#include <ostream>
+
+#include "llformat.h"
+#include "llmessagetemplate.h"
+#include "llmessagetemplateparser.h"
+
+namespace
+{
+	// Where a field sits: the variable field it follows, or the start of
+	// the block, and how many bytes past that.
+	struct field_offset
+	{
+		S32 mSegment;
+		S32 mOffset;
+	};
+
+	typedef std::vector<field_offset> field_offset_vec_t;
+
+	S32 get_offsets(const LLMessageBlock* block, field_offset_vec_t& offsets)
+	{
+		field_offset offset = { 0, 0 };
+		for (LLMessageBlock::message_variable_map_t::const_iterator iter = block->mMemberVariables.begin();
+			 iter != block->mMemberVariables.end(); ++iter)
+		{
+			const LLMessageVariable* var = *iter;
+			offsets.push_back(offset);
+			if (var->getType() == MVT_VARIABLE)
+			{
+				offset.mSegment++;
+				offset.mOffset = 0;
+			}
+			else
+			{
+				offset.mOffset += var->getSize();
+			}
+		}
+		return offset.mSegment + 1;
+	}
+
+	const char* get_value_type(EMsgVariableType type)
+	{
+		switch (type)
+		{
+		case MVT_U8:			return "U8";
+		case MVT_U16:			return "U16";
+		case MVT_U32:			return "U32";
+		case MVT_U64:			return "U64";
+		case MVT_S8:			return "S8";
+		case MVT_S16:			return "S16";
+		case MVT_S32:			return "S32";
+		case MVT_S64:			return "S64";
+		case MVT_F32:			return "F32";
+		case MVT_F64:			return "F64";
+		case MVT_LLVector3:		return "LLVector3";
+		case MVT_LLVector3d:	return "LLVector3d";
+		case MVT_LLVector4:		return "LLVector4";
+		case MVT_LLQuaternion:	return "LLQuaternion";
+		case MVT_LLUUID:		return "LLUUID";
+		case MVT_BOOL:			return "BOOL";
+		case MVT_IP_ADDR:		return "U32";
+		case MVT_IP_PORT:		return "U16";
+		default:				return NULL;
+		}
+	}
+
+	const char* get_reader(EMsgVariableType type)
+	{
+		switch (type)
+		{
+		case MVT_U8:			return "readU8";
+		case MVT_U16:			return "readU16";
+		case MVT_U32:			return "readU32";
+		case MVT_U64:			return "readU64";
+		case MVT_S8:			return "readS8";
+		case MVT_S16:			return "readS16";
+		case MVT_S32:			return "readS32";
+		case MVT_S64:			return "readS64";
+		case MVT_F32:			return "readF32";
+		case MVT_F64:			return "readF64";
+		case MVT_LLVector3:		return "readVector3";
+		case MVT_LLVector3d:	return "readVector3d";
+		case MVT_LLVector4:		return "readVector4";
+		case MVT_LLQuaternion:	return "readQuat";
+		case MVT_LLUUID:		return "readUUID";
+		case MVT_BOOL:			return "readBOOL";
+		case MVT_IP_ADDR:		return "readIPAddr";
+		case MVT_IP_PORT:		return "readIPPort";
+		default:				return NULL;
+		}
+	}
+
+	// The float readers name the field in their warnings
+	bool reader_takes_names(EMsgVariableType type)
+	{
+		switch (type)
+		{
+		case MVT_F32:
+		case MVT_F64:
+		case MVT_LLVector3:
+		case MVT_LLVector3d:
+		case MVT_LLVector4:
+		case MVT_LLQuaternion:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	std::string get_block_class(const LLMessageBlock* block)
+	{
+		return std::string(block->mName) + "Block";
+	}
+
+	std::string get_block_member(const LLMessageBlock* block)
+	{
+		return std::string("m") + block->mName;
+	}
+
+	std::string get_segment(const field_offset& offset)
+	{
+		std::string segment = llformat("mSeg[%d]", offset.mSegment);
+		if (offset.mOffset)
+		{
+			segment += llformat(" + %d", offset.mOffset);
+		}
+		return segment;
+	}
+
+	// Fixed bytes and length prefixes only
+	S32 get_min_size(const LLMessageBlock* block)
+	{
+		S32 size = 0;
+		for (LLMessageBlock::message_variable_map_t::const_iterator iter = block->mMemberVariables.begin();
+			 iter != block->mMemberVariables.end(); ++iter)
+		{
+			size += (*iter)->getSize();
+		}
+		return size;
+	}
+
+	// The size accessor of variable field Foo is getFooSize(), unless the
+	// block already has a FooSize field
+	std::string get_size_accessor(const LLMessageBlock* block, const LLMessageVariable* var)
+	{
+		std::string name = std::string(var->getName()) + "Size";
+		for (LLMessageBlock::message_variable_map_t::const_iterator iter = block->mMemberVariables.begin();
+			 iter != block->mMemberVariables.end(); ++iter)
+		{
+			if (name == (*iter)->getName())
+			{
+				return std::string("get") + var->getName() + "Length";
+			}
+		}
+		return "get" + name;
+	}
+}
+
+// static
+const char* const LLMessageDecoderGenerator::sDefaultMessages[] =
+{
+	"ObjectUpdate",
+	"ObjectUpdateCompressed",
+	"ObjectUpdateCached",
+	"ImprovedTerseObjectUpdate",
+	"KillObject",
+	"SimulatorViewerTimeMessage",
+	"AvatarAnimation",
+	NULL
+};
+
+LLMessageDecoderGenerator::LLMessageDecoderGenerator(const LLTemplateParser& parser)
+	: mParser(parser)
+{
+}
+
+BOOL LLMessageDecoderGenerator::addMessage(const std::string& name)
+{
+	for (LLTemplateParser::message_iterator iter = mParser.getMessagesBegin();
+		 iter != mParser.getMessagesEnd(); ++iter)
+	{
+		if (name == (*iter)->mName)
+		{
+			mMessages.push_back(*iter);
+			return TRUE;
+		}
+	}
+	llwarns << "No message " << name << " in the template" << llendl;
+	return FALSE;
+}
+
+BOOL LLMessageDecoderGenerator::addDefaultMessages()
+{
+	BOOL found = TRUE;
+	for (S32 i = 0; sDefaultMessages[i]; i++)
+	{
+		found = addMessage(sDefaultMessages[i]) && found;
+	}
+	return found;
+}
+
+// static
+std::string LLMessageDecoderGenerator::getClassName(const LLMessageTemplate* message)
+{
+	return std::string("LLMsg") + message->mName;
+}
+
+// static
+S32 LLMessageDecoderGenerator::getPadding(const LLMessageTemplate* message)
+{
+	S32 padding = 0;
+	for (LLMessageTemplate::message_block_map_t::const_iterator iter = message->mMemberBlocks.begin();
+		 iter != message->mMemberBlocks.end(); ++iter)
+	{
+		const LLMessageBlock* block = *iter;
+		switch (block->mType)
+		{
+		case MBT_SINGLE:
+			padding += get_min_size(block);
+			break;
+		case MBT_MULTIPLE:
+			padding += block->mNumber * get_min_size(block);
+			break;
+		default:
+			// A count, and as many blocks as it can ask for
+			padding += 1 + 255 * get_min_size(block);
+			break;
+		}
+	}
+	return padding;
+}
+
+void LLMessageDecoderGenerator::writeLicense(std::ostream& out, const char* file, const char* brief) const
+{
+	out << "/**\n"
+		<< " * @file " << file << "\n"
+		<< " * @brief " << brief << "\n"
+		<< " *\n"
+		<< " * $LicenseInfo:firstyear=2010&license=viewergpl$\n"
+		<< " *\n"
+		<< " * Copyright (c) 2010, Linden Research, Inc.\n"
+		<< " *\n"
+		<< " * Second Life Viewer Source Code\n"
+		<< " * The source code in this file (\"Source Code\") is provided by Linden Lab\n"
+		<< " * to you under the terms of the GNU General Public License, version 2.0\n"
+		<< " * (\"GPL\"), unless you have obtained a separate licensing agreement\n"
+		<< " * (\"Other License\"), formally executed by you and Linden Lab.  Terms of\n"
+		<< " * the GPL can be found in doc/GPL-license.txt in this distribution, or\n"
+		<< " * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2\n"
+		<< " *\n"
+		<< " * There are special exceptions to the terms and conditions of the GPL as\n"
+		<< " * it is applied to this Source Code. View the full text of the exception\n"
+		<< " * in the file doc/FLOSS-exception.txt in this software distribution, or\n"
+		<< " * online at\n"
+		<< " * http://secondlifegrid.net/programs/open_source/licensing/flossexception\n"
+		<< " *\n"
+		<< " * By copying, modifying or distributing this software, you acknowledge\n"
+		<< " * that you have read and understood your obligations described above,\n"
+		<< " * and agree to abide by those obligations.\n"
+		<< " *\n"
+		<< " * ALL LINDEN LAB SOURCE CODE IS PROVIDED \"AS IS.\" LINDEN LAB MAKES NO\n"
+		<< " * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,\n"
+		<< " * COMPLETENESS OR PERFORMANCE.\n"
+		<< " * $/LicenseInfo$\n"
+		<< " */\n"
+		<< "\n"
+		<< "// Generated by LLMessageDecoderGenerator from message template version "
+		<< llformat("%.1f", mParser.getVersion()) << ".\n"
+		<< "// Do not edit; run tools/msgdecodergen instead.\n"
+		<< "\n";
+}
+
+void LLMessageDecoderGenerator::writeHeader(std::ostream& out) const
+{
+	writeLicense(out, "llmessagedecoders.h", "Decoders for frequent messages, generated from message_template.msg");
+	out << "#ifndef LL_LLMESSAGEDECODERS_H\n"
+		<< "#define LL_LLMESSAGEDECODERS_H\n"
+		<< "\n"
+		<< "#include \"llmessagedecoder.h\"\n";
+
+	for (std::vector<const LLMessageTemplate*>::const_iterator iter = mMessages.begin();
+		 iter != mMessages.end(); ++iter)
+	{
+		out << "\n";
+		writeMessageClass(out, *iter);
+	}
+
+	out << "\n"
+		<< "#endif // LL_LLMESSAGEDECODERS_H\n";
+}
+
+void LLMessageDecoderGenerator::writeSource(std::ostream& out) const
+{
+	writeLicense(out, "llmessagedecoders.cpp", "Decoders for frequent messages, generated from message_template.msg");
+	out << "#include \"linden_common.h\"\n"
+		<< "\n"
+		<< "#include \"llmessagedecoders.h\"\n";
+
+	for (std::vector<const LLMessageTemplate*>::const_iterator iter = mMessages.begin();
+		 iter != mMessages.end(); ++iter)
+	{
+		out << "\n";
+		writeParse(out, *iter);
+	}
+}
+
+void LLMessageDecoderGenerator::writeBlockClass(std::ostream& out, const LLMessageTemplate* message,
+												const LLMessageBlock* block) const
+{
+	field_offset_vec_t offsets;
+	S32 segments = get_offsets(block, offsets);
+
+	out << "\tclass " << get_block_class(block) << "\n"
+		<< "\t{\n"
+		<< "\tpublic:\n";
+
+	S32 i = 0;
+	for (LLMessageBlock::message_variable_map_t::const_iterator iter = block->mMemberVariables.begin();
+		 iter != block->mMemberVariables.end(); ++iter, ++i)
+	{
+		const LLMessageVariable* var = *iter;
+		const char* name = var->getName();
+		std::string segment = get_segment(offsets[i]);
+		EMsgVariableType type = var->getType();
+		if (type == MVT_VARIABLE)
+		{
+			S32 prefix = var->getSize();
+			std::string size_accessor = get_size_accessor(block, var);
+			out << "\t\tconst U8* get" << name << "() const\t{ return " << segment << " + " << prefix << "; }\n"
+				<< "\t\tS32 " << size_accessor << "() const\t{ return readVariableSize(" << segment << ", " << prefix << "); }\n"
+				<< "\t\tvoid get" << name << "(std::string& str) const\t{ readString(get" << name << "(), "
+				<< size_accessor << "(), str); }\n";
+		}
+		else if (get_value_type(type))
+		{
+			out << "\t\t" << get_value_type(type) << " get" << name << "() const\t{ return "
+				<< get_reader(type) << "(" << segment;
+			if (reader_takes_names(type))
+			{
+				out << ", \"" << block->mName << "\", \"" << name << "\"";
+			}
+			out << "); }\n";
+		}
+		else
+		{
+			// MVT_FIXED and the packed arrays, left as bytes
+			out << "\t\tconst U8* get" << name << "() const\t{ return " << segment << "; }\n";
+		}
+	}
+
+	out << "\n"
+		<< "\tprivate:\n"
+		<< "\t\tfriend class " << getClassName(message) << ";\n"
+		<< "\t\tconst U8* mSeg[" << segments << "];\n"
+		<< "\t};\n";
+}
+
+void LLMessageDecoderGenerator::writeMessageClass(std::ostream& out, const LLMessageTemplate* message) const
+{
+	std::string class_name = getClassName(message);
+	LLMessageTemplate::message_block_map_t::const_iterator iter;
+
+	out << "// " << message->mName << "\n"
+		<< "class " << class_name << " : public LLMessageDecoder\n"
+		<< "{\n"
+		<< "public:\n"
+		<< "\tstatic const U32 MESSAGE_NUMBER = " << llformat("0x%08x", message->mMessageNumber) << ";\n";
+
+	std::string counts;
+	for (iter = message->mMemberBlocks.begin(); iter != message->mMemberBlocks.end(); ++iter)
+	{
+		out << "\n";
+		writeBlockClass(out, message, *iter);
+		if ((*iter)->mType == MBT_VARIABLE)
+		{
+			counts += counts.empty() ? " : " : ", ";
+			counts += get_block_member(*iter) + "Count(0)";
+		}
+	}
+
+	out << "\n";
+	if (!counts.empty())
+	{
+		out << "\t" << class_name << "()" << counts << " {}\n"
+			<< "\n";
+	}
+	out << "\t// Decodes the message msg is dispatching, FALSE if it is another\n"
+		<< "\t// message or is malformed\n"
+		<< "\tBOOL decode(LLMessageSystem* msg)\n"
+		<< "\t{\n"
+		<< "\t\tconst U8* body;\n"
+		<< "\t\tS32 size;\n"
+		<< "\t\treturn getMessageBody(msg, MESSAGE_NUMBER, body, size) && decode(body, size);\n"
+		<< "\t}\n"
+		<< "\tBOOL decode(const U8* body, S32 size);\n"
+		<< "\n";
+
+	for (iter = message->mMemberBlocks.begin(); iter != message->mMemberBlocks.end(); ++iter)
+	{
+		const LLMessageBlock* block = *iter;
+		std::string member = get_block_member(block);
+		if (block->mType == MBT_VARIABLE)
+		{
+			out << "\tS32 get" << block->mName << "Count() const\t{ return " << member << "Count; }\n";
+		}
+		else if (block->mType == MBT_MULTIPLE)
+		{
+			out << "\tS32 get" << block->mName << "Count() const\t{ return " << block->mNumber << "; }\n";
+		}
+		out << "\tconst " << get_block_class(block) << "& get" << block->mName << "(S32 i = 0) const\t{ return "
+			<< member << "[i]; }\n";
+	}
+
+	out << "\n"
+		<< "private:\n"
+		<< "\tBOOL parse(const U8* body, S32 size);\n"
+		<< "\n";
+
+	for (iter = message->mMemberBlocks.begin(); iter != message->mMemberBlocks.end(); ++iter)
+	{
+		const LLMessageBlock* block = *iter;
+		std::string member = get_block_member(block);
+		S32 count = block->mType == MBT_SINGLE ? 1 : (block->mType == MBT_MULTIPLE ? block->mNumber : 255);
+		out << "\t" << get_block_class(block) << " " << member << "[" << count << "];\n";
+		if (block->mType == MBT_VARIABLE)
+		{
+			out << "\tS32 " << member << "Count;\n";
+		}
+	}
+	out << "};\n";
+}
+
+void LLMessageDecoderGenerator::writeParse(std::ostream& out, const LLMessageTemplate* message) const
+{
+	std::string class_name = getClassName(message);
+	LLMessageTemplate::message_block_map_t::const_iterator iter;
+
+	out << "BOOL " << class_name << "::decode(const U8* body, S32 size)\n"
+		<< "{\n"
+		<< "\tif (parse(body, size))\n"
+		<< "\t{\n"
+		<< "\t\treturn TRUE;\n"
+		<< "\t}\n"
+		<< "\t// Decode short messages as though zero filled, like the reader\n"
+		<< "\tconst S32 PADDING = " << getPadding(message) << ";\n"
+		<< "\treturn parse(padBody(body, size, PADDING), size + PADDING);\n"
+		<< "}\n"
+		<< "\n"
+		<< "BOOL " << class_name << "::parse(const U8* body, S32 size)\n"
+		<< "{\n"
+		<< "\tS32 pos = 0;\n";
+
+	bool all_variable = !message->mMemberBlocks.empty();
+	for (iter = message->mMemberBlocks.begin(); iter != message->mMemberBlocks.end(); ++iter)
+	{
+		const LLMessageBlock* block = *iter;
+		std::string member = get_block_member(block);
+		out << "\n";
+		if (block->mType == MBT_SINGLE)
+		{
+			all_variable = false;
+			out << "\t{\n"
+				<< "\t\t" << get_block_class(block) << "& block = " << member << "[0];\n";
+		}
+		else
+		{
+			std::string count;
+			if (block->mType == MBT_MULTIPLE)
+			{
+				all_variable = false;
+				count = llformat("%d", block->mNumber);
+			}
+			else
+			{
+				count = member + "Count";
+				out << "\t" << count << " = pos < size ? body[pos++] : 0;\n";
+			}
+			out << "\tfor (S32 i = 0; i < " << count << "; i++)\n"
+				<< "\t{\n"
+				<< "\t\t" << get_block_class(block) << "& block = " << member << "[i];\n";
+		}
+
+		// Note where each segment starts, stepping over the variable fields
+		// that end them
+		S32 segment = 0;
+		S32 run = 0;
+		out << "\t\tblock.mSeg[0] = body + pos;\n";
+		for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = block->mMemberVariables.begin();
+			 var_iter != block->mMemberVariables.end(); ++var_iter)
+		{
+			const LLMessageVariable* var = *var_iter;
+			if (var->getType() != MVT_VARIABLE)
+			{
+				run += var->getSize();
+				continue;
+			}
+			if (run)
+			{
+				out << "\t\tpos += " << run << ";\n";
+				run = 0;
+			}
+			out << "\t\tif (!skipVariable(body, size, pos, " << var->getSize() << "))\n"
+				<< "\t\t{\n"
+				<< "\t\t\treturn FALSE;\n"
+				<< "\t\t}\n"
+				<< "\t\tblock.mSeg[" << ++segment << "] = body + pos;\n";
+		}
+		if (run)
+		{
+			out << "\t\tpos += " << run << ";\n";
+		}
+		out << "\t}\n";
+	}
+
+	if (all_variable)
+	{
+		// The reader turns away messages with no blocks at all
+		out << "\n"
+			<< "\tif (";
+		for (iter = message->mMemberBlocks.begin(); iter != message->mMemberBlocks.end(); ++iter)
+		{
+			out << (iter == message->mMemberBlocks.begin() ? "" : " && ") << get_block_member(*iter) << "Count == 0";
+		}
+		out << ")\n"
+			<< "\t{\n"
+			<< "\t\treturn FALSE;\n"
+			<< "\t}\n";
+	}
+
+	out << "\n"
+		<< "\treturn pos <= size;\n"
+		<< "}\n";
+}
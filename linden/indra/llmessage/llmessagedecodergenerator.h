@@ -0,0 +1,82 @@
+/**
+ * @file llmessagedecodergenerator.h
+ * @brief Writes llmessagedecoders.h/.cpp from the message template
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGEDECODERGENERATOR_H
+#define LL_LLMESSAGEDECODERGENERATOR_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class LLMessageBlock;
+class LLMessageTemplate;
+class LLMessageVariable;
+class LLTemplateParser;
+
+// Writes an LLMessageDecoder subclass for each message asked for, with the
+// offset of every field worked out from the template. The output is checked
+// in as llmessagedecoders.h/.cpp; run tools/msgdecodergen after changing
+// message_template.msg or the list of messages below, and the tut test
+// notices when the two have drifted apart.
+class LLMessageDecoderGenerator
+{
+public:
+	LLMessageDecoderGenerator(const LLTemplateParser& parser);
+
+	// Messages the viewer decodes through generated classes
+	static const char* const sDefaultMessages[];
+
+	// Returns FALSE if the template has no message by that name
+	BOOL addMessage(const std::string& name);
+	BOOL addDefaultMessages();
+
+	void writeHeader(std::ostream& out) const;
+	void writeSource(std::ostream& out) const;
+
+	static std::string getClassName(const LLMessageTemplate* message);
+
+private:
+	void writeLicense(std::ostream& out, const char* file, const char* brief) const;
+	void writeBlockClass(std::ostream& out, const LLMessageTemplate* message, const LLMessageBlock* block) const;
+	void writeMessageClass(std::ostream& out, const LLMessageTemplate* message) const;
+	void writeParse(std::ostream& out, const LLMessageTemplate* message) const;
+
+	// Bytes needed to hold the message with every block at its smallest,
+	// which is all a short message can be missing
+	static S32 getPadding(const LLMessageTemplate* message);
+
+	const LLTemplateParser& mParser;
+	std::vector<const LLMessageTemplate*> mMessages;
+};
+
+#endif // LL_LLMESSAGEDECODERGENERATOR_H
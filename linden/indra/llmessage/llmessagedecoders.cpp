@@ -0,0 +1,335 @@
+/**
+ * @file llmessagedecoders.cpp
+ * @brief Decoders for frequent messages, generated from message_template.msg
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Generated by LLMessageDecoderGenerator from message template version 2.0.
+// Do not edit; run tools/msgdecodergen instead.
+
+#include "linden_common.h"
+
+#include "llmessagedecoders.h"
+
+BOOL LLMsgObjectUpdate::decode(const U8* body, S32 size)
+{
+	if (parse(body, size))
+	{
+		return TRUE;
+	}
+	// Decode short messages as though zero filled, like the reader
+	const S32 PADDING = 39026;
+	return parse(padBody(body, size, PADDING), size + PADDING);
+}
+
+BOOL LLMsgObjectUpdate::parse(const U8* body, S32 size)
+{
+	S32 pos = 0;
+
+	{
+		RegionDataBlock& block = mRegionData[0];
+		block.mSeg[0] = body + pos;
+		pos += 10;
+	}
+
+	mObjectDataCount = pos < size ? body[pos++] : 0;
+	for (S32 i = 0; i < mObjectDataCount; i++)
+	{
+		ObjectDataBlock& block = mObjectData[i];
+		block.mSeg[0] = body + pos;
+		pos += 40;
+		if (!skipVariable(body, size, pos, 1))
+		{
+			return FALSE;
+		}
+		block.mSeg[1] = body + pos;
+		pos += 31;
+		if (!skipVariable(body, size, pos, 2))
+		{
+			return FALSE;
+		}
+		block.mSeg[2] = body + pos;
+		if (!skipVariable(body, size, pos, 1))
+		{
+			return FALSE;
+		}
+		block.mSeg[3] = body + pos;
+		if (!skipVariable(body, size, pos, 2))
+		{
+			return FALSE;
+		}
+		block.mSeg[4] = body + pos;
+		if (!skipVariable(body, size, pos, 2))
+		{
+			return FALSE;
+		}
+		block.mSeg[5] = body + pos;
+		if (!skipVariable(body, size, pos, 1))
+		{
+			return FALSE;
+		}
+		block.mSeg[6] = body + pos;
+		pos += 4;
+		if (!skipVariable(body, size, pos, 1))
+		{
+			return FALSE;
+		}
+		block.mSeg[7] = body + pos;
+		if (!skipVariable(body, size, pos, 1))
+		{
+			return FALSE;
+		}
+		block.mSeg[8] = body + pos;
+		if (!skipVariable(body, size, pos, 1))
+		{
+			return FALSE;
+		}
+		block.mSeg[9] = body + pos;
+		pos += 66;
+	}
+
+	return pos <= size;
+}
+
+BOOL LLMsgObjectUpdateCompressed::decode(const U8* body, S32 size)
+{
+	if (parse(body, size))
+	{
+		return TRUE;
+	}
+	// Decode short messages as though zero filled, like the reader
+	const S32 PADDING = 1541;
+	return parse(padBody(body, size, PADDING), size + PADDING);
+}
+
+BOOL LLMsgObjectUpdateCompressed::parse(const U8* body, S32 size)
+{
+	S32 pos = 0;
+
+	{
+		RegionDataBlock& block = mRegionData[0];
+		block.mSeg[0] = body + pos;
+		pos += 10;
+	}
+
+	mObjectDataCount = pos < size ? body[pos++] : 0;
+	for (S32 i = 0; i < mObjectDataCount; i++)
+	{
+		ObjectDataBlock& block = mObjectData[i];
+		block.mSeg[0] = body + pos;
+		pos += 4;
+		if (!skipVariable(body, size, pos, 2))
+		{
+			return FALSE;
+		}
+		block.mSeg[1] = body + pos;
+	}
+
+	return pos <= size;
+}
+
+BOOL LLMsgObjectUpdateCached::decode(const U8* body, S32 size)
+{
+	if (parse(body, size))
+	{
+		return TRUE;
+	}
+	// Decode short messages as though zero filled, like the reader
+	const S32 PADDING = 3071;
+	return parse(padBody(body, size, PADDING), size + PADDING);
+}
+
+BOOL LLMsgObjectUpdateCached::parse(const U8* body, S32 size)
+{
+	S32 pos = 0;
+
+	{
+		RegionDataBlock& block = mRegionData[0];
+		block.mSeg[0] = body + pos;
+		pos += 10;
+	}
+
+	mObjectDataCount = pos < size ? body[pos++] : 0;
+	for (S32 i = 0; i < mObjectDataCount; i++)
+	{
+		ObjectDataBlock& block = mObjectData[i];
+		block.mSeg[0] = body + pos;
+		pos += 12;
+	}
+
+	return pos <= size;
+}
+
+BOOL LLMsgImprovedTerseObjectUpdate::decode(const U8* body, S32 size)
+{
+	if (parse(body, size))
+	{
+		return TRUE;
+	}
+	// Decode short messages as though zero filled, like the reader
+	const S32 PADDING = 776;
+	return parse(padBody(body, size, PADDING), size + PADDING);
+}
+
+BOOL LLMsgImprovedTerseObjectUpdate::parse(const U8* body, S32 size)
+{
+	S32 pos = 0;
+
+	{
+		RegionDataBlock& block = mRegionData[0];
+		block.mSeg[0] = body + pos;
+		pos += 10;
+	}
+
+	mObjectDataCount = pos < size ? body[pos++] : 0;
+	for (S32 i = 0; i < mObjectDataCount; i++)
+	{
+		ObjectDataBlock& block = mObjectData[i];
+		block.mSeg[0] = body + pos;
+		if (!skipVariable(body, size, pos, 1))
+		{
+			return FALSE;
+		}
+		block.mSeg[1] = body + pos;
+		if (!skipVariable(body, size, pos, 2))
+		{
+			return FALSE;
+		}
+		block.mSeg[2] = body + pos;
+	}
+
+	return pos <= size;
+}
+
+BOOL LLMsgKillObject::decode(const U8* body, S32 size)
+{
+	if (parse(body, size))
+	{
+		return TRUE;
+	}
+	// Decode short messages as though zero filled, like the reader
+	const S32 PADDING = 1021;
+	return parse(padBody(body, size, PADDING), size + PADDING);
+}
+
+BOOL LLMsgKillObject::parse(const U8* body, S32 size)
+{
+	S32 pos = 0;
+
+	mObjectDataCount = pos < size ? body[pos++] : 0;
+	for (S32 i = 0; i < mObjectDataCount; i++)
+	{
+		ObjectDataBlock& block = mObjectData[i];
+		block.mSeg[0] = body + pos;
+		pos += 4;
+	}
+
+	if (mObjectDataCount == 0)
+	{
+		return FALSE;
+	}
+
+	return pos <= size;
+}
+
+BOOL LLMsgSimulatorViewerTimeMessage::decode(const U8* body, S32 size)
+{
+	if (parse(body, size))
+	{
+		return TRUE;
+	}
+	// Decode short messages as though zero filled, like the reader
+	const S32 PADDING = 44;
+	return parse(padBody(body, size, PADDING), size + PADDING);
+}
+
+BOOL LLMsgSimulatorViewerTimeMessage::parse(const U8* body, S32 size)
+{
+	S32 pos = 0;
+
+	{
+		TimeInfoBlock& block = mTimeInfo[0];
+		block.mSeg[0] = body + pos;
+		pos += 44;
+	}
+
+	return pos <= size;
+}
+
+BOOL LLMsgAvatarAnimation::decode(const U8* body, S32 size)
+{
+	if (parse(body, size))
+	{
+		return TRUE;
+	}
+	// Decode short messages as though zero filled, like the reader
+	const S32 PADDING = 9454;
+	return parse(padBody(body, size, PADDING), size + PADDING);
+}
+
+BOOL LLMsgAvatarAnimation::parse(const U8* body, S32 size)
+{
+	S32 pos = 0;
+
+	{
+		SenderBlock& block = mSender[0];
+		block.mSeg[0] = body + pos;
+		pos += 16;
+	}
+
+	mAnimationListCount = pos < size ? body[pos++] : 0;
+	for (S32 i = 0; i < mAnimationListCount; i++)
+	{
+		AnimationListBlock& block = mAnimationList[i];
+		block.mSeg[0] = body + pos;
+		pos += 20;
+	}
+
+	mAnimationSourceListCount = pos < size ? body[pos++] : 0;
+	for (S32 i = 0; i < mAnimationSourceListCount; i++)
+	{
+		AnimationSourceListBlock& block = mAnimationSourceList[i];
+		block.mSeg[0] = body + pos;
+		pos += 16;
+	}
+
+	mPhysicalAvatarEventListCount = pos < size ? body[pos++] : 0;
+	for (S32 i = 0; i < mPhysicalAvatarEventListCount; i++)
+	{
+		PhysicalAvatarEventListBlock& block = mPhysicalAvatarEventList[i];
+		block.mSeg[0] = body + pos;
+		if (!skipVariable(body, size, pos, 1))
+		{
+			return FALSE;
+		}
+		block.mSeg[1] = body + pos;
+	}
+
+	return pos <= size;
+}
@@ -0,0 +1,476 @@
+/**
+ * @file llmessagedecoders.h
+ * @brief Decoders for frequent messages, generated from message_template.msg
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Generated by LLMessageDecoderGenerator from message template version 2.0.
+// Do not edit; run tools/msgdecodergen instead.
+
+#ifndef LL_LLMESSAGEDECODERS_H
+#define LL_LLMESSAGEDECODERS_H
+
+#include "llmessagedecoder.h"
+
+// ObjectUpdate
+class LLMsgObjectUpdate : public LLMessageDecoder
+{
+public:
+	static const U32 MESSAGE_NUMBER = 0x0000000c;
+
+	class RegionDataBlock
+	{
+	public:
+		U64 getRegionHandle() const	{ return readU64(mSeg[0]); }
+		U16 getTimeDilation() const	{ return readU16(mSeg[0] + 8); }
+
+	private:
+		friend class LLMsgObjectUpdate;
+		const U8* mSeg[1];
+	};
+
+	class ObjectDataBlock
+	{
+	public:
+		U32 getID() const	{ return readU32(mSeg[0]); }
+		U8 getState() const	{ return readU8(mSeg[0] + 4); }
+		LLUUID getFullID() const	{ return readUUID(mSeg[0] + 5); }
+		U32 getCRC() const	{ return readU32(mSeg[0] + 21); }
+		U8 getPCode() const	{ return readU8(mSeg[0] + 25); }
+		U8 getMaterial() const	{ return readU8(mSeg[0] + 26); }
+		U8 getClickAction() const	{ return readU8(mSeg[0] + 27); }
+		LLVector3 getScale() const	{ return readVector3(mSeg[0] + 28, "ObjectData", "Scale"); }
+		const U8* getObjectData() const	{ return mSeg[0] + 40 + 1; }
+		S32 getObjectDataSize() const	{ return readVariableSize(mSeg[0] + 40, 1); }
+		void getObjectData(std::string& str) const	{ readString(getObjectData(), getObjectDataSize(), str); }
+		U32 getParentID() const	{ return readU32(mSeg[1]); }
+		U32 getUpdateFlags() const	{ return readU32(mSeg[1] + 4); }
+		U8 getPathCurve() const	{ return readU8(mSeg[1] + 8); }
+		U8 getProfileCurve() const	{ return readU8(mSeg[1] + 9); }
+		U16 getPathBegin() const	{ return readU16(mSeg[1] + 10); }
+		U16 getPathEnd() const	{ return readU16(mSeg[1] + 12); }
+		U8 getPathScaleX() const	{ return readU8(mSeg[1] + 14); }
+		U8 getPathScaleY() const	{ return readU8(mSeg[1] + 15); }
+		U8 getPathShearX() const	{ return readU8(mSeg[1] + 16); }
+		U8 getPathShearY() const	{ return readU8(mSeg[1] + 17); }
+		S8 getPathTwist() const	{ return readS8(mSeg[1] + 18); }
+		S8 getPathTwistBegin() const	{ return readS8(mSeg[1] + 19); }
+		S8 getPathRadiusOffset() const	{ return readS8(mSeg[1] + 20); }
+		S8 getPathTaperX() const	{ return readS8(mSeg[1] + 21); }
+		S8 getPathTaperY() const	{ return readS8(mSeg[1] + 22); }
+		U8 getPathRevolutions() const	{ return readU8(mSeg[1] + 23); }
+		S8 getPathSkew() const	{ return readS8(mSeg[1] + 24); }
+		U16 getProfileBegin() const	{ return readU16(mSeg[1] + 25); }
+		U16 getProfileEnd() const	{ return readU16(mSeg[1] + 27); }
+		U16 getProfileHollow() const	{ return readU16(mSeg[1] + 29); }
+		const U8* getTextureEntry() const	{ return mSeg[1] + 31 + 2; }
+		S32 getTextureEntrySize() const	{ return readVariableSize(mSeg[1] + 31, 2); }
+		void getTextureEntry(std::string& str) const	{ readString(getTextureEntry(), getTextureEntrySize(), str); }
+		const U8* getTextureAnim() const	{ return mSeg[2] + 1; }
+		S32 getTextureAnimSize() const	{ return readVariableSize(mSeg[2], 1); }
+		void getTextureAnim(std::string& str) const	{ readString(getTextureAnim(), getTextureAnimSize(), str); }
+		const U8* getNameValue() const	{ return mSeg[3] + 2; }
+		S32 getNameValueSize() const	{ return readVariableSize(mSeg[3], 2); }
+		void getNameValue(std::string& str) const	{ readString(getNameValue(), getNameValueSize(), str); }
+		const U8* getData() const	{ return mSeg[4] + 2; }
+		S32 getDataSize() const	{ return readVariableSize(mSeg[4], 2); }
+		void getData(std::string& str) const	{ readString(getData(), getDataSize(), str); }
+		const U8* getText() const	{ return mSeg[5] + 1; }
+		S32 getTextSize() const	{ return readVariableSize(mSeg[5], 1); }
+		void getText(std::string& str) const	{ readString(getText(), getTextSize(), str); }
+		const U8* getTextColor() const	{ return mSeg[6]; }
+		const U8* getMediaURL() const	{ return mSeg[6] + 4 + 1; }
+		S32 getMediaURLSize() const	{ return readVariableSize(mSeg[6] + 4, 1); }
+		void getMediaURL(std::string& str) const	{ readString(getMediaURL(), getMediaURLSize(), str); }
+		const U8* getPSBlock() const	{ return mSeg[7] + 1; }
+		S32 getPSBlockSize() const	{ return readVariableSize(mSeg[7], 1); }
+		void getPSBlock(std::string& str) const	{ readString(getPSBlock(), getPSBlockSize(), str); }
+		const U8* getExtraParams() const	{ return mSeg[8] + 1; }
+		S32 getExtraParamsSize() const	{ return readVariableSize(mSeg[8], 1); }
+		void getExtraParams(std::string& str) const	{ readString(getExtraParams(), getExtraParamsSize(), str); }
+		LLUUID getSound() const	{ return readUUID(mSeg[9]); }
+		LLUUID getOwnerID() const	{ return readUUID(mSeg[9] + 16); }
+		F32 getGain() const	{ return readF32(mSeg[9] + 32, "ObjectData", "Gain"); }
+		U8 getFlags() const	{ return readU8(mSeg[9] + 36); }
+		F32 getRadius() const	{ return readF32(mSeg[9] + 37, "ObjectData", "Radius"); }
+		U8 getJointType() const	{ return readU8(mSeg[9] + 41); }
+		LLVector3 getJointPivot() const	{ return readVector3(mSeg[9] + 42, "ObjectData", "JointPivot"); }
+		LLVector3 getJointAxisOrAnchor() const	{ return readVector3(mSeg[9] + 54, "ObjectData", "JointAxisOrAnchor"); }
+
+	private:
+		friend class LLMsgObjectUpdate;
+		const U8* mSeg[10];
+	};
+
+	LLMsgObjectUpdate() : mObjectDataCount(0) {}
+
+	// Decodes the message msg is dispatching, FALSE if it is another
+	// message or is malformed
+	BOOL decode(LLMessageSystem* msg)
+	{
+		const U8* body;
+		S32 size;
+		return getMessageBody(msg, MESSAGE_NUMBER, body, size) && decode(body, size);
+	}
+	BOOL decode(const U8* body, S32 size);
+
+	const RegionDataBlock& getRegionData(S32 i = 0) const	{ return mRegionData[i]; }
+	S32 getObjectDataCount() const	{ return mObjectDataCount; }
+	const ObjectDataBlock& getObjectData(S32 i = 0) const	{ return mObjectData[i]; }
+
+private:
+	BOOL parse(const U8* body, S32 size);
+
+	RegionDataBlock mRegionData[1];
+	ObjectDataBlock mObjectData[255];
+	S32 mObjectDataCount;
+};
+
+// ObjectUpdateCompressed
+class LLMsgObjectUpdateCompressed : public LLMessageDecoder
+{
+public:
+	static const U32 MESSAGE_NUMBER = 0x0000000d;
+
+	class RegionDataBlock
+	{
+	public:
+		U64 getRegionHandle() const	{ return readU64(mSeg[0]); }
+		U16 getTimeDilation() const	{ return readU16(mSeg[0] + 8); }
+
+	private:
+		friend class LLMsgObjectUpdateCompressed;
+		const U8* mSeg[1];
+	};
+
+	class ObjectDataBlock
+	{
+	public:
+		U32 getUpdateFlags() const	{ return readU32(mSeg[0]); }
+		const U8* getData() const	{ return mSeg[0] + 4 + 2; }
+		S32 getDataSize() const	{ return readVariableSize(mSeg[0] + 4, 2); }
+		void getData(std::string& str) const	{ readString(getData(), getDataSize(), str); }
+
+	private:
+		friend class LLMsgObjectUpdateCompressed;
+		const U8* mSeg[2];
+	};
+
+	LLMsgObjectUpdateCompressed() : mObjectDataCount(0) {}
+
+	// Decodes the message msg is dispatching, FALSE if it is another
+	// message or is malformed
+	BOOL decode(LLMessageSystem* msg)
+	{
+		const U8* body;
+		S32 size;
+		return getMessageBody(msg, MESSAGE_NUMBER, body, size) && decode(body, size);
+	}
+	BOOL decode(const U8* body, S32 size);
+
+	const RegionDataBlock& getRegionData(S32 i = 0) const	{ return mRegionData[i]; }
+	S32 getObjectDataCount() const	{ return mObjectDataCount; }
+	const ObjectDataBlock& getObjectData(S32 i = 0) const	{ return mObjectData[i]; }
+
+private:
+	BOOL parse(const U8* body, S32 size);
+
+	RegionDataBlock mRegionData[1];
+	ObjectDataBlock mObjectData[255];
+	S32 mObjectDataCount;
+};
+
+// ObjectUpdateCached
+class LLMsgObjectUpdateCached : public LLMessageDecoder
+{
+public:
+	static const U32 MESSAGE_NUMBER = 0x0000000e;
+
+	class RegionDataBlock
+	{
+	public:
+		U64 getRegionHandle() const	{ return readU64(mSeg[0]); }
+		U16 getTimeDilation() const	{ return readU16(mSeg[0] + 8); }
+
+	private:
+		friend class LLMsgObjectUpdateCached;
+		const U8* mSeg[1];
+	};
+
+	class ObjectDataBlock
+	{
+	public:
+		U32 getID() const	{ return readU32(mSeg[0]); }
+		U32 getCRC() const	{ return readU32(mSeg[0] + 4); }
+		U32 getUpdateFlags() const	{ return readU32(mSeg[0] + 8); }
+
+	private:
+		friend class LLMsgObjectUpdateCached;
+		const U8* mSeg[1];
+	};
+
+	LLMsgObjectUpdateCached() : mObjectDataCount(0) {}
+
+	// Decodes the message msg is dispatching, FALSE if it is another
+	// message or is malformed
+	BOOL decode(LLMessageSystem* msg)
+	{
+		const U8* body;
+		S32 size;
+		return getMessageBody(msg, MESSAGE_NUMBER, body, size) && decode(body, size);
+	}
+	BOOL decode(const U8* body, S32 size);
+
+	const RegionDataBlock& getRegionData(S32 i = 0) const	{ return mRegionData[i]; }
+	S32 getObjectDataCount() const	{ return mObjectDataCount; }
+	const ObjectDataBlock& getObjectData(S32 i = 0) const	{ return mObjectData[i]; }
+
+private:
+	BOOL parse(const U8* body, S32 size);
+
+	RegionDataBlock mRegionData[1];
+	ObjectDataBlock mObjectData[255];
+	S32 mObjectDataCount;
+};
+
+// ImprovedTerseObjectUpdate
+class LLMsgImprovedTerseObjectUpdate : public LLMessageDecoder
+{
+public:
+	static const U32 MESSAGE_NUMBER = 0x0000000f;
+
+	class RegionDataBlock
+	{
+	public:
+		U64 getRegionHandle() const	{ return readU64(mSeg[0]); }
+		U16 getTimeDilation() const	{ return readU16(mSeg[0] + 8); }
+
+	private:
+		friend class LLMsgImprovedTerseObjectUpdate;
+		const U8* mSeg[1];
+	};
+
+	class ObjectDataBlock
+	{
+	public:
+		const U8* getData() const	{ return mSeg[0] + 1; }
+		S32 getDataSize() const	{ return readVariableSize(mSeg[0], 1); }
+		void getData(std::string& str) const	{ readString(getData(), getDataSize(), str); }
+		const U8* getTextureEntry() const	{ return mSeg[1] + 2; }
+		S32 getTextureEntrySize() const	{ return readVariableSize(mSeg[1], 2); }
+		void getTextureEntry(std::string& str) const	{ readString(getTextureEntry(), getTextureEntrySize(), str); }
+
+	private:
+		friend class LLMsgImprovedTerseObjectUpdate;
+		const U8* mSeg[3];
+	};
+
+	LLMsgImprovedTerseObjectUpdate() : mObjectDataCount(0) {}
+
+	// Decodes the message msg is dispatching, FALSE if it is another
+	// message or is malformed
+	BOOL decode(LLMessageSystem* msg)
+	{
+		const U8* body;
+		S32 size;
+		return getMessageBody(msg, MESSAGE_NUMBER, body, size) && decode(body, size);
+	}
+	BOOL decode(const U8* body, S32 size);
+
+	const RegionDataBlock& getRegionData(S32 i = 0) const	{ return mRegionData[i]; }
+	S32 getObjectDataCount() const	{ return mObjectDataCount; }
+	const ObjectDataBlock& getObjectData(S32 i = 0) const	{ return mObjectData[i]; }
+
+private:
+	BOOL parse(const U8* body, S32 size);
+
+	RegionDataBlock mRegionData[1];
+	ObjectDataBlock mObjectData[255];
+	S32 mObjectDataCount;
+};
+
+// KillObject
+class LLMsgKillObject : public LLMessageDecoder
+{
+public:
+	static const U32 MESSAGE_NUMBER = 0x00000010;
+
+	class ObjectDataBlock
+	{
+	public:
+		U32 getID() const	{ return readU32(mSeg[0]); }
+
+	private:
+		friend class LLMsgKillObject;
+		const U8* mSeg[1];
+	};
+
+	LLMsgKillObject() : mObjectDataCount(0) {}
+
+	// Decodes the message msg is dispatching, FALSE if it is another
+	// message or is malformed
+	BOOL decode(LLMessageSystem* msg)
+	{
+		const U8* body;
+		S32 size;
+		return getMessageBody(msg, MESSAGE_NUMBER, body, size) && decode(body, size);
+	}
+	BOOL decode(const U8* body, S32 size);
+
+	S32 getObjectDataCount() const	{ return mObjectDataCount; }
+	const ObjectDataBlock& getObjectData(S32 i = 0) const	{ return mObjectData[i]; }
+
+private:
+	BOOL parse(const U8* body, S32 size);
+
+	ObjectDataBlock mObjectData[255];
+	S32 mObjectDataCount;
+};
+
+// SimulatorViewerTimeMessage
+class LLMsgSimulatorViewerTimeMessage : public LLMessageDecoder
+{
+public:
+	static const U32 MESSAGE_NUMBER = 0xffff0096;
+
+	class TimeInfoBlock
+	{
+	public:
+		U64 getUsecSinceStart() const	{ return readU64(mSeg[0]); }
+		U32 getSecPerDay() const	{ return readU32(mSeg[0] + 8); }
+		U32 getSecPerYear() const	{ return readU32(mSeg[0] + 12); }
+		LLVector3 getSunDirection() const	{ return readVector3(mSeg[0] + 16, "TimeInfo", "SunDirection"); }
+		F32 getSunPhase() const	{ return readF32(mSeg[0] + 28, "TimeInfo", "SunPhase"); }
+		LLVector3 getSunAngVelocity() const	{ return readVector3(mSeg[0] + 32, "TimeInfo", "SunAngVelocity"); }
+
+	private:
+		friend class LLMsgSimulatorViewerTimeMessage;
+		const U8* mSeg[1];
+	};
+
+	// Decodes the message msg is dispatching, FALSE if it is another
+	// message or is malformed
+	BOOL decode(LLMessageSystem* msg)
+	{
+		const U8* body;
+		S32 size;
+		return getMessageBody(msg, MESSAGE_NUMBER, body, size) && decode(body, size);
+	}
+	BOOL decode(const U8* body, S32 size);
+
+	const TimeInfoBlock& getTimeInfo(S32 i = 0) const	{ return mTimeInfo[i]; }
+
+private:
+	BOOL parse(const U8* body, S32 size);
+
+	TimeInfoBlock mTimeInfo[1];
+};
+
+// AvatarAnimation
+class LLMsgAvatarAnimation : public LLMessageDecoder
+{
+public:
+	static const U32 MESSAGE_NUMBER = 0x00000014;
+
+	class SenderBlock
+	{
+	public:
+		LLUUID getID() const	{ return readUUID(mSeg[0]); }
+
+	private:
+		friend class LLMsgAvatarAnimation;
+		const U8* mSeg[1];
+	};
+
+	class AnimationListBlock
+	{
+	public:
+		LLUUID getAnimID() const	{ return readUUID(mSeg[0]); }
+		S32 getAnimSequenceID() const	{ return readS32(mSeg[0] + 16); }
+
+	private:
+		friend class LLMsgAvatarAnimation;
+		const U8* mSeg[1];
+	};
+
+	class AnimationSourceListBlock
+	{
+	public:
+		LLUUID getObjectID() const	{ return readUUID(mSeg[0]); }
+
+	private:
+		friend class LLMsgAvatarAnimation;
+		const U8* mSeg[1];
+	};
+
+	class PhysicalAvatarEventListBlock
+	{
+	public:
+		const U8* getTypeData() const	{ return mSeg[0] + 1; }
+		S32 getTypeDataSize() const	{ return readVariableSize(mSeg[0], 1); }
+		void getTypeData(std::string& str) const	{ readString(getTypeData(), getTypeDataSize(), str); }
+
+	private:
+		friend class LLMsgAvatarAnimation;
+		const U8* mSeg[2];
+	};
+
+	LLMsgAvatarAnimation() : mAnimationListCount(0), mAnimationSourceListCount(0), mPhysicalAvatarEventListCount(0) {}
+
+	// Decodes the message msg is dispatching, FALSE if it is another
+	// message or is malformed
+	BOOL decode(LLMessageSystem* msg)
+	{
+		const U8* body;
+		S32 size;
+		return getMessageBody(msg, MESSAGE_NUMBER, body, size) && decode(body, size);
+	}
+	BOOL decode(const U8* body, S32 size);
+
+	const SenderBlock& getSender(S32 i = 0) const	{ return mSender[i]; }
+	S32 getAnimationListCount() const	{ return mAnimationListCount; }
+	const AnimationListBlock& getAnimationList(S32 i = 0) const	{ return mAnimationList[i]; }
+	S32 getAnimationSourceListCount() const	{ return mAnimationSourceListCount; }
+	const AnimationSourceListBlock& getAnimationSourceList(S32 i = 0) const	{ return mAnimationSourceList[i]; }
+	S32 getPhysicalAvatarEventListCount() const	{ return mPhysicalAvatarEventListCount; }
+	const PhysicalAvatarEventListBlock& getPhysicalAvatarEventList(S32 i = 0) const	{ return mPhysicalAvatarEventList[i]; }
+
+private:
+	BOOL parse(const U8* body, S32 size);
+
+	SenderBlock mSender[1];
+	AnimationListBlock mAnimationList[255];
+	S32 mAnimationListCount;
+	AnimationSourceListBlock mAnimationSourceList[255];
+	S32 mAnimationSourceListCount;
+	PhysicalAvatarEventListBlock mPhysicalAvatarEventList[255];
+	S32 mPhysicalAvatarEventListCount;
+};
+
+#endif // LL_LLMESSAGEDECODERS_H
@@ -368,6 +368,11 @@ public:
 		mUserData = user_data;
 	}
 
+	BOOL hasHandlerFunc() const
+	{
+		return mHandlerFunc != NULL;
+	}
+
 	BOOL callHandlerFunc(LLMessageSystem *msgsystem) const
 	{
 		if (mHandlerFunc)
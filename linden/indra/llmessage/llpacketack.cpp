@@ -43,13 +43,33 @@
 
 #include "message.h"
 
+// Cap on the free list, so a burst of unacked packets doesn't pin its
+// memory for the rest of the session
+const U32 LL_RELIABLE_PACKET_POOL_MAX = 512;
+
+// Slots allocated for the first packet of a ring
+const U32 LL_RELIABLE_RING_MIN_SIZE = 64;
+
+std::vector<LLReliablePacket*> LLReliablePacket::sFreePackets;
+U32 LLReliablePacket::sPoolSize = 0;
+
 LLReliablePacket::LLReliablePacket(
 	S32 socket,
 	U8* buf_ptr,
 	S32 buf_len,
 	LLReliablePacketParams* params) :
 	mBuffer(NULL),
-	mBufferLength(0)
+	mBufferLength(0),
+	mBufferCapacity(0)
+{
+	init(socket, buf_ptr, buf_len, params);
+}
+
+void LLReliablePacket::init(
+	S32 socket,
+	U8* buf_ptr,
+	S32 buf_len,
+	LLReliablePacketParams* params)
 {
 	if (params)
 	{
@@ -63,6 +83,7 @@ LLReliablePacket::LLReliablePacket(
 	}
 	else
 	{
+		mHost.invalidate();
 		mRetries = 0;
 		mPingBasedRetry = TRUE;
 		mTimeout = 0.f;
@@ -75,14 +96,196 @@ LLReliablePacket::LLReliablePacket(
 	mPacketID = ntohl(*((U32*)(&buf_ptr[PHL_PACKET_ID])));
 
 	mSocket = socket;
+	mBufferLength = 0;
 	if (mRetries)
 	{
-		mBuffer = new U8[buf_len];
-		if (mBuffer != NULL)
+		if (buf_len > mBufferCapacity)
+		{
+			delete [] mBuffer;
+			mBuffer = new U8[buf_len];
+			mBufferCapacity = buf_len;
+		}
+		memcpy(mBuffer,buf_ptr,buf_len);	/*Flawfinder: ignore*/
+		mBufferLength = buf_len;
+	}
+}
+
+// static
+LLReliablePacket* LLReliablePacket::create(
+	S32 socket,
+	U8* buf_ptr,
+	S32 buf_len,
+	LLReliablePacketParams* params)
+{
+	if (sFreePackets.empty())
+	{
+		sPoolSize++;
+		return new LLReliablePacket(socket, buf_ptr, buf_len, params);
+	}
+	LLReliablePacket* packetp = sFreePackets.back();
+	sFreePackets.pop_back();
+	packetp->init(socket, buf_ptr, buf_len, params);
+	return packetp;
+}
+
+// static
+void LLReliablePacket::release(LLReliablePacket* packetp)
+{
+	if (sFreePackets.size() >= LL_RELIABLE_PACKET_POOL_MAX)
+	{
+		sPoolSize--;
+		delete packetp;
+		return;
+	}
+	packetp->mCallback = NULL;
+	packetp->mCallbackData = NULL;
+	sFreePackets.push_back(packetp);
+}
+
+LLReliablePacketRing::LLReliablePacketRing() :
+	mMask(0),
+	mOldest(0),
+	mNewest(0),
+	mCount(0)
+{
+}
+
+void LLReliablePacketRing::reserve(U32 span)
+{
+	U32 size = mSlots.empty() ? LL_RELIABLE_RING_MIN_SIZE : mSlots.size();
+	while (size < span)
+	{
+		size <<= 1;
+	}
+	if (size == mSlots.size())
+	{
+		return;
+	}
+
+	// Rehome the current window, the slot of an id depends on the size
+	std::vector<LLReliablePacket*> slots(size, (LLReliablePacket*)NULL);
+	if (mCount)
+	{
+		U32 old_span = getSpan();
+		for (U32 i = 0; i < old_span; i++)
+		{
+			TPACKETID id = (mOldest + i) & LL_PACKET_ID_MASK;
+			slots[id & (size - 1)] = mSlots[id & mMask];
+		}
+	}
+	mSlots.swap(slots);
+	mMask = size - 1;
+}
+
+void LLReliablePacketRing::insert(LLReliablePacket* packetp)
+{
+	TPACKETID id = packetp->getPacketID() & LL_PACKET_ID_MASK;
+	if (!mCount)
+	{
+		reserve(1);
+		mOldest = id;
+		mNewest = id;
+	}
+	else
+	{
+		// Ids up to half the id space ahead of the window are newer,
+		// anything else is older
+		TPACKETID ahead = (id - mNewest) & LL_PACKET_ID_MASK;
+		TPACKETID behind = (mOldest - id) & LL_PACKET_ID_MASK;
+		if (ahead && ahead <= (LL_PACKET_ID_MASK >> 1))
+		{
+			reserve(getSpan() + ahead);
+			mNewest = id;
+		}
+		else if (behind && behind <= (LL_PACKET_ID_MASK >> 1))
+		{
+			reserve(getSpan() + behind);
+			mOldest = id;
+		}
+	}
+
+	LLReliablePacket*& slot = mSlots[id & mMask];
+	if (slot)
+	{
+		llwarns << "Replacing reliable packet " << id << " still waiting for an ack" << llendl;
+	}
+	else
+	{
+		mCount++;
+	}
+	slot = packetp;
+}
+
+LLReliablePacket* LLReliablePacketRing::find(TPACKETID id) const
+{
+	if (!mCount || ((id - mOldest) & LL_PACKET_ID_MASK) >= getSpan())
+	{
+		return NULL;
+	}
+	return mSlots[id & mMask];
+}
+
+LLReliablePacket* LLReliablePacketRing::remove(TPACKETID id)
+{
+	id &= LL_PACKET_ID_MASK;
+	LLReliablePacket* packetp = find(id);
+	if (!packetp)
+	{
+		return NULL;
+	}
+	mSlots[id & mMask] = NULL;
+	mCount--;
+
+	// Shrink the window to the packets still in it
+	if (mCount)
+	{
+		while (!mSlots[mOldest & mMask])
+		{
+			mOldest = (mOldest + 1) & LL_PACKET_ID_MASK;
+		}
+		while (!mSlots[mNewest & mMask])
+		{
+			mNewest = (mNewest - 1) & LL_PACKET_ID_MASK;
+		}
+	}
+	return packetp;
+}
+
+LLReliablePacket* LLReliablePacketRing::getFirst() const
+{
+	return mCount ? mSlots[mOldest & mMask] : NULL;
+}
+
+LLReliablePacket* LLReliablePacketRing::getNext(TPACKETID id) const
+{
+	if (!mCount)
+	{
+		return NULL;
+	}
+
+	U32 span = getSpan();
+	U32 offset = (id - mOldest) & LL_PACKET_ID_MASK;
+	if (offset < span)
+	{
+		offset++;
+	}
+	else if (((mOldest - id) & LL_PACKET_ID_MASK) <= (LL_PACKET_ID_MASK >> 1))
+	{
+		// id was removed from the front of the window during the walk
+		offset = 0;
+	}
+	else
+	{
+		// id is past the newest packet
+		return NULL;
+	}
+	for (; offset < span; offset++)
+	{
+		LLReliablePacket* packetp = mSlots[(mOldest + offset) & mMask];
+		if (packetp)
 		{
-			memcpy(mBuffer,buf_ptr,buf_len);	/*Flawfinder: ignore*/
-			mBufferLength = buf_len;
+			return packetp;
 		}
-			
 	}
+	return NULL;
 }
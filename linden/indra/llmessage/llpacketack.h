@@ -33,6 +33,8 @@
 #ifndef LL_LLPACKETACK_H
 #define LL_LLPACKETACK_H
 
+#include <vector>
+
 #include "llhost.h"
 
 class LLReliablePacketParams
@@ -98,8 +100,29 @@ public:
 		mBuffer = NULL;
 	};
 
+	// Reliable packets come and go at the packet rate, so they are recycled
+	// through a free list, keeping their buffers for the next packet that
+	// fits. Only used from the message system thread.
+	static LLReliablePacket* create(
+		S32 socket,
+		U8* buf_ptr,
+		S32 buf_len,
+		LLReliablePacketParams* params);
+	static void release(LLReliablePacket* packetp);
+
+	static U32 getPoolSize()							{ return sPoolSize; }
+	static U32 getPoolFreeCount()						{ return sFreePackets.size(); }
+
+	TPACKETID getPacketID() const						{ return mPacketID; }
+
 	friend class LLCircuitData;
 protected:
+	void init(
+		S32 socket,
+		U8* buf_ptr,
+		S32 buf_len,
+		LLReliablePacketParams* params);
+
 	S32 mSocket;
 	LLHost mHost;
 	S32 mRetries;
@@ -111,10 +134,58 @@ protected:
 
 	U8* mBuffer;
 	S32 mBufferLength;
+	S32 mBufferCapacity;
 
 	TPACKETID mPacketID;
 
 	F64 mExpirationTime;
+
+	static std::vector<LLReliablePacket*> sFreePackets;
+	static U32 sPoolSize;
+};
+
+// Packet ids are 24 bits and wrap (see LL_MAX_OUT_PACKET_ID)
+const TPACKETID LL_PACKET_ID_MASK = 0x00ffffff;
+
+// Unacked reliable packets of one circuit, indexed by packet id.
+// Outgoing ids are sequential and acks mostly arrive in order, so the
+// packets in flight form a window [oldest, newest] of the id space which is
+// kept in a power of two array of slots indexed by (id & mask). Lookup,
+// insert and remove are constant time and walks visit packets oldest first,
+// also across a wrap of the id space. The ring does not own the packets.
+class LLReliablePacketRing
+{
+public:
+	LLReliablePacketRing();
+
+	// Adds packetp under its id, growing the window (and the slot array) to
+	// cover it. Ids older than the window are fine too.
+	void insert(LLReliablePacket* packetp);
+
+	LLReliablePacket* find(TPACKETID id) const;
+
+	// Removes and returns the packet with this id, NULL if there is none
+	LLReliablePacket* remove(TPACKETID id);
+
+	// Oldest packet, and the next packet after id. Walks built from these
+	// may insert and remove packets as they go.
+	LLReliablePacket* getFirst() const;
+	LLReliablePacket* getNext(TPACKETID id) const;
+
+	BOOL isEmpty() const								{ return mCount == 0; }
+	S32 size() const									{ return mCount; }
+	TPACKETID getOldestID() const						{ return mOldest; }
+	U32 getCapacity() const								{ return mSlots.size(); }
+
+private:
+	U32 getSpan() const									{ return ((mNewest - mOldest) & LL_PACKET_ID_MASK) + 1; }
+	void reserve(U32 span);
+
+	std::vector<LLReliablePacket*> mSlots;
+	U32 mMask;
+	TPACKETID mOldest;
+	TPACKETID mNewest;
+	S32 mCount;
 };
 
 #endif
@@ -37,10 +37,17 @@
 #include "net.h"
 #include "timing.h"
 #include "llhost.h"
+#include "llsocks5.h"
+
+#if LL_WINDOWS
+	#include <winsock2.h>
+#else
+	#include <netinet/in.h>
+#endif
 
 ///////////////////////////////////////////////////////////
 
-LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size) : mHost(host)
+LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size) : mSize(0), mHost(host), mReceiveTime(0)
 {
 	if (size > NET_BUFFER_SIZE)
 	{
@@ -73,7 +80,21 @@ LLPacketBuffer::~LLPacketBuffer ()
 void LLPacketBuffer::init (S32 hSocket)
 {
 	mSize = receive_packet(hSocket, mData);
-	mHost = ::get_sender();
+	mReceiveTime = totalTime();
 	mReceivingIF = ::get_receiving_interface();
+
+	if (LLSocks::isEnabled() && mSize > 10)
+	{
+		// Strip the SOCKS 5 UDP header, which holds the real sender
+		const proxywrap_t* header = (const proxywrap_t*)mData;
+		mHost.setAddress(header->addr);
+		mHost.setPort(ntohs(header->port));
+		mSize -= 10;
+		memmove(mData, mData + 10, mSize);
+	}
+	else
+	{
+		mHost = ::get_sender();
+	}
 }
 
@@ -48,6 +48,7 @@ public:
 	const char	*getData() const				{ return mData; }
 	LLHost		getHost() const					{ return mHost; }
 	LLHost		getReceivingInterface() const	{ return mReceivingIF; }
+	U64			getReceiveTime() const			{ return mReceiveTime; }
 	void init(S32 hSocket);
 
 protected:
@@ -55,6 +56,7 @@ protected:
 	S32		mSize;          // size of buffer in bytes
 	LLHost	mHost;         // source/dest IP and port
 	LLHost	mReceivingIF;         // source/dest IP and port
+	U64		mReceiveTime;	// totalTime() when the packet was read off the socket
 };
 
 #endif
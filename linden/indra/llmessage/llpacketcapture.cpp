@@ -0,0 +1,250 @@
+/**
+ * @file llpacketcapture.cpp
+ * @brief Recording and reading back captures of inbound UDP packets
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketcapture.h"
+
+#include "llerror.h"
+#include "net.h"
+
+static const char CAPTURE_MAGIC[8] = { 'L', 'L', 'P', 'C', 'A', 'P', '\r', '\n' };
+static const U32 CAPTURE_VERSION = 1;
+static const S32 CAPTURE_HEADER_SIZE = 12;
+static const S32 RECORD_HEADER_SIZE = 22;
+
+static void pack_u16(U8* p, U16 v)
+{
+	p[0] = (U8)v;
+	p[1] = (U8)(v >> 8);
+}
+
+static void pack_u32(U8* p, U32 v)
+{
+	pack_u16(p, (U16)v);
+	pack_u16(p + 2, (U16)(v >> 16));
+}
+
+static void pack_u64(U8* p, U64 v)
+{
+	pack_u32(p, (U32)v);
+	pack_u32(p + 4, (U32)(v >> 32));
+}
+
+static U16 unpack_u16(const U8* p)
+{
+	return (U16)(p[0] | (p[1] << 8));
+}
+
+static U32 unpack_u32(const U8* p)
+{
+	return (U32)unpack_u16(p) | ((U32)unpack_u16(p + 2) << 16);
+}
+
+static U64 unpack_u64(const U8* p)
+{
+	return (U64)unpack_u32(p) | ((U64)unpack_u32(p + 4) << 32);
+}
+
+static void pack_host(U8* p, const LLHost& host)
+{
+	U32 ip = host.getAddress();
+	memcpy(p, &ip, sizeof(ip));		/* Flawfinder: ignore */
+	pack_u16(p + 4, (U16)host.getPort());
+}
+
+static LLHost unpack_host(const U8* p)
+{
+	U32 ip;
+	memcpy(&ip, p, sizeof(ip));		/* Flawfinder: ignore */
+	return LLHost(ip, unpack_u16(p + 4));
+}
+
+///////////////////////////////////////////////////////////
+LLPacketCaptureWriter::LLPacketCaptureWriter()
+:	mFile(NULL),
+	mPacketCount(0)
+{
+}
+
+LLPacketCaptureWriter::~LLPacketCaptureWriter()
+{
+	close();
+}
+
+BOOL LLPacketCaptureWriter::open(const std::string& filename)
+{
+	close();
+
+	mFile = LLFile::fopen(filename, "wb");
+	if (!mFile)
+	{
+		llwarns << "Unable to create packet capture " << filename << llendl;
+		return FALSE;
+	}
+
+	U8 header[CAPTURE_HEADER_SIZE];
+	memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));		/* Flawfinder: ignore */
+	pack_u32(header + 8, CAPTURE_VERSION);
+	if (fwrite(header, sizeof(header), 1, mFile) != 1)
+	{
+		llwarns << "Unable to write packet capture " << filename << llendl;
+		close();
+		return FALSE;
+	}
+
+	mFileName = filename;
+	mPacketCount = 0;
+	return TRUE;
+}
+
+void LLPacketCaptureWriter::close()
+{
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = NULL;
+	}
+}
+
+BOOL LLPacketCaptureWriter::write(U64 receive_time, const LLHost& sender, const LLHost& receiving_if, const U8* data, S32 size)
+{
+	if (!mFile || size <= 0 || size > NET_BUFFER_SIZE)
+	{
+		return FALSE;
+	}
+
+	U8 record[RECORD_HEADER_SIZE];
+	pack_u64(record, receive_time);
+	pack_host(record + 8, sender);
+	pack_host(record + 14, receiving_if);
+	pack_u16(record + 20, (U16)size);
+	if (fwrite(record, sizeof(record), 1, mFile) != 1 || fwrite(data, size, 1, mFile) != 1)
+	{
+		// Most likely out of disk, so stop rather than warn on every packet
+		llwarns << "Packet capture to " << mFileName << " failed after " << mPacketCount << " packets" << llendl;
+		close();
+		return FALSE;
+	}
+	mPacketCount++;
+	return TRUE;
+}
+
+///////////////////////////////////////////////////////////
+LLPacketCaptureReader::LLPacketCaptureReader()
+:	mFile(NULL),
+	mPacketCount(0)
+{
+}
+
+LLPacketCaptureReader::~LLPacketCaptureReader()
+{
+	close();
+}
+
+BOOL LLPacketCaptureReader::open(const std::string& filename)
+{
+	close();
+
+	mFile = LLFile::fopen(filename, "rb");
+	if (!mFile)
+	{
+		llwarns << "Unable to open packet capture " << filename << llendl;
+		return FALSE;
+	}
+
+	U8 header[CAPTURE_HEADER_SIZE];
+	if (fread(header, sizeof(header), 1, mFile) != 1
+		|| memcmp(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)))
+	{
+		llwarns << filename << " is not a packet capture" << llendl;
+		close();
+		return FALSE;
+	}
+	U32 version = unpack_u32(header + 8);
+	if (version != CAPTURE_VERSION)
+	{
+		llwarns << "Packet capture " << filename << " has unknown version " << version << llendl;
+		close();
+		return FALSE;
+	}
+
+	mFileName = filename;
+	mPacketCount = 0;
+	return TRUE;
+}
+
+void LLPacketCaptureReader::close()
+{
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = NULL;
+	}
+}
+
+S32 LLPacketCaptureReader::read(U64& receive_time, LLHost& sender, LLHost& receiving_if, U8* data)
+{
+	if (!mFile)
+	{
+		return 0;
+	}
+
+	U8 record[RECORD_HEADER_SIZE];
+	if (fread(record, sizeof(record), 1, mFile) != 1)
+	{
+		return 0;
+	}
+	S32 size = unpack_u16(record + 20);
+	if (size <= 0 || size > NET_BUFFER_SIZE || fread(data, size, 1, mFile) != 1)
+	{
+		llwarns << "Packet capture " << mFileName << " is cut short after " << mPacketCount << " packets" << llendl;
+		fseek(mFile, 0, SEEK_END);
+		return 0;
+	}
+
+	receive_time = unpack_u64(record);
+	sender = unpack_host(record + 8);
+	receiving_if = unpack_host(record + 14);
+	mPacketCount++;
+	return size;
+}
+
+void LLPacketCaptureReader::rewind()
+{
+	if (mFile)
+	{
+		fseek(mFile, CAPTURE_HEADER_SIZE, SEEK_SET);
+		mPacketCount = 0;
+	}
+}
@@ -0,0 +1,104 @@
+/**
+ * @file llpacketcapture.h
+ * @brief Recording and reading back captures of inbound UDP packets
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETCAPTURE_H
+#define LL_LLPACKETCAPTURE_H
+
+#include <string>
+
+#include "llfile.h"
+#include "llhost.h"
+
+// A capture holds the raw UDP packets a session received, in order, so the
+// session can be fed through LLMessageSystem::checkMessages() again offline
+// (see LLPacketRing::startCapture() and startReplay()).
+//
+// The file starts with an 8 byte magic number and a U32 version, followed
+// by one record per packet:
+//   U64	receive time, microseconds on the totalTime() clock
+//   U32	sender address, U16 sender port
+//   U32	receiving interface address, U16 its port
+//   U16	packet size, then the packet as read from the socket
+// Addresses are stored in network order, everything else little endian.
+class LLPacketCaptureWriter
+{
+public:
+	LLPacketCaptureWriter();
+	~LLPacketCaptureWriter();
+
+	// Creates (or truncates) filename and writes the file header
+	BOOL open(const std::string& filename);
+	void close();
+	BOOL isOpen() const						{ return mFile != NULL; }
+
+	// Appends a packet, returns FALSE if the write failed
+	BOOL write(U64 receive_time, const LLHost& sender, const LLHost& receiving_if, const U8* data, S32 size);
+
+	U32 getPacketCount() const				{ return mPacketCount; }
+	const std::string& getFileName() const	{ return mFileName; }
+
+private:
+	LLFILE* mFile;
+	std::string mFileName;
+	U32 mPacketCount;
+};
+
+class LLPacketCaptureReader
+{
+public:
+	LLPacketCaptureReader();
+	~LLPacketCaptureReader();
+
+	// Opens filename and checks its header
+	BOOL open(const std::string& filename);
+	void close();
+	BOOL isOpen() const						{ return mFile != NULL; }
+
+	// Reads the next packet into data, which must hold NET_BUFFER_SIZE
+	// bytes. Returns the packet size, or 0 at the end of the capture (a
+	// record cut short, as by a crash while capturing, also ends it).
+	S32 read(U64& receive_time, LLHost& sender, LLHost& receiving_if, U8* data);
+
+	// Back to the first packet
+	void rewind();
+
+	U32 getPacketCount() const				{ return mPacketCount; }
+	const std::string& getFileName() const	{ return mFileName; }
+
+private:
+	LLFILE* mFile;
+	std::string mFileName;
+	U32 mPacketCount;
+};
+
+#endif // LL_LLPACKETCAPTURE_H
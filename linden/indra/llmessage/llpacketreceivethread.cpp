@@ -0,0 +1,125 @@
+/**
+ * @file llpacketreceivethread.cpp
+ * @brief Thread that reads UDP packets into a lock-free ring
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketreceivethread.h"
+
+#include "llpacketbuffer.h"
+#include "lltimer.h"
+#include "net.h"
+
+// How long the thread blocks in select() before checking whether it should quit
+const U32 RECEIVE_WAIT_MS = 50;
+
+LLPacketReceiveThread::LLPacketReceiveThread(S32 socket, U32 size)
+:	LLThread("Packet receive"),
+	mSocket(socket),
+	mHead(0),
+	mTail(0),
+	mPacketCount(0),
+	mDroppedCount(0),
+	mMaxQueueDepth(0)
+{
+	U32 capacity = 1;
+	while (capacity < size)
+	{
+		capacity <<= 1;
+	}
+	mMask = capacity - 1;
+	mBuffers.resize(capacity);
+	for (U32 i = 0; i < capacity; i++)
+	{
+		mBuffers[i] = new LLPacketBuffer(LLHost(), NULL, 0);
+	}
+}
+
+LLPacketReceiveThread::~LLPacketReceiveThread()
+{
+	// Stop the thread before its buffers go away, so ~LLThread() finds it
+	// stopped. The wait is bounded by one select() timeout.
+	setQuitting();
+	for (S32 i = 0; mAPRThreadp && !isStopped() && i < 100; i++)
+	{
+		ms_sleep(RECEIVE_WAIT_MS);
+	}
+	for (U32 i = 0; i < mBuffers.size(); i++)
+	{
+		delete mBuffers[i];
+	}
+}
+
+void LLPacketReceiveThread::run()
+{
+	// Packets that arrive while the ring is full are still read, so the
+	// kernel buffer keeps draining, and then thrown away
+	LLPacketBuffer overflow(LLHost(), NULL, 0);
+
+	while (!isQuitting())
+	{
+		if (!wait_for_packet(mSocket, RECEIVE_WAIT_MS))
+		{
+			continue;
+		}
+
+		while (!isQuitting())
+		{
+			U32 head = mHead;
+			U32 depth = head - mTail;
+			LLPacketBuffer* packetp = depth <= mMask ? mBuffers[head & mMask] : &overflow;
+
+			packetp->init(mSocket);
+			if (packetp->getSize() <= 0)
+			{
+				// Socket drained (or a transient error, which the main
+				// thread's direct reads used to swallow the same way)
+				break;
+			}
+
+			mPacketCount++;
+			if (packetp == &overflow)
+			{
+				mDroppedCount++;
+				continue;
+			}
+
+			// The increment is a full barrier, so the packet is written
+			// before the consumer can see it
+			mHead++;
+			if (depth + 1 > mMaxQueueDepth)
+			{
+				mMaxQueueDepth = depth + 1;
+			}
+		}
+	}
+}
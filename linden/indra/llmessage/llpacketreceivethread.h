@@ -0,0 +1,90 @@
+/**
+ * @file llpacketreceivethread.h
+ * @brief Thread that reads UDP packets into a lock-free ring
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETRECEIVETHREAD_H
+#define LL_LLPACKETRECEIVETHREAD_H
+
+#include <vector>
+
+#include "llapr.h"
+#include "llthread.h"
+
+class LLPacketBuffer;
+
+// Reads packets off a UDP socket as soon as they arrive, so they don't sit
+// in the kernel buffer (or get dropped there) while the main thread is busy.
+// Packets go into a fixed ring of buffers with one producer (this thread)
+// and one consumer (the thread that owns the LLPacketRing), handed over
+// through the atomic head and tail counts without locking.
+class LLPacketReceiveThread : public LLThread
+{
+public:
+	// size is rounded up to a power of two
+	LLPacketReceiveThread(S32 socket, U32 size = 512);
+	virtual ~LLPacketReceiveThread();
+
+	// Consumer side. getPacket(0) is the oldest packet not yet popped;
+	// index must be less than getQueueDepth().
+	U32 getQueueDepth()						{ return mHead - mTail; }
+	const LLPacketBuffer* getPacket(U32 index)	{ return mBuffers[(mTail + index) & mMask]; }
+	void popPacket()						{ mTail++; }
+
+	U32 getCapacity() const					{ return mBuffers.size(); }
+
+	// Packets read from the socket, including dropped ones
+	U32 getPacketCount()					{ return mPacketCount; }
+	// Packets thrown away because the ring was full
+	U32 getDroppedCount()					{ return mDroppedCount; }
+	// Deepest the queue has been since the last reset
+	U32 getMaxQueueDepth()					{ return mMaxQueueDepth; }
+	void resetMaxQueueDepth()				{ mMaxQueueDepth = 0; }
+
+protected:
+	virtual void run();
+
+private:
+	S32 mSocket;
+	std::vector<LLPacketBuffer*> mBuffers;
+	U32 mMask;
+
+	// Free running counts; only the thread advances mHead and only the
+	// consumer advances mTail.
+	LLAtomicU32 mHead;
+	LLAtomicU32 mTail;
+
+	LLAtomicU32 mPacketCount;
+	LLAtomicU32 mDroppedCount;
+	LLAtomicU32 mMaxQueueDepth;
+};
+
+#endif // LL_LLPACKETRECEIVETHREAD_H
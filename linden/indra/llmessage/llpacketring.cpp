@@ -41,6 +41,8 @@
 #include "llrand.h"
 #include "u64.h"
 #include "llmessagelog.h"
+#include "llpacketcapture.h"
+#include "llpacketreceivethread.h"
 #include "message.h"
 
 #include "llsocks5.h"
@@ -64,7 +66,14 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mLastReceiveTime(0),
+	mLastPacketSeen(FALSE),
+	mReceiveThread(NULL),
+	mSeenPackets(0),
+	mCapture(NULL),
+	mReplay(NULL),
+	mReplayFinished(FALSE)
 {
 }
 
@@ -79,6 +88,10 @@ void LLPacketRing::cleanup ()
 {
 	LLPacketBuffer *packetp;
 
+	stopReceiveThread();
+	stopCapture();
+	stopReplay();
+
 	while (!mReceiveQueue.empty())
 	{
 		packetp = mReceiveQueue.front();
@@ -125,6 +138,165 @@ void LLPacketRing::setOutBandwidth(const F32 bps)
 {
 	mOutThrottle.setRate(bps);
 }
+
+void LLPacketRing::startReceiveThread(S32 socket)
+{
+	if (!mReceiveThread)
+	{
+		llinfos << "Starting packet receive thread" << llendl;
+		mReceiveThread = new LLPacketReceiveThread(socket);
+		mSeenPackets = 0;
+		mReceiveThread->start();
+	}
+}
+
+void LLPacketRing::stopReceiveThread()
+{
+	if (mReceiveThread)
+	{
+		llinfos << "Stopping packet receive thread, " << mReceiveThread->getPacketCount()
+				<< " packets received, " << mReceiveThread->getDroppedCount() << " dropped" << llendl;
+		// Anything still queued is lost, like packets left in the socket buffer
+		delete mReceiveThread;
+		mReceiveThread = NULL;
+		mSeenPackets = 0;
+	}
+}
+
+BOOL LLPacketRing::startCapture(const std::string& filename)
+{
+	stopCapture();
+
+	mCapture = new LLPacketCaptureWriter;
+	if (!mCapture->open(filename))
+	{
+		stopCapture();
+		return FALSE;
+	}
+	llinfos << "Capturing incoming packets to " << filename << llendl;
+	return TRUE;
+}
+
+void LLPacketRing::stopCapture()
+{
+	if (mCapture)
+	{
+		llinfos << "Captured " << mCapture->getPacketCount() << " packets to " << mCapture->getFileName() << llendl;
+		delete mCapture;
+		mCapture = NULL;
+	}
+}
+
+BOOL LLPacketRing::startReplay(const std::string& filename)
+{
+	stopReplay();
+
+	mReplay = new LLPacketCaptureReader;
+	if (!mReplay->open(filename))
+	{
+		stopReplay();
+		return FALSE;
+	}
+	mReplayFinished = FALSE;
+	return TRUE;
+}
+
+void LLPacketRing::stopReplay()
+{
+	delete mReplay;
+	mReplay = NULL;
+	mReplayFinished = FALSE;
+}
+
+void LLPacketRing::getUnseenPackets(std::vector<const LLPacketBuffer*>& packets)
+{
+	// The in throttle copies packets into mReceiveQueue as it likes, so
+	// don't let anyone get ahead of it. Simulated drops are only decided
+	// when a packet is received, so acks read early could belong to a
+	// packet that then gets thrown away.
+	if (!mReceiveThread || mUseInThrottle || mReplay || mDropPercentage > 0.f)
+	{
+		return;
+	}
+
+	U32 depth = mReceiveThread->getQueueDepth();
+	for ( ; mSeenPackets < depth; mSeenPackets++)
+	{
+		packets.push_back(mReceiveThread->getPacket(mSeenPackets));
+	}
+}
+
+///////////////////////////////////////////////////////////
+S32 LLPacketRing::receiveFromNet(S32 socket, char *datap)
+{
+	S32 packet_size = 0;
+	mLastPacketSeen = FALSE;
+
+	if (mReceiveThread)
+	{
+		if (!mReceiveThread->getQueueDepth())
+		{
+			return 0;
+		}
+
+		const LLPacketBuffer* packetp = mReceiveThread->getPacket(0);
+		packet_size = packetp->getSize();
+		memcpy(datap, packetp->getData(), packet_size);	/*Flawfinder: ignore*/
+		mLastSender = packetp->getHost();
+		mLastReceivingIF = packetp->getReceivingInterface();
+		mLastReceiveTime = packetp->getReceiveTime();
+		if (mSeenPackets)
+		{
+			mLastPacketSeen = TRUE;
+			mSeenPackets--;
+		}
+		mReceiveThread->popPacket();
+		return packet_size;
+	}
+
+	if (LLSocks::isEnabled())
+	{
+		proxywrap_t * header;
+		datap  = datap-10;
+		header = (proxywrap_t *)datap;
+		packet_size = receive_packet(socket, datap);
+		mLastSender.setAddress(header->addr);
+		mLastSender.setPort(ntohs(header->port));
+		if (packet_size > 10)
+		{
+			packet_size -= 10;			
+		}
+	}
+	else
+	{
+		packet_size = receive_packet(socket, datap);		
+		mLastSender = ::get_sender();
+	}
+
+	mLastReceivingIF = ::get_receiving_interface();
+	mLastReceiveTime = totalTime();
+	return packet_size;
+}
+S32 LLPacketRing::receiveFromReplay(char *datap)
+{
+	mLastPacketSeen = FALSE;
+	if (mReplayFinished)
+	{
+		return 0;
+	}
+
+	U64 capture_time;
+	S32 packet_size = mReplay->read(capture_time, mLastSender, mLastReceivingIF, (U8*)datap);
+	if (!packet_size)
+	{
+		mReplayFinished = TRUE;
+		return 0;
+	}
+	// Replayed packets arrive now, as far as anyone timing them goes
+	mLastReceiveTime = totalTime();
+	return packet_size;
+}
+
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 {
@@ -153,6 +325,8 @@ S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 	// need to set sender IP/port!!
 	mLastSender = packetp->getHost();
 	mLastReceivingIF = packetp->getReceivingInterface();
+	mLastReceiveTime = packetp->getReceiveTime();
+	mLastPacketSeen = FALSE;
 	delete packetp;
 
 	this->mInBufferLength -= packet_size;
@@ -167,6 +341,12 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 {
 	S32 packet_size = 0;
 
+	if (mReplay)
+	{
+		// Replays what was received, so no throttle or dropping
+		return receiveFromReplay(datap);
+	}
+
 	// If using the throttle, simulate a limited size input buffer.
 	if (mUseInThrottle)
 	{
@@ -176,7 +356,26 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 		while (!done)
 		{
 			LLPacketBuffer *packetp;
-			packetp = new LLPacketBuffer(socket);
+			if (mReceiveThread)
+			{
+				if (mReceiveThread->getQueueDepth())
+				{
+					packetp = new LLPacketBuffer(*mReceiveThread->getPacket(0));
+					mReceiveThread->popPacket();
+					if (mSeenPackets)
+					{
+						mSeenPackets--;
+					}
+				}
+				else
+				{
+					packetp = new LLPacketBuffer(LLHost(), NULL, 0);
+				}
+			}
+			else
+			{
+				packetp = new LLPacketBuffer(socket);
+			}
 
 			if (packetp->getSize())
 			{
@@ -232,27 +431,8 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 	}
 	else
 	{
-		// no delay, pull straight from net
-		if (LLSocks::isEnabled())
-		{
-			proxywrap_t * header;
-			datap  = datap-10;
-			header = (proxywrap_t *)datap;
-			packet_size = receive_packet(socket, datap);
-			mLastSender.setAddress(header->addr);
-			mLastSender.setPort(ntohs(header->port));
-			if (packet_size > 10)
-			{
-				packet_size -= 10;			
-			}
-		}
-		else
-		{
-			packet_size = receive_packet(socket, datap);		
-			mLastSender = ::get_sender();
-		}
-
-		mLastReceivingIF = ::get_receiving_interface();
+		// no delay, pull straight from net (or from the receive thread)
+		packet_size = receiveFromNet(socket, datap);
 
 		if (packet_size)  // did we actually get a packet?
 		{
@@ -269,11 +449,27 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 		}
 	}
 
+	if (mCapture && packet_size > 0)
+	{
+		mCapture->write(mLastReceiveTime, mLastSender, mLastReceivingIF, (const U8*)datap, packet_size);
+		if (!mCapture->isOpen())
+		{
+			stopCapture();
+		}
+	}
+
 	return packet_size;
 }
 
 BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host)
 {
+	if (mReplay)
+	{
+		// Nobody to send to
+		mActualBitsOut += buf_size * 8;
+		return TRUE;
+	}
+
 	//<edit>
 	LLMessageLog::log(LLHost(16777343, gMessageSystem->getListenPort()), host, (U8*)send_buffer, buf_size);
 	//</edit>
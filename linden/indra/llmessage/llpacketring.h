@@ -35,12 +35,16 @@
 #define LL_LLPACKETRING_H
 
 #include <queue>
+#include <vector>
 
 #include "llpacketbuffer.h"
 #include "llhost.h"
 #include "net.h"
 #include "llthrottle.h"
 
+class LLPacketCaptureReader;
+class LLPacketCaptureWriter;
+class LLPacketReceiveThread;
 
 class LLPacketRing
 {
@@ -59,10 +63,38 @@ public:
 	S32  receivePacket (S32 socket, char *datap);
 	S32  receiveFromRing (S32 socket, char *datap);
 
+	// Reads the socket on a thread of its own from now on, instead of on
+	// the caller of receivePacket().
+	void startReceiveThread(S32 socket);
+	void stopReceiveThread();
+	LLPacketReceiveThread* getReceiveThread()	{ return mReceiveThread; }
+
+	// Packets waiting in the receive thread's queue that no earlier call
+	// returned, oldest first. Lets the caller look at them (to process
+	// their acks) before they are received. Returns nothing while the in
+	// throttle or the drop simulation is on, or while replaying.
+	void getUnseenPackets(std::vector<const LLPacketBuffer*>& packets);
+
+	// Writes every packet received from now on to a capture file
+	BOOL startCapture(const std::string& filename);
+	void stopCapture();
+	BOOL isCapturing() const					{ return mCapture != NULL; }
+
+	// Takes received packets from a capture file instead of the socket,
+	// as fast as they are asked for, and throws sent packets away. Once
+	// the capture runs out nothing more is received until stopReplay().
+	BOOL startReplay(const std::string& filename);
+	void stopReplay();
+	BOOL isReplaying() const					{ return mReplay != NULL; }
+	BOOL isReplayFinished() const				{ return mReplayFinished; }
+
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
 
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
+	U64 getLastReceiveTime() const				{ return mLastReceiveTime; }
+	// TRUE if the last packet was returned by getUnseenPackets() first
+	BOOL getLastPacketSeen() const				{ return mLastPacketSeen; }
 
 	S32 getAndResetActualInBits()				{ S32 bits = mActualBitsIn; mActualBitsIn = 0; return bits;}
 	S32 getAndResetActualOutBits()				{ S32 bits = mActualBitsOut; mActualBitsOut = 0; return bits;}
@@ -88,6 +120,18 @@ protected:
 
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
+	U64 mLastReceiveTime;
+	BOOL mLastPacketSeen;
+
+	LLPacketReceiveThread* mReceiveThread;
+	U32 mSeenPackets;				// Front of the receive thread's queue already returned by getUnseenPackets()
+
+	LLPacketCaptureWriter* mCapture;
+	LLPacketCaptureReader* mReplay;
+	BOOL mReplayFinished;
+
+	S32 receiveFromNet(S32 socket, char *datap);
+	S32 receiveFromReplay(char *datap);
 
 	BOOL doSendPacket(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
 	U8	 mProxyWrappedSendBuffer[NET_BUFFER_SIZE];
@@ -46,6 +46,8 @@
 LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 												 number_template_map) :
 	mReceiveSize(0),
+	mReceiveBody(NULL),
+	mReceiveBodySize(0),
 	mCurrentRMessageTemplate(NULL),
 	mCurrentRMessageData(NULL),
 	mMessageNumbers(number_template_map)
@@ -63,6 +65,8 @@ LLTemplateMessageReader::~LLTemplateMessageReader()
 void LLTemplateMessageReader::clearMessage()
 {
 	mReceiveSize = -1;
+	mReceiveBody = NULL;
+	mReceiveBodySize = 0;
 	mCurrentRMessageTemplate = NULL;
 	delete mCurrentRMessageData;
 	mCurrentRMessageData = NULL;
@@ -561,6 +565,8 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 	// message name.
 	U8 offset = buffer[PHL_OFFSET];
 	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
+	mReceiveBody = buffer + decode_pos;
+	mReceiveBodySize = llmax(mReceiveSize - decode_pos, 0);
 
 	// create base working data set
 	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
@@ -836,6 +842,11 @@ BOOL LLTemplateMessageReader::readMessage(const U8* buffer,
 	return decodeData(buffer, sender);
 }
 
+U32 LLTemplateMessageReader::getMessageNumber() const
+{
+	return mCurrentRMessageTemplate ? mCurrentRMessageTemplate->mMessageNumber : 0;
+}
+
 //virtual 
 const char* LLTemplateMessageReader::getMessageName() const
 {
@@ -102,6 +102,12 @@ public:
 	virtual const char* getMessageName() const;
 	virtual S32 getMessageSize() const;
 
+	// The current message as received, from just past its message number.
+	// Only valid while the message's handler runs.
+	U32 getMessageNumber() const;
+	const U8* getMessageBody() const			{ return mReceiveBody; }
+	S32 getMessageBodySize() const				{ return mReceiveBodySize; }
+
 	// <edit>
 	LLMessageTemplate* getTemplate();
 	// </edit>
@@ -129,6 +135,8 @@ private:
 	void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
 
 	S32	mReceiveSize;
+	const U8* mReceiveBody;
+	S32 mReceiveBodySize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
 	LLMsgData* mCurrentRMessageData;
 	message_template_number_map_t& mMessageNumbers;
@@ -0,0 +1,240 @@
+/**
+ * @file llzerocode.cpp
+ * @brief Zero coding of UDP message bodies
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llzerocode.h"
+
+// Only vectorize when the whole build uses SSE2, see llv4math.h
+#if (LL_GNUC && __SSE2__) || (LL_MSVC && (_M_X64 || _M_IX86_FP >= 2))
+#define LL_ZERO_CODE_SSE2 1
+#include <emmintrin.h>
+#if LL_MSVC
+#include <intrin.h>
+#endif
+#else
+#define LL_ZERO_CODE_SSE2 0
+#endif
+
+#if LL_ZERO_CODE_SSE2
+
+// Index of the lowest set bit of a non-zero mask
+inline S32 lowest_bit(U32 mask)
+{
+#if LL_MSVC
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (S32)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// Bit i is set if byte i of the 16 at p is zero
+inline U32 zero_mask(const __m128i& bytes)
+{
+	return (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()));
+}
+
+#endif // LL_ZERO_CODE_SSE2
+
+// Copies bytes from in to out up to the next zero or end. The vector loop
+// stores 16 bytes at a time, so out may be written up to 15 bytes past the
+// last byte copied.
+inline void copy_literals(const U8*& in, const U8* end, U8*& out)
+{
+#if LL_ZERO_CODE_SSE2
+	while (end - in >= 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)in);
+		_mm_storeu_si128((__m128i*)out, bytes);
+		U32 mask = zero_mask(bytes);
+		if (mask)
+		{
+			S32 length = lowest_bit(mask);
+			in += length;
+			out += length;
+			return;
+		}
+		in += 16;
+		out += 16;
+	}
+#endif
+	while (in < end && *in)
+	{
+		*out++ = *in++;
+	}
+}
+
+// Returns the first byte at or after in that is not zero, or end
+inline const U8* skip_literals(const U8* in, const U8* end)
+{
+#if LL_ZERO_CODE_SSE2
+	while (end - in >= 16)
+	{
+		U32 mask = zero_mask(_mm_loadu_si128((const __m128i*)in));
+		if (mask)
+		{
+			return in + lowest_bit(mask);
+		}
+		in += 16;
+	}
+#endif
+	while (in < end && *in)
+	{
+		in++;
+	}
+	return in;
+}
+
+// Returns the first byte at or after in that is not zero, or end
+inline const U8* skip_zeros(const U8* in, const U8* end)
+{
+#if LL_ZERO_CODE_SSE2
+	while (end - in >= 16)
+	{
+		U32 mask = ~zero_mask(_mm_loadu_si128((const __m128i*)in)) & 0xffff;
+		if (mask)
+		{
+			return in + lowest_bit(mask);
+		}
+		in += 16;
+	}
+#endif
+	while (in < end && !*in)
+	{
+		in++;
+	}
+	return in;
+}
+
+S32 zero_code_encode(const U8* in, S32 size, U8* out)
+{
+	const U8* end = in + size;
+	U8* start = out;
+	while (in < end)
+	{
+		copy_literals(in, end, out);
+		if (in == end)
+		{
+			break;
+		}
+
+		const U8* run = in;
+		in = skip_zeros(in, end);
+		S32 zeros = (S32)(in - run);
+		while (zeros >= 255)
+		{
+			*out++ = 0;
+			*out++ = 255;
+			zeros -= 255;
+		}
+		if (zeros)
+		{
+			*out++ = 0;
+			*out++ = (U8)zeros;
+		}
+	}
+	return (S32)(out - start);
+}
+
+S32 zero_code_encoded_size(const U8* in, S32 size)
+{
+	const U8* end = in + size;
+	S32 encoded_size = size;
+	while (in < end)
+	{
+		in = skip_literals(in, end);
+		if (in == end)
+		{
+			break;
+		}
+
+		const U8* run = in;
+		in = skip_zeros(in, end);
+		S32 zeros = (S32)(in - run);
+		// Each piece of up to 255 zeros becomes two bytes
+		encoded_size += 2 * ((zeros + 254) / 255) - zeros;
+	}
+	return encoded_size;
+}
+
+S32 zero_code_expand(const U8* in, S32 size, U8* out, S32 max_size)
+{
+	const U8* end = in + size;
+	U8* start = out;
+	U8* out_end = out + max_size;
+	while (in < end)
+	{
+		// A literal run is no longer than what is left of the input, so
+		// only copy it whole when that fits
+		if (end - in > out_end - out)
+		{
+			while (in < end && *in)
+			{
+				if (out == out_end)
+				{
+					return -1;
+				}
+				*out++ = *in++;
+			}
+		}
+		else
+		{
+			copy_literals(in, end, out);
+		}
+		if (in == end)
+		{
+			break;
+		}
+
+		// A zero, then a length. Zeros in place of the length stand for 256
+		// more each, and the length may be missing at the end of the packet.
+		in++;
+		S32 zeros = 1;
+		const U8* run = in;
+		in = skip_zeros(in, end);
+		zeros += 256 * (S32)(in - run);
+		if (in < end)
+		{
+			zeros += *in++ - 1;
+		}
+		if (zeros > out_end - out)
+		{
+			return -1;
+		}
+		memset(out, 0, zeros);
+		out += zeros;
+	}
+	return (S32)(out - start);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file llzerocode.h
+ * @brief Zero coding of UDP message bodies
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLZEROCODE_H
+#define LL_LLZEROCODE_H
+
+// Zerocoded messages send every run of zero bytes as a zero followed by the
+// length of the run, splitting runs longer than 255. These work on the
+// packet after its header, and look for zeros 16 bytes at a time where the
+// build has SSE2.
+
+// Encodes size bytes from in to out, which needs room for 2 * size bytes.
+// Returns the encoded size.
+S32 zero_code_encode(const U8* in, S32 size, U8* out);
+
+// The size zero_code_encode() would return, without writing anything
+S32 zero_code_encoded_size(const U8* in, S32 size);
+
+// Expands size encoded bytes from in to out. Returns the expanded size, or
+// -1 if that would be more than max_size, leaving out undefined.
+S32 zero_code_expand(const U8* in, S32 size, U8* out, S32 max_size);
+
+#endif // LL_LLZEROCODE_H
@@ -71,6 +71,8 @@
 #include "lltrustedmessageservice.h"
 #include "llmessagetemplate.h"
 #include "llmessagetemplateparser.h"
+#include "llpacketreceivethread.h"
+#include "llzerocode.h"
 #include "llsd.h"
 #include "llsdmessagebuilder.h"
 #include "llsdmessagereader.h"
@@ -223,6 +225,9 @@ void LLMessageSystem::init()
 	mTotalBytesIn = 0;
 	mTotalBytesOut = 0;
 
+	mQueuedPacketsIn = 0;
+	mQueuedUsecsIn = 0;
+
     mDroppedPackets = 0;            // total dropped packets in
     mResentPackets = 0;             // total resent packets out
     mFailedResendPackets = 0;       // total resend failure packets out
@@ -362,6 +367,9 @@ LLMessageSystem::~LLMessageSystem()
 	for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
 	mMessageNumbers.clear();
 	
+	// The receive thread must be done with the socket before it closes
+	mPacketRing.stopReceiveThread();
+
 	if (!mbError)
 	{
 		end_net(mSocket);
@@ -536,6 +544,10 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 		mMessageCountTime = getMessageTimeSeconds();
 	}
 
+	// Get the acks of everything that's arrived in before any of it is
+	// decoded, so a backlog doesn't hold them up and cause resends
+	processQueuedAcks();
+
 	// loop until either no packets or a valid packet
 	// i.e., burn through packets from unregistered circuits
 	S32 receive_size = 0;
@@ -564,6 +576,12 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 		receive_size = mTrueReceiveSize;
 		mLastSender = mPacketRing.getLastSender();
 		mLastReceivingIF = mPacketRing.getLastReceivingInterface();
+
+		if (receive_size > 0 && mPacketRing.getReceiveThread())
+		{
+			mQueuedPacketsIn++;
+			mQueuedUsecsIn += totalTime() - mPacketRing.getLastReceiveTime();
+		}
 		
 		if (receive_size < (S32) LL_MINIMUM_VALID_PACKET_SIZE)
 		{
@@ -615,24 +633,13 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 			// this message came in on if it's valid, and NULL if the
 			// circuit was bogus.
 
-			if(cdp && (acks > 0) && ((S32)(acks * sizeof(TPACKETID)) < (true_rcv_size)))
+			// The acks are read from the packet as received: buffer may
+			// now point at the zero-code expanded copy, which doesn't have
+			// them at the same offset.
+			if(cdp && (acks > 0) && ((S32)(acks * sizeof(TPACKETID)) < (true_rcv_size))
+			   && !mPacketRing.getLastPacketSeen())
 			{
-				TPACKETID packet_id;
-				U32 mem_id=0;
-				for(S32 i = 0; i < acks; ++i)
-				{
-					true_rcv_size -= sizeof(TPACKETID);
-					memcpy(&mem_id, &buffer[true_rcv_size], /* Flawfinder: ignore*/
-					     sizeof(TPACKETID));
-					packet_id = ntohl(mem_id);
-					//LL_INFOS("Messaging") << "got ack: " << packet_id << llendl;
-					cdp->ackReliablePacket(packet_id);
-				}
-				if (!cdp->getUnackedPacketCount())
-				{
-					// Remove this circuit from the list of circuits with unacked packets
-					mCircuitInfo.mUnackedCircuitMap.erase(cdp->mHost);
-				}
+				processAppendedAcks(cdp, mTrueReceiveBuffer.buffer, true_rcv_size, acks);
 			}
 
 			if (buffer[0] & LL_RELIABLE_FLAG)
@@ -795,6 +802,77 @@ S32	LLMessageSystem::getReceiveBytes() const
 }
 
 
+void LLMessageSystem::processAppendedAcks(LLCircuitData* cdp, const U8* buffer, S32 size, S32 acks)
+{
+	// The ack count is a single byte
+	TPACKETID packet_ids[256];
+	acks = llmin(acks, 256);
+	U32 mem_id=0;
+	for(S32 i = 0; i < acks; ++i)
+	{
+		size -= sizeof(TPACKETID);
+		memcpy(&mem_id, &buffer[size], /* Flawfinder: ignore*/
+			 sizeof(TPACKETID));
+		packet_ids[i] = ntohl(mem_id);
+		//LL_INFOS("Messaging") << "got ack: " << packet_ids[i] << llendl;
+	}
+	cdp->ackReliablePackets(packet_ids, acks);
+	if (!cdp->getUnackedPacketCount())
+	{
+		// Remove this circuit from the list of circuits with unacked packets
+		mCircuitInfo.mUnackedCircuitMap.erase(cdp->mHost);
+	}
+}
+
+void LLMessageSystem::processQueuedAcks()
+{
+	mQueuedPackets.clear();
+	mPacketRing.getUnseenPackets(mQueuedPackets);
+
+	for (U32 i = 0; i < mQueuedPackets.size(); i++)
+	{
+		const LLPacketBuffer* packetp = mQueuedPackets[i];
+		const U8* buffer = (const U8*)packetp->getData();
+		S32 size = packetp->getSize();
+		if (size < (S32)LL_MINIMUM_VALID_PACKET_SIZE || !(buffer[0] & LL_ACK_FLAG))
+		{
+			continue;
+		}
+
+		// Same checks as checkMessages(), which will complain about any
+		// malformed packets when it gets to them
+		S32 acks = buffer[--size];
+		if (size < (S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE))
+		{
+			continue;
+		}
+
+		// Like findCircuit(), ignore dead circuits when we're protected,
+		// but leave opening and waking circuits to checkMessages()
+		LLCircuitData* cdp = mCircuitInfo.findCircuit(packetp->getHost());
+		if (cdp && !cdp->isAlive() && mbProtected)
+		{
+			continue;
+		}
+		if (cdp && acks > 0)
+		{
+			processAppendedAcks(cdp, buffer, size, acks);
+		}
+	}
+}
+
+void LLMessageSystem::setUseReceiveThread(BOOL use_thread)
+{
+	if (use_thread && !mbError)
+	{
+		mPacketRing.startReceiveThread(mSocket);
+	}
+	else
+	{
+		mPacketRing.stopReceiveThread();
+	}
+}
+
 void LLMessageSystem::processAcks()
 {
 	F64 mt_sec = getMessageTimeSeconds();
@@ -2252,7 +2330,8 @@ S32 LLMessageSystem::sendError(
 
 void	process_packet_ack(LLMessageSystem *msgsystem, void** /*user_data*/)
 {
-	TPACKETID packet_id;
+	const S32 MAX_BATCH = 256;
+	TPACKETID packet_ids[MAX_BATCH];
 
 	LLHost host = msgsystem->getSender();
 	LLCircuitData *cdp = msgsystem->mCircuitInfo.findCircuit(host);
@@ -2261,12 +2340,18 @@ void	process_packet_ack(LLMessageSystem *msgsystem, void** /*user_data*/)
 	
 		S32 ack_count = msgsystem->getNumberOfBlocksFast(_PREHASH_Packets);
 
+		S32 batch = 0;
 		for (S32 i = 0; i < ack_count; i++)
 		{
-			msgsystem->getU32Fast(_PREHASH_Packets, _PREHASH_ID, packet_id, i);
-//			LL_DEBUGS("Messaging") << "ack recvd' from " << host << " for packet " << (TPACKETID)packet_id << llendl;
-			cdp->ackReliablePacket(packet_id);
+			msgsystem->getU32Fast(_PREHASH_Packets, _PREHASH_ID, packet_ids[batch], i);
+//			LL_DEBUGS("Messaging") << "ack recvd' from " << host << " for packet " << packet_ids[batch] << llendl;
+			if (++batch == MAX_BATCH)
+			{
+				cdp->ackReliablePackets(packet_ids, batch);
+				batch = 0;
+			}
 		}
+		cdp->ackReliablePackets(packet_ids, batch);
 		if (!cdp->getUnackedPacketCount())
 		{
 			// Remove this circuit from the list of circuits with unacked packets
@@ -2634,6 +2719,17 @@ void LLMessageSystem::summarizeLogs(std::ostream& str)
 	tmp_str = U64_to_str(savings/(mPacketsIn+1));
 	buffer = llformat( "Avg overall comp savings:  %20s (%5.2f : 1)", tmp_str.c_str(), ((F32) mTotalBytesIn + (F32) savings)/((F32) mTotalBytesIn + 1.f));
 
+	LLPacketReceiveThread* receive_thread = mPacketRing.getReceiveThread();
+	if (receive_thread)
+	{
+		str << buffer << std::endl;
+		buffer = llformat( "Receive thread drops:      %20u (%5.2f%%)", receive_thread->getDroppedCount(), 100.f * ((F32) receive_thread->getDroppedCount())/((F32) receive_thread->getPacketCount() + 1));
+		str << buffer << std::endl;
+		buffer = llformat( "Receive queue depth:       %20u (max %u of %u)", receive_thread->getQueueDepth(), receive_thread->getMaxQueueDepth(), receive_thread->getCapacity());
+		str << buffer << std::endl;
+		buffer = llformat( "Avg receive queue wait:    %20.3f ms", ((F32) mQueuedUsecsIn)/((F32) mQueuedPacketsIn + 1) * 0.001f);
+	}
+
 	// Outgoing
 	str << buffer << std::endl << std::endl << "Outgoing:" << std::endl;
 	tmp_str = U64_to_str(mTotalBytesOut);
@@ -2818,54 +2914,11 @@ S32 LLMessageSystem::zeroCodeAdjustCurrentSendTotal()
 	// TODO: babbage: remove this horror
 	mMessageBuilder->setBuilt(FALSE);
 
-	S32 count = mSendSize;
-	
-	S32 net_gain = 0;
-	U8 num_zeroes = 0;
-	
-	U8 *inptr = (U8 *)mSendBuffer;
+// skip the packet id field, and don't actually build, just test
 
-// skip the packet id field
-
-	for (U32 ii = 0; ii < LL_PACKET_ID_SIZE; ++ii)
-	{
-		count--;
-		inptr++;
-	}
+	S32 count = mSendSize - LL_PACKET_ID_SIZE;
+	S32 net_gain = zero_code_encoded_size(mSendBuffer + LL_PACKET_ID_SIZE, count) - count;
 
-// don't actually build, just test
-
-// sequential zero bytes are encoded as 0 [U8 count] 
-// with 0 0 [count] representing wrap (>256 zeroes)
-
-	while (count--)
-	{
-		if (!(*inptr))   // in a zero count
-		{
-			if (num_zeroes)
-			{
-				if (++num_zeroes > 254)
-				{
-					num_zeroes = 0;
-				}
-				net_gain--;   // subseqent zeroes save one
-			}
-			else
-			{
-				net_gain++;  // starting a zero count adds one
-				num_zeroes = 1;
-			}
-			inptr++;
-		}
-		else
-		{
-			if (num_zeroes)
-			{
-				num_zeroes = 0;
-			}
-			inptr++;
-		}
-	}
 	if (net_gain < 0)
 	{
 		return net_gain;
@@ -2913,6 +2966,18 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 		*outptr++ = *inptr++;
 	}
 
+	// Expand in one pass when the result fits with room to spare. Packets
+	// that come near the end of the buffer take the byte at a time path
+	// below, which reports them.
+	S32 expanded_size = zero_code_expand(inptr, count, outptr, MAX_BUFFER_SIZE - 256 - LL_PACKET_ID_SIZE);
+	if (expanded_size >= 0)
+	{
+		*data = mEncodedRecvBuffer;
+		*data_size = LL_PACKET_ID_SIZE + expanded_size;
+		mUncompressedBytesIn += *data_size;
+		return(in_size);
+	}
+
 // reconstruct encoded packet, keeping track of net size gain
 
 // sequential zero bytes are encoded as 0 [U8 count] 
@@ -4013,6 +4078,19 @@ S32 LLMessageSystem::getReceiveSize() const
 	return mMessageReader->getMessageSize();
 }
 
+BOOL LLMessageSystem::getTemplateMessageBody(U32 message_number, const U8*& body, S32& size) const
+{
+	if (mMessageReader != mTemplateMessageReader
+		|| mTemplateMessageReader->getMessageNumber() != message_number
+		|| !mTemplateMessageReader->getMessageBody())
+	{
+		return FALSE;
+	}
+	body = mTemplateMessageReader->getMessageBody();
+	size = mTemplateMessageReader->getMessageBodySize();
+	return TRUE;
+}
+
 //static 
 void LLMessageSystem::setTimeDecodes( BOOL b )
 {
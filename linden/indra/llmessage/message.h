@@ -278,6 +278,9 @@ class LLMessageSystem : public LLMessageSenderInterface
 	S64					mTotalBytesIn;		    // total size of all uncompressed packets in
 	S64					mTotalBytesOut;		    // total size of all uncompressed packets out
 
+	U32					mQueuedPacketsIn;	    // total packets in through the receive thread
+	U64					mQueuedUsecsIn;		    // total time those packets waited between arrival and decode
+
 	BOOL                                    mSendReliable;              // does the outgoing message require a pos ack?
 
 	LLCircuit 	 			mCircuitInfo;
@@ -348,6 +351,10 @@ public:
 	BOOL	checkMessages( S64 frame_count = 0, bool faked_message = false, U8 fake_buffer[MAX_BUFFER_SIZE] = NULL, LLHost fake_host = LLHost(), S32 fake_size = 0 );
 	void	processAcks();
 
+	// Reads the socket on a separate thread, so packets are queued (and
+	// their appended acks processed) while the caller is busy elsewhere.
+	void	setUseReceiveThread(BOOL use_thread);
+
 	BOOL	isMessageFast(const char *msg);
 	BOOL	isMessage(const char *msg)
 	{
@@ -671,6 +678,11 @@ public:
 	S32		getReceiveCompressedSize() const { return mIncomingCompressedSize; }
 	S32		getReceiveBytes() const;
 
+	// The body of the message being handled, for the decoders in
+	// llmessagedecoders.h. Returns FALSE unless it is a template (not LLSD)
+	// message with the given number.
+	BOOL	getTemplateMessageBody(U32 message_number, const U8*& body, S32& size) const;
+
 	S32		getUnackedListSize() const			{ return mUnackedListSize; }
 
 	//const char* getCurrentSMessageName() const { return mCurrentSMessageName; }
@@ -822,6 +834,14 @@ private:
 
 	void init(); // ctor shared initialisation.
 
+	// Acks the packet ids appended to the end of a packet. size is the
+	// length of the packet without the trailing ack count.
+	void processAppendedAcks(LLCircuitData* cdp, const U8* buffer, S32 size, S32 acks);
+	// Processes the appended acks of packets still waiting in the receive
+	// thread's queue, ahead of decoding them.
+	void processQueuedAcks();
+	std::vector<const LLPacketBuffer*> mQueuedPackets;
+
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 	S32 mIncomingCompressedSize;		// original size of compressed msg (0 if uncomp.)
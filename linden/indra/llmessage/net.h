@@ -49,6 +49,10 @@ void	end_net(S32& socket_out);
 // returns size of packet or -1 in case of error
 S32		receive_packet(int hSocket, char * receiveBuffer);
 
+// Blocks for up to timeout_ms until a packet can be read from hSocket.
+// Returns TRUE if one is waiting.
+BOOL	wait_for_packet(int hSocket, U32 timeout_ms);
+
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
 //void	get_sender(char * tmp);
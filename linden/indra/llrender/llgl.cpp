@@ -142,6 +142,19 @@ PFNGLBLITFRAMEBUFFEREXTPROC glBlitFramebufferEXT = NULL;
 // GL_ARB_draw_buffers
 PFNGLDRAWBUFFERSARBPROC glDrawBuffersARB = NULL;
 
+#if (LL_WINDOWS || LL_LINUX) && !LL_MESA && !LL_MESA_HEADLESS
+// GL_ARB_map_buffer_range
+PFNGLMAPBUFFERRANGEPROC glMapBufferRange = NULL;
+
+// GL_ARB_sync
+PFNGLFENCESYNCPROC glFenceSync = NULL;
+PFNGLDELETESYNCPROC glDeleteSync = NULL;
+PFNGLCLIENTWAITSYNCPROC glClientWaitSync = NULL;
+
+// GL_ARB_buffer_storage
+PFNGLBUFFERSTORAGEPROC glBufferStorage = NULL;
+#endif // (LL_WINDOWS || LL_LINUX) && !LL_MESA && !LL_MESA_HEADLESS
+
 //shader object prototypes
 PFNGLDELETEOBJECTARBPROC glDeleteObjectARB = NULL;
 PFNGLGETHANDLEARBPROC glGetHandleARB = NULL;
@@ -286,6 +299,8 @@ LLGLManager::LLGLManager() :
 	mHasFragmentShader(FALSE),
 	mHasOcclusionQuery(FALSE),
 	mHasPointParameters(FALSE),
+	mHasSync(FALSE),
+	mHasBufferStorage(FALSE),
 
 	mHasAnisotropic(FALSE),
 	mHasARBEnvCombine(FALSE),
@@ -590,6 +605,8 @@ void LLGLManager::initExtensions()
 #else
 	mHasDepthClamp = FALSE;
 #endif
+	mHasSync = FALSE;
+	mHasBufferStorage = FALSE;
 	mHasMipMapGeneration = FALSE;
 	mHasSeparateSpecularColor = FALSE;
 	mHasAnisotropic = FALSE;
@@ -616,6 +633,11 @@ void LLGLManager::initExtensions()
 	mHasFramebufferMultisample = mHasFramebufferObject && ExtensionExists("GL_EXT_framebuffer_multisample", gGLHExts.mSysExts);
 	mHasDrawBuffers = ExtensionExists("GL_ARB_draw_buffers", gGLHExts.mSysExts);
 	mHasDepthClamp = ExtensionExists("GL_ARB_depth_clamp", gGLHExts.mSysExts) || ExtensionExists("GL_NV_depth_clamp", gGLHExts.mSysExts);
+#if (LL_WINDOWS || LL_LINUX) && !LL_MESA && !LL_MESA_HEADLESS
+	mHasSync = ExtensionExists("GL_ARB_sync", gGLHExts.mSysExts);
+	mHasBufferStorage = ExtensionExists("GL_ARB_buffer_storage", gGLHExts.mSysExts)
+		&& ExtensionExists("GL_ARB_map_buffer_range", gGLHExts.mSysExts);
+#endif
 #if !LL_DARWIN
 	mHasPointParameters = !mIsATI && ExtensionExists("GL_ARB_point_parameters", gGLHExts.mSysExts);
 #endif
@@ -639,6 +661,8 @@ void LLGLManager::initExtensions()
 		mHasFramebufferMultisample = FALSE;
 		mHasDrawBuffers = FALSE;
 		mHasDepthClamp = FALSE;
+		mHasSync = FALSE;
+		mHasBufferStorage = FALSE;
 		mHasMipMapGeneration = FALSE;
 		mHasSeparateSpecularColor = FALSE;
 		mHasAnisotropic = FALSE;
@@ -691,6 +715,8 @@ void LLGLManager::initExtensions()
 		if (strchr(blacklist,'r')) mHasDrawBuffers = FALSE;//S
 		if (strchr(blacklist,'s')) mHasFramebufferMultisample = FALSE;
 		if (strchr(blacklist,'t')) mHasDepthClamp = FALSE;
+		if (strchr(blacklist,'u')) mHasSync = FALSE;
+		if (strchr(blacklist,'v')) mHasBufferStorage = FALSE;
 
 	}
 #endif // LL_LINUX || LL_SOLARIS
@@ -739,6 +765,14 @@ void LLGLManager::initExtensions()
 	{
 		LL_INFOS("RenderInit") << "Couldn't initialize GL_ARB_fragment_shader" << LL_ENDL;
 	}
+	if (!mHasSync)
+	{
+		LL_INFOS("RenderInit") << "Couldn't initialize GL_ARB_sync" << LL_ENDL;
+	}
+	if (!mHasBufferStorage)
+	{
+		LL_INFOS("RenderInit") << "Couldn't initialize GL_ARB_buffer_storage" << LL_ENDL;
+	}
 
 	// Disable certain things due to known bugs
 	if (mIsIntel && mHasMipMapGeneration)
@@ -809,6 +843,21 @@ void LLGLManager::initExtensions()
 	{
 		glDrawBuffersARB = (PFNGLDRAWBUFFERSARBPROC) GLH_EXT_GET_PROC_ADDRESS("glDrawBuffersARB");
 	}
+#if (LL_WINDOWS || LL_LINUX) && !LL_MESA && !LL_MESA_HEADLESS
+	if (mHasSync)
+	{
+		glFenceSync = (PFNGLFENCESYNCPROC) GLH_EXT_GET_PROC_ADDRESS("glFenceSync");
+		glDeleteSync = (PFNGLDELETESYNCPROC) GLH_EXT_GET_PROC_ADDRESS("glDeleteSync");
+		glClientWaitSync = (PFNGLCLIENTWAITSYNCPROC) GLH_EXT_GET_PROC_ADDRESS("glClientWaitSync");
+		mHasSync = glFenceSync && glDeleteSync && glClientWaitSync;
+	}
+	if (mHasBufferStorage)
+	{
+		glMapBufferRange = (PFNGLMAPBUFFERRANGEPROC) GLH_EXT_GET_PROC_ADDRESS("glMapBufferRange");
+		glBufferStorage = (PFNGLBUFFERSTORAGEPROC) GLH_EXT_GET_PROC_ADDRESS("glBufferStorage");
+		mHasBufferStorage = glMapBufferRange && glBufferStorage;
+	}
+#endif // (LL_WINDOWS || LL_LINUX) && !LL_MESA && !LL_MESA_HEADLESS
 #if (!LL_LINUX && !LL_SOLARIS) || LL_LINUX_NV_GL_HEADERS
 	// This is expected to be a static symbol on Linux GL implementations, except if we use the nvidia headers - bah
 	glDrawRangeElements = (PFNGLDRAWRANGEELEMENTSPROC)GLH_EXT_GET_PROC_ADDRESS("glDrawRangeElements");
@@ -89,6 +89,8 @@ public:
 	BOOL mHasPointParameters;
 	BOOL mHasDrawBuffers;
 	BOOL mHasDepthClamp;
+	BOOL mHasSync;
+	BOOL mHasBufferStorage; // with GL_ARB_map_buffer_range
 
 	// Other extensions.
 	BOOL mHasAnisotropic;
@@ -819,6 +819,54 @@ extern void glGetBufferPointervARB (GLenum, GLenum, GLvoid* *);
 
 #endif // LL_MESA / LL_WINDOWS / LL_DARWIN
 
+#if (LL_WINDOWS || LL_LINUX) && !LL_MESA && !LL_MESA_HEADLESS
+// Used to stream vertex data through a persistently mapped buffer (see
+// LLVBOStreamRing). The headers we build against may predate these, so
+// supply what is missing.
+#ifndef GL_ARB_map_buffer_range
+#define GL_MAP_READ_BIT                   0x0001
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT       0x0004
+#define GL_MAP_INVALIDATE_BUFFER_BIT      0x0008
+#define GL_MAP_FLUSH_EXPLICIT_BIT         0x0010
+#define GL_MAP_UNSYNCHRONIZED_BIT         0x0020
+typedef GLvoid* (APIENTRYP PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptrARB offset, GLsizeiptrARB length, GLbitfield access);
+#endif
+
+#ifndef GL_ARB_sync
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_ALREADY_SIGNALED               0x911A
+#define GL_TIMEOUT_EXPIRED                0x911B
+#define GL_CONDITION_SATISFIED            0x911C
+#define GL_WAIT_FAILED                    0x911D
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
+typedef struct __GLsync *GLsync;
+typedef unsigned long long GLuint64;
+typedef GLsync (APIENTRYP PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef void (APIENTRYP PFNGLDELETESYNCPROC) (GLsync sync);
+typedef GLenum (APIENTRYP PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
+#endif
+
+#ifndef GL_ARB_buffer_storage
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_DYNAMIC_STORAGE_BIT            0x0100
+#define GL_CLIENT_STORAGE_BIT             0x0200
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptrARB size, const GLvoid *data, GLbitfield flags);
+#endif
+
+// GL_ARB_map_buffer_range
+extern PFNGLMAPBUFFERRANGEPROC glMapBufferRange;
+
+// GL_ARB_sync
+extern PFNGLFENCESYNCPROC glFenceSync;
+extern PFNGLDELETESYNCPROC glDeleteSync;
+extern PFNGLCLIENTWAITSYNCPROC glClientWaitSync;
+
+// GL_ARB_buffer_storage
+extern PFNGLBUFFERSTORAGEPROC glBufferStorage;
+#endif // (LL_WINDOWS || LL_LINUX) && !LL_MESA && !LL_MESA_HEADLESS
+
 // Even when GL_ARB_depth_clamp is available in the driver, the (correct)
 // headers, and therefore GL_DEPTH_CLAMP might not be defined.
 // In that case GL_DEPTH_CLAMP_NV should be defined, but why not just
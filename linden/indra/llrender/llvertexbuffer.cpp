@@ -40,6 +40,192 @@
 #include "llmemory.h"
 #include "llmemtype.h"
 #include "llrender.h"
+#include "lltimer.h"
+
+// Mesa builds get the GL prototypes instead of the extension pointers
+#if (LL_WINDOWS || LL_LINUX) && !LL_MESA && !LL_MESA_HEADLESS
+#define LL_STREAM_RING 1
+#else
+#define LL_STREAM_RING 0
+#endif
+
+const U32 STREAM_RING_ALIGN = 64;
+const U32 STREAM_VBO_RING_SIZE = 8*1024*1024;
+const U32 STREAM_IBO_RING_SIZE = 2*1024*1024;
+const U64 STREAM_RING_WAIT_TIMEOUT = 1000000; // nanoseconds
+
+//============================================================================
+
+LLVBOStreamRing::LLVBOStreamRing(U32 target)
+:	mTarget(target),
+	mName(0),
+	mData(NULL),
+	mSize(0),
+	mOffset(0),
+	mGeneration(0),
+	mHead(0),
+	mFenced(0),
+	mRetired(0)
+{
+}
+
+LLVBOStreamRing::~LLVBOStreamRing()
+{
+	// The GL context is gone by now, cleanup() must have been called
+	llassert(!mName);
+}
+
+bool LLVBOStreamRing::init(U32 size)
+{
+	cleanup();
+#if LL_STREAM_RING
+	if (!gGLManager.mHasBufferStorage || !gGLManager.mHasSync)
+	{
+		return false;
+	}
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffersARB(1, (GLuint*) &mName);
+	glBindBufferARB(mTarget, mName);
+	glBufferStorage(mTarget, size, NULL, flags);
+	mData = (U8*) glMapBufferRange(mTarget, 0, size, flags);
+	glBindBufferARB(mTarget, 0);
+	stop_glerror();
+
+	if (!mData)
+	{
+		llwarns << "Unable to map " << size << " byte stream ring, streaming from client arrays." << llendl;
+		glDeleteBuffersARB(1, (GLuint*) &mName);
+		mName = 0;
+		return false;
+	}
+
+	mSize = size;
+	mOffset = 0;
+	mGeneration++;
+	mFenced = mRetired = mHead;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void LLVBOStreamRing::cleanup()
+{
+#if LL_STREAM_RING
+	for (std::deque<Fence>::iterator iter = mFences.begin(); iter != mFences.end(); ++iter)
+	{
+		glDeleteSync((GLsync) iter->mSync);
+	}
+	mFences.clear();
+
+	if (mName)
+	{
+		// deleting the buffer unmaps it
+		glDeleteBuffersARB(1, (GLuint*) &mName);
+		mName = 0;
+	}
+#endif
+	mData = NULL;
+	mSize = 0;
+}
+
+bool LLVBOStreamRing::upload(const U8* data, U32 size, Region& region)
+{
+	U32 aligned = (size + STREAM_RING_ALIGN - 1) & ~(STREAM_RING_ALIGN - 1);
+	if (!mName || aligned > mSize / 4)
+	{
+		return false;
+	}
+
+	// Regions are contiguous, skip the tail if this doesn't fit in it
+	U32 skip = mOffset + aligned > mSize ? mSize - mOffset : 0;
+	U64 end = mHead + skip + aligned;
+	if (end > mSize && !waitFor(end - mSize))
+	{
+		return false;
+	}
+	if (skip)
+	{
+		mHead += skip;
+		mOffset = 0;
+	}
+
+	memcpy(mData + mOffset, data, size);		/* Flawfinder: ignore */
+	region.mOffset = mOffset;
+	region.mSize = size;
+	region.mSerial = mHead;
+	region.mGeneration = mGeneration;
+	mHead += aligned;
+	mOffset += aligned;
+	LLVertexBuffer::sStreamBytes += size;
+	return true;
+}
+
+bool LLVBOStreamRing::holds(const Region& region, U32 size) const
+{
+	return mName && region.mGeneration == mGeneration &&
+		region.mSize >= size && region.mSerial >= mFenced;
+}
+
+void LLVBOStreamRing::fence()
+{
+#if LL_STREAM_RING
+	if (mName && mHead != mFenced)
+	{
+		Fence fence;
+		fence.mSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		fence.mEnd = mHead;
+		mFences.push_back(fence);
+		mFenced = mHead;
+	}
+#endif
+}
+
+bool LLVBOStreamRing::waitFor(U64 serial)
+{
+#if LL_STREAM_RING
+	if (mRetired >= serial)
+	{
+		return true;
+	}
+	if (serial > mFenced)
+	{
+		// Wrapping onto this frame's own data
+		fence();
+	}
+
+	while (mRetired < serial && !mFences.empty())
+	{
+		Fence& fence = mFences.front();
+		GLenum status = glClientWaitSync((GLsync) fence.mSync, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+		{
+			LLTimer timer;
+			do
+			{
+				status = glClientWaitSync((GLsync) fence.mSync, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_RING_WAIT_TIMEOUT);
+			}
+			while (status == GL_TIMEOUT_EXPIRED);
+			LLVertexBuffer::sStreamStallCount++;
+			LLVertexBuffer::sStreamStallTime += timer.getElapsedTimeF32();
+		}
+		if (status == GL_WAIT_FAILED)
+		{
+			llwarns << "Stream ring fence wait failed, streaming from client arrays." << llendl;
+			cleanup();
+			return false;
+		}
+
+		glDeleteSync((GLsync) fence.mSync);
+		mRetired = fence.mEnd;
+		mFences.pop_front();
+	}
+	return mRetired >= serial;
+#else
+	return false;
+#endif
+}
 
 //============================================================================
 
@@ -48,6 +234,8 @@ LLVBOPool LLVertexBuffer::sStreamVBOPool;
 LLVBOPool LLVertexBuffer::sDynamicVBOPool;
 LLVBOPool LLVertexBuffer::sStreamIBOPool;
 LLVBOPool LLVertexBuffer::sDynamicIBOPool;
+LLVBOStreamRing LLVertexBuffer::sStreamVBORing(GL_ARRAY_BUFFER_ARB);
+LLVBOStreamRing LLVertexBuffer::sStreamIBORing(GL_ELEMENT_ARRAY_BUFFER_ARB);
 
 U32 LLVertexBuffer::sBindCount = 0;
 U32 LLVertexBuffer::sSetCount = 0;
@@ -57,11 +245,16 @@ S32 LLVertexBuffer::sMappedCount = 0;
 BOOL LLVertexBuffer::sEnableVBOs = TRUE;
 U32 LLVertexBuffer::sGLRenderBuffer = 0;
 U32 LLVertexBuffer::sGLRenderIndices = 0;
+U32 LLVertexBuffer::sGLRenderStreamOffset = 0;
 U32 LLVertexBuffer::sLastMask = 0;
 BOOL LLVertexBuffer::sVBOActive = FALSE;
 BOOL LLVertexBuffer::sIBOActive = FALSE;
 U32 LLVertexBuffer::sAllocatedBytes = 0;
 BOOL LLVertexBuffer::sMapped = FALSE;
+U32 LLVertexBuffer::sStreamBytes = 0;
+U32 LLVertexBuffer::sStreamStallCount = 0;
+F32 LLVertexBuffer::sStreamStallTime = 0.f;
+U32 LLVertexBuffer::sStreamFallbackCount = 0;
 
 std::vector<U32> LLVertexBuffer::sDeleteList;
 
@@ -206,12 +399,12 @@ void LLVertexBuffer::drawRange(U32 mode, U32 start, U32 end, U32 count, U32 indi
 		llerrs << "Bad index buffer draw range: [" << indices_offset << ", " << indices_offset+count << "]" << llendl;
 	}
 
-	if (mGLIndices != sGLRenderIndices)
+	if (getRenderIndices() != sGLRenderIndices)
 	{
 		llerrs << "Wrong index buffer bound." << llendl;
 	}
 
-	if (mGLBuffer != sGLRenderBuffer)
+	if (getRenderBuffer() != sGLRenderBuffer)
 	{
 		llerrs << "Wrong vertex buffer bound." << llendl;
 	}
@@ -236,12 +429,12 @@ void LLVertexBuffer::draw(U32 mode, U32 count, U32 indices_offset) const
 		llerrs << "Bad index buffer draw range: [" << indices_offset << ", " << indices_offset+count << "]" << llendl;
 	}
 
-	if (mGLIndices != sGLRenderIndices)
+	if (getRenderIndices() != sGLRenderIndices)
 	{
 		llerrs << "Wrong index buffer bound." << llendl;
 	}
 
-	if (mGLBuffer != sGLRenderBuffer)
+	if (getRenderBuffer() != sGLRenderBuffer)
 	{
 		llerrs << "Wrong vertex buffer bound." << llendl;
 	}
@@ -266,7 +459,7 @@ void LLVertexBuffer::drawArrays(U32 mode, U32 first, U32 count) const
 		llerrs << "Bad vertex buffer draw range: [" << first << ", " << first+count << "]" << llendl;
 	}
 
-	if (mGLBuffer != sGLRenderBuffer || useVBOs() != sVBOActive)
+	if (getRenderBuffer() != sGLRenderBuffer || (useVBOs() || mStreamBound) != sVBOActive)
 	{
 		llerrs << "Wrong vertex buffer bound." << llendl;
 	}
@@ -283,13 +476,29 @@ void LLVertexBuffer::drawArrays(U32 mode, U32 first, U32 count) const
 }
 
 //static
-void LLVertexBuffer::initClass(bool use_vbo)
+void LLVertexBuffer::initClass(bool use_vbo, bool use_stream_ring)
 {
 	sEnableVBOs = use_vbo;
 	LLGLNamePool::registerPool(&sDynamicVBOPool);
 	LLGLNamePool::registerPool(&sDynamicIBOPool);
 	LLGLNamePool::registerPool(&sStreamVBOPool);
 	LLGLNamePool::registerPool(&sStreamIBOPool);
+
+	sStreamVBORing.cleanup();
+	sStreamIBORing.cleanup();
+	if (use_vbo && use_stream_ring)
+	{
+		if (sStreamVBORing.init(STREAM_VBO_RING_SIZE) && sStreamIBORing.init(STREAM_IBO_RING_SIZE))
+		{
+			llinfos << "Streaming vertex data through persistently mapped ring buffers." << llendl;
+		}
+		else
+		{
+			sStreamVBORing.cleanup();
+			sStreamIBORing.cleanup();
+		}
+		unbind();
+	}
 }
 
 //static 
@@ -318,6 +527,15 @@ void LLVertexBuffer::cleanupClass()
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	unbind();
 	clientCopy(); // deletes GL buffers
+	sStreamVBORing.cleanup();
+	sStreamIBORing.cleanup();
+}
+
+//static
+void LLVertexBuffer::fenceStream()
+{
+	sStreamVBORing.fence();
+	sStreamIBORing.fence();
 }
 
 void LLVertexBuffer::clientCopy(F64 max_time)
@@ -340,13 +558,23 @@ LLVertexBuffer::LLVertexBuffer(U32 typemask, S32 usage) :
 	mFilthy(FALSE),
 	mEmpty(TRUE),
 	mResized(FALSE),
-	mDynamicSize(FALSE)
+	mDynamicSize(FALSE),
+	mStreamed(FALSE),
+	mStreamBound(FALSE),
+	mStreamDirty(TRUE),
+	mMapCount(0)
 {
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	if (!sEnableVBOs)
 	{
 		mUsage = 0 ; 
 	}
+	else if (mUsage == GL_STREAM_DRAW_ARB)
+	{
+		// Kept in client memory, and copied to the rings to be drawn when
+		// they are available, otherwise drawn from client arrays
+		mStreamed = TRUE;
+	}
 	
 	S32 stride = calcStride(typemask, mOffsets);
 
@@ -766,7 +994,7 @@ BOOL LLVertexBuffer::useVBOs() const
 		return FALSE;
 	}
 #else
-	if (!mUsage)
+	if (!mUsage || mStreamed)
 	{
 		return FALSE;
 	}
@@ -774,6 +1002,63 @@ BOOL LLVertexBuffer::useVBOs() const
 	return sEnableVBOs;
 }
 
+U8* LLVertexBuffer::getIndicesPointer() const
+{
+	if (mStreamBound)
+	{
+		return (U8*) NULL + mStreamIndices.mOffset;
+	}
+	return useVBOs() ? NULL : mMappedIndexData;
+}
+
+U8* LLVertexBuffer::getVerticesPointer() const
+{
+	if (mStreamBound)
+	{
+		return (U8*) NULL + mStreamVertices.mOffset;
+	}
+	return useVBOs() ? NULL : mMappedData;
+}
+
+// GL names the last setBuffer() bound for this buffer
+U32 LLVertexBuffer::getRenderBuffer() const
+{
+	return mStreamBound && mGLBuffer ? sStreamVBORing.getName() : mGLBuffer;
+}
+
+U32 LLVertexBuffer::getRenderIndices() const
+{
+	return mStreamBound && mGLIndices ? sStreamIBORing.getName() : mGLIndices;
+}
+
+// Copies the client data to the stream rings unless they still hold it.
+// Returns FALSE if the buffer has to be drawn from client arrays instead.
+BOOL LLVertexBuffer::uploadStream()
+{
+	if (!sStreamVBORing.isValid() || !sStreamIBORing.isValid())
+	{
+		return FALSE;
+	}
+
+	U32 size = mMappedData ? mRequestedNumVerts * mStride : 0;
+	U32 index_size = mMappedIndexData ? mRequestedNumIndices * sizeof(U16) : 0;
+	if (!mStreamDirty &&
+		(!size || sStreamVBORing.holds(mStreamVertices, size)) &&
+		(!index_size || sStreamIBORing.holds(mStreamIndices, index_size)))
+	{
+		return TRUE;
+	}
+
+	if ((size && !sStreamVBORing.upload(mMappedData, size, mStreamVertices)) ||
+		(index_size && !sStreamIBORing.upload(mMappedIndexData, index_size, mStreamIndices)))
+	{
+		sStreamFallbackCount++;
+		return FALSE;
+	}
+	mStreamDirty = FALSE;
+	return TRUE;
+}
+
 //----------------------------------------------------------------------------
 
 // Map for data access
@@ -788,6 +1073,12 @@ U8* LLVertexBuffer::mapBuffer(S32 access)
 	{
 		llerrs << "LLVertexBuffer::mapBuffer() called on unallocated buffer." << llendl;
 	}
+	if (mStreamed)
+	{
+		// about to be written to
+		mStreamDirty = TRUE;
+	}
+	mMapCount++;
 		
 	if (!mLocked && useVBOs())
 	{
@@ -987,6 +1278,7 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	//set up pointers if the data mask is different ...
 	BOOL setup = (sLastMask != data_mask);
+	BOOL stream_bound = FALSE;
 
 	if (useVBOs())
 	{
@@ -1074,6 +1366,35 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 
 		unmapBuffer();
 	}
+	else if (mStreamed && uploadStream())
+	{
+		stream_bound = TRUE;
+		if (mGLBuffer)
+		{
+			U32 name = sStreamVBORing.getName();
+			if (name != sGLRenderBuffer || !sVBOActive)
+			{
+				glBindBufferARB(GL_ARRAY_BUFFER_ARB, name);
+				sBindCount++;
+				sVBOActive = TRUE;
+				setup = TRUE; // ... or the bound buffer changed
+			}
+			else if (sGLRenderStreamOffset != mStreamVertices.mOffset)
+			{
+				setup = TRUE; // ... or the data moved within it
+			}
+		}
+		if (mGLIndices)
+		{
+			U32 name = sStreamIBORing.getName();
+			if (name != sGLRenderIndices || !sIBOActive)
+			{
+				glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, name);
+				sBindCount++;
+				sIBOActive = TRUE;
+			}
+		}
+	}
 	else
 	{		
 		if (mGLBuffer)
@@ -1102,15 +1423,17 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 		}
 	}
 
+	mStreamBound = stream_bound;
 	setupClientArrays(data_mask);
 	
 	if (mGLIndices)
 	{
-		sGLRenderIndices = mGLIndices;
+		sGLRenderIndices = getRenderIndices();
 	}
 	if (mGLBuffer)
 	{
-		sGLRenderBuffer = mGLBuffer;
+		sGLRenderBuffer = getRenderBuffer();
+		sGLRenderStreamOffset = mStreamVertices.mOffset;
 		if (data_mask && setup)
 		{
 			setupVertexBuffer(data_mask); // subclass specific setup (virtual function)
@@ -1124,7 +1447,7 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask) const
 {
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	stop_glerror();
-	U8* base = useVBOs() ? NULL : mMappedData;
+	U8* base = getVerticesPointer();
 	S32 stride = mStride;
 
 	if ((data_mask & mTypeMask) != data_mask)
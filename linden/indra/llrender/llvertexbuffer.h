@@ -41,6 +41,7 @@
 #include "llstrider.h"
 #include "llmemory.h"
 #include "llrender.h"
+#include <deque>
 #include <set>
 #include <vector>
 #include <list>
@@ -73,6 +74,65 @@ protected:
 	}
 };
 
+//============================================================================
+// Ring buffer that GL_STREAM_DRAW_ARB geometry is copied into for drawing.
+// The GL buffer is mapped once for its lifetime (GL_ARB_buffer_storage) and
+// allocated from front to back, wrapping at the end. A fence is set at the
+// end of each frame; before reusing space the ring waits on the fence of
+// the frame that used it, which only stalls if the GPU is a whole ring
+// behind. A region may be drawn from until the next fence.
+
+class LLVBOStreamRing
+{
+public:
+	struct Region
+	{
+		Region() : mOffset(0), mSize(0), mSerial(0), mGeneration(0) { }
+
+		U32 mOffset;		// in the GL buffer
+		U32 mSize;
+		U64 mSerial;		// position in everything ever written to the ring
+		U32 mGeneration;	// of the GL buffer it was written to
+	};
+
+	LLVBOStreamRing(U32 target);
+	~LLVBOStreamRing();
+
+	// Returns false if the extensions needed are missing
+	bool init(U32 size);
+	void cleanup();
+	bool isValid() const				{ return mName != 0; }
+	U32 getName() const					{ return mName; }
+
+	// Copies data into the ring. Returns false if it doesn't fit.
+	bool upload(const U8* data, U32 size, Region& region);
+	// TRUE if region may still be drawn from
+	bool holds(const Region& region, U32 size) const;
+	// Marks the end of the GL commands using what was written so far
+	void fence();
+
+private:
+	// Waits until the GPU is done with everything written before serial
+	bool waitFor(U64 serial);
+
+	struct Fence
+	{
+		void* mSync;		// GLsync
+		U64 mEnd;			// serial of the first byte written after it
+	};
+
+	U32 mTarget;
+	U32 mName;
+	U8* mData;
+	U32 mSize;
+	U32 mOffset;			// where the next upload goes
+	U32 mGeneration;
+	U64 mHead;				// serial of the next upload
+	U64 mFenced;			// serial up to which writes are fenced
+	U64 mRetired;			// serial up to which the GPU is done reading
+	std::deque<Fence> mFences;
+};
+
 
 //============================================================================
 // base class
@@ -84,11 +144,16 @@ public:
 	static LLVBOPool sDynamicVBOPool;
 	static LLVBOPool sStreamIBOPool;
 	static LLVBOPool sDynamicIBOPool;
+	static LLVBOStreamRing sStreamVBORing;
+	static LLVBOStreamRing sStreamIBORing;
 
-	static void initClass(bool use_vbo);
+	// use_stream_ring draws GL_STREAM_DRAW_ARB buffers through the stream
+	// rings where GL supports it, and from client arrays where it doesn't
+	static void initClass(bool use_vbo, bool use_stream_ring = false);
 	static void cleanupClass();
 	static void setupClientArrays(U32 data_mask);
  	static void clientCopy(F64 max_time = 0.005); //copy data from client to GL
+	static void fenceStream(); // call once a frame, after the last draw
 	static void unbind(); //unbind any bound vertex buffer
 
 	//get the size of a vertex with the given typemask
@@ -145,6 +210,9 @@ protected:
 	void	updateNumIndices(S32 nindices); 
 	virtual BOOL	useVBOs() const;
 	void	unmapBuffer();
+	BOOL	uploadStream();
+	U32		getRenderBuffer() const;
+	U32		getRenderIndices() const;
 		
 public:
 	LLVertexBuffer(U32 typemask, S32 usage);
@@ -181,8 +249,9 @@ public:
 	S32 getRequestedVerts() const			{ return mRequestedNumVerts; }
 	S32 getRequestedIndices() const			{ return mRequestedNumIndices; }
 
-	U8* getIndicesPointer() const			{ return useVBOs() ? NULL : mMappedIndexData; }
-	U8* getVerticesPointer() const			{ return useVBOs() ? NULL : mMappedData; }
+	// Pointers to hand to GL once setBuffer() has been called
+	U8* getIndicesPointer() const;
+	U8* getVerticesPointer() const;
 	S32 getStride() const					{ return mStride; }
 	S32 getTypeMask() const					{ return mTypeMask; }
 	BOOL hasDataType(S32 type) const		{ return ((1 << type) & getTypeMask()) ? TRUE : FALSE; }
@@ -192,6 +261,8 @@ public:
 	U8* getMappedIndices() const			{ return mMappedIndexData; }
 	S32 getOffset(S32 type) const			{ return mOffsets[type]; }
 	S32 getUsage() const					{ return mUsage; }
+	// Changes whenever the buffer is mapped, so whenever its contents may have
+	U32 getMapCount() const					{ return mMapCount; }
 
 	void setStride(S32 type, S32 new_stride);
 	
@@ -221,6 +292,12 @@ protected:
 	S32		mOffsets[TYPE_MAX];
 	BOOL	mResized;		// if TRUE, client buffer has been resized and GL buffer has not
 	BOOL	mDynamicSize;	// if TRUE, buffer has been resized at least once (and should be padded)
+	BOOL	mStreamed;		// if TRUE, client data is drawn through the stream rings when they are available
+	BOOL	mStreamBound;	// if TRUE, the last setBuffer() bound the stream rings
+	BOOL	mStreamDirty;	// if TRUE, client data has changed since it was last copied to the stream rings
+	U32		mMapCount;		// number of mapBuffer() calls
+	LLVBOStreamRing::Region mStreamVertices;
+	LLVBOStreamRing::Region mStreamIndices;
 
 	class DirtyRegion
 	{
@@ -256,6 +333,12 @@ public:
 	static U32 sAllocatedBytes;
 	static U32 sBindCount;
 	static U32 sSetCount;
+	static U32 sGLRenderStreamOffset;
+	// Per frame stream ring counters, reset by whoever displays them
+	static U32 sStreamBytes;
+	static U32 sStreamStallCount;
+	static F32 sStreamStallTime;	// seconds
+	static U32 sStreamFallbackCount; // buffers drawn from client arrays
 };
 
 
@@ -0,0 +1,239 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Memory mapped file wrapper
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if LL_WINDOWS
+#	define WIN32_LEAN_AND_MEAN
+#	include <winsock2.h>
+#	include <windows.h>
+#else
+#	include <sys/types.h>
+#	include <sys/stat.h>
+#	include <sys/mman.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <errno.h>
+#endif
+
+LLMappedFile::LLMappedFile()
+	: mData(NULL),
+	  mSize(0),
+	  mReadOnly(true),
+#if LL_WINDOWS
+	  mFileHandle(INVALID_HANDLE_VALUE),
+	  mMappingHandle(NULL)
+#else
+	  mFD(-1)
+#endif
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+	unmap();
+}
+
+#if LL_WINDOWS
+
+bool LLMappedFile::map(const std::string& filename, size_t size, bool read_only)
+{
+	unmap();
+
+	llutf16string utf16filename = utf8str_to_utf16str(filename);
+	DWORD access = read_only ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
+	DWORD creation = read_only ? OPEN_EXISTING : OPEN_ALWAYS;
+	HANDLE file = CreateFileW((LPCWSTR)utf16filename.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+							  NULL, creation, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LL_WARNS("MappedFile") << "Unable to open " << filename << " error: " << GetLastError() << LL_ENDL;
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	if (read_only)
+	{
+		size = llmin(size, (size_t)file_size.QuadPart);
+	}
+	if (size == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	LARGE_INTEGER map_size;
+	map_size.QuadPart = (LONGLONG)size;
+	HANDLE mapping = CreateFileMappingW(file, NULL, read_only ? PAGE_READONLY : PAGE_READWRITE,
+										read_only ? 0 : map_size.HighPart, read_only ? 0 : map_size.LowPart, NULL);
+	if (mapping == NULL)
+	{
+		LL_WARNS("MappedFile") << "Unable to create mapping for " << filename << " error: " << GetLastError() << LL_ENDL;
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, read_only ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+	if (data == NULL)
+	{
+		LL_WARNS("MappedFile") << "Unable to map " << size << " bytes of " << filename << " error: " << GetLastError() << LL_ENDL;
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFileName = filename;
+	mData = (U8*)data;
+	mSize = size;
+	mReadOnly = read_only;
+	mFileHandle = file;
+	mMappingHandle = mapping;
+	return true;
+}
+
+void LLMappedFile::unmap()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+		mData = NULL;
+	}
+	if (mMappingHandle)
+	{
+		CloseHandle((HANDLE)mMappingHandle);
+		mMappingHandle = NULL;
+	}
+	if (mFileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle((HANDLE)mFileHandle);
+		mFileHandle = INVALID_HANDLE_VALUE;
+	}
+	mSize = 0;
+}
+
+bool LLMappedFile::flush(bool sync)
+{
+	if (!mData || mReadOnly)
+	{
+		return false;
+	}
+	if (!FlushViewOfFile(mData, 0))
+	{
+		return false;
+	}
+	// FlushViewOfFile() only hands the pages to the lazy writer
+	return sync ? (FlushFileBuffers((HANDLE)mFileHandle) != 0) : true;
+}
+
+#else // LL_WINDOWS
+
+bool LLMappedFile::map(const std::string& filename, size_t size, bool read_only)
+{
+	unmap();
+
+	int fd = ::open(filename.c_str(), read_only ? O_RDONLY : O_RDWR | O_CREAT, 0600);
+	if (fd == -1)
+	{
+		LL_WARNS("MappedFile") << "Unable to open " << filename << " errno: " << errno << LL_ENDL;
+		return false;
+	}
+
+	struct stat file_stat;
+	if (::fstat(fd, &file_stat) == -1)
+	{
+		::close(fd);
+		return false;
+	}
+	if (read_only)
+	{
+		size = llmin(size, (size_t)file_stat.st_size);
+	}
+	else if ((size_t)file_stat.st_size < size && ::ftruncate(fd, (off_t)size) == -1)
+	{
+		LL_WARNS("MappedFile") << "Unable to grow " << filename << " to " << size << " bytes, errno: " << errno << LL_ENDL;
+		::close(fd);
+		return false;
+	}
+	if (size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* data = ::mmap(NULL, size, read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		LL_WARNS("MappedFile") << "Unable to map " << size << " bytes of " << filename << " errno: " << errno << LL_ENDL;
+		::close(fd);
+		return false;
+	}
+
+	mFileName = filename;
+	mData = (U8*)data;
+	mSize = size;
+	mReadOnly = read_only;
+	mFD = fd;
+	return true;
+}
+
+void LLMappedFile::unmap()
+{
+	if (mData)
+	{
+		::munmap(mData, mSize);
+		mData = NULL;
+	}
+	if (mFD != -1)
+	{
+		::close(mFD);
+		mFD = -1;
+	}
+	mSize = 0;
+}
+
+bool LLMappedFile::flush(bool sync)
+{
+	if (!mData || mReadOnly)
+	{
+		return false;
+	}
+	return ::msync(mData, mSize, sync ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+#endif // LL_WINDOWS
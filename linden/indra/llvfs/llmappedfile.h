@@ -0,0 +1,77 @@
+/**
+ * @file llmappedfile.h
+ * @brief Memory mapped file wrapper
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include <string>
+
+// Maps (a prefix of) a file on disk into the address space of the process.
+// Writes to a writable mapping go straight to the page cache and are written
+// back by the OS, or explicitly through flush().
+class LLMappedFile
+{
+public:
+	LLMappedFile();
+	~LLMappedFile();
+
+	// Maps the first size bytes of filename. A writable mapping creates the
+	// file if needed and grows it to size (new space reads as zeroes); a read
+	// only mapping is clamped to the current size of the file.
+	// Returns false (and leaves the object unmapped) on failure.
+	bool map(const std::string& filename, size_t size, bool read_only);
+	void unmap();
+
+	// Schedules write back of modified pages. If sync is true, blocks until
+	// the data has reached the disk.
+	bool flush(bool sync = false);
+
+	bool isMapped() const { return mData != NULL; }
+	bool isReadOnly() const { return mReadOnly; }
+	U8* getData() const { return mData; }
+	size_t getSize() const { return mSize; }
+	const std::string& getFileName() const { return mFileName; }
+
+private:
+	std::string mFileName;
+	U8* mData;
+	size_t mSize;
+	bool mReadOnly;
+#if LL_WINDOWS
+	void* mFileHandle;
+	void* mMappingHandle;
+#else
+	int mFD;
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
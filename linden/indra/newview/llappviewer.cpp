@@ -61,6 +61,7 @@
 #include "llviewerwindow.h"
 #include "llviewerdisplay.h"
 #include "llviewermedia.h"
+#include "llviewermemorybudget.h"
 #include "llv4math.h"		// for LL_VECTORIZE
 #include "llviewerparcelmedia.h"
 #include "llviewermediafocus.h"
@@ -95,6 +96,7 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "llthreadpool.h"
 
 // The files below handle dependencies from cleanup.
 #include "llkeyframemotion.h"
@@ -151,6 +153,7 @@
 #include "llagentpilot.h"
 #include "llsrv.h"
 #include "llvovolume.h"
+#include "llvolumecache.h"
 #include "llflexibleobject.h" 
 #include "llvosurfacepatch.h"
 #include "llslider.h"
@@ -552,6 +555,7 @@ const std::string LLAppViewer::sCrashSettingsName = "CrashSettings";
 LLTextureCache* LLAppViewer::sTextureCache = NULL; 
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = NULL; 
 LLTextureFetch* LLAppViewer::sTextureFetch = NULL; 
+LLLFSThread* LLAppViewer::sCacheWriteThread = NULL;
 
 LLAppViewer::LLAppViewer() : 
 	mMarkerFile(),
@@ -624,6 +628,8 @@ bool LLAppViewer::init()
 
     initThreads();
 
+	LLViewerMemoryBudget::initClass();
+
     writeSystemInfo();
 
 
@@ -1091,7 +1097,12 @@ bool LLAppViewer::mainLoop()
  					work_pending += LLAppViewer::getImageDecodeThread()->update(1); // unpauses the image thread
  					work_pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
 					io_pending += LLVFSThread::updateClass(1);
+					if (LLVolumeCache::getInstance())
+					{
+						io_pending += LLVolumeCache::getInstance()->update();
+					}
 					io_pending += LLLFSThread::updateClass(1);
+					io_pending += LLAppViewer::getCacheWriteThread()->update(1);
 					if (io_pending > 1000)
 					{
 						ms_sleep(llmin(io_pending/100,100)); // give the vfs some time to catch up
@@ -1320,6 +1331,7 @@ bool LLAppViewer::cleanup()
 	{
 		S32 pending = LLVFSThread::updateClass(0);
 		pending += LLLFSThread::updateClass(0);
+		pending += LLAppViewer::getCacheWriteThread()->update(0);
 		if (!pending)
 		{
 			break;
@@ -1354,6 +1366,8 @@ bool LLAppViewer::cleanup()
 	LLSelectMgr::cleanupGlobals();
 
 	LLViewerObject::cleanupVOClasses();
+	// After the volume build queue, whose builds may still store geometry
+	LLVolumeCache::cleanupClass();
 
 	LLWaterParamManager::cleanupClass();
 	LLWLParamManager::cleanupClass();
@@ -1468,6 +1482,7 @@ bool LLAppViewer::cleanup()
 		pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
 		pending += LLVFSThread::updateClass(0);
 		pending += LLLFSThread::updateClass(0);
+		pending += LLAppViewer::getCacheWriteThread()->update(0);
 		if (pending == 0)
 		{
 			break;
@@ -1484,12 +1499,15 @@ bool LLAppViewer::cleanup()
 	sTextureCache->shutdown();
 	sTextureFetch->shutdown();
 	sImageDecodeThread->shutdown();
+	sCacheWriteThread->shutdown();
 	delete sTextureCache;
     sTextureCache = NULL;
 	delete sTextureFetch;
     sTextureFetch = NULL;
 	delete sImageDecodeThread;
     sImageDecodeThread = NULL;
+	delete sCacheWriteThread;
+	sCacheWriteThread = NULL;
 
 	gSavedSettings.cleanup();//do this after last time gSavedSettings is used  *surprise*
 
@@ -1503,10 +1521,13 @@ bool LLAppViewer::cleanup()
 	gImageList.shutdown(); // shutdown again in case a callback added something
 	LLUIImageList::getInstance()->cleanUp();
 	
+	LLViewerMemoryBudget::cleanupClass();
+
 	// This should eventually be done in LLAppViewer
 	LLImage::cleanupClass();
 	LLVFSThread::cleanupClass();
 	LLLFSThread::cleanupClass();
+	LLThreadPool::cleanupClass(); // after every queue attached to it
 
 	llinfos << "VFS Thread finished" << llendflush;
 
@@ -1619,13 +1640,40 @@ bool LLAppViewer::initThreads()
 		LLWatchdog::getInstance()->init(watchdog_killer_callback);
 	}
 
+	// VFS and LFS requests stay on the main thread (see the loop in
+	// mainLoop()) until the VFS is known to be thread safe. Cache files
+	// written in the background get an LFS queue of their own below.
 	LLVFSThread::initClass(enable_threads && false);
 	LLLFSThread::initClass(enable_threads && false);
 
-	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
-	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
-	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, enable_threads && true);
+	S32 pool_size = gSavedSettings.getS32("ThreadPoolSize");
+	if (enable_threads && pool_size >= 0)
+	{
+		// One set of threads shared by all the queues below. The I/O bound
+		// queues prefer the first thread, decoding runs on all of them, and
+		// idle threads steal whatever is left.
+		LLThreadPool::initClass((U32)pool_size);
+		LLThreadPool* pool = LLThreadPool::getShared();
+		const U32 io_affinity = 1;
+
+		LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(false);
+		LLAppViewer::sTextureCache = new LLTextureCache(false);
+		LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, false);
+		LLAppViewer::sCacheWriteThread = new LLLFSThread(false);
+		pool->addQueue(sImageDecodeThread, LLThreadPool::AFFINITY_ANY, 0);
+		pool->addQueue(sTextureCache, io_affinity, 1);
+		pool->addQueue(sTextureFetch, io_affinity, 1);
+		pool->addQueue(sCacheWriteThread, io_affinity, 1);
+	}
+	else
+	{
+		// Image decoding
+		LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true,
+																  gSavedSettings.getU32("ImageDecodeThreads"));
+		LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
+		LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, enable_threads && true);
+		LLAppViewer::sCacheWriteThread = new LLLFSThread(enable_threads && true);
+	}
 	LLImage::initClass(gSavedSettings.getBOOL("UseKDUIfAvailable"));
 
 	// *FIX: no error handling here!
@@ -3032,6 +3080,13 @@ bool LLAppViewer::initCache()
 	S64 extra = LLAppViewer::getTextureCache()->initCache(LL_PATH_CACHE, texture_cache_size, read_only);
 	texture_cache_size -= extra;
 
+	// Init the volume cache, which is sized apart from the rest
+	S64 volume_cache_size = (S64)(gSavedSettings.getU32("VolumeCacheSize")) * MB;
+	if (volume_cache_size > 0)
+	{
+		LLVolumeCache::initClass(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "volumes"), volume_cache_size, read_only);
+	}
+
 	LLSplashScreen::update("Initializing VFS...");
 	
 	// Init the VFS
@@ -3188,6 +3243,7 @@ void LLAppViewer::purgeCache()
 	if (gSavedSettings.getBOOL("PurgeCacheOnStartup")) // purging from cmd line
 	{
 		LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE);
+		LLVolumeCache::purgeFiles(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "volumes"));
 		removeCacheFiles("*.*");
 	}
 	else // purging cache from ui
@@ -3201,6 +3257,7 @@ void LLAppViewer::purgeCache()
 		if (gSavedSettings.getBOOL("ClearObjectCache"))
 		{
 			removeCacheFiles("*.slc");
+			LLVolumeCache::purgeFiles(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "volumes"));
 			gSavedSettings.setBOOL("ClearObjectCache", FALSE);
 		}
 
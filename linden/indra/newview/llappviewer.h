@@ -38,6 +38,7 @@
 class LLTextureCache;
 class LLImageDecodeThread;
 class LLTextureFetch;
+class LLLFSThread;
 class LLWatchdogTimeout;
 class LLCommandLineParser;
 
@@ -95,6 +96,7 @@ public:
 	static LLTextureCache* getTextureCache() { return sTextureCache; }
 	static LLImageDecodeThread* getImageDecodeThread() { return sImageDecodeThread; }
 	static LLTextureFetch* getTextureFetch() { return sTextureFetch; }
+	static LLLFSThread* getCacheWriteThread() { return sCacheWriteThread; }
 
 	const std::string& getSerialNumber() { return mSerialNumber; }
 	
@@ -218,6 +220,7 @@ private:
 	static LLTextureCache* sTextureCache; 
 	static LLImageDecodeThread* sImageDecodeThread; 
 	static LLTextureFetch* sTextureFetch;
+	static LLLFSThread* sCacheWriteThread;
 
 	S32 mNumSessions;
 
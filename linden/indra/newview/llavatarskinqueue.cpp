@@ -0,0 +1,88 @@
+/**
+ * @file llavatarskinqueue.cpp
+ * @brief Skins the visible avatars on the shared thread pool.
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llavatarskinqueue.h"
+
+#include "llcharacter.h"
+#include "llviewerjointmesh.h"
+#include "llvoavatar.h"
+
+LLAvatarSkinQueue::LLAvatarSkinQueue()
+	: LLSkinQueue("Avatar Skin"),
+	  mLastAvatarCount(0)
+{
+}
+
+LLAvatarSkinQueue::~LLAvatarSkinQueue()
+{
+}
+
+// ANY THREAD
+void LLAvatarSkinQueue::skinOne(U32 index)
+{
+	mAvatars[index]->skinMeshes();
+}
+
+void LLAvatarSkinQueue::skin()
+{
+	mLastAvatarCount = 0;
+	if (!LLViewerJointMesh::canSkinOnAnyThread())
+	{
+		return;
+	}
+
+	mAvatars.clear();
+	for (std::vector<LLCharacter*>::iterator iter = LLCharacter::sInstances.begin();
+		 iter != LLCharacter::sInstances.end(); ++iter)
+	{
+		LLVOAvatar* avatar = (LLVOAvatar*) *iter;
+		if (avatar->beginSkin())
+		{
+			mAvatars.push_back(avatar);
+		}
+	}
+	if (mAvatars.empty())
+	{
+		return;
+	}
+
+	skinAll(mAvatars.size());
+
+	for (U32 i = 0; i < mAvatars.size(); i++)
+	{
+		mAvatars[i]->endSkin();
+	}
+	mLastAvatarCount = mAvatars.size();
+}
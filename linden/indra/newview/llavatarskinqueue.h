@@ -0,0 +1,71 @@
+/**
+ * @file llavatarskinqueue.h
+ * @brief Skins the visible avatars on the shared thread pool.
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLAVATARSKINQUEUE_H
+#define LL_LLAVATARSKINQUEUE_H
+
+#include <vector>
+
+#include "llskinning.h"
+
+class LLVOAvatar;
+
+// Skins the meshes of all visible avatars in parallel when avatar vertex
+// programs are off. skin() runs once the frame's visible set is known: it
+// maps each avatar's vertex buffer on the main thread, has LLSkinQueue deal
+// the avatars out to the workers (each one writes only to its own buffer),
+// and unmaps them once all of them are done, so nothing is drawn from a half
+// skinned buffer. Avatars it leaves alone are still skinned by
+// LLVOAvatar::renderSkinned().
+class LLAvatarSkinQueue : public LLSkinQueue
+{
+public:
+	// Has no thread of its own, attach it to an LLThreadPool
+	LLAvatarSkinQueue();
+	virtual ~LLAvatarSkinQueue();
+
+	// MAIN THREAD
+	void skin();
+
+	U32 getAvatarCount() const { return mLastAvatarCount; }
+
+protected:
+	// ANY THREAD
+	/*virtual*/ void skinOne(U32 index);
+
+	// Reused from frame to frame so its storage sticks around
+	std::vector<LLVOAvatar*> mAvatars;
+	U32 mLastAvatarCount;
+};
+
+#endif // LL_LLAVATARSKINQUEUE_H
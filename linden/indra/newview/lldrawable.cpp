@@ -107,6 +107,7 @@ void LLDrawable::init()
 	
 	mGeneration = -1;
 	mBinRadius = 1.f;
+	mBinIndex = -1;
 	mSpatialBridge = NULL;
 }
 
@@ -37,6 +37,7 @@
 #include "llviewertextureanim.h"
 
 #include "llviewercontrol.h"
+#include "llv4transform.h"
 #include "llvolume.h"
 #include "m3math.h"
 #include "v3color.h"
@@ -807,8 +808,8 @@ LLVector2 LLFace::surfaceToTexture(LLVector2 surface_coord, LLVector3 position,
 void LLFace::getPlanarProjectedParams(LLQuaternion* face_rot, LLVector3* face_pos, F32* scale) const
 {
 	const LLVolumeFace& vf = getViewerObject()->getVolume()->getVolumeFace(mTEOffset);
-	LLVector3 normal = vf.mVertices[0].mNormal;
-	LLVector3 binormal = vf.mVertices[0].mBinormal;
+	LLVector3 normal = vf.mNormals[0];
+	LLVector3 binormal = vf.mBinormals[0];
 	LLVector2 projected_binormal;
 	planarProjection(projected_binormal, normal, vf.mCenter, binormal);
 	projected_binormal -= LLVector2(0.5f, 0.5f); // this normally happens in xform()
@@ -903,7 +904,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 								const U16 &index_offset)
 {
 	const LLVolumeFace &vf = volume.getVolumeFace(f);
-	S32 num_vertices = (S32)vf.mVertices.size();
+	S32 num_vertices = (S32)vf.getNumVertices();
 	S32 num_indices = (S32)vf.mIndices.size();
 	
 	if (mVertexBuffer.notNull())
@@ -1140,28 +1141,28 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		mVObjp->getVolume()->genBinormals(f);
 	}
 
-	for (S32 i = 0; i < num_vertices; i++)
+	if (rebuild_tcoord)
 	{
-		if (rebuild_tcoord)
+		for (S32 i = 0; i < num_vertices; i++)
 		{
-			LLVector2 tc = vf.mVertices[i].mTexCoord;
+			LLVector2 tc = vf.mTexCoords[i];
 		
 			if (texgen != LLTextureEntry::TEX_GEN_DEFAULT)
 			{
-				LLVector3 vec = vf.mVertices[i].mPosition; 
+				LLVector3 vec = vf.mPositions[i]; 
 			
 				vec.scaleVec(scale);
 
 				switch (texgen)
 				{
 					case LLTextureEntry::TEX_GEN_PLANAR:
-						planarProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						planarProjection(tc, vf.mNormals[i], vf.mCenter, vec);
 						break;
 					case LLTextureEntry::TEX_GEN_SPHERICAL:
-						sphericalProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						sphericalProjection(tc, vf.mNormals[i], vf.mCenter, vec);
 						break;
 					case LLTextureEntry::TEX_GEN_CYLINDRICAL:
-						cylindricalProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						cylindricalProjection(tc, vf.mNormals[i], vf.mCenter, vec);
 						break;
 					default:
 						break;
@@ -1184,10 +1185,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		
 			if (bump_code && mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TEXCOORD1))
 			{
-				LLVector3 tangent = vf.mVertices[i].mBinormal % vf.mVertices[i].mNormal;
+				LLVector3 tangent = vf.mBinormals[i] % vf.mNormals[i];
 
 				LLMatrix3 tangent_to_object;
-				tangent_to_object.setRows(tangent, vf.mVertices[i].mBinormal, vf.mVertices[i].mNormal);
+				tangent_to_object.setRows(tangent, vf.mBinormals[i], vf.mNormals[i]);
 				LLVector3 binormal = binormal_dir * tangent_to_object;
 				binormal = binormal * mat_normal;
 				
@@ -1202,30 +1203,32 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 				*tex_coords2++ = tc;
 			}	
 		}
-			
+	}
+
+	// positions, normals and binormals are transformed a stream at a time
+	if (num_vertices > 0)
+	{
 		if (rebuild_pos)
 		{
-			*vertices++ = vf.mVertices[i].mPosition * mat_vert;
+			llv4transform_positions(mat_vert, &vf.mPositions[0], num_vertices, vertices);
 		}
 		
 		if (rebuild_normal)
 		{
-			LLVector3 normal = vf.mVertices[i].mNormal * mat_normal;
-			normal.normVec();
-			
-			*normals++ = normal;
+			llv4transform_normals(mat_normal, &vf.mNormals[0], num_vertices, normals);
 		}
 		
 		if (rebuild_binormal)
 		{
-			LLVector3 binormal = vf.mVertices[i].mBinormal * mat_normal;
-			binormal.normVec();
-			*binormals++ = binormal;
+			llv4transform_normals(mat_normal, &vf.mBinormals[0], num_vertices, binormals);
 		}
+	}
 		
-		if (rebuild_color)
+	if (rebuild_color)
+	{
+		for (S32 i = 0; i < num_vertices; i++)
 		{
-			*colors++ = color;		
+			*colors++ = color;
 		}
 	}
 
@@ -46,7 +46,10 @@
 #include "llcamera.h"
 #include "pipeline.h"
 #include "llrender.h"
+#include "llocclusionbuffer.h"
 #include "lloctree.h"
+#include "llthreadpool.h"
+#include "llv4frustum.h"
 #include "llvoavatar.h"
 
 const F32 SG_OCCLUSION_FUDGE = 0.25f;
@@ -468,7 +471,7 @@ void validate_draw_info(LLDrawInfo& params)
 	}
 	
 	//bad indices
-	U32* indicesp = (U32*) params.mVertexBuffer->getIndicesPointer();
+	U32* indicesp = (U32*) params.mVertexBuffer->getMappedIndices();
 	if (indicesp)
 	{
 		for (U32 i = params.mOffset; i < params.mOffset+params.mCount; i++)
@@ -775,6 +778,12 @@ BOOL LLSpatialGroup::removeObject(LLDrawable *drawablep, BOOL from_octree)
 			}
 		}
 
+		std::vector<LLPointer<LLDrawable> >::iterator occluder = std::find(mOccluders.begin(), mOccluders.end(), drawablep);
+		if (occluder != mOccluders.end())
+		{
+			mOccluders.erase(occluder);
+		}
+
 		if (getElementCount() == 0)
 		{ //delete draw map on last element removal since a rebuild might never happen
 			clearDrawMap();
@@ -1298,6 +1307,31 @@ void LLSpatialGroup::checkOcclusion()
 	}
 }
 
+void LLSpatialGroup::checkOcclusion(const LLOcclusionBuffer& buffer)
+{
+	LLSpatialGroup* parent = getParent();
+	if (!parent || parent->isState(LLSpatialGroup::OCCLUDED))
+	{	//never occlusion cull the root node, and children of an occluded node are implicitly occluded
+		return;
+	}
+
+	if (mSpatialPartition->isOcclusionEnabled() && buffer.isOccluded(mBounds[0], mBounds[1]))
+	{
+		if (!isState(LLSpatialGroup::OCCLUDED))
+		{
+			assert_states_valid(this);
+			setState(LLSpatialGroup::OCCLUDED, LLSpatialGroup::STATE_MODE_DIFF);
+			assert_states_valid(this);
+		}
+	}
+	else if (isState(LLSpatialGroup::OCCLUDED))
+	{
+		assert_states_valid(this);
+		clearState(LLSpatialGroup::OCCLUDED, LLSpatialGroup::STATE_MODE_DIFF);
+		assert_states_valid(this);
+	}
+}
+
 void LLSpatialGroup::doOcclusion(LLCamera* camera)
 {
 	if (mSpatialPartition->isOcclusionEnabled() && LLPipeline::sUseOcclusion > 1)
@@ -1502,11 +1536,19 @@ class LLOctreeCull : public LLSpatialGroup::OctreeTraveler
 {
 public:
 	LLOctreeCull(LLCamera* camera)
-		: mCamera(camera), mRes(0) { }
+		: mCamera(camera), mRes(0), mChildRes(-1), mRecords(NULL), mSplitNodes(NULL),
+		  mOcclusionBuffer(gPipeline.getOcclusionBuffer())
+	{
+		mFrustum.setCamera(*camera, FALSE);
+	}
 
 	virtual bool earlyFail(LLSpatialGroup* group)
 	{
 		group->checkOcclusion();
+		if (mOcclusionBuffer)
+		{
+			group->checkOcclusion(*mOcclusionBuffer);
+		}
 
 		if (group->mOctreeNode->getParent() &&	//never occlusion cull the root node
 		  	LLPipeline::sUseOcclusion &&			//ignore occlusion if disabled
@@ -1522,6 +1564,14 @@ public:
 	virtual void traverse(const LLSpatialGroup::OctreeNode* n)
 	{
 		LLSpatialGroup* group = (LLSpatialGroup*) n->getListener(0);
+		S32 child_res = mChildRes;
+		mChildRes = -1;
+
+		if (mRecords)
+		{
+			record(n, group, child_res);
+			return;
+		}
 
 		if (earlyFail(group))
 		{
@@ -1535,16 +1585,74 @@ public:
 		}
 		else
 		{
-			mRes = frustumCheck(group);
+			mRes = child_res >= 0 ? child_res : frustumCheck(group);
 				
 			if (mRes)
 			{ //at least partially in, run on down
-				LLSpatialGroup::OctreeTraveler::traverse(n);
+				traverseChildren(n);
 			}
 
 			mRes = 0;
 		}
 	}
+
+	// Visits n, then its children. If n is only partly in the frustum the
+	// children are tested against it all at once before descending.
+	void traverseChildren(const LLSpatialGroup::OctreeNode* n)
+	{
+		n->accept(this);
+
+		U32 count = n->getChildCount();
+		if (mRes == 1 && count > 1)
+		{
+			S32 res[8];
+			frustumCheckChildren(n, res);
+			for (U32 i = 0; i < count; i++)
+			{
+				mChildRes = res[i];
+				traverse(n->getChild(i));
+			}
+			mChildRes = -1;
+		}
+		else
+		{
+			for (U32 i = 0; i < count; i++)
+			{
+				traverse(n->getChild(i));
+			}
+		}
+	}
+
+	// Batched frustumCheck() of every child of n
+	virtual void frustumCheckChildren(const LLSpatialGroup::OctreeNode* n, S32* res)
+	{
+		const LLVector3* bounds[8];
+		const LLVector3* extents[8];
+		U32 count = getChildBounds(n, bounds, extents);
+
+		S32 sphere[8];
+		mFrustum.AABBInFrustum(bounds, count, res);
+		mFrustum.AABBSphereIntersect(extents, count, sphere);
+		for (U32 i = 0; i < count; i++)
+		{
+			if (res[i] != 0)
+			{
+				res[i] = llmin(res[i], sphere[i]);
+			}
+		}
+	}
+
+	static U32 getChildBounds(const LLSpatialGroup::OctreeNode* n, const LLVector3** bounds, const LLVector3** extents)
+	{
+		U32 count = n->getChildCount();
+		for (U32 i = 0; i < count; i++)
+		{
+			const LLSpatialGroup* group = (const LLSpatialGroup*) n->getChild(i)->getListener(0);
+			bounds[i] = group->mBounds;
+			extents[i] = group->mExtents;
+		}
+		return count;
+	}
 	
 	virtual S32 frustumCheck(const LLSpatialGroup* group)
 	{
@@ -1607,12 +1715,92 @@ public:
 		
 		if (checkObjects(branch, group))
 		{
-			processGroup(group);
+			if (mRecords)
+			{
+				mRecords->back().mProcess = true;
+			}
+			else
+			{
+				processGroup(group);
+			}
+		}
+	}
+
+	// Read only half of traverse() used by LLCullQueue: does the frustum
+	// tests and records the result instead of acting on it. If mSplitNodes
+	// is set, the children of n are handed back instead of traversed.
+	void record(const LLSpatialGroup::OctreeNode* n, LLSpatialGroup* group, S32 child_res)
+	{
+		U32 index = mRecords->size();
+		mRecords->push_back(LLCullQueue::Record(group));
+
+		if (mRes == 2 || 
+			(mRes && group->isState(LLSpatialGroup::SKIP_FRUSTUM_CHECK)))
+		{
+			(*mRecords)[index].mInFrustum = true;
+			recordChildren(n);
+		}
+		else
+		{
+			mRes = child_res >= 0 ? child_res : frustumCheck(group);
+			if (mRes)
+			{
+				(*mRecords)[index].mInFrustum = true;
+				recordChildren(n);
+			}
+			mRes = 0;
+		}
+
+		(*mRecords)[index].mEnd = mRecords->size();
+	}
+
+	void recordChildren(const LLSpatialGroup::OctreeNode* n)
+	{
+		if (mSplitNodes)
+		{
+			n->accept(this);
+			for (U32 i = 0; i < n->getChildCount(); i++)
+			{
+				mSplitNodes->push_back(std::make_pair(n->getChild(i), mRes));
+			}
+			mSplitNodes = NULL;
+		}
+		else
+		{
+			traverseChildren(n);
+		}
+	}
+
+	// Acts on the records of a subtree in order, doing the occlusion
+	// readback that the recording pass skipped
+	void replay(const LLCullQueue::record_list_t& records)
+	{
+		U32 i = 0;
+		while (i < records.size())
+		{
+			const LLCullQueue::Record& record = records[i];
+			if (earlyFail(record.mGroup))
+			{	//occluded, skip the whole subtree
+				i = record.mEnd;
+				continue;
+			}
+			if (record.mProcess)
+			{
+				processGroup(record.mGroup);
+			}
+			i++;
 		}
 	}
 
+	typedef std::vector<std::pair<const LLSpatialGroup::OctreeNode*, S32> > split_list_t;
+
 	LLCamera *mCamera;
+	LLV4Frustum mFrustum;
 	S32 mRes;
+	S32 mChildRes;
+	LLCullQueue::record_list_t* mRecords;
+	split_list_t* mSplitNodes;
+	const LLOcclusionBuffer* mOcclusionBuffer;
 };
 
 class LLOctreeCullNoFarClip : public LLOctreeCull
@@ -1626,6 +1814,14 @@ public:
 		return mCamera->AABBInFrustumNoFarClip(group->mBounds[0], group->mBounds[1]);
 	}
 
+	virtual void frustumCheckChildren(const LLSpatialGroup::OctreeNode* n, S32* res)
+	{
+		const LLVector3* bounds[8];
+		const LLVector3* extents[8];
+		U32 count = getChildBounds(n, bounds, extents);
+		mFrustum.AABBInFrustum(bounds, count, res);
+	}
+
 	virtual S32 frustumCheckObjects(const LLSpatialGroup* group)
 	{
 		S32 res = mCamera->AABBInFrustumNoFarClip(group->mObjectBounds[0], group->mObjectBounds[1]);
@@ -1637,13 +1833,24 @@ class LLOctreeCullShadow : public LLOctreeCull
 {
 public:
 	LLOctreeCullShadow(LLCamera* camera)
-		: LLOctreeCull(camera) { }
+		: LLOctreeCull(camera)
+	{
+		mFrustum.setCamera(*camera, TRUE);
+	}
 
 	virtual S32 frustumCheck(const LLSpatialGroup* group)
 	{
 		return mCamera->AABBInFrustum(group->mBounds[0], group->mBounds[1]);
 	}
 
+	virtual void frustumCheckChildren(const LLSpatialGroup::OctreeNode* n, S32* res)
+	{
+		const LLVector3* bounds[8];
+		const LLVector3* extents[8];
+		U32 count = getChildBounds(n, bounds, extents);
+		mFrustum.AABBInFrustum(bounds, count, res);
+	}
+
 	virtual S32 frustumCheckObjects(const LLSpatialGroup* group)
 	{
 		return mCamera->AABBInFrustum(group->mObjectBounds[0], group->mObjectBounds[1]);
@@ -1866,6 +2073,79 @@ void LLSpatialPartition::resetVertexBuffers()
 	dirty.traverse(mOctree);
 }
 
+// Releases the vertex buffers of groups that have not been visible for a
+// while, they are rebuilt like after resetVertexBuffers() if seen again
+class LLOctreeEvict : public LLOctreeTraveler<LLDrawable>
+{
+public:
+	LLOctreeEvict(S32 bytes, S32 last_visible_frame)
+		: mBytes(bytes), mFreed(0), mLastVisibleFrame(last_visible_frame)
+	{
+	}
+
+	virtual void traverse(const LLSpatialGroup::OctreeNode* node)
+	{
+		if (mFreed < mBytes)
+		{
+			LLOctreeTraveler<LLDrawable>::traverse(node);
+		}
+	}
+
+	virtual void visit(const LLSpatialGroup::OctreeNode* state)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*) state->getListener(0);
+		if (mFreed >= mBytes || group->mVisible > mLastVisibleFrame)
+		{
+			return;
+		}
+
+		S32 bytes = 0;
+		if (group->mVertexBuffer.notNull())
+		{
+			bytes += group->mVertexBuffer->getSize() + group->mVertexBuffer->getIndicesSize();
+		}
+		for (LLSpatialGroup::buffer_map_t::iterator i = group->mBufferMap.begin(); i != group->mBufferMap.end(); ++i)
+		{
+			for (LLSpatialGroup::buffer_texture_map_t::iterator j = i->second.begin(); j != i->second.end(); ++j)
+			{
+				for (LLSpatialGroup::buffer_list_t::iterator k = j->second.begin(); k != j->second.end(); ++k)
+				{
+					if (*k != group->mVertexBuffer)
+					{
+						bytes += (*k)->getSize() + (*k)->getIndicesSize();
+					}
+				}
+			}
+		}
+		if (bytes == 0)
+		{
+			return;
+		}
+
+		group->destroyGL();
+		for (LLSpatialGroup::element_iter i = group->getData().begin(); i != group->getData().end(); ++i)
+		{
+			LLDrawable* drawable = *i;
+			if (drawable->getVObj().notNull() && !group->mSpatialPartition->mRenderByGroup)
+			{
+				gPipeline.markRebuild(drawable, LLDrawable::REBUILD_ALL, TRUE);
+			}
+		}
+		mFreed += bytes;
+	}
+
+	S32 mBytes;
+	S32 mFreed;
+	S32 mLastVisibleFrame;
+};
+
+S32 LLSpatialPartition::evictVertexBuffers(S32 bytes, S32 min_idle_frames)
+{
+	LLOctreeEvict evict(bytes, LLDrawable::getCurrentFrame() - min_idle_frames);
+	evict.traverse(mOctree);
+	return evict.mFreed;
+}
+
 BOOL LLSpatialPartition::isOcclusionEnabled()
 {
 	return mOcclusionEnabled || LLPipeline::sUseOcclusion > 2;
@@ -1932,6 +2212,219 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 	return 0;
 }
 
+//============================================================================
+// LLCullQueue
+
+enum
+{
+	CULL_DEFAULT,
+	CULL_NO_FAR_CLIP,
+	CULL_SHADOW
+};
+
+template <class T>
+static void record_cull(LLCullQueue::WorkItem& item, LLOctreeCull::split_list_t* split_nodes = NULL)
+{
+	T culler(item.mCamera);
+	culler.mRecords = &item.mRecords;
+	culler.mSplitNodes = split_nodes;
+	culler.mRes = item.mRes;
+	culler.traverse(item.mNode);
+}
+
+template <class T>
+static void replay_cull(LLCullQueue::WorkItem& item)
+{
+	T culler(item.mCamera);
+	culler.replay(item.mRecords);
+}
+
+LLCullQueue::CullRequest::CullRequest(handle_t handle, LLCullQueue* queue, U32 first, U32 stride)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_HIGH, FLAG_AUTO_COMPLETE),
+	  mQueue(queue),
+	  mFirst(first),
+	  mStride(stride)
+{
+}
+
+// ANY THREAD
+bool LLCullQueue::CullRequest::processRequest()
+{
+	for (U32 i = mFirst; i < mQueue->mItemCount; i += mStride)
+	{
+		mQueue->recordItem(mQueue->mItems[i]);
+	}
+	mQueue->mCompleted++;
+	return true;
+}
+
+LLCullQueue::LLCullQueue()
+	: LLQueuedThread("Cull", false),
+	  mItemCount(0),
+	  mCameraCount(0),
+	  mLastItemCount(0)
+{
+	mCompleted = 0;
+}
+
+LLCullQueue::~LLCullQueue()
+{
+	for (U32 i = 0; i < mCameras.size(); i++)
+	{
+		delete mCameras[i];
+	}
+}
+
+LLCullQueue::WorkItem& LLCullQueue::newItem(const LLSpatialGroup::OctreeNode* node, LLCamera* camera, U32 cull_type, S32 res)
+{
+	if (mItemCount == mItems.size())
+	{
+		mItems.push_back(WorkItem());
+	}
+	WorkItem& item = mItems[mItemCount++];
+	item.mNode = node;
+	item.mCamera = camera;
+	item.mCullType = cull_type;
+	item.mRes = res;
+	item.mRecords.clear();
+	return item;
+}
+
+void LLCullQueue::setCamera(const LLCamera& camera)
+{
+	if (mCameraCount == mCameras.size())
+	{
+		mCameras.push_back(new LLCamera());
+	}
+	*mCameras[mCameraCount++] = camera;
+}
+
+void LLCullQueue::addPartition(LLSpatialPartition* part)
+{
+	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
+	{
+		BOOL temp = LLSpatialPartition::sFreezeState;
+		LLSpatialPartition::sFreezeState = FALSE;
+		LLFastTimer ftm(LLFastTimer::FTM_CULL_REBOUND);		
+		LLSpatialGroup* group = (LLSpatialGroup*) part->mOctree->getListener(0);
+		group->rebound();
+		LLSpatialPartition::sFreezeState = temp;
+	}
+
+	llassert(mCameraCount > 0);
+	LLCamera* camera = mCameras[mCameraCount - 1];
+
+	U32 cull_type = CULL_DEFAULT;
+	if (LLPipeline::sShadowRender)
+	{
+		cull_type = CULL_SHADOW;
+	}
+	else if (part->mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	{
+		cull_type = CULL_NO_FAR_CLIP;
+	}
+
+	// The root is done here, which also makes sure the camera's function
+	// statics are initialized before any worker gets to them
+	LLOctreeCull::split_list_t split_nodes;
+	WorkItem& root = newItem(part->mOctree, camera, cull_type, 0);
+	switch (cull_type)
+	{
+	case CULL_SHADOW:
+		record_cull<LLOctreeCullShadow>(root, &split_nodes);
+		break;
+	case CULL_NO_FAR_CLIP:
+		record_cull<LLOctreeCullNoFarClip>(root, &split_nodes);
+		break;
+	default:
+		record_cull<LLOctreeCull>(root, &split_nodes);
+		break;
+	}
+
+	for (U32 i = 0; i < split_nodes.size(); i++)
+	{
+		newItem(split_nodes[i].first, camera, cull_type, split_nodes[i].second);
+	}
+}
+
+// ANY THREAD
+void LLCullQueue::recordItem(WorkItem& item)
+{
+	if (!item.mRecords.empty())
+	{	//root, already recorded by addPartition()
+		return;
+	}
+	switch (item.mCullType)
+	{
+	case CULL_SHADOW:
+		record_cull<LLOctreeCullShadow>(item);
+		break;
+	case CULL_NO_FAR_CLIP:
+		record_cull<LLOctreeCullNoFarClip>(item);
+		break;
+	default:
+		record_cull<LLOctreeCull>(item);
+		break;
+	}
+}
+
+void LLCullQueue::replayItem(WorkItem& item)
+{
+	switch (item.mCullType)
+	{
+	case CULL_SHADOW:
+		replay_cull<LLOctreeCullShadow>(item);
+		break;
+	case CULL_NO_FAR_CLIP:
+		replay_cull<LLOctreeCullNoFarClip>(item);
+		break;
+	default:
+		replay_cull<LLOctreeCull>(item);
+		break;
+	}
+}
+
+void LLCullQueue::cull()
+{
+	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
+	{
+		LLFastTimer ftm(LLFastTimer::FTM_FRUSTUM_CULL);
+
+		// A few requests per worker so that one big subtree doesn't leave the
+		// others idle; items are dealt out round robin since neighbouring
+		// subtrees tend to be of similar size
+		U32 requests = 1;
+		if (mThreadPool)
+		{
+			requests = llmin(mItemCount, mThreadPool->getSize() * 4);
+		}
+		mCompleted = 0;
+		for (U32 i = 0; i < requests; i++)
+		{
+			addRequest(new CullRequest(generateHandle(), this, i, requests));
+		}
+
+		// Help out rather than sit idle until the workers are done
+		while (mCompleted < requests)
+		{
+			processNextRequest();
+			if (mCompleted < requests)
+			{
+				yield();
+			}
+		}
+	}
+
+	for (U32 i = 0; i < mItemCount; i++)
+	{
+		replayItem(mItems[i]);
+	}
+
+	mLastItemCount = mItemCount;
+	mItemCount = 0;
+	mCameraCount = 0;
+}
+
 BOOL earlyFail(LLCamera* camera, LLSpatialGroup* group)
 {
 	const F32 vel = SG_OCCLUSION_FUDGE*2.f;
@@ -3169,3 +3662,272 @@ void LLCullResult::assertDrawMapsEmpty()
 
 
 
+void LLCullResult::truncateRenderMap(U32 type, U32 size)
+{
+	for (U32 i = size; i < mRenderMapSize[type]; i++)
+	{
+		mRenderMap[type][i] = 0;
+	}
+	mRenderMapSize[type] = llmin(size, mRenderMapSize[type]);
+}
+
+//============================================================================
+
+// Batches not drawn for this many frames are dropped
+const U32 BATCH_EXPIRE_FRAMES = 30;
+
+BOOL LLDrawBatcher::sEnabled = TRUE;
+U32 LLDrawBatcher::sMaxSourceVertices = 1024;
+U32 LLDrawBatcher::sDrawInfoCount = 0;
+U32 LLDrawBatcher::sDrawCallCount = 0;
+U32 LLDrawBatcher::sBuildCount = 0;
+
+LLDrawBatcher::LLDrawBatcher()
+	: mCacheBytes(0),
+	  mLastExpireFrame(0)
+{
+}
+
+LLDrawBatcher::~LLDrawBatcher()
+{
+	clear();
+}
+
+//static
+bool LLDrawBatcher::useSourceBuffer(const LLSpatialGroup* group, U32 usage, U32 num_vertices)
+{
+	// Bridged groups move as a whole and streamed ones change every frame,
+	// neither is worth copying
+	return sEnabled && LLVertexBuffer::sEnableVBOs &&
+		usage != GL_STREAM_DRAW_ARB &&
+		num_vertices <= sMaxSourceVertices &&
+		!group->mSpatialPartition->isBridge();
+}
+
+//static
+bool LLDrawBatcher::isSource(const LLDrawInfo* draw_info)
+{
+	const LLVertexBuffer* buffer = draw_info->mVertexBuffer.get();
+	return buffer && buffer->getUsage() == 0 &&
+		buffer->getMappedData() && buffer->getMappedIndices() &&
+		!draw_info->mParticle &&
+		// a dirty mesh is only written when it is drawn
+		draw_info->mGroup && !draw_info->mGroup->isState(LLSpatialGroup::MESH_DIRTY);
+}
+
+//static
+bool LLDrawBatcher::sameState(const LLDrawInfo* lhs, const LLDrawInfo* rhs)
+{
+	return lhs->mTexture == rhs->mTexture &&
+		lhs->mModelMatrix == rhs->mModelMatrix &&
+		lhs->mTextureMatrix == rhs->mTextureMatrix &&
+		lhs->mGlowColor.mV[3] == rhs->mGlowColor.mV[3] &&
+		lhs->mFullbright == rhs->mFullbright &&
+		lhs->mBump == rhs->mBump &&
+		lhs->mParticle == rhs->mParticle &&
+		lhs->mVertexBuffer.notNull() && rhs->mVertexBuffer.notNull() &&
+		lhs->mVertexBuffer->getTypeMask() == rhs->mVertexBuffer->getTypeMask();
+}
+
+void LLDrawBatcher::batch(LLCullResult* cull, U32 type)
+{
+	LLCullResult::drawinfo_list_t::iterator begin = cull->beginRenderMap(type);
+	LLCullResult::drawinfo_list_t::iterator end = cull->endRenderMap(type);
+	U32 count = end - begin;
+	sDrawInfoCount += count;
+
+	if (!sEnabled || !LLVertexBuffer::sEnableVBOs || count == 0)
+	{
+		sDrawCallCount += count;
+		return;
+	}
+
+	static S32* sRenderMaxVBOSize = rebind_llcontrol<S32>("RenderMaxVBOSize", &gSavedSettings, true);
+
+	mOut.clear();
+	LLCullResult::drawinfo_list_t::iterator run = begin;
+	while (run != end)
+	{
+		// Split the run of draw infos sharing this state into sources,
+		// which get merged, and the rest, which pass through
+		mSources.clear();
+		LLCullResult::drawinfo_list_t::iterator i = run;
+		do
+		{
+			if (isSource(*i))
+			{
+				mSources.push_back(*i);
+			}
+			else
+			{
+				mOut.push_back(*i);
+			}
+			++i;
+		}
+		while (i != end && sameState(*run, *i));
+		run = i;
+
+		if (mSources.empty())
+		{
+			continue;
+		}
+
+		U32 max_vertices = ((*sRenderMaxVBOSize)*1024)/mSources[0]->mVertexBuffer->getStride();
+		max_vertices = llmin(max_vertices, (U32) 65535);
+
+		std::vector<LLDrawInfo*>::const_iterator first = mSources.begin();
+		U32 num_vertices = 0;
+		U32 num_indices = 0;
+		for (std::vector<LLDrawInfo*>::const_iterator j = mSources.begin(); j != mSources.end(); ++j)
+		{
+			U32 vertices = (*j)->mEnd - (*j)->mStart + 1;
+			if (j != first && num_vertices + vertices > max_vertices)
+			{
+				merge(first, j, num_vertices, num_indices);
+				first = j;
+				num_vertices = 0;
+				num_indices = 0;
+			}
+			num_vertices += vertices;
+			num_indices += (*j)->mCount;
+		}
+		merge(first, mSources.end(), num_vertices, num_indices);
+	}
+
+	// Never more draw infos out than in, so this fits
+	std::copy(mOut.begin(), mOut.end(), begin);
+	cull->truncateRenderMap(type, mOut.size());
+	sDrawCallCount += mOut.size();
+}
+
+void LLDrawBatcher::merge(std::vector<LLDrawInfo*>::const_iterator begin, std::vector<LLDrawInfo*>::const_iterator end,
+						  U32 num_vertices, U32 num_indices)
+{
+	mKey.clear();
+	for (std::vector<LLDrawInfo*>::const_iterator i = begin; i != end; ++i)
+	{
+		mKey.push_back(source_t(*i, (*i)->mVertexBuffer->getMapCount()));
+	}
+
+	batch_map_t::iterator found = mBatches.find(mKey);
+	if (found != mBatches.end())
+	{
+		found->second.mLastFrame = LLFrameTimer::getFrameCount();
+		mOut.push_back(found->second.mDrawInfo);
+		return;
+	}
+
+	static S32* sRenderBatchCacheSize = rebind_llcontrol<S32>("RenderBatchCacheSize", &gSavedSettings, true);
+
+	S32 bytes = num_vertices*(*begin)->mVertexBuffer->getStride() + num_indices*sizeof(U16);
+	if (mCacheBytes + bytes > (*sRenderBatchCacheSize)*1024*1024)
+	{ //full until expire() makes room, draw the sources as they are
+		mOut.insert(mOut.end(), begin, end);
+		return;
+	}
+
+	mOut.push_back(build(mKey, begin, end, num_vertices, num_indices));
+}
+
+LLDrawInfo* LLDrawBatcher::build(const key_t& key, std::vector<LLDrawInfo*>::const_iterator begin,
+								 std::vector<LLDrawInfo*>::const_iterator end, U32 num_vertices, U32 num_indices)
+{
+	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
+
+	const LLDrawInfo* first = *begin;
+	LLVertexBuffer* buffer = new LLVertexBuffer(first->mVertexBuffer->getTypeMask(), GL_STATIC_DRAW_ARB);
+	buffer->allocateBuffer(num_vertices, num_indices, TRUE);
+
+	U8* vertices = buffer->mapBuffer();
+	U16* indices = (U16*) buffer->getMappedIndices();
+	S32 stride = buffer->getStride();
+
+	Batch& batch = mBatches[key];
+	LLVector3 extents[2] = { first->mExtents[0], first->mExtents[1] };
+	F32 vsize = 0.f;
+	U32 base = 0;
+	U32 offset = 0;
+	for (std::vector<LLDrawInfo*>::const_iterator i = begin; i != end; ++i)
+	{
+		LLDrawInfo* src = *i;
+		U32 count = src->mEnd - src->mStart + 1;
+		memcpy(vertices + base*stride, src->mVertexBuffer->getMappedData() + src->mStart*stride, count*stride);
+
+		const U16* src_indices = ((const U16*) src->mVertexBuffer->getMappedIndices()) + src->mOffset;
+		for (U32 j = 0; j < src->mCount; j++)
+		{
+			indices[offset + j] = (U16) (src_indices[j] - src->mStart + base);
+		}
+
+		update_min_max(extents[0], extents[1], src->mExtents[0]);
+		update_min_max(extents[0], extents[1], src->mExtents[1]);
+		vsize = llmax(vsize, src->mVSize);
+		batch.mSources.push_back(src);
+
+		base += count;
+		offset += src->mCount;
+	}
+	buffer->setBuffer(0);
+
+	LLDrawInfo* draw_info = new LLDrawInfo(0, num_vertices - 1, num_indices, 0, first->mTexture.get(), buffer,
+										   first->mFullbright, first->mBump);
+	draw_info->mTextureMatrix = first->mTextureMatrix;
+	draw_info->mModelMatrix = first->mModelMatrix;
+	draw_info->mGlowColor = first->mGlowColor;
+	draw_info->mVSize = vsize;
+	draw_info->mExtents[0] = extents[0];
+	draw_info->mExtents[1] = extents[1];
+
+	batch.mDrawInfo = draw_info;
+	batch.mBytes = buffer->getSize() + buffer->getIndicesSize();
+	batch.mLastFrame = LLFrameTimer::getFrameCount();
+	mCacheBytes += batch.mBytes;
+	sBuildCount++;
+	return draw_info;
+}
+
+void LLDrawBatcher::expire()
+{
+	U32 frame = LLFrameTimer::getFrameCount();
+	if (frame == mLastExpireFrame)
+	{
+		return;
+	}
+	mLastExpireFrame = frame;
+
+	static S32* sRenderBatchCacheSize = rebind_llcontrol<S32>("RenderBatchCacheSize", &gSavedSettings, true);
+
+	// Anything drawn this frame or the last may still be in a cull result
+	lru_list_t lru;
+	for (batch_map_t::iterator iter = mBatches.begin(); iter != mBatches.end(); )
+	{
+		batch_map_t::iterator cur = iter++;
+		U32 age = frame - cur->second.mLastFrame;
+		if (age > BATCH_EXPIRE_FRAMES)
+		{
+			mCacheBytes -= cur->second.mBytes;
+			mBatches.erase(cur);
+		}
+		else if (age > 1)
+		{
+			lru.push_back(cur);
+		}
+	}
+
+	S32 max_bytes = (*sRenderBatchCacheSize)*1024*1024;
+	if (mCacheBytes > max_bytes)
+	{
+		std::sort(lru.begin(), lru.end(), CompareLastFrame());
+		for (lru_list_t::iterator iter = lru.begin(); iter != lru.end() && mCacheBytes > max_bytes; ++iter)
+		{
+			mCacheBytes -= (*iter)->second.mBytes;
+			mBatches.erase(*iter);
+		}
+	}
+}
+
+void LLDrawBatcher::clear()
+{
+	mBatches.clear();
+	mCacheBytes = 0;
+}
@@ -43,8 +43,11 @@
 #include "llcubemap.h"
 #include "lldrawpool.h"
 #include "llface.h"
+#include "llqueuedthread.h"
 
+#include <map>
 #include <queue>
+#include <set>
 
 #define SG_STATE_INHERIT_MASK (OCCLUDED)
 #define SG_INITIAL_STATE_MASK (DIRTY | GEOM_DIRTY)
@@ -52,6 +55,7 @@
 class LLSpatialPartition;
 class LLSpatialBridge;
 class LLSpatialGroup;
+class LLOcclusionBuffer;
 
 S32 AABBSphereIntersect(const LLVector3& min, const LLVector3& max, const LLVector3 &origin, const F32 &rad);
 S32 AABBSphereIntersectR2(const LLVector3& min, const LLVector3& max, const LLVector3 &origin, const F32 &radius_squared);
@@ -129,6 +133,51 @@ public:
 
 	};
 
+	struct CompareBatch
+	{ //sort by bump map, texture and transforms, then by vertex buffer, so
+	  //draw infos the batcher can merge end up next to each other
+		bool operator()(const LLDrawInfo* const& lhs, const LLDrawInfo* const& rhs)
+		{
+			if (lhs == rhs || !rhs)
+			{
+				return false;
+			}
+			if (!lhs)
+			{
+				return true;
+			}
+			if (lhs->mBump != rhs->mBump)
+			{
+				return lhs->mBump > rhs->mBump;
+			}
+			if (lhs->mTexture.get() != rhs->mTexture.get())
+			{
+				return lhs->mTexture.get() > rhs->mTexture.get();
+			}
+			if (lhs->mModelMatrix != rhs->mModelMatrix)
+			{
+				return lhs->mModelMatrix > rhs->mModelMatrix;
+			}
+			if (lhs->mTextureMatrix != rhs->mTextureMatrix)
+			{
+				return lhs->mTextureMatrix > rhs->mTextureMatrix;
+			}
+			if (lhs->mGlowColor.mV[3] != rhs->mGlowColor.mV[3])
+			{
+				return lhs->mGlowColor.mV[3] > rhs->mGlowColor.mV[3];
+			}
+			if (lhs->mFullbright != rhs->mFullbright)
+			{
+				return lhs->mFullbright > rhs->mFullbright;
+			}
+			if (lhs->mVertexBuffer.get() != rhs->mVertexBuffer.get())
+			{
+				return lhs->mVertexBuffer.get() > rhs->mVertexBuffer.get();
+			}
+			return lhs->mOffset < rhs->mOffset;
+		}
+	};
+
 	struct CompareBump
 	{
 		bool operator()(const LLPointer<LLDrawInfo>& lhs, const LLPointer<LLDrawInfo>& rhs) 
@@ -247,6 +296,7 @@ public:
 	BOOL rebound();
 	void buildOcclusion(); //rebuild mOcclusionVerts
 	void checkOcclusion(); //read back last occlusion query (if any)
+	void checkOcclusion(const LLOcclusionBuffer& buffer); //test against this frame's software occlusion buffer
 	void doOcclusion(LLCamera* camera); //issue occlusion query
 	void destroyGL();
 	
@@ -295,6 +345,7 @@ public:
 
 	U32 mBufferUsage;
 	draw_map_t mDrawMap;
+	std::vector<LLPointer<LLDrawable> > mOccluders; //static solid boxes, candidates for the software occlusion buffer
 	
 	S32 mVisible;
 	F32 mDistance;
@@ -365,6 +416,9 @@ public:
 	void renderIntersectingBBoxes(LLCamera* camera);
 	void restoreGL();
 	void resetVertexBuffers();
+	// Releases about bytes of vertex buffers held by groups not visible for
+	// min_idle_frames, returns the bytes released
+	S32 evictVertexBuffers(S32 bytes, S32 min_idle_frames);
 	BOOL isOcclusionEnabled();
 	BOOL getVisibleExtents(LLCamera& camera, LLVector3& visMin, LLVector3& visMax);
 
@@ -453,6 +507,8 @@ public:
 	void pushDrawable(LLDrawable* drawable);
 	void pushBridge(LLSpatialBridge* bridge);
 	void pushDrawInfo(U32 type, LLDrawInfo* draw_info);
+	// Drops all but the first size draw infos of a render map
+	void truncateRenderMap(U32 type, U32 size);
 	
 	U32 getVisibleGroupsSize()		{ return mVisibleGroupsSize; }
 	U32	getAlphaGroupsSize()		{ return mAlphaGroupsSize; }
@@ -481,6 +537,167 @@ private:
 	drawinfo_list_t		mRenderMap[LLRenderPass::NUM_RENDER_TYPES];
 };
 
+// Merges the draw infos of one render pass that differ only in their vertex
+// buffer, typically the same texture on small prims in different spatial
+// groups, into consolidated buffers, so that the pass issues one drawRange
+// per run instead of one per group.
+//
+// Only batch sources take part: the small static buffers that
+// LLVolumeGeometryManager keeps in client memory while batching is on (see
+// useSourceBuffer()), whose contents can be read back. A source that is not
+// merged with anything is still copied to a buffer of its own, so sources are
+// only drawn from client memory when the batch cache is full or their mesh is
+// about to be rebuilt. Each consolidated buffer is cached against the draw
+// infos and buffer contents it was built from, so a static scene builds no
+// batches from one frame to the next.
+class LLDrawBatcher
+{
+public:
+	LLDrawBatcher();
+	~LLDrawBatcher();
+
+	// Whether a group should build a buffer of num_vertices, which would
+	// otherwise get usage, as a batch source
+	static bool useSourceBuffer(const LLSpatialGroup* group, U32 usage, U32 num_vertices);
+
+	// Merges the sorted (LLDrawInfo::CompareBatch) render map of one pass
+	// in place and counts draw infos in and out
+	void batch(LLCullResult* cull, U32 type);
+
+	// Drops batches not drawn in the last few frames, then the least
+	// recently drawn ones while the cache is over budget. Batches must not
+	// be dropped while LLSpatialGroup::sNoDelete is TRUE.
+	void expire();
+	// Drops every batch, for GL resets and shutdown
+	void clear();
+
+	S32 getCacheBytes() const { return mCacheBytes; }
+	U32 getCacheCount() const { return mBatches.size(); }
+
+	static BOOL sEnabled;				// RenderBatchStatic
+	static U32 sMaxSourceVertices;		// RenderBatchMaxVertices
+	static U32 sDrawInfoCount;			// draw infos handed to batch()
+	static U32 sDrawCallCount;			// draw infos left after batch()
+	static U32 sBuildCount;				// consolidated buffers built
+
+private:
+	// A source draw info and the map count of its buffer when it was copied
+	typedef std::pair<const LLDrawInfo*, U32> source_t;
+	typedef std::vector<source_t> key_t;
+
+	struct Batch
+	{
+		std::vector<LLPointer<LLDrawInfo> > mSources; // pins the key's pointers
+		LLPointer<LLDrawInfo> mDrawInfo;
+		S32 mBytes;
+		U32 mLastFrame;
+	};
+	typedef std::map<key_t, Batch> batch_map_t;
+	typedef std::vector<batch_map_t::iterator> lru_list_t;
+
+	struct CompareLastFrame
+	{
+		bool operator()(const batch_map_t::iterator& lhs, const batch_map_t::iterator& rhs)
+		{
+			return lhs->second.mLastFrame < rhs->second.mLastFrame;
+		}
+	};
+
+	static bool isSource(const LLDrawInfo* draw_info);
+	static bool sameState(const LLDrawInfo* lhs, const LLDrawInfo* rhs);
+
+	// Appends the draw info for sources [begin, end) to mOut
+	void merge(std::vector<LLDrawInfo*>::const_iterator begin, std::vector<LLDrawInfo*>::const_iterator end,
+			   U32 num_vertices, U32 num_indices);
+	LLDrawInfo* build(const key_t& key, std::vector<LLDrawInfo*>::const_iterator begin,
+					  std::vector<LLDrawInfo*>::const_iterator end, U32 num_vertices, U32 num_indices);
+
+	batch_map_t mBatches;
+	S32 mCacheBytes;
+	U32 mLastExpireFrame;
+	// Scratch space for batch()
+	std::vector<LLDrawInfo*> mOut;
+	std::vector<LLDrawInfo*> mSources;
+	key_t mKey;
+};
+
+// Fans LLPipeline::updateCull() out over the shared thread pool.
+//
+// Each partition is split at the children of its root node, and the pool
+// workers walk those subtrees with the partition's regular culler, doing
+// only the frustum tests and recording what the serial traversal would have
+// done in depth first order. The octree is read only during this phase.
+// The main thread then replays the records of every subtree in order, doing
+// the occlusion readback, occluder marking and LLCullResult updates that
+// need GL or touch shared state, so the result does not depend on how the
+// work was spread across threads.
+class LLCullQueue : public LLQueuedThread
+{
+public:
+	// What the culler saw at one group, in traversal order
+	struct Record
+	{
+		Record(LLSpatialGroup* group) : mGroup(group), mEnd(0), mInFrustum(false), mProcess(false) { }
+
+		LLSpatialGroup* mGroup;
+		U32 mEnd;			// index of the first record past this group's subtree
+		bool mInFrustum;	// the subtree was traversed
+		bool mProcess;		// visit() would have called processGroup()
+	};
+	typedef std::vector<Record> record_list_t;
+
+	// One subtree of one partition
+	struct WorkItem
+	{
+		const LLSpatialGroup::OctreeNode* mNode;
+		LLCamera* mCamera;
+		U32 mCullType;
+		S32 mRes; // frustum result inherited from the parent
+		record_list_t mRecords;
+	};
+
+	LLCullQueue();
+	virtual ~LLCullQueue();
+
+	// MAIN THREAD
+	// Partitions added after this are culled against a copy of camera
+	void setCamera(const LLCamera& camera);
+	// Rebounds part and queues its subtrees
+	void addPartition(LLSpatialPartition* part);
+	// Culls everything added since the last call and replays the results
+	// into the current LLCullResult
+	void cull();
+
+	U32 getWorkItemCount() const { return mLastItemCount; }
+
+protected:
+	class CullRequest : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		CullRequest(handle_t handle, LLCullQueue* queue, U32 first, U32 stride);
+		/*virtual*/ bool processRequest();
+	protected:
+		/*virtual*/ ~CullRequest() { }
+	private:
+		LLCullQueue* mQueue;
+		U32 mFirst;
+		U32 mStride;
+	};
+	friend class CullRequest;
+
+	WorkItem& newItem(const LLSpatialGroup::OctreeNode* node, LLCamera* camera, U32 cull_type, S32 res);
+	void recordItem(WorkItem& item); // ANY THREAD
+	void replayItem(WorkItem& item);
+
+	// Reused from frame to frame so their storage sticks around
+	std::vector<WorkItem> mItems;
+	U32 mItemCount;
+	std::vector<LLCamera*> mCameras;
+	U32 mCameraCount;
+	U32 mLastItemCount;
+	LLAtomicU32 mCompleted;
+};
+
 //spatial partition for water (implemented in LLVOWater.cpp)
 class LLWaterPartition : public LLSpatialPartition
 {
@@ -630,6 +630,17 @@ bool idle_startup()
 				msg->mPacketRing.setUseOutThrottle(TRUE);
 				msg->mPacketRing.setOutBandwidth(outBandwidth);
 			}
+
+			if (gSavedSettings.getBOOL("NetworkReceiveThread"))
+			{
+				msg->setUseReceiveThread(TRUE);
+			}
+
+			std::string capture_file = gSavedSettings.getString("PacketCaptureFile");
+			if (!capture_file.empty())
+			{
+				msg->mPacketRing.startCapture(gDirUtilp->getExpandedFilename(LL_PATH_LOGS, capture_file));
+			}
 		}
 
 		LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
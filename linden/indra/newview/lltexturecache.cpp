@@ -45,16 +45,19 @@
 
 // Cache organization:
 // cache/texture.entries
-//  Unordered array of Entry structs
+//  EntriesInfo followed by an unordered array of Entry structs (memory mapped)
 // cache/texture.cache
-//  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
+//  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order (memory mapped)
 //  Entry size same as header packet, so we're not 0-padding unless whole image is contained in header.
-// cache/textures/[0-F]/UUID.texture
-//  Actual texture body files
+// cache/textures/[0-F]/[0-F]/UUID.texture
+//  Actual texture body files, fanned out on the first two digits of the UUID
 
 const S32 TEXTURE_CACHE_ENTRY_SIZE = FIRST_PACKET_SIZE; 
 const F32 TEXTURE_CACHE_PURGE_AMOUNT = .20f; // % amount to reduce the cache by when it exceeds its limit
 const F32 TEXTURE_CACHE_LRU_SIZE = .10f; // % amount for LRU list (low overhead to regenerate)
+const F32 TEXTURE_CACHE_FLUSH_INTERVAL = 5.f; // seconds between write backs of the mapped header files
+const S32 TEXTURE_CACHE_EVICT_BATCH = 16; // max body files removed by the evictor per request slice
+const U32 TEXTURE_CACHE_GROW_ENTRIES = 1024; // records added to the texture.cache mapping when it fills up
 
 class LLTextureCacheWorker : public LLWorkerClass
 {
@@ -311,6 +314,60 @@ private:
 };
 
 
+// Removes the least recently used texture bodies once the cache goes over
+// its limit. Runs at low priority on the cache thread, a few files per slice,
+// so that the cost is spread out instead of stalling a single frame.
+class LLTextureCacheEvictor : public LLWorkerClass
+{
+public:
+	LLTextureCacheEvictor(LLTextureCache* cache)
+		: LLWorkerClass(cache, "LLTextureCacheEvictor"),
+		  mCache(cache),
+		  mSelectTime(0),
+		  mSelected(false),
+		  mNext(0)
+	{
+	}
+
+	void evict() { addWork(0, LLWorkerThread::PRIORITY_LOW); }
+	bool complete() { return checkWork(); }
+
+	/*virtual*/ bool doWork(S32 param); // Called from LLWorkerThread::processRequest()
+
+private:
+	/*virtual*/ void startWork(S32 param) {} // called from addWork() (MAIN THREAD)
+	/*virtual*/ void endWork(S32 param, bool aborted) {} // called from doWork() (MAIN THREAD)
+
+	LLTextureCache* mCache;
+	std::vector<LLUUID> mEvictList;
+	U32 mSelectTime;
+	bool mSelected;
+	U32 mNext;
+};
+
+//virtual (WORKER THREAD)
+bool LLTextureCacheEvictor::doWork(S32 param)
+{
+	if (!mSelected)
+	{
+		// First slice: pick the candidates from the entries LRU data
+		mSelectTime = time(NULL);
+		mCache->getEvictionList(mEvictList);
+		mSelected = true;
+		return mEvictList.empty();
+	}
+	for (S32 count = 0; count < TEXTURE_CACHE_EVICT_BATCH && mNext < mEvictList.size(); ++count)
+	{
+		if (!mCache->evictTextureBody(mEvictList[mNext++], mSelectTime))
+		{
+			return true; // back under the target
+		}
+	}
+	return mNext >= mEvictList.size();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 //virtual
 void LLTextureCacheWorker::startWork(S32 param)
 {
@@ -421,14 +478,12 @@ bool LLTextureCacheRemoteWorker::doRead()
 	{
 		llassert_always(idx >= 0);	// we need an entry here or reading the header makes no sense
 		llassert_always(mOffset < TEXTURE_CACHE_ENTRY_SIZE);
-		S32 offset = idx * TEXTURE_CACHE_ENTRY_SIZE + mOffset;
 		// Compute the size we need to read (in bytes)
 		S32 size = TEXTURE_CACHE_ENTRY_SIZE - mOffset;
 		size = llmin(size, mDataSize);
 		// Allocate the read buffer
 		mReadData = new U8[size];
-		S32 bytes_read = LLAPRFile::readEx(mCache->mHeaderDataFileName, 
-											 mReadData, offset, size);
+		S32 bytes_read = mCache->readHeaderData(mID, idx, mOffset, mReadData, size);
 		if (bytes_read != size)
 		{
 			llwarns << "LLTextureCacheWorker: "  << mID
@@ -584,25 +639,8 @@ bool LLTextureCacheRemoteWorker::doWrite()
 	if (!done && (mState == HEADER))
 	{
 		llassert_always(idx >= 0);	// we need an entry here or storing the header makes no sense
-		S32 offset = idx * TEXTURE_CACHE_ENTRY_SIZE;	// skip to the correct spot in the header file
-		S32 size = TEXTURE_CACHE_ENTRY_SIZE;			// record size is fixed for the header
-		S32 bytes_written;
-
-		if (mDataSize < TEXTURE_CACHE_ENTRY_SIZE)
-		{
-			// We need to write a full record in the header cache so, if the amount of data is smaller
-			// than a record, we need to transfer the data to a buffer padded with 0 and write that
-			U8* padBuffer = new U8[TEXTURE_CACHE_ENTRY_SIZE];
-			memset(padBuffer, 0, TEXTURE_CACHE_ENTRY_SIZE);		// Init with zeros
-			memcpy(padBuffer, mWriteData, mDataSize);			// Copy the write buffer
-			bytes_written = LLAPRFile::writeEx(mCache->mHeaderDataFileName, padBuffer, offset, size);
-			delete [] padBuffer;
-		}
-		else
-		{
-			// Write the header record (== first TEXTURE_CACHE_ENTRY_SIZE bytes of the raw file) in the header file
-			bytes_written = LLAPRFile::writeEx(mCache->mHeaderDataFileName, mWriteData, offset, size);
-		}
+		// Write the header record (== first TEXTURE_CACHE_ENTRY_SIZE bytes of the raw file), padded with 0 if needed
+		S32 bytes_written = mCache->writeHeaderData(mID, idx, mWriteData, mDataSize);
 
 		if (bytes_written <= 0)
 		{
@@ -736,7 +774,11 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 
 LLTextureCache::LLTextureCache(bool threaded)
 	: LLWorkerThread("TextureCache", threaded),
-	  mHeaderAPRFile(NULL),
+	  mEntriesBuffer(NULL),
+	  mEntriesTable(NULL),
+	  mEntriesCapacity(0),
+	  mRecoverEntries(false),
+	  mEvictor(NULL),
 	  mReadOnly(FALSE),
 	  mTexturesSizeTotal(0),
 	  mDoPurge(FALSE)
@@ -745,6 +787,8 @@ LLTextureCache::LLTextureCache(bool threaded)
 
 LLTextureCache::~LLTextureCache()
 {
+	LLMutexLock lock(&mHeaderMutex);
+	closeHeaderFiles();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -777,6 +821,20 @@ S32 LLTextureCache::update(U32 max_time_ms)
 	}
 
 	unlockWorkers(); 
+
+	if (mEvictor && mEvictor->complete())
+	{
+		mEvictor->scheduleDelete();
+		mEvictor = NULL;
+	}
+	if (mDoPurge && !mEvictor)
+	{
+		// Started from the main thread (i.e. here), the evictor then
+		//  removes bodies in small batches on the cache thread
+		mEvictor = new LLTextureCacheEvictor(this);
+		mEvictor->evict();
+		mDoPurge = FALSE;
+	}
 	
 	// call 'completed' with workers list unlocked (may call readComplete() or writeComplete()
 	for (responder_list_t::iterator iter1 = completed_list.begin();
@@ -786,6 +844,17 @@ S32 LLTextureCache::update(U32 max_time_ms)
 		bool success = iter1->second;
 		responder->completed(success);
 	}
+
+	// Write back the mapped header files every so often so that an OS crash
+	// only loses the last few seconds of cache bookkeeping
+	if (mFlushTimer.getElapsedTimeF32() > TEXTURE_CACHE_FLUSH_INTERVAL)
+	{
+		mFlushTimer.reset();
+		if (mEntriesFile.isMapped())
+		{
+			flushHeaderFiles(false);
+		}
+	}
 	
 	return res;
 }
@@ -805,7 +874,7 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 {
 	std::string idstr = id.asString();
 	std::string delem = gDirUtilp->getDirDelimiter();
-	std::string filename = mTexturesDirName + delem + idstr[0] + delem + idstr + ".texture";
+	std::string filename = mTexturesDirName + delem + idstr[0] + delem + idstr[1] + delem + idstr + ".texture";
 	return filename;
 }
 
@@ -827,7 +896,7 @@ bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
 			}
 						
 			Entry entry;
-			S32 idx = openAndReadEntry(id, entry, false);
+			S32 idx = readEntry(id, entry, false);
 			if (idx < 0)
 			{
 				llwarns << "Failed to open entry: " << id << llendl;
@@ -841,7 +910,7 @@ bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
 					   << " idx=" << idx << " oldsize=" << oldbodysize << " entrysize=" << entry.mBodySize << llendl;
 			}
 			entry.mBodySize = bodysize;
-			writeEntryAndClose(idx, entry);
+			writeEntry(idx, entry);
 			
 			mTexturesSizeTotal -= oldbodysize;
 			mTexturesSizeTotal += bodysize;
@@ -865,7 +934,7 @@ bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
 
 //static
 const S32 MAX_REASONABLE_FILE_SIZE = 512*1024*1024; // 512 MB
-F32 LLTextureCache::sHeaderCacheVersion = 1.3f;
+F32 LLTextureCache::sHeaderCacheVersion = 1.5f;
 U32 LLTextureCache::sCacheMaxEntries = MAX_REASONABLE_FILE_SIZE / TEXTURE_CACHE_ENTRY_SIZE;
 S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 const char* entries_filename = "texture.entries";
@@ -886,8 +955,8 @@ void LLTextureCache::purgeCache(ELLPath location)
 
 	if (!mReadOnly)
 	{
+		closeHeaderFiles();
 		setDirNames(location);
-		llassert_always(mHeaderAPRFile == NULL);
 		LLAPRFile::remove(mHeaderEntriesFileName);
 		LLAPRFile::remove(mHeaderDataFileName);
 	}
@@ -918,14 +987,23 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL read_only)
 	{
 		LLFile::mkdir(mTexturesDirName);
 		const char* subdirs = "0123456789abcdef";
+		std::string delem = gDirUtilp->getDirDelimiter();
 		for (S32 i=0; i<16; i++)
 		{
-			std::string dirname = mTexturesDirName + gDirUtilp->getDirDelimiter() + subdirs[i];
+			std::string dirname = mTexturesDirName + delem + subdirs[i];
 			LLFile::mkdir(dirname);
+			for (S32 j=0; j<16; j++)
+			{
+				LLFile::mkdir(dirname + delem + subdirs[j]);
+			}
 		}
 	}
+	mHeaderMutex.lock();
+	openHeaderFiles();
+	mHeaderMutex.unlock();
 	readHeaderCache();
 	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
+	mRecoverEntries = false;
 
 	return max_size; // unused cache space
 }
@@ -933,44 +1011,184 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL read_only)
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
+void LLTextureCache::openHeaderFiles()
+{
+	closeHeaderFiles();
+
+	// Cover sCacheMaxEntries, or the whole file if it is bigger than that
+	// (readHeaderCache() prunes the extra entries).
+	S32 file_size = LLAPRFile::size(mHeaderEntriesFileName);
+	U32 table_size = sizeof(EntriesInfo) + sCacheMaxEntries * sizeof(Entry);
+	table_size = llmax(table_size, (U32)llmax(file_size, 0));
+	if (!mReadOnly && mEntriesFile.map(mHeaderEntriesFileName, table_size, false))
+	{
+		mEntriesTable = mEntriesFile.getData();
+	}
+	else
+	{
+		// Read only, or mapping failed: work on a copy that is written back on close
+		mEntriesBuffer = new U8[table_size];
+		memset(mEntriesBuffer, 0, table_size);
+		if (file_size > 0)
+		{
+			LLAPRFile::readEx(mHeaderEntriesFileName, mEntriesBuffer, 0, file_size);
+		}
+		mEntriesTable = mEntriesBuffer;
+	}
+	mEntriesCapacity = (table_size - sizeof(EntriesInfo)) / sizeof(Entry);
+
+	readEntriesHeader();
+	mRecoverEntries = (mHeaderEntriesInfo.mVersion == sHeaderCacheVersion && mHeaderEntriesInfo.mDirty != 0);
+	if (mRecoverEntries)
+	{
+		LL_WARNS("TextureCache") << "Texture cache was not closed cleanly, validating all entries" << LL_ENDL;
+	}
+	if (!mReadOnly)
+	{
+		// Stays set on disk until closeHeaderFiles(), so a crash is detected next time
+		mHeaderEntriesInfo.mDirty = 1;
+		writeEntriesHeader();
+		flushHeaderFiles(true);
+	}
+
+	// Only cover the records in use; growHeaderData() extends the file and
+	// the mapping as entries are added.
+	U32 entries = mHeaderEntriesInfo.mVersion == sHeaderCacheVersion ? mHeaderEntriesInfo.mEntries : 0;
+	if (!mHeaderDataFile.map(mHeaderDataFileName, getHeaderDataSize(entries), mReadOnly))
+	{
+		LL_WARNS("TextureCache") << "Unable to map " << mHeaderDataFileName << ", using file I/O for headers" << LL_ENDL;
+	}
+	mFlushTimer.reset();
+}
+
+// Size of the texture.cache mapping holding at least entries records
+size_t LLTextureCache::getHeaderDataSize(U32 entries)
 {
-	llassert_always(mHeaderAPRFile == NULL);
-	apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-	mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags, LLAPRFile::local);
-	mHeaderAPRFile->seek(APR_SET, offset);
-	return mHeaderAPRFile;
+	entries = (entries / TEXTURE_CACHE_GROW_ENTRIES + 1) * TEXTURE_CACHE_GROW_ENTRIES;
+	entries = llmin(entries, sCacheMaxEntries);
+	return (size_t)entries * TEXTURE_CACHE_ENTRY_SIZE;
 }
 
-void LLTextureCache::closeHeaderEntriesFile()
+// Remaps texture.cache when record entries - 1 is past the end of the
+// mapping. The mapping moves, so every entry lock is held meanwhile.
+void LLTextureCache::growHeaderData(U32 entries)
 {
-	llassert_always(mHeaderAPRFile != NULL);
-	delete mHeaderAPRFile;
-	mHeaderAPRFile = NULL;
+	if (mReadOnly || !mHeaderDataFile.isMapped() ||
+		(size_t)entries * TEXTURE_CACHE_ENTRY_SIZE <= mHeaderDataFile.getSize())
+	{
+		return;
+	}
+	lockAllEntries();
+	if (!mHeaderDataFile.map(mHeaderDataFileName, getHeaderDataSize(entries), false))
+	{
+		LL_WARNS("TextureCache") << "Unable to grow the mapping of " << mHeaderDataFileName
+								 << ", using file I/O for headers" << LL_ENDL;
+	}
+	unlockAllEntries();
+}
+
+void LLTextureCache::closeHeaderFiles()
+{
+	if (mEntriesTable && !mReadOnly)
+	{
+		// Only mark the entries clean once everything else is on disk
+		flushHeaderFiles(true);
+		mHeaderEntriesInfo.mDirty = 0;
+		writeEntriesHeader();
+		flushHeaderFiles(true);
+	}
+	mEntriesFile.unmap();
+	delete[] mEntriesBuffer;
+	mEntriesBuffer = NULL;
+	mEntriesTable = NULL;
+	mEntriesCapacity = 0;
+	mHeaderDataFile.unmap();
+}
+
+// Safe to call without mHeaderMutex while the files are mapped
+void LLTextureCache::flushHeaderFiles(bool sync)
+{
+	if (mReadOnly || !mEntriesTable)
+	{
+		return;
+	}
+	if (mEntriesFile.isMapped())
+	{
+		mEntriesFile.flush(sync);
+	}
+	else
+	{
+		lockAllEntries();
+		LLAPRFile::writeEx(mHeaderEntriesFileName, mEntriesBuffer, 0,
+						   sizeof(EntriesInfo) + mEntriesCapacity * sizeof(Entry));
+		unlockAllEntries();
+	}
+	// growHeaderData() may be replacing the mapping
+	lockAllEntries();
+	mHeaderDataFile.flush(sync);
+	unlockAllEntries();
 }
 
 void LLTextureCache::readEntriesHeader()
 {
 	// mHeaderEntriesInfo initializes to default values so safe not to read it
-		llassert_always(mHeaderAPRFile == NULL);
-	if (LLAPRFile::isExist(mHeaderEntriesFileName))
+	if (mEntriesTable)
 	{
-		LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo));
+		memcpy(&mHeaderEntriesInfo, mEntriesTable, sizeof(EntriesInfo));
 	}
 }
 
 void LLTextureCache::writeEntriesHeader()
 {
-	llassert_always(mHeaderAPRFile == NULL);
-	if (!mReadOnly)
+	if (!mReadOnly && mEntriesTable)
+	{
+		memcpy(mEntriesTable, &mHeaderEntriesInfo, sizeof(EntriesInfo));
+	}
+}
+
+void LLTextureCache::lockEntries(const LLUUID& id1, const LLUUID& id2)
+{
+	LLMutex* mutex1 = getEntryMutex(id1);
+	LLMutex* mutex2 = getEntryMutex(id2);
+	if (mutex1 > mutex2)
+	{
+		std::swap(mutex1, mutex2);
+	}
+	mutex1->lock();
+	if (mutex2 != mutex1)
+	{
+		mutex2->lock();
+	}
+}
+
+void LLTextureCache::unlockEntries(const LLUUID& id1, const LLUUID& id2)
+{
+	LLMutex* mutex1 = getEntryMutex(id1);
+	LLMutex* mutex2 = getEntryMutex(id2);
+	mutex1->unlock();
+	if (mutex2 != mutex1)
 	{
-		LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo));
+		mutex2->unlock();
 	}
 }
 
-static S32 mHeaderEntriesMaxWriteIdx = 0;
+void LLTextureCache::lockAllEntries()
+{
+	for (S32 i = 0; i < ENTRY_MUTEX_COUNT; i++)
+	{
+		mEntryMutexes[i].lock();
+	}
+}
 
-S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
+void LLTextureCache::unlockAllEntries()
+{
+	for (S32 i = ENTRY_MUTEX_COUNT - 1; i >= 0; i--)
+	{
+		mEntryMutexes[i].unlock();
+	}
+}
+
+S32 LLTextureCache::readEntry(const LLUUID& id, Entry& entry, bool create)
 {
 	S32 idx = -1;
 	
@@ -988,7 +1206,7 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			{
 				// Add an entry to the end of the list
 				idx = mHeaderEntriesInfo.mEntries++;
-
+				growHeaderData(mHeaderEntriesInfo.mEntries);
 			}
 			else if (!mFreeList.empty())
 			{
@@ -1027,13 +1245,13 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 				entry.init(id, time(NULL));
 				// Update Header
 				writeEntriesHeader();
-				// Write Entry
-				S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-				LLAPRFile* aprfile = openHeaderEntriesFile(false, offset);
-				S32 bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-				llassert_always(bytes_written == sizeof(Entry));
-				mHeaderEntriesMaxWriteIdx = llmax(mHeaderEntriesMaxWriteIdx, idx);
-				closeHeaderEntriesFile();
+				// Write Entry. Workers may still hold the index of the previous
+				// owner of this slot, so take its lock as well.
+				Entry* record = getEntryRecord(idx);
+				LLUUID oldid = record->mID;
+				lockEntries(oldid, id);
+				*record = entry;
+				unlockEntries(oldid, id);
 			}
 		}
 	}
@@ -1042,17 +1260,14 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 		// Remove this entry from the LRU if it exists
 		mLRU.erase(id);
 		// Read the entry
-		S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-		LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-		S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-		llassert_always(bytes_read == sizeof(Entry));
+		LLMutexLock lock(getEntryMutex(id));
+		entry = *getEntryRecord(idx);
 		llassert_always(entry.mImageSize == 0 || entry.mImageSize == -1 || entry.mImageSize > entry.mBodySize);
-		closeHeaderEntriesFile();
 	}
 	return idx;
 }
 
-void LLTextureCache::writeEntryAndClose(S32 idx, Entry& entry)
+void LLTextureCache::writeEntry(S32 idx, Entry& entry)
 {
 	if (idx >= 0)
 	{
@@ -1072,17 +1287,13 @@ void LLTextureCache::writeEntryAndClose(S32 idx, Entry& entry)
 				mTexturesSizeMap[entry.mID] = entry.mBodySize;
 			}
 // 			llinfos << "Updating TE: " << idx << ": " << id << " Size: " << entry.mBodySize << " Time: " << entry.mTime << llendl;
-			S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-			LLAPRFile* aprfile = openHeaderEntriesFile(false, offset);
-			S32 bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-			llassert_always(bytes_written == sizeof(Entry));
-			mHeaderEntriesMaxWriteIdx = llmax(mHeaderEntriesMaxWriteIdx, idx);
-			closeHeaderEntriesFile();
+			LLMutexLock lock(getEntryMutex(entry.mID));
+			*getEntryRecord(idx) = entry;
 		}
 	}
 }
 
-U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
+U32 LLTextureCache::readEntries(std::vector<Entry>& entries)
 {
 	U32 num_entries = mHeaderEntriesInfo.mEntries;
 
@@ -1091,20 +1302,37 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
 
-	LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
+	if (num_entries > mEntriesCapacity)
+	{
+		llwarns << "Corrupted header entries, " << num_entries << " entries in a table of " << mEntriesCapacity << llendl;
+		purgeAllTextures(false);
+		return 0;
+	}
+
+	lockAllEntries();
+	const Entry* records = getEntryRecord(0);
+	entries.assign(records, records + num_entries);
+	unlockAllEntries();
+
+	U32 recovered = 0;
 	for (U32 idx=0; idx<num_entries; idx++)
 	{
-		Entry entry;
-		S32 bytes_read = aprfile->read((void*)(&entry), (S32)sizeof(Entry));
-		if (bytes_read < sizeof(Entry))
+		Entry& entry = entries[idx];
+// 		llinfos << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << llendl;
+		if (mRecoverEntries && entry.mImageSize >= 0 &&
+			((entry.mImageSize > 0 && entry.mImageSize <= entry.mBodySize) || entry.mBodySize < 0 ||
+			 mHeaderIDMap.find(entry.mID) != mHeaderIDMap.end()))
 		{
-			llwarns << "Corrupted header entries, failed at " << idx << " / " << num_entries << llendl;
-			closeHeaderEntriesFile();
-			purgeAllTextures(false);
-			return 0;
+			// Half written or duplicated entry left behind by a crash: free it
+			// (the body file goes too if no other entry owns it)
+			if (mHeaderIDMap.find(entry.mID) == mHeaderIDMap.end())
+			{
+				LLAPRFile::remove(getTextureFileName(entry.mID));
+			}
+			entry.mImageSize = -1;
+			entry.mBodySize = 0;
+			++recovered;
 		}
-		entries.push_back(entry);
-// 		llinfos << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << llendl;
 		if (entry.mImageSize < 0)
 		{
 			mFreeList.insert(idx);
@@ -1120,26 +1348,87 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 			llassert_always(entry.mImageSize == 0 || entry.mImageSize > entry.mBodySize);
 		}
 	}
-	closeHeaderEntriesFile();
+	if (recovered)
+	{
+		LL_WARNS("TextureCache") << "Freed " << recovered << " invalid texture cache entries" << LL_ENDL;
+		writeEntries(entries);
+	}
 	return num_entries;
 }
 
-void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
+void LLTextureCache::writeEntries(const std::vector<Entry>& entries)
 {
 	S32 num_entries = entries.size();
 	llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
+	llassert_always((U32)num_entries <= mEntriesCapacity);
 	
-	if (!mReadOnly)
+	if (!mReadOnly && num_entries > 0)
 	{
-		LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-		for (S32 idx=0; idx<num_entries; idx++)
+		lockAllEntries();
+		memcpy(getEntryRecord(0), &entries[0], num_entries * sizeof(Entry));
+		unlockAllEntries();
+	}
+}
+
+// Called from the worker threads, mHeaderMutex does not need to be locked.
+S32 LLTextureCache::readHeaderData(const LLUUID& id, S32 idx, S32 offset, U8* data, S32 size)
+{
+	S32 file_offset = idx * TEXTURE_CACHE_ENTRY_SIZE + offset;
+	// Held before looking at the mapping, which growHeaderData() can replace
+	LLMutexLock lock(getEntryMutex(id));
+	if (!mHeaderDataFile.isMapped())
+	{
+		return LLAPRFile::readEx(mHeaderDataFileName, data, file_offset, size);
+	}
+	if (file_offset + size > (S32)mHeaderDataFile.getSize())
+	{
+		return 0;
+	}
+	const Entry* record = getEntryRecord(idx);
+	if (record->mID != id || record->mImageSize < 0)
+	{
+		// The entry was removed or recycled since it was looked up
+		return 0;
+	}
+	memcpy(data, mHeaderDataFile.getData() + file_offset, size);
+	return size;
+}
+
+// Writes a whole record, padding data with 0 if it is smaller than one.
+S32 LLTextureCache::writeHeaderData(const LLUUID& id, S32 idx, const U8* data, S32 size)
+{
+	S32 file_offset = idx * TEXTURE_CACHE_ENTRY_SIZE;
+	S32 copy_size = llmin(size, TEXTURE_CACHE_ENTRY_SIZE);
+	LLMutexLock lock(getEntryMutex(id));
+	if (!mHeaderDataFile.isMapped())
+	{
+		if (copy_size < TEXTURE_CACHE_ENTRY_SIZE)
 		{
-			S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-			llassert_always(bytes_written == sizeof(Entry));
+			U8* pad_buffer = new U8[TEXTURE_CACHE_ENTRY_SIZE];
+			memset(pad_buffer, 0, TEXTURE_CACHE_ENTRY_SIZE);
+			memcpy(pad_buffer, data, copy_size);
+			S32 bytes_written = LLAPRFile::writeEx(mHeaderDataFileName, pad_buffer, file_offset, TEXTURE_CACHE_ENTRY_SIZE);
+			delete[] pad_buffer;
+			return bytes_written;
 		}
-		mHeaderEntriesMaxWriteIdx = llmax(mHeaderEntriesMaxWriteIdx, num_entries-1);
-		closeHeaderEntriesFile();
+		return LLAPRFile::writeEx(mHeaderDataFileName, (void*)data, file_offset, TEXTURE_CACHE_ENTRY_SIZE);
+	}
+	if (file_offset + TEXTURE_CACHE_ENTRY_SIZE > (S32)mHeaderDataFile.getSize())
+	{
+		return 0;
+	}
+	const Entry* record = getEntryRecord(idx);
+	if (record->mID != id || record->mImageSize < 0)
+	{
+		return 0;
+	}
+	U8* dest = mHeaderDataFile.getData() + file_offset;
+	memcpy(dest, data, copy_size);
+	if (copy_size < TEXTURE_CACHE_ENTRY_SIZE)
+	{
+		memset(dest + copy_size, 0, TEXTURE_CACHE_ENTRY_SIZE - copy_size);
 	}
+	return TEXTURE_CACHE_ENTRY_SIZE;
 }
 
 //----------------------------------------------------------------------------
@@ -1163,7 +1452,7 @@ void LLTextureCache::readHeaderCache()
 	else
 	{
 		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
+		U32 num_entries = readEntries(entries);
 		if (num_entries)
 		{
 			U32 empty_entries = 0;
@@ -1239,7 +1528,7 @@ void LLTextureCache::readHeaderCache()
 				llassert_always(new_entries.size() <= sCacheMaxEntries);
 				mHeaderEntriesInfo.mEntries = new_entries.size();
 				writeEntriesHeader();
-				writeEntriesAndClose(new_entries);
+				writeEntries(new_entries);
 				mHeaderMutex.unlock(); // unlock the mutex before calling again
 				readHeaderCache(); // repeat with new entries file
 				return;
@@ -1265,7 +1554,17 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 		for (S32 i=0; i<16; i++)
 		{
 			std::string dirname = mTexturesDirName + delem + subdirs[i];
-			gDirUtilp->deleteFilesInDir(dirname,mask);
+			for (S32 j=0; j<16; j++)
+			{
+				std::string subdirname = dirname + delem + subdirs[j];
+				gDirUtilp->deleteFilesInDir(subdirname,mask);
+				if (purge_directories)
+				{
+					LLFile::rmdir(subdirname);
+				}
+			}
+			// Bodies from caches that predate the two level layout
+			gDirUtilp->deleteFilesInDir(dirname, delem + "*.texture");
 			if (purge_directories)
 			{
 				LLFile::rmdir(dirname);
@@ -1307,10 +1606,10 @@ void LLTextureCache::purgeTextures(bool validate)
 
 	// Read the entries list
 	std::vector<Entry> entries;
-	U32 num_entries = openAndReadEntries(entries);
+	U32 num_entries = readEntries(entries);
 	if (!num_entries)
 	{
-		writeEntriesAndClose(entries);
+		writeEntries(entries);
 		return; // nothing to purge
 	}
 	
@@ -1358,8 +1657,9 @@ void LLTextureCache::purgeTextures(bool validate)
 		else if (validate)
 		{
 			// make sure file exists and is the correct size
+			// (all of them if the last session didn't close the cache cleanly)
 			S32 uuididx = entries[idx].mID.mData[0];
-			if (uuididx == validate_idx)
+			if (mRecoverEntries || uuididx == validate_idx)
 			{
  				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entries[idx].mBodySize << LL_ENDL;
 				S32 bodysize = LLAPRFile::size(filename);
@@ -1398,7 +1698,7 @@ void LLTextureCache::purgeTextures(bool validate)
 
 	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
 
-	writeEntriesAndClose(entries);
+	writeEntries(entries);
 	
 	if (!mThreaded)
 	{
@@ -1413,6 +1713,81 @@ void LLTextureCache::purgeTextures(bool validate)
 			<< llendl;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Called from the evictor (WORKER THREAD)
+
+// Oldest texture bodies first, enough of them to bring the cache
+// TEXTURE_CACHE_PURGE_AMOUNT under its limit
+void LLTextureCache::getEvictionList(std::vector<LLUUID>& ids)
+{
+	LLMutexLock lock(&mHeaderMutex);
+	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
+	S64 excess = mTexturesSizeTotal - purged_cache_size;
+	if (excess <= 0 || !mEntriesTable)
+	{
+		return;
+	}
+
+	// Note: mTime can be touched by getHeaderCacheEntry() while we read it,
+	//  at worst that changes the eviction order a little.
+	typedef std::pair<U32, std::pair<LLUUID, S32> > time_id_size_t;
+	std::vector<time_id_size_t> lru;
+	lru.reserve(mTexturesSizeMap.size());
+	for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
+		 iter1 != mTexturesSizeMap.end(); ++iter1)
+	{
+		id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
+		if (iter1->second > 0 && iter2 != mHeaderIDMap.end())
+		{
+			U32 time = getEntryRecord(iter2->second)->mTime;
+			lru.push_back(std::make_pair(time, std::make_pair(iter1->first, iter1->second)));
+		}
+	}
+	std::sort(lru.begin(), lru.end());
+
+	for (std::vector<time_id_size_t>::iterator iter = lru.begin();
+		 iter != lru.end() && excess > 0; ++iter)
+	{
+		ids.push_back(iter->second.first);
+		excess -= iter->second.second;
+	}
+	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Evicting up to " << ids.size() << " bodies" << LL_ENDL;
+}
+
+// Removes the body of a texture but keeps its header entry. Entries touched
+// after select_time are skipped. Returns false once the cache is back under
+// the eviction target.
+bool LLTextureCache::evictTextureBody(const LLUUID& id, U32 select_time)
+{
+	LLMutexLock lock(&mHeaderMutex);
+	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
+	if (mTexturesSizeTotal <= purged_cache_size)
+	{
+		return false;
+	}
+	size_map_t::iterator iter1 = mTexturesSizeMap.find(id);
+	id_map_t::iterator iter2 = mHeaderIDMap.find(id);
+	if (iter1 == mTexturesSizeMap.end() || iter2 == mHeaderIDMap.end())
+	{
+		return true; // removed since the list was built
+	}
+	{
+		LLMutexLock entry_lock(getEntryMutex(id));
+		Entry* entry = getEntryRecord(iter2->second);
+		if (entry->mTime > select_time)
+		{
+			return true; // used again since the list was built
+		}
+		entry->mBodySize = 0;
+	}
+	mTexturesSizeTotal -= iter1->second;
+	mTexturesSizeMap.erase(iter1);
+	// Removed with mHeaderMutex held so that a concurrent write of this
+	//  texture can't end up with an entry pointing at a deleted body
+	LLAPRFile::remove(getTextureFileName(id));
+	return true;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 // call lockWorkers() first!
@@ -1444,13 +1819,30 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 // Reads imagesize from the header, updates timestamp
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, S32& imagesize)
 {
-	LLMutexLock lock(&mHeaderMutex);
-	Entry entry;
-	S32 idx = openAndReadEntry(id, entry, false);
-	if (idx >= 0)
+	S32 idx = -1;
 	{
-		imagesize = entry.mImageSize;
-		writeEntryAndClose(idx, entry); // updates time
+		LLMutexLock lock(&mHeaderMutex);
+		id_map_t::iterator iter = mHeaderIDMap.find(id);
+		if (iter == mHeaderIDMap.end() || !mEntriesTable)
+		{
+			return -1;
+		}
+		idx = iter->second;
+		mLRU.erase(id);
+	}
+
+	// Only the entry's own lock is needed to read it and touch its time
+	LLMutexLock lock(getEntryMutex(id));
+	Entry* entry = getEntryRecord(idx);
+	if (entry->mID != id || entry->mImageSize < 0)
+	{
+		// Removed or recycled since the lookup
+		return -1;
+	}
+	imagesize = entry->mImageSize;
+	if (!mReadOnly)
+	{
+		entry->mTime = time(NULL);
 	}
 	return idx;
 }
@@ -1461,11 +1853,11 @@ S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, S32 imagesize)
 	mHeaderMutex.lock();
 	llassert_always(imagesize >= 0);
 	Entry entry;
-	S32 idx = openAndReadEntry(id, entry, true);
+	S32 idx = readEntry(id, entry, true);
 	if (idx >= 0)
 	{
 		entry.mImageSize = imagesize;
-		writeEntryAndClose(idx, entry);
+		writeEntry(idx, entry);
 		mHeaderMutex.unlock();
 	}
 	else // retry
@@ -1556,14 +1948,6 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id, U32 prio
 		delete responder;
 		return LLWorkerThread::nullHandle();
 	}
-	if (mDoPurge)
-	{
-		// NOTE: This may cause an occasional hiccup,
-		//  but it really needs to be done on the control thread
-		//  (i.e. here)		
-		purgeTextures(false);
-		mDoPurge = FALSE;
-	}
 	LLMutexLock lock(&mWorkersMutex);
 	LLTextureCacheWorker* worker = new LLTextureCacheRemoteWorker(this, priority, id,
 																  data, datasize, 0,
@@ -1616,12 +2000,12 @@ bool LLTextureCache::removeHeaderCacheEntry(const LLUUID& id)
 	if (!mReadOnly)
 	{
 		Entry entry;
-		S32 idx = openAndReadEntry(id, entry, false);
+		S32 idx = readEntry(id, entry, false);
 		if (idx >= 0)
 		{
 			entry.mImageSize = -1;
 			entry.mBodySize = 0;
-			writeEntryAndClose(idx, entry);
+			writeEntry(idx, entry);
 			mFreeList.insert(idx);
 			mHeaderIDMap.erase(id);
 			mTexturesSizeMap.erase(id);
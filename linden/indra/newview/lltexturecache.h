@@ -34,6 +34,8 @@
 #define LL_LLTEXTURECACHE_H
 
 #include "lldir.h"
+#include "llframetimer.h"
+#include "llmappedfile.h"
 #include "llstl.h"
 #include "llstring.h"
 #include "lluuid.h"
@@ -41,20 +43,23 @@
 #include "llworkerthread.h"
 
 class LLTextureCacheWorker;
+class LLTextureCacheEvictor;
 
 class LLTextureCache : public LLWorkerThread
 {
 	friend class LLTextureCacheWorker;
 	friend class LLTextureCacheRemoteWorker;
 	friend class LLTextureCacheLocalFileWorker;
+	friend class LLTextureCacheEvictor;
 
 private:
 	// Entries
 	struct EntriesInfo
 	{
-		EntriesInfo() : mVersion(0.f), mEntries(0) {}
+		EntriesInfo() : mVersion(0.f), mEntries(0), mDirty(0) {}
 		F32 mVersion;
 		U32 mEntries;
+		U32 mDirty; // set while a session has the entries open for writing
 	};
 	struct Entry
 	{
@@ -138,31 +143,64 @@ protected:
 	std::string getLocalFileName(const LLUUID& id);
 	std::string getTextureFileName(const LLUUID& id);
 	void addCompleted(Responder* responder, bool success);
+	// Accessed by LLTextureCacheEvictor
+	void getEvictionList(std::vector<LLUUID>& ids);
+	bool evictTextureBody(const LLUUID& id, U32 select_time);
 	
 private:
 	void setDirNames(ELLPath location);
 	void readHeaderCache();
 	void purgeAllTextures(bool purge_directories);
 	void purgeTextures(bool validate);
-	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
-	void closeHeaderEntriesFile();
+	void openHeaderFiles();
+	void closeHeaderFiles();
+	size_t getHeaderDataSize(U32 entries);
+	void growHeaderData(U32 entries);
+	void flushHeaderFiles(bool sync);
 	void readEntriesHeader();
 	void writeEntriesHeader();
-	S32 openAndReadEntry(const LLUUID& id, Entry& entry, bool create);
-	void writeEntryAndClose(S32 idx, Entry& entry);
-	U32 openAndReadEntries(std::vector<Entry>& entries);
-	void writeEntriesAndClose(const std::vector<Entry>& entries);
+	S32 readEntry(const LLUUID& id, Entry& entry, bool create);
+	void writeEntry(S32 idx, Entry& entry);
+	U32 readEntries(std::vector<Entry>& entries);
+	void writeEntries(const std::vector<Entry>& entries);
 	S32 getHeaderCacheEntry(const LLUUID& id, S32& imagesize);
 	S32 setHeaderCacheEntry(const LLUUID& id, S32 imagesize);
 	bool removeHeaderCacheEntry(const LLUUID& id);
 	void removeFromCacheLocked(const LLUUID& id);
+	S32 readHeaderData(const LLUUID& id, S32 idx, S32 offset, U8* data, S32 size);
+	S32 writeHeaderData(const LLUUID& id, S32 idx, const U8* data, S32 size);
+	Entry* getEntryRecord(S32 idx) { return (Entry*)(mEntriesTable + sizeof(EntriesInfo)) + idx; }
+
+	// Entry records are guarded by a mutex picked by UUID, so workers touching
+	// different textures don't serialize on mHeaderMutex.
+	LLMutex* getEntryMutex(const LLUUID& id) { return &mEntryMutexes[id.mData[0] % ENTRY_MUTEX_COUNT]; }
+	void lockEntries(const LLUUID& id1, const LLUUID& id2);
+	void unlockEntries(const LLUUID& id1, const LLUUID& id2);
+	void lockAllEntries();
+	void unlockAllEntries();
 	
 private:
 	// Internal
 	LLMutex mWorkersMutex;
 	LLMutex mHeaderMutex;
 	LLMutex mListMutex;
-	LLAPRFile* mHeaderAPRFile;
+
+	enum { ENTRY_MUTEX_COUNT = 16 };
+	LLMutex mEntryMutexes[ENTRY_MUTEX_COUNT];
+
+	// texture.entries is mapped when possible, otherwise it is kept in
+	// mEntriesBuffer and written back on close. mEntriesTable points to
+	// whichever one is in use.
+	LLMappedFile mEntriesFile;
+	U8* mEntriesBuffer;
+	U8* mEntriesTable;
+	U32 mEntriesCapacity;
+	// texture.cache is mapped when possible, otherwise records are read
+	// and written through LLAPRFile. The file and the mapping grow with
+	// the number of entries rather than being sized for sCacheMaxEntries.
+	LLMappedFile mHeaderDataFile;
+	LLFrameTimer mFlushTimer;
+	bool mRecoverEntries; // previous session did not close the entries cleanly
 	
 	typedef std::map<handle_t, LLTextureCacheWorker*> handle_map_t;
 	handle_map_t mReaders;
@@ -191,6 +229,7 @@ private:
 	size_map_t mTexturesSizeMap;
 	S64 mTexturesSizeTotal;
 	LLAtomic32<BOOL> mDoPurge;
+	LLTextureCacheEvictor* mEvictor; // MAIN THREAD only, started and reaped by update()
 
 	// Statics
 	static F32 sHeaderCacheVersion;
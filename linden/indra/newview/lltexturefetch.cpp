@@ -45,6 +45,7 @@
 #include "llhttpstatuscodes.h"
 #include "llimage.h"
 #include "llimageworker.h"
+#include "lltexturefetchreplay.h"
 #include "llworkerthread.h"
 
 #include "llagent.h"
@@ -172,6 +173,8 @@ public:
 	void setCanUseHTTP(bool can_use_http) {mCanUseHTTP = can_use_http;}
 	bool getCanUseHTTP()const {return mCanUseHTTP ;}
 
+	void stopStats(); // called from removeRequest() (MAIN THREAD)
+
 protected:
 	LLTextureFetchWorker(LLTextureFetch* fetcher, const LLUUID& id, const LLHost& host,
 						 F32 priority, S32 discard, S32 size);
@@ -184,6 +187,7 @@ private:
 
 	void resetFormattedData();
 	
+	void setState(S32 new_state);
 	void setImagePriority(F32 priority);
 	void setDesiredDiscard(S32 discard, S32 size);
 	bool insertPacket(S32 index, U8* data, S32 size);
@@ -287,6 +291,10 @@ private:
 	S32 mLastPacket;
 	U16 mTotalPackets;
 	U8 mImageCodec;
+
+	// Time spent in mState, for LLTextureFetch::mStats
+	LLTimer mStateTimer;
+	bool mTrackStats;
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -382,6 +390,29 @@ const char* LLTextureFetchWorker::sStateDescs[] = {
 	"DONE",
 };
 
+// call lockWorkMutex() first!
+void LLTextureFetchWorker::setState(S32 new_state)
+{
+	if (mTrackStats)
+	{
+		mFetcher->mStats.leaveState(mState, mStateTimer.getElapsedTimeAndResetF64());
+		mFetcher->mStats.enterState(new_state);
+	}
+	mState = (e_state)new_state;
+}
+
+// The worker can outlive the fetcher (it is deleted from ~LLWorkerThread),
+// so it stops reporting once it has been removed from the request map.
+void LLTextureFetchWorker::stopStats()
+{
+	LLMutexLock lock(&mWorkMutex);
+	if (mTrackStats)
+	{
+		mFetcher->mStats.leaveState(mState, mStateTimer.getElapsedTimeAndResetF64());
+		mTrackStats = false;
+	}
+}
+
 // called from MAIN THREAD
 
 LLTextureFetchWorker::LLTextureFetchWorker(LLTextureFetch* fetcher,
@@ -431,9 +462,11 @@ LLTextureFetchWorker::LLTextureFetchWorker(LLTextureFetch* fetcher,
 	  mFirstPacket(0),
 	  mLastPacket(-1),
 	  mTotalPackets(0),
-	  mImageCodec(IMG_CODEC_INVALID)
+	  mImageCodec(IMG_CODEC_INVALID),
+	  mTrackStats(true)
 {
 	mCanUseNET = mUrl.empty() ;
+	mFetcher->mStats.enterState(mState);
 
 	calcWorkPriority();
 	mType = host.isOk() ? LLImageBase::TYPE_AVATAR_BAKE : LLImageBase::TYPE_NORMAL;
@@ -547,7 +580,7 @@ void LLTextureFetchWorker::setDesiredDiscard(S32 discard, S32 size)
 	}
 	if ((prioritize && mState == INIT) || mState == DONE)
 	{
-		mState = INIT;
+		setState(INIT);
 		U32 work_priority = mWorkPriority | LLWorkerThread::PRIORITY_HIGH;
 		setPriority(work_priority);
 	}
@@ -644,7 +677,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		clearPackets(); // TODO: Shouldn't be necessary
 		mCacheReadHandle = LLTextureCache::nullHandle();
 		mCacheWriteHandle = LLTextureCache::nullHandle();
-		mState = LOAD_FROM_TEXTURE_CACHE;
+		setState(LOAD_FROM_TEXTURE_CACHE);
 		// fall through
 	}
 
@@ -657,7 +690,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			S32 size = mDesiredSize - offset;
 			if (size <= 0)
 			{
-				mState = CACHE_POST;
+				setState(CACHE_POST);
 				return false;
 			}
 			mFileSize = 0;
@@ -686,12 +719,12 @@ bool LLTextureFetchWorker::doWork(S32 param)
 					llwarns << "Unknown URL Type: " << mUrl << llendl;
 				}
 				setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
-				mState = SEND_HTTP_REQ;
+				setState(SEND_HTTP_REQ);
 			}
 			else
 			{
 				setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
-				mState = LOAD_FROM_NETWORK;
+				setState(LOAD_FROM_NETWORK);
 			}
 		}
 
@@ -701,7 +734,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			if (mFetcher->mTextureCache->readComplete(mCacheReadHandle, false))
 			{
 				mCacheReadHandle = LLTextureCache::nullHandle();
-				mState = CACHE_POST;
+				setState(CACHE_POST);
 				// fall through
 			}
 			else
@@ -725,7 +758,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			// we have enough data, decode it
 			llassert_always(mFormattedImage->getDataSize() > 0);
 			mLoadedDiscard = mDesiredDiscard;
-			mState = DECODE_IMAGE;
+			setState(DECODE_IMAGE);
 			mWriteToCacheState = NOT_WRITE ;
 			LL_DEBUGS("Texture") << mID << ": Cached. Bytes: " << mFormattedImage->getDataSize()
 								 << " Size: " << llformat("%dx%d",mFormattedImage->getWidth(),mFormattedImage->getHeight())
@@ -742,7 +775,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			// need more data
 			else
 			{
-				mState = LOAD_FROM_NETWORK;	// CACHE_POST --> LOAD_FROM_NETWORK, or SEND_HTTP_REQ see below.
+				setState(LOAD_FROM_NETWORK);	// CACHE_POST --> LOAD_FROM_NETWORK, or SEND_HTTP_REQ see below.
 				// This is true because mSentRequest is set to UNSENT in INIT and if we get here we went through
 				// the states INIT --> LOAD_FROM_TEXTURE_CACHE --> CACHE_POST. Therefore either
 				// mFetcher->addToNetworkQueue(this) is called below, or mState is set to SEND_HTTP_REQ.
@@ -789,7 +822,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		}
 		if (mCanUseHTTP && !mUrl.empty())
 		{
-			mState = LLTextureFetchWorker::SEND_HTTP_REQ;
+			setState(LLTextureFetchWorker::SEND_HTTP_REQ);
 			setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
 			if(mWriteToCacheState != NOT_WRITE)
 			{
@@ -832,7 +865,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				return true; // failed
 			}
 			setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
-			mState = DECODE_IMAGE;
+			setState(DECODE_IMAGE);
 			mWriteToCacheState = SHOULD_WRITE ;
 		}
 		else
@@ -846,14 +879,13 @@ bool LLTextureFetchWorker::doWork(S32 param)
 	{
 		if(mCanUseHTTP)
 		{
-			const S32 HTTP_QUEUE_MAX_SIZE = 8;
 			// *TODO: Integrate this with llviewerthrottle
 			// Note: LLViewerThrottle uses dynamic throttling which makes sense for UDP,
 			// but probably not for Textures.
 			// Set the throttle to the entire bandwidth, assuming UDP packets will get priority
 			// when they are needed
 			F32 max_bandwidth = mFetcher->mMaxBandwidth;
-			if ((mFetcher->getNumHTTPRequests() >= HTTP_QUEUE_MAX_SIZE) ||
+			if ((mFetcher->getNumHTTPRequests() >= mFetcher->mHTTPMaxRequests) ||
 				(mFetcher->getTextureBandwidth() > max_bandwidth))
 			{
 				// Make normal priority and return (i.e. wait until there is room in the queue)
@@ -869,14 +901,28 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				{
 					// We already have all the data, just decode it
 					mLoadedDiscard = mFormattedImage->getDiscardLevel();
-					mState = DECODE_IMAGE;
+					setState(DECODE_IMAGE);
 					return false;
 				}
 			}
 
+			if (cur_size >= mDesiredSize)
+			{
+				// An earlier request was widened to cover this one, decode it
+				mLoadedDiscard = mDesiredDiscard;
+				setState(DECODE_IMAGE);
+				return false;
+			}
+
 			mRequestedSize = mDesiredSize;
 			mRequestedDiscard = mDesiredDiscard;
 			mRequestedSize -= cur_size;
+			if (mRequestedSize < mFetcher->mHTTPMinRange && mDesiredSize < MAX_IMAGE_DATA_SIZE)
+			{
+				// Fetch the following discard levels in the same round trip
+				// rather than one small range request each
+				mRequestedSize = llmin(mFetcher->mHTTPMinRange, MAX_IMAGE_DATA_SIZE - cur_size);
+			}
 // 			F32 priority = mImagePriority / (F32)LLViewerImage::maxDecodePriority(); // 0-1
 			S32 offset = cur_size;
 			mBufferSize = cur_size; // This will get modified by callbackHttpGet()
@@ -893,7 +939,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 						<< " Bandwidth(kbps): " << mFetcher->getTextureBandwidth() << "/" << max_bandwidth
 						<< LL_ENDL;
 				setPriority(LLWorkerThread::PRIORITY_LOW | mWorkPriority);
-				mState = WAIT_HTTP_REQ;	
+				setState(WAIT_HTTP_REQ);	
 
 				mFetcher->addToHTTPQueue(mID);
 				// Will call callbackHttpGet when curl request completes
@@ -929,7 +975,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 					//roll back to try UDP
 					if(mCanUseNET)
 					{
-						mState = INIT ;
+						setState(INIT);
 						mCanUseHTTP = false ;
 						setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
 						return false ;
@@ -967,7 +1013,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 					{
 						// Use available data
 						mLoadedDiscard = mFormattedImage->getDiscardLevel();
-						mState = DECODE_IMAGE;
+						setState(DECODE_IMAGE);
 						return false;
 					}
 					else
@@ -975,7 +1021,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 						//roll back to try UDP
 						if(mCanUseNET)
 						{
-							mState = INIT ;
+							setState(INIT);
 							mCanUseHTTP = false ;
 							setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
 							return false ;
@@ -990,7 +1036,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				}
 				else
 				{
-					mState = SEND_HTTP_REQ;
+					setState(SEND_HTTP_REQ);
 					return false; // retry
 				}
 			}
@@ -1029,7 +1075,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			mBuffer = NULL;
 			mBufferSize = 0;
 			mLoadedDiscard = mRequestedDiscard;
-			mState = DECODE_IMAGE;
+			setState(DECODE_IMAGE);
 			if(mWriteToCacheState != NOT_WRITE)
 			{
 				mWriteToCacheState = SHOULD_WRITE ;
@@ -1054,7 +1100,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		S32 discard = mHaveAllData ? 0 : mLoadedDiscard;
 		U32 image_priority = LLWorkerThread::PRIORITY_NORMAL | mWorkPriority;
 		mDecoded  = FALSE;
-		mState = DECODE_IMAGE_UPDATE;
+		setState(DECODE_IMAGE_UPDATE);
 		mDecodeHandle = mFetcher->mImageDecodeThread->decodeImage(mFormattedImage, image_priority, discard, mNeedsAux,
 																  new DecodeResponder(mFetcher, mID, this));
 		// fall though
@@ -1074,19 +1120,19 @@ bool LLTextureFetchWorker::doWork(S32 param)
 					mFormattedImage = NULL;
 					++mRetryAttempt;
 					setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
-					mState = INIT;
+					setState(INIT);
 					return false;
 				}
 				else
 				{
 // 					llwarns << "UNABLE TO LOAD TEXTURE: " << mID << " RETRIES: " << mRetryAttempt << llendl;
-					mState = DONE; // failed
+					setState(DONE); // failed
 				}
 			}
 			else
 			{
 				setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
-				mState = WRITE_TO_CACHE;
+				setState(WRITE_TO_CACHE);
 			}
 			// fall through
 		}
@@ -1102,7 +1148,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		{
 			// If we're in a local cache or we didn't actually receive any new data,
 			// or we failed to load anything, skip
-			mState = DONE;
+			setState(DONE);
 			return false;
 		}
 		S32 datasize = mFormattedImage->getDataSize();
@@ -1121,7 +1167,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		setPriority(LLWorkerThread::PRIORITY_LOW | mWorkPriority); // Set priority first since Responder may change it
 		U32 cache_priority = mWorkPriority;
 		mWritten = FALSE;
-		mState = WAIT_ON_WRITE;
+		setState(WAIT_ON_WRITE);
 		CacheWriteResponder* responder = new CacheWriteResponder(mFetcher, mID);
 		mCacheWriteHandle = mFetcher->mTextureCache->writeToCache(mID, cache_priority,
 																  mFormattedImage->getData(), datasize,
@@ -1133,7 +1179,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 	{
 		if (writeToCacheComplete())
 		{
-			mState = DONE;
+			setState(DONE);
 			// fall through
 		}
 		else
@@ -1154,7 +1200,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		if (mDecodedDiscard >= 0 && mDesiredDiscard < mDecodedDiscard)
 		{
 			// More data was requested, return to INIT
-			mState = INIT;
+			setState(INIT);
 			setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
 			return false;
 		}
@@ -1546,14 +1592,44 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, LLImageDecodeThread* image
 	  mTextureCache(cache),
 	  mImageDecodeThread(imagedecodethread),
 	  mTextureBandwidth(0),
-	  mCurlGetRequest(NULL)
+	  mCurlGetRequest(NULL),
+	  mStats(LLTextureFetchWorker::DONE + 1, LLTextureFetchWorker::sStateDescs),
+	  mRecorder(NULL),
+	  mReplay(NULL)
 {
 	mMaxBandwidth = gSavedSettings.getF32("ThrottleBandwidthKBPS");
+	mHTTPMaxRequests = llmax(gSavedSettings.getS32("TextureFetchHTTPMaxRequests"), 1);
+	mHTTPMinRange = llmax(gSavedSettings.getS32("TextureFetchHTTPMinRange"), 0);
+	mHTTPPipelining = gSavedSettings.getBOOL("TextureFetchHTTPPipelining");
 	mTextureInfo.setUpLogging(gSavedSettings.getBOOL("LogTextureDownloadsToViewerLog"), gSavedSettings.getBOOL("LogTextureDownloadsToSimulator"), gSavedSettings.getU32("TextureLoggingThreshold"));
+
+	std::string replay_file = gSavedSettings.getString("TextureFetchReplayFile");
+	std::string record_file = gSavedSettings.getString("TextureFetchRecordFile");
+	if (!replay_file.empty())
+	{
+		mReplay = new LLTextureFetchReplay(replay_file, gSavedSettings.getString("TextureFetchReplayURL"));
+		if (!mReplay->isValid())
+		{
+			delete mReplay;
+			mReplay = NULL;
+		}
+	}
+	else if (!record_file.empty())
+	{
+		mRecorder = new LLTextureFetchRecorder(record_file);
+		if (!mRecorder->isOpen())
+		{
+			delete mRecorder;
+			mRecorder = NULL;
+		}
+	}
 }
 
 LLTextureFetch::~LLTextureFetch()
 {
+	mStats.dump();
+	delete mRecorder;
+	delete mReplay;
 	// ~LLQueuedThread() called here
 }
 
@@ -1629,7 +1705,7 @@ bool LLTextureFetch::createRequest(const std::string& url, const LLUUID& id, con
 			{
 			  	removeFromNetworkQueue(worker, true);
 			}
-			worker->mState = LLTextureFetchWorker::INIT;
+			worker->setState(LLTextureFetchWorker::INIT);
 			worker->unlockWorkMutex();
 			worker->addWork(0, LLWorkerThread::PRIORITY_HIGH | worker->mWorkPriority);
 		}
@@ -1641,6 +1717,10 @@ bool LLTextureFetch::createRequest(const std::string& url, const LLUUID& id, con
 	}
 	worker->mActiveCount++;
 	worker->mNeedsAux = needs_aux;
+	if (mRecorder)
+	{
+		mRecorder->recordCreate(url, id, host, priority, w, h, c, desired_discard, needs_aux, can_use_http);
+	}
 // 	llinfos << "REQUESTED: " << id << " Discard: " << desired_discard << llendl;
 	return true;
 }
@@ -1652,6 +1732,10 @@ void LLTextureFetch::deleteRequest(const LLUUID& id, bool cancel)
 	if (worker)
 	{		
 		removeRequest(worker, cancel);
+		if (mRecorder)
+		{
+			mRecorder->recordDelete(id, cancel);
+		}
 	}
 }
 
@@ -1697,6 +1781,7 @@ void LLTextureFetch::removeRequest(LLTextureFetchWorker* worker, bool cancel)
 	removeFromNetworkQueue(worker, cancel);
 	llassert_always(!(worker->getFlags(LLWorkerClass::WCF_DELETE_REQUESTED))) ;
 
+	worker->stopStats();
 	worker->scheduleDelete();	
 }
 
@@ -1773,6 +1858,10 @@ bool LLTextureFetch::updateRequestPriority(const LLUUID& id, F32 priority)
 		worker->lockWorkMutex();
 		worker->setImagePriority(priority);
 		worker->unlockWorkMutex();
+		if (mRecorder)
+		{
+			mRecorder->recordPriority(id, priority);
+		}
 		res = true;
 	}
 	return res;
@@ -1794,6 +1883,11 @@ S32 LLTextureFetch::update(U32 max_time_ms)
 	{
 		sendRequestListToSimulators();
 	}
+
+	if (mReplay && !mReplay->isDone())
+	{
+		mReplay->update(this);
+	}
 	
 	return res;
 }
@@ -1803,6 +1897,12 @@ void LLTextureFetch::startThread()
 {
 	// Construct mCurlGetRequest from Worker Thread
 	mCurlGetRequest = new LLCurlRequest();
+	if (getThreadPool())
+	{
+		// Pooled queues start on the main thread and run on any pool thread
+		mCurlGetRequest->detachThread();
+	}
+	mCurlGetRequest->setConnectionOptions(mHTTPPipelining, mHTTPMaxRequests);
 }
 
 // WORKER THREAD
@@ -1820,12 +1920,11 @@ void LLTextureFetch::threadedUpdate()
 	
 	// Limit update frequency
 	const F32 PROCESS_TIME = 0.05f; 
-	static LLFrameTimer process_timer;
-	if (process_timer.getElapsedTimeF32() < PROCESS_TIME)
+	if (mProcessTimer.getElapsedTimeF32() < PROCESS_TIME)
 	{
 		return;
 	}
-	process_timer.reset();
+	mProcessTimer.reset();
 	
 	// Update Curl on same thread as mCurlGetRequest was constructed
 	S32 processed = mCurlGetRequest->process();
@@ -2136,7 +2235,7 @@ bool LLTextureFetch::receiveImageHeader(const LLHost& host, const LLUUID& id, U8
 		llassert_always(data_size == FIRST_PACKET_SIZE || data_size == worker->mFileSize);
 		res = worker->insertPacket(0, data, data_size);
 		worker->setPriority(LLWorkerThread::PRIORITY_HIGH | worker->mWorkPriority);
-		worker->mState = LLTextureFetchWorker::LOAD_FROM_SIMULATOR;
+		worker->setState(LLTextureFetchWorker::LOAD_FROM_SIMULATOR);
 	}
 	worker->unlockWorkMutex();
 	return res;
@@ -2181,7 +2280,7 @@ bool LLTextureFetch::receiveImagePacket(const LLHost& host, const LLUUID& id, U1
 		(worker->mState == LLTextureFetchWorker::LOAD_FROM_NETWORK))
 	{
 		worker->setPriority(LLWorkerThread::PRIORITY_HIGH | worker->mWorkPriority);
-		worker->mState = LLTextureFetchWorker::LOAD_FROM_SIMULATOR;
+		worker->setState(LLTextureFetchWorker::LOAD_FROM_SIMULATOR);
 	}
 	else
 	{
@@ -2269,4 +2368,8 @@ void LLTextureFetch::dump()
 				<< " STATE: " << worker->sStateDescs[worker->mState]
 				<< llendl;
 	}
+	mStats.dump();
+	llinfos << "HTTP requests: " << LLCurl::getRequestCount()
+			<< " new connections: " << LLCurl::getConnectCount()
+			<< " reused: " << LLCurl::getReuseCount() << llendl;
 }
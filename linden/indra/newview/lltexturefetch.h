@@ -34,10 +34,12 @@
 #define LL_LLTEXTUREFETCH_H
 
 #include "lldir.h"
+#include "llframetimer.h"
 #include "llimage.h"
 #include "lluuid.h"
 #include "llworkerthread.h"
 #include "llcurl.h"
+#include "lltexturefetchstats.h"
 #include "lltextureinfo.h"
 
 class LLViewerImage;
@@ -46,6 +48,8 @@ class HTTPGetResponder;
 class LLTextureCache;
 class LLImageDecodeThread;
 class LLHost;
+class LLTextureFetchRecorder;
+class LLTextureFetchReplay;
 
 // Interface class
 class LLTextureFetch : public LLWorkerThread
@@ -85,6 +89,7 @@ public:
 	LLTextureFetchWorker* getWorker(const LLUUID& id);
 
 	LLTextureInfo* getTextureInfo() { return &mTextureInfo; }
+	LLTextureFetchStats& getStats() { return mStats; }
 	
 protected:
 	void addToNetworkQueue(LLTextureFetchWorker* worker);
@@ -115,6 +120,7 @@ private:
 	LLTextureCache* mTextureCache;
 	LLImageDecodeThread* mImageDecodeThread;
 	LLCurlRequest* mCurlGetRequest;
+	LLFrameTimer mProcessTimer; // limits how often threadedUpdate() runs curl
 	
 	// Map of all requests by UUID
 	typedef std::map<LLUUID,LLTextureFetchWorker*> map_t;
@@ -128,7 +134,15 @@ private:
 	cancel_queue_t mCancelQueue;
 	F32 mTextureBandwidth;
 	F32 mMaxBandwidth;
+	S32 mHTTPMaxRequests; // concurrent HTTP requests (and connections)
+	S32 mHTTPMinRange; // smallest range requested, in bytes
+	bool mHTTPPipelining;
 	LLTextureInfo mTextureInfo;
+
+	// Per state worker timing, see LLTextureFetchWorker::setState()
+	LLTextureFetchStats mStats;
+	LLTextureFetchRecorder* mRecorder;
+	LLTextureFetchReplay* mReplay;
 };
 
 #endif // LL_LLTEXTUREFETCH_H
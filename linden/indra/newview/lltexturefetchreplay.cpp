@@ -0,0 +1,284 @@
+/** 
+ * @file lltexturefetchreplay.cpp
+ * @brief Recording and replay of texture fetch request streams
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturefetchreplay.h"
+
+#include "lldir.h"
+#include "llimage.h"
+#include "llsdserialize.h"
+#include "lltexturefetch.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// LLTextureFetchRecorder
+
+LLTextureFetchRecorder::LLTextureFetchRecorder(const std::string& filename)
+{
+	mFile.open(filename, std::ios::out | std::ios::trunc);
+	if (mFile.is_open())
+	{
+		llinfos << "Recording texture fetch requests to " << filename << llendl;
+	}
+	else
+	{
+		llwarns << "Unable to record texture fetch requests to " << filename << llendl;
+	}
+}
+
+LLTextureFetchRecorder::~LLTextureFetchRecorder()
+{
+	mFile.close();
+}
+
+void LLTextureFetchRecorder::write(LLSD& event)
+{
+	event["t"] = mTimer.getElapsedTimeF64();
+	LLSDSerialize::toNotation(event, mFile);
+	mFile << "\n";
+}
+
+void LLTextureFetchRecorder::recordCreate(const std::string& url, const LLUUID& id, const LLHost& host, F32 priority,
+										  S32 w, S32 h, S32 c, S32 discard, bool needs_aux, bool can_use_http)
+{
+	LLSD event;
+	event["op"] = "create";
+	event["id"] = id;
+	event["url"] = url;
+	event["host"] = host.getString();
+	event["priority"] = priority;
+	event["w"] = w;
+	event["h"] = h;
+	event["c"] = c;
+	event["discard"] = discard;
+	event["aux"] = needs_aux;
+	event["http"] = can_use_http;
+	write(event);
+	mPriorities[id] = priority;
+}
+
+void LLTextureFetchRecorder::recordPriority(const LLUUID& id, F32 priority)
+{
+	std::map<LLUUID, F32>::iterator iter = mPriorities.find(id);
+	if (iter == mPriorities.end() || fabs(priority - iter->second) <= iter->second * .05f)
+	{
+		return;
+	}
+	iter->second = priority;
+	LLSD event;
+	event["op"] = "priority";
+	event["id"] = id;
+	event["priority"] = priority;
+	write(event);
+}
+
+void LLTextureFetchRecorder::recordDelete(const LLUUID& id, bool cancel)
+{
+	if (!mPriorities.erase(id))
+	{
+		return;
+	}
+	LLSD event;
+	event["op"] = "delete";
+	event["id"] = id;
+	event["cancel"] = cancel;
+	write(event);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LLTextureFetchReplay
+
+LLTextureFetchReplay::LLTextureFetchReplay(const std::string& filename, const std::string& base_url)
+	: mNextEvent(0),
+	  mBaseURL(base_url),
+	  mStarted(false),
+	  mDone(false),
+	  mCreated(0),
+	  mCompleted(0),
+	  mFailed(0),
+	  mCancelled(0),
+	  mCompletionTime(0.0)
+{
+	llifstream file(filename);
+	if (!file.is_open())
+	{
+		llwarns << "Unable to open texture fetch recording " << filename << llendl;
+		return;
+	}
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty())
+		{
+			continue;
+		}
+		std::istringstream str(line);
+		LLSD event;
+		if (LLSDSerialize::fromNotation(event, str, line.size()) <= 0 || !event.has("op"))
+		{
+			llwarns << "Bad event in texture fetch recording " << filename << ": " << line << llendl;
+			continue;
+		}
+		mEvents.push_back(event);
+	}
+	llinfos << "Loaded " << mEvents.size() << " texture fetch events from " << filename << llendl;
+}
+
+// Swaps the server part of the recorded URL for the stand-in. UDP requests
+// (no URL) are turned into texture capability requests.
+std::string LLTextureFetchReplay::getURL(const std::string& url, const LLUUID& id) const
+{
+	if (url.empty())
+	{
+		return mBaseURL + "?texture_id=" + id.asString();
+	}
+	if (url.compare(0, 7, "http://") != 0)
+	{
+		return url; // local file
+	}
+	size_t path = url.find('/', 7);
+	if (path == std::string::npos)
+	{
+		return mBaseURL;
+	}
+	std::string base = mBaseURL;
+	if (!base.empty() && base[base.size() - 1] == '/')
+	{
+		base.erase(base.size() - 1);
+	}
+	return base + url.substr(path);
+}
+
+void LLTextureFetchReplay::update(LLTextureFetch* fetcher)
+{
+	if (mDone)
+	{
+		return;
+	}
+	if (!mStarted)
+	{
+		llinfos << "Replaying " << mEvents.size() << " texture fetch events against " << mBaseURL << llendl;
+		fetcher->getStats().reset();
+		mTimer.reset();
+		mStarted = true;
+	}
+	F64 now = mTimer.getElapsedTimeF64();
+
+	while (mNextEvent < mEvents.size() && mEvents[mNextEvent]["t"].asReal() <= now)
+	{
+		const LLSD& event = mEvents[mNextEvent++];
+		const LLUUID id = event["id"].asUUID();
+		const std::string op = event["op"].asString();
+		if (op == "create")
+		{
+			// No simulator to talk to, everything goes over HTTP
+			if (fetcher->createRequest(getURL(event["url"].asString(), id), id, LLHost(),
+									   (F32)event["priority"].asReal(),
+									   event["w"].asInteger(), event["h"].asInteger(), event["c"].asInteger(),
+									   event["discard"].asInteger(), event["aux"].asBoolean(), true)
+				&& mActive.insert(std::make_pair(id, now)).second)
+			{
+				mCreated++;
+			}
+		}
+		else if (op == "priority")
+		{
+			if (mActive.count(id))
+			{
+				fetcher->updateRequestPriority(id, (F32)event["priority"].asReal());
+			}
+		}
+		else if (op == "delete")
+		{
+			if (mActive.erase(id))
+			{
+				fetcher->deleteRequest(id, event["cancel"].asBoolean());
+				mCancelled++;
+			}
+		}
+	}
+
+	// Pick up finished requests the way LLViewerImage does
+	for (request_map_t::iterator iter = mActive.begin(); iter != mActive.end(); )
+	{
+		request_map_t::iterator cur = iter++;
+		S32 discard = -1;
+		LLPointer<LLImageRaw> raw;
+		LLPointer<LLImageRaw> aux;
+		if (fetcher->getRequestFinished(cur->first, discard, raw, aux))
+		{
+			if (raw.notNull())
+			{
+				mCompleted++;
+				mCompletionTime += now - cur->second;
+			}
+			else
+			{
+				mFailed++;
+			}
+			fetcher->deleteRequest(cur->first, false);
+			mActive.erase(cur);
+		}
+	}
+
+	if (mNextEvent >= mEvents.size() && mActive.empty())
+	{
+		finish(fetcher);
+	}
+}
+
+void LLTextureFetchReplay::finish(LLTextureFetch* fetcher)
+{
+	mDone = true;
+	F64 elapsed = mTimer.getElapsedTimeF64();
+	llinfos << llformat("Texture fetch replay done in %.2fs: %u requests, %u completed (mean %.0fms), %u failed, %u cancelled",
+						elapsed, mCreated, mCompleted,
+						mCompleted ? mCompletionTime * 1000.0 / mCompleted : 0.0,
+						mFailed, mCancelled) << llendl;
+	fetcher->getStats().dump();
+
+	LLSD results;
+	results["elapsed"] = elapsed;
+	results["created"] = (S32)mCreated;
+	results["completed"] = (S32)mCompleted;
+	results["failed"] = (S32)mFailed;
+	results["cancelled"] = (S32)mCancelled;
+	results["mean_ms"] = mCompleted ? mCompletionTime * 1000.0 / mCompleted : 0.0;
+	results["states"] = fetcher->getStats().asLLSD();
+	std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "texture_fetch_replay.xml");
+	llofstream out(filename);
+	if (out.is_open())
+	{
+		LLSDSerialize::toPrettyXML(results, out);
+		llinfos << "Texture fetch replay results written to " << filename << llendl;
+	}
+}
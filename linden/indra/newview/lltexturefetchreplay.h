@@ -0,0 +1,114 @@
+/** 
+ * @file lltexturefetchreplay.h
+ * @brief Recording and replay of texture fetch request streams
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREFETCHREPLAY_H
+#define LL_LLTEXTUREFETCHREPLAY_H
+
+#include <map>
+#include <vector>
+
+#include "llfile.h"
+#include "llhost.h"
+#include "llsd.h"
+#include "lltimer.h"
+#include "lluuid.h"
+
+class LLTextureFetch;
+
+// Writes the stream of requests made to LLTextureFetch to a file, one LLSD
+// notation map per line:
+//   { 't': seconds since the recording started, 'op': 'create'|'priority'|'delete',
+//     'id': uuid, ... }
+// 'create' also has the arguments of LLTextureFetch::createRequest().
+// Enabled with the TextureFetchRecordFile setting. MAIN THREAD only.
+class LLTextureFetchRecorder
+{
+public:
+	LLTextureFetchRecorder(const std::string& filename);
+	~LLTextureFetchRecorder();
+
+	bool isOpen() const { return mFile.is_open(); }
+
+	void recordCreate(const std::string& url, const LLUUID& id, const LLHost& host, F32 priority,
+					  S32 w, S32 h, S32 c, S32 discard, bool needs_aux, bool can_use_http);
+	void recordPriority(const LLUUID& id, F32 priority);
+	void recordDelete(const LLUUID& id, bool cancel);
+
+private:
+	void write(LLSD& event);
+
+	llofstream mFile;
+	LLTimer mTimer;
+	// last recorded priority, small changes are ignored like the fetcher does
+	std::map<LLUUID, F32> mPriorities;
+};
+
+// Plays a recording back against LLTextureFetch with the original timing,
+// to benchmark the fetch pipeline reproducibly. Requests go over HTTP to
+// a local stand-in for the texture capability (TextureFetchReplayURL, any
+// server that answers <url>?texture_id=<uuid> with ranged GETs will do)
+// and through the texture cache as usual; clear the cache first for a cold
+// run. Enabled with the TextureFetchReplayFile setting, driven from
+// LLTextureFetch::update(). Logs the elapsed time and the per state
+// histograms when done. MAIN THREAD only.
+class LLTextureFetchReplay
+{
+public:
+	LLTextureFetchReplay(const std::string& filename, const std::string& base_url);
+
+	bool isValid() const { return !mEvents.empty(); }
+	bool isDone() const { return mDone; }
+
+	void update(LLTextureFetch* fetcher);
+
+private:
+	std::string getURL(const std::string& url, const LLUUID& id) const;
+	void finish(LLTextureFetch* fetcher);
+
+	std::vector<LLSD> mEvents;
+	U32 mNextEvent;
+	std::string mBaseURL;
+	LLTimer mTimer;
+	bool mStarted;
+	bool mDone;
+
+	// requests issued and not yet finished or deleted
+	typedef std::map<LLUUID, F64> request_map_t; // id -> time it was issued
+	request_map_t mActive;
+	U32 mCreated;
+	U32 mCompleted;
+	U32 mFailed;
+	U32 mCancelled;
+	F64 mCompletionTime; // summed latency of the completed requests
+};
+
+#endif // LL_LLTEXTUREFETCHREPLAY_H
@@ -0,0 +1,171 @@
+/** 
+ * @file lltexturefetchstats.cpp
+ * @brief Per state latency histograms for the texture fetch pipeline
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturefetchstats.h"
+
+LLTextureFetchStats::StateStats::StateStats()
+	: mDepth(0),
+	  mCount(0),
+	  mTotal(0.0),
+	  mMax(0.0)
+{
+	memset(mBuckets, 0, sizeof(mBuckets));
+}
+
+// Upper bound of the bucket holding the given fraction of the samples
+F64 LLTextureFetchStats::StateStats::getPercentileMS(F32 fraction) const
+{
+	if (!mCount)
+	{
+		return 0.0;
+	}
+	U32 target = llmax((U32)1, (U32)ceil(mCount * fraction));
+	U32 seen = 0;
+	for (S32 i = 0; i < NUM_BUCKETS - 1; ++i)
+	{
+		seen += mBuckets[i];
+		if (seen >= target)
+		{
+			return llmin(getBucketLimitMS(i), mMax * 1000.0);
+		}
+	}
+	return mMax * 1000.0;
+}
+
+LLTextureFetchStats::LLTextureFetchStats(S32 num_states, const char* const* state_names)
+	: mStates(num_states),
+	  mStateNames(state_names)
+{
+}
+
+//static
+F64 LLTextureFetchStats::getBucketLimitMS(S32 bucket)
+{
+	return (F64)(1 << bucket);
+}
+
+void LLTextureFetchStats::enterState(S32 state)
+{
+	LLMutexLock lock(&mMutex);
+	mStates[state].mDepth++;
+}
+
+void LLTextureFetchStats::leaveState(S32 state, F64 seconds)
+{
+	S32 bucket = 0;
+	for (F64 ms = seconds * 1000.0; ms >= 1.0 && bucket < NUM_BUCKETS - 1; ms *= .5)
+	{
+		bucket++;
+	}
+
+	LLMutexLock lock(&mMutex);
+	StateStats& stats = mStates[state];
+	stats.mDepth--;
+	stats.mCount++;
+	stats.mTotal += seconds;
+	stats.mMax = llmax(stats.mMax, seconds);
+	stats.mBuckets[bucket]++;
+}
+
+void LLTextureFetchStats::reset()
+{
+	LLMutexLock lock(&mMutex);
+	for (std::vector<StateStats>::iterator iter = mStates.begin(); iter != mStates.end(); ++iter)
+	{
+		S32 depth = iter->mDepth;
+		*iter = StateStats();
+		iter->mDepth = depth;
+	}
+}
+
+LLSD LLTextureFetchStats::asLLSD() const
+{
+	LLSD res = LLSD::emptyMap();
+	LLMutexLock lock(&mMutex);
+	for (S32 i = 0; i < (S32)mStates.size(); ++i)
+	{
+		const StateStats& stats = mStates[i];
+		LLSD state;
+		state["depth"] = stats.mDepth;
+		state["count"] = (S32)stats.mCount;
+		state["mean_ms"] = stats.mCount ? stats.mTotal * 1000.0 / stats.mCount : 0.0;
+		state["max_ms"] = stats.mMax * 1000.0;
+		state["p50_ms"] = stats.getPercentileMS(.5f);
+		state["p95_ms"] = stats.getPercentileMS(.95f);
+		LLSD buckets = LLSD::emptyArray();
+		for (S32 b = 0; b < NUM_BUCKETS; ++b)
+		{
+			buckets.append((S32)stats.mBuckets[b]);
+		}
+		state["buckets"] = buckets;
+		res[mStateNames[i]] = state;
+	}
+	return res;
+}
+
+std::string LLTextureFetchStats::getDepthString() const
+{
+	std::string res;
+	LLMutexLock lock(&mMutex);
+	for (S32 i = 0; i < (S32)mStates.size(); ++i)
+	{
+		if (mStates[i].mDepth > 0)
+		{
+			if (!res.empty())
+			{
+				res += " ";
+			}
+			res += llformat("%s:%d", mStateNames[i], mStates[i].mDepth);
+		}
+	}
+	return res;
+}
+
+void LLTextureFetchStats::dump() const
+{
+	LLMutexLock lock(&mMutex);
+	for (S32 i = 0; i < (S32)mStates.size(); ++i)
+	{
+		const StateStats& stats = mStates[i];
+		if (!stats.mCount && !stats.mDepth)
+		{
+			continue;
+		}
+		llinfos << llformat("%-24s depth %4d count %7u mean %8.1fms p50 %7.0fms p95 %7.0fms max %8.1fms",
+							mStateNames[i], stats.mDepth, stats.mCount,
+							stats.mCount ? stats.mTotal * 1000.0 / stats.mCount : 0.0,
+							stats.getPercentileMS(.5f), stats.getPercentileMS(.95f),
+							stats.mMax * 1000.0) << llendl;
+	}
+}
@@ -0,0 +1,87 @@
+/** 
+ * @file lltexturefetchstats.h
+ * @brief Per state latency histograms for the texture fetch pipeline
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREFETCHSTATS_H
+#define LL_LLTEXTUREFETCHSTATS_H
+
+#include <vector>
+
+#include "llsd.h"
+#include "llthread.h"
+
+// Time spent by fetch workers in each state of the fetch state machine, as
+// log2 histograms, plus the number of workers currently in each state.
+// Thread safe: workers change state on the fetch thread and the main thread.
+class LLTextureFetchStats
+{
+public:
+	enum
+	{
+		// Bucket 0 counts times under 1ms, bucket i times in [2^(i-1), 2^i) ms,
+		// and the last bucket everything from ~16s up
+		NUM_BUCKETS = 16
+	};
+
+	LLTextureFetchStats(S32 num_states, const char* const* state_names);
+
+	void enterState(S32 state);
+	void leaveState(S32 state, F64 seconds);
+	void reset(); // clears the histograms, not the depths
+
+	// { "<state>": { "depth", "count", "mean_ms", "max_ms", "p50_ms", "p95_ms",
+	//                "buckets": [ ... ] }, ... }
+	LLSD asLLSD() const;
+	// "INIT:3 CACHE:12 ..." for the texture console, states with depth > 0
+	std::string getDepthString() const;
+	void dump() const;
+
+	static F64 getBucketLimitMS(S32 bucket); // upper bound of a bucket
+
+private:
+	struct StateStats
+	{
+		StateStats();
+		S32 mDepth;
+		U32 mCount;
+		F64 mTotal;
+		F64 mMax;
+		U32 mBuckets[NUM_BUCKETS];
+
+		F64 getPercentileMS(F32 fraction) const;
+	};
+
+	mutable LLMutex mMutex;
+	std::vector<StateStats> mStates;
+	const char* const* mStateNames;
+};
+
+#endif // LL_LLTEXTUREFETCHSTATS_H
@@ -41,6 +41,7 @@
 #include "lllfsthread.h"
 #include "llui.h"
 #include "llimageworker.h"
+#include "llmemorybudget.h"
 #include "llrender.h"
 
 #include "llappviewer.h"
@@ -53,6 +54,7 @@
 #include "llviewerobject.h"
 #include "llviewerimage.h"
 #include "llviewerimagelist.h"
+#include "llvocache.h"
 #include "llvovolume.h"
 extern F32 texmem_lower_bound_scale;
 
@@ -415,6 +417,15 @@ void LLGLTexMemBar::draw()
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, line_height*3,
 											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
 
+	// Everything under the memory budget, see LLViewerMemoryBudget
+	text = llformat("Budget: %d/%d MB VB: %d MB ObjCache: %d MB",
+					(S32)(LLMemoryBudget::getTotalUsage() >> 20), (S32)(LLMemoryBudget::getBudget() >> 20),
+					LLVertexBuffer::sAllocatedBytes >> 20, LLVOCacheEntry::sAllocatedBytes >> 20);
+	color = LLMemoryBudget::isOverBudget() ? LLColor4::red : text_color;
+	color[VALPHA] = text_color[VALPHA];
+	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 700, line_height*3,
+											 color, LLFontGL::LEFT, LLFontGL::TOP);
+
 	//----------------------------------------------------------------------------
 #if 0
 	S32 bar_left = 400;
@@ -500,6 +511,13 @@ void LLGLTexMemBar::draw()
 	text = llformat("BW:%.0f/%.0f",bandwidth, max_bandwidth);
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, line_height*2,
 											 color, LLFontGL::LEFT, LLFontGL::TOP);
+
+	// HTTP connections opened/reused, workers per fetch state
+	left += 100;
+	text = llformat("Conn:%u/%u ", LLCurl::getConnectCount(), LLCurl::getReuseCount())
+		+ LLAppViewer::getTextureFetch()->getStats().getDepthString();
+	LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, line_height*2,
+											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
 	
 	S32 dx1 = 0;
 	if (LLAppViewer::getTextureFetch()->mDebugPause)
@@ -51,6 +51,7 @@
 #include "llhudmanager.h"
 #include "llimagebmp.h"
 #include "llimagegl.h"
+#include "llmemorybudget.h"
 #include "llselectmgr.h"
 #include "llsky.h"
 #include "llstartup.h"
@@ -638,15 +639,23 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 		LLDrawable::incrementVisible();
 
 		LLSpatialGroup::sNoDelete = TRUE;
-		LLPipeline::sUseOcclusion = 
-				(!gUseWireframe
-				&& LLFeatureManager::getInstance()->isFeatureAvailable("UseOcclusion") 
-				&& gSavedSettings.getBOOL("UseOcclusion") 
-				&& gGLManager.mHasOcclusionQuery) ? 2 : 0;
-
-		if (LLPipeline::sUseOcclusion && LLPipeline::sRenderDeferred)
-		{ //force occlusion on for all render types if doing deferred render
-			LLPipeline::sUseOcclusion = 3;
+		LLPipeline::sUseSoftwareOcclusion = gSavedSettings.getBOOL("UseSoftwareOcclusion");
+		if (LLPipeline::sUseSoftwareOcclusion)
+		{ //occlusion is decided on the CPU during the cull, there are no queries to issue or read back
+			LLPipeline::sUseOcclusion = (!gUseWireframe && gSavedSettings.getBOOL("UseOcclusion")) ? 1 : 0;
+		}
+		else
+		{
+			LLPipeline::sUseOcclusion = 
+					(!gUseWireframe
+					&& LLFeatureManager::getInstance()->isFeatureAvailable("UseOcclusion") 
+					&& gSavedSettings.getBOOL("UseOcclusion") 
+					&& gGLManager.mHasOcclusionQuery) ? 2 : 0;
+
+			if (LLPipeline::sUseOcclusion && LLPipeline::sRenderDeferred)
+			{ //force occlusion on for all render types if doing deferred render
+				LLPipeline::sUseOcclusion = 3;
+			}
 		}
 
 		LLPipeline::sFastAlpha = gSavedSettings.getBOOL("RenderFastAlpha");
@@ -753,6 +762,9 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 		{
 			LLFastTimer t(LLFastTimer::FTM_IMAGE_UPDATE);
 			
+			// May raise the discard bias used by updateClass()
+			LLMemoryBudget::update();
+
 			LLViewerImage::updateClass(LLViewerCamera::getInstance()->getVelocityStat()->getMean(),
 										LLViewerCamera::getInstance()->getAngularVelocityStat()->getMean());
 
@@ -1175,6 +1187,8 @@ void render_ui(F32 zoom_factor, int subfield)
 	glh_set_current_modelview(saved_view);
 	glPopMatrix();
 
+	LLVertexBuffer::fenceStream();
+
 	if (gDisplaySwapBuffers)
 	{
 		LLFastTimer t(LLFastTimer::FTM_SWAP);
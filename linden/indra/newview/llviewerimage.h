@@ -455,6 +455,7 @@ public:
 	static LLTimer sEvaluationTimer;
 	static S8  sCameraMovingDiscardBias;
 	static F32 sDesiredDiscardBias;
+	static BOOL sMemoryPressure; // set by LLMemoryBudget, raises sDesiredDiscardBias
 	static F32 sDesiredDiscardScale;
 	static S32 sBoundTextureMemoryInBytes;
 	static S32 sTotalTextureMemoryInBytes;
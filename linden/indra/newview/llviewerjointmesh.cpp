@@ -56,6 +56,7 @@
 #include "llviewerjointmesh.h"
 #include "llvoavatar.h"
 #include "llsky.h"
+#include "llskinning.h"
 #include "pipeline.h"
 #include "llviewershadermgr.h"
 #include "llmath.h"
@@ -381,19 +382,15 @@ const S32 NUM_AXES = 3;
 // rotation Z 0-n
 // pivot parent 0-n -- child = n+1
 
-static LLMatrix4	gJointMatUnaligned[32];
-static LLMatrix3	gJointRotUnaligned[32];
-static LLVector4	gJointPivot[32];
-
-//-----------------------------------------------------------------------------
-// uploadJointMatrices()
-//-----------------------------------------------------------------------------
-void LLViewerJointMesh::uploadJointMatrices()
+// Fills in the pivoted joint matrices (and their rotations) of a mesh, in
+// world space or, with hardware skinning, in eye space. Only touches the
+// arrays it is given, so it is safe on the skinning threads.
+static void calc_joint_matrices(LLPolyMesh* mesh, BOOL hardware_skinning,
+								LLMatrix4* joint_mat_unaligned, LLMatrix3* joint_rot_unaligned)
 {
 	S32 joint_num;
-	LLPolyMesh *reference_mesh = mMesh->getReferenceMesh();
-	LLDrawPool *poolp = mFace ? mFace->getPool() : NULL;
-	BOOL hardware_skinning = (poolp && poolp->getVertexShaderLevel() > 0) ? TRUE : FALSE;
+	LLPolyMesh *reference_mesh = mesh->getReferenceMesh();
+	LLVector4 joint_pivot[32];
 
 	//calculate joint matrices
 	for (joint_num = 0; joint_num < reference_mesh->mJointRenderData.count(); joint_num++)
@@ -404,8 +401,8 @@ void LLViewerJointMesh::uploadJointMatrices()
 		{
 			joint_mat *= LLDrawPoolAvatar::getModelView();
 		}
-		gJointMatUnaligned[joint_num] = joint_mat;
-		gJointRotUnaligned[joint_num] = joint_mat.getMat3();
+		joint_mat_unaligned[joint_num] = joint_mat;
+		joint_rot_unaligned[joint_num] = joint_mat.getMat3();
 	}
 
 	BOOL last_pivot_uploaded = FALSE;
@@ -421,13 +418,13 @@ void LLViewerJointMesh::uploadJointMatrices()
 			{
 				LLVector4 parent_pivot(sj->mRootToParentJointSkinOffset);
 				parent_pivot.mV[VW] = 0.f;
-				gJointPivot[j++] = parent_pivot;
+				joint_pivot[j++] = parent_pivot;
 			}
 
 			LLVector4 child_pivot(sj->mRootToJointSkinOffset);
 			child_pivot.mV[VW] = 0.f;
 
-			gJointPivot[j++] = child_pivot;
+			joint_pivot[j++] = child_pivot;
 
 			last_pivot_uploaded = TRUE;
 		}
@@ -441,24 +438,39 @@ void LLViewerJointMesh::uploadJointMatrices()
 	for (S32 i = 0; i < j; i++)
 	{
 		LLVector3 pivot;
-		pivot = LLVector3(gJointPivot[i]);
-		pivot = pivot * gJointRotUnaligned[i];
-		gJointMatUnaligned[i].translate(pivot);
+		pivot = LLVector3(joint_pivot[i]);
+		pivot = pivot * joint_rot_unaligned[i];
+		joint_mat_unaligned[i].translate(pivot);
 	}
+}
+
+//-----------------------------------------------------------------------------
+// uploadJointMatrices()
+//-----------------------------------------------------------------------------
+void LLViewerJointMesh::uploadJointMatrices()
+{
+	LLDrawPool *poolp = mFace ? mFace->getPool() : NULL;
+	BOOL hardware_skinning = (poolp && poolp->getVertexShaderLevel() > 0) ? TRUE : FALSE;
 
 	// upload matrices
 	if (hardware_skinning)
 	{
+		LLMatrix4 joint_mat_unaligned[32];
+		LLMatrix3 joint_rot_unaligned[32];
+		calc_joint_matrices(mMesh, hardware_skinning, joint_mat_unaligned, joint_rot_unaligned);
+
+		LLPolyMesh *reference_mesh = mMesh->getReferenceMesh();
+		S32 joint_num;
 		GLfloat mat[45*4];
 		memset(mat, 0, sizeof(GLfloat)*45*4);
 
 		for (joint_num = 0; joint_num < reference_mesh->mJointRenderData.count(); joint_num++)
 		{
-			gJointMatUnaligned[joint_num].transpose();
+			joint_mat_unaligned[joint_num].transpose();
 
 			for (S32 axis = 0; axis < NUM_AXES; axis++)
 			{
-				F32* vector = gJointMatUnaligned[joint_num].mMatrix[axis];
+				F32* vector = joint_mat_unaligned[joint_num].mMatrix[axis];
 				U32 offset = LL_CHARACTER_MAX_JOINTS_PER_MESH*axis+joint_num;
 				memcpy(mat+offset*4, vector, sizeof(GLfloat)*4);
 			}
@@ -736,91 +748,16 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 
 	//get vertex and normal striders
 	LLVertexBuffer *buffer = mFace->mVertexBuffer;
-	buffer->getVertexStrider(o_vertices,  0);
-	buffer->getNormalStrider(o_normals,   0);
-
-	F32 last_weight = F32_MAX;
-	LLMatrix4 gBlendMat;
-	LLMatrix3 gBlendRotMat;
-
-	const F32* weights = mMesh->getWeights();
-	const LLVector3* coords = mMesh->getCoords();
-	const LLVector3* normals = mMesh->getNormals();
-	for (U32 index = 0; index < mMesh->getNumVertices(); index++)
-	{
-		U32 bidx = index + mMesh->mFaceVertexOffset;
-		
-		// blend by first matrix
-		F32 w = weights[index]; 
-		
-		// Maybe we don't have to change gBlendMat.
-		// Profiles of a single-avatar scene on a Mac show this to be a very
-		// common case.  JC
-		if (w == last_weight)
-		{
-			o_vertices[bidx] = coords[index] * gBlendMat;
-			o_normals[bidx] = normals[index] * gBlendRotMat;
-			continue;
-		}
-		
-		last_weight = w;
-
-		S32 joint = llfloor(w);
-		w -= joint;
-		
-		// No lerp required in this case.
-		if (w == 1.0f)
-		{
-			gBlendMat = gJointMatUnaligned[joint+1];
-			o_vertices[bidx] = coords[index] * gBlendMat;
-			gBlendRotMat = gJointRotUnaligned[joint+1];
-			o_normals[bidx] = normals[index] * gBlendRotMat;
-			continue;
-		}
-		
-		// Try to keep all the accesses to the matrix data as close
-		// together as possible.  This function is a hot spot on the
-		// Mac. JC
-		LLMatrix4 &m0 = gJointMatUnaligned[joint+1];
-		LLMatrix4 &m1 = gJointMatUnaligned[joint+0];
-		
-		gBlendMat.mMatrix[VX][VX] = lerp(m1.mMatrix[VX][VX], m0.mMatrix[VX][VX], w);
-		gBlendMat.mMatrix[VX][VY] = lerp(m1.mMatrix[VX][VY], m0.mMatrix[VX][VY], w);
-		gBlendMat.mMatrix[VX][VZ] = lerp(m1.mMatrix[VX][VZ], m0.mMatrix[VX][VZ], w);
+	buffer->getVertexStrider(o_vertices,  mMesh->mFaceVertexOffset);
+	buffer->getNormalStrider(o_normals,   mMesh->mFaceVertexOffset);
 
-		gBlendMat.mMatrix[VY][VX] = lerp(m1.mMatrix[VY][VX], m0.mMatrix[VY][VX], w);
-		gBlendMat.mMatrix[VY][VY] = lerp(m1.mMatrix[VY][VY], m0.mMatrix[VY][VY], w);
-		gBlendMat.mMatrix[VY][VZ] = lerp(m1.mMatrix[VY][VZ], m0.mMatrix[VY][VZ], w);
+	LLMatrix4 joint_mat_unaligned[32];
+	LLMatrix3 joint_rot_unaligned[32];
+	calc_joint_matrices(mMesh, FALSE, joint_mat_unaligned, joint_rot_unaligned);
 
-		gBlendMat.mMatrix[VZ][VX] = lerp(m1.mMatrix[VZ][VX], m0.mMatrix[VZ][VX], w);
-		gBlendMat.mMatrix[VZ][VY] = lerp(m1.mMatrix[VZ][VY], m0.mMatrix[VZ][VY], w);
-		gBlendMat.mMatrix[VZ][VZ] = lerp(m1.mMatrix[VZ][VZ], m0.mMatrix[VZ][VZ], w);
-
-		gBlendMat.mMatrix[VW][VX] = lerp(m1.mMatrix[VW][VX], m0.mMatrix[VW][VX], w);
-		gBlendMat.mMatrix[VW][VY] = lerp(m1.mMatrix[VW][VY], m0.mMatrix[VW][VY], w);
-		gBlendMat.mMatrix[VW][VZ] = lerp(m1.mMatrix[VW][VZ], m0.mMatrix[VW][VZ], w);
-
-		o_vertices[bidx] = coords[index] * gBlendMat;
-		
-		LLMatrix3 &n0 = gJointRotUnaligned[joint+1];
-		LLMatrix3 &n1 = gJointRotUnaligned[joint+0];
-		
-		gBlendRotMat.mMatrix[VX][VX] = lerp(n1.mMatrix[VX][VX], n0.mMatrix[VX][VX], w);
-		gBlendRotMat.mMatrix[VX][VY] = lerp(n1.mMatrix[VX][VY], n0.mMatrix[VX][VY], w);
-		gBlendRotMat.mMatrix[VX][VZ] = lerp(n1.mMatrix[VX][VZ], n0.mMatrix[VX][VZ], w);
-
-		gBlendRotMat.mMatrix[VY][VX] = lerp(n1.mMatrix[VY][VX], n0.mMatrix[VY][VX], w);
-		gBlendRotMat.mMatrix[VY][VY] = lerp(n1.mMatrix[VY][VY], n0.mMatrix[VY][VY], w);
-		gBlendRotMat.mMatrix[VY][VZ] = lerp(n1.mMatrix[VY][VZ], n0.mMatrix[VY][VZ], w);
-
-		gBlendRotMat.mMatrix[VZ][VX] = lerp(n1.mMatrix[VZ][VX], n0.mMatrix[VZ][VX], w);
-		gBlendRotMat.mMatrix[VZ][VY] = lerp(n1.mMatrix[VZ][VY], n0.mMatrix[VZ][VY], w);
-		gBlendRotMat.mMatrix[VZ][VZ] = lerp(n1.mMatrix[VZ][VZ], n0.mMatrix[VZ][VZ], w);
-		
-		o_normals[bidx] = normals[index] * gBlendRotMat;
-	}
-
-	buffer->setBuffer(0);
+	ll_skin_vertices(joint_mat_unaligned, joint_rot_unaligned,
+					 mMesh->getWeights(), mMesh->getCoords(), mMesh->getNormals(),
+					 mMesh->getNumVertices(), o_vertices, o_normals);
 }
 
 const U32 UPDATE_GEOMETRY_CALL_MASK			= 0x1FFF; // 8K samples before overflow
@@ -835,11 +772,12 @@ static F64 sUpdateGeometryRunAvgOn[10];
 static U32 sUpdateGeometryRunCount			= 0 ;
 static U32 sUpdateGeometryCalls				= 0 ;
 static U32 sUpdateGeometryLastProcessor		= 0 ;
-static BOOL sVectorizePerfTest 				= FALSE;
 static U32 sVectorizeProcessor 				= 0;
 
 //static
 void (*LLViewerJointMesh::sUpdateGeometryFunc)(LLFace* face, LLPolyMesh* mesh);
+//static
+BOOL LLViewerJointMesh::sVectorizePerfTest = FALSE;
 
 //static
 void LLViewerJointMesh::updateVectorize()
@@ -896,8 +834,6 @@ void LLViewerJointMesh::updateJointGeometry()
 	{
 		// Once we've measured performance, just run the specified
 		// code version.
-		if(sUpdateGeometryFunc == updateGeometryOriginal)
-			uploadJointMatrices();
 		sUpdateGeometryFunc(mFace, mMesh);
 	}
 	else
@@ -908,14 +844,11 @@ void LLViewerJointMesh::updateJointGeometry()
 		
 		if (sUpdateGeometryCallPointer)
 		{
-			if(sUpdateGeometryFunc == updateGeometryOriginal)
-				uploadJointMatrices();
 			// call accelerated version for this processor
 			sUpdateGeometryFunc(mFace, mMesh);
 		}
 		else
 		{
-			uploadJointMatrices();
 			updateGeometryOriginal(mFace, mMesh);
 		}
 	
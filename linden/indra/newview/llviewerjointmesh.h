@@ -151,6 +151,10 @@ public:
 	/*virtual*/ BOOL isAnimatable() { return FALSE; }
 	
 	static void updateVectorize(); // Update globals when settings variables change
+	// FALSE while VectorizePerfTest is timing the skinning functions, as its
+	// bookkeeping is not thread safe; updateJointGeometry() is otherwise safe
+	// on any thread once the face's vertex buffer has been mapped.
+	static BOOL canSkinOnAnyThread() { return !sVectorizePerfTest; }
 	
 private:
 	// Avatar vertex skinning is a significant performance issue on computers
@@ -167,6 +171,7 @@ private:
 
 	// Use a fuction pointer to indicate which version we are running.
 	static void (*sUpdateGeometryFunc)(LLFace* face, LLPolyMesh* mesh);
+	static BOOL sVectorizePerfTest;
 
 private:
 	// Allocate skin data
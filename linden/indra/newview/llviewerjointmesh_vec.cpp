@@ -52,7 +52,8 @@
 // static
 void LLViewerJointMesh::updateGeometryVectorized(LLFace *face, LLPolyMesh *mesh)
 {
-	static LLV4Matrix4	sJointMat[32];
+	// On the stack so avatars can be skinned on several threads at once
+	LLV4Matrix4			joint_mat[32];
 	LLDynamicArray<LLJointRenderData*>& joint_data = mesh->getReferenceMesh()->mJointRenderData;
 	S32 j, joint_num, joint_end = joint_data.count();
 	LLV4Vector3 pivot;
@@ -65,12 +66,12 @@ void LLViewerJointMesh::updateGeometryVectorized(LLFace *face, LLPolyMesh *mesh)
 		if (NULL == (sj = joint_data[joint_num]->mSkinJoint))
 		{
 				sj = joint_data[++joint_num]->mSkinJoint;
-				((LLV4Matrix3)(sJointMat[j] = *wm)).multiply(sj->mRootToParentJointSkinOffset, pivot);
-				sJointMat[j++].translate(pivot);
+				((LLV4Matrix3)(joint_mat[j] = *wm)).multiply(sj->mRootToParentJointSkinOffset, pivot);
+				joint_mat[j++].translate(pivot);
 				wm = joint_data[joint_num]->mWorldMatrix;
 		}
-		((LLV4Matrix3)(sJointMat[j] = *wm)).multiply(sj->mRootToJointSkinOffset, pivot);
-		sJointMat[j++].translate(pivot);
+		((LLV4Matrix3)(joint_mat[j] = *wm)).multiply(sj->mRootToJointSkinOffset, pivot);
+		joint_mat[j++].translate(pivot);
 	}
 
 	F32					weight		= F32_MAX;
@@ -91,11 +92,9 @@ void LLViewerJointMesh::updateGeometryVectorized(LLFace *face, LLPolyMesh *mesh)
 		if( weight != weights[index])
 		{
 			S32 joint = llfloor(weight = weights[index]);
-			blend_mat.lerp(sJointMat[joint], sJointMat[joint+1], weight - joint);
+			blend_mat.lerp(joint_mat[joint], joint_mat[joint+1], weight - joint);
 		}
 		blend_mat.multiply(coords[index], o_vertices[index]);
 		((LLV4Matrix3)blend_mat).multiply(normals[index], o_normals[index]);
 	}
-
-	buffer->setBuffer(0);
 }
@@ -0,0 +1,187 @@
+/** 
+ * @file llviewermemorybudget.cpp
+ * @brief Registers the viewer caches with LLMemoryBudget
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llviewermemorybudget.h"
+
+#include "llimage.h"
+#include "llimagegl.h"
+#include "llmemorybudget.h"
+#include "llsys.h"
+#include "llvertexbuffer.h"
+
+#include "llviewercontrol.h"
+#include "llviewerimage.h"
+#include "llviewerregion.h"
+#include "llvocache.h"
+#include "llworld.h"
+#include "pipeline.h"
+
+// Pools in the order they are asked to trim: what is cheapest to get back first
+
+// Object updates cached for the regions, refetched from the simulator
+class LLObjectCachePool : public LLMemoryBudget::Pool
+{
+public:
+	LLObjectCachePool() : LLMemoryBudget::Pool("Object cache", 0) {}
+
+	/*virtual*/ S64 getUsage()
+	{
+		return LLVOCacheEntry::sAllocatedBytes;
+	}
+
+	/*virtual*/ S64 trim(S64 bytes)
+	{
+		S64 freed = 0;
+		for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin();
+			 iter != LLWorld::getInstance()->getRegionList().end() && freed < bytes; ++iter)
+		{
+			freed += (*iter)->trimCache((S32)llmin(bytes - freed, (S64)S32_MAX));
+		}
+		return freed;
+	}
+};
+
+// Geometry of groups out of view, rebuilt from the objects when seen again
+class LLVertexBufferPool : public LLMemoryBudget::Pool
+{
+public:
+	LLVertexBufferPool() : LLMemoryBudget::Pool("Vertex buffers", 1) {}
+
+	/*virtual*/ S64 getUsage()
+	{
+		return LLVertexBuffer::sAllocatedBytes;
+	}
+
+	/*virtual*/ S64 trim(S64 bytes)
+	{
+		return gPipeline.evictVertexBuffers((S32)llmin(bytes, (S64)S32_MAX));
+	}
+};
+
+// Decoded images waiting to be turned into textures, or kept for callbacks.
+// Accounting only, they go away as the textures they feed are created.
+class LLDecodedImagePool : public LLMemoryBudget::Pool
+{
+public:
+	LLDecodedImagePool() : LLMemoryBudget::Pool("Decoded images", 2) {}
+
+	/*virtual*/ S64 getUsage()
+	{
+		return LLImageRaw::sGlobalRawMemory;
+	}
+
+	/*virtual*/ S64 trim(S64 bytes)
+	{
+		return 0;
+	}
+};
+
+// GL textures. Raising the discard bias lowers the resolution of textures
+// over the next frames, so this never reports anything released right away.
+class LLTexturePool : public LLMemoryBudget::Pool
+{
+public:
+	LLTexturePool() : LLMemoryBudget::Pool("Textures", 3) {}
+
+	/*virtual*/ S64 getUsage()
+	{
+		return LLImageGL::sGlobalTextureMemoryInBytes;
+	}
+
+	/*virtual*/ S64 trim(S64 bytes)
+	{
+		LLViewerImage::sMemoryPressure = TRUE;
+		return 0;
+	}
+
+	/*virtual*/ void relax()
+	{
+		LLViewerImage::sMemoryPressure = FALSE;
+	}
+};
+
+static std::vector<LLMemoryBudget::Pool*> sViewerPools;
+
+//static
+void LLViewerMemoryBudget::initClass()
+{
+	sViewerPools.push_back(new LLObjectCachePool);
+	sViewerPools.push_back(new LLVertexBufferPool);
+	sViewerPools.push_back(new LLDecodedImagePool);
+	sViewerPools.push_back(new LLTexturePool);
+	updateBudget();
+}
+
+//static
+void LLViewerMemoryBudget::cleanupClass()
+{
+	LLMemoryBudget::dump();
+	for_each(sViewerPools.begin(), sViewerPools.end(), DeletePointer());
+	sViewerPools.clear();
+	LLViewerImage::sMemoryPressure = FALSE;
+}
+
+//static
+S64 LLViewerMemoryBudget::getDefaultBudget()
+{
+	// The pools share the memory with everything else the viewer holds,
+	// give them half of it
+	const S64 MIN_BUDGET = 256 << 20;
+	S64 budget = (S64)gSysMemory.getPhysicalMemoryClamped() / 2;
+	if (sizeof(void*) == 4)
+	{
+		// A 32 bit process runs out of address space well before 4GB
+		const S64 MAX_BUDGET_32BIT = 1024 << 20;
+		budget = llmin(budget, MAX_BUDGET_32BIT);
+	}
+	return llmax(budget, MIN_BUDGET);
+}
+
+//static
+void LLViewerMemoryBudget::updateBudget()
+{
+	S32 budget_mb = gSavedSettings.getS32("MemoryBudgetMB");
+	if (budget_mb < 0)
+	{
+		LLMemoryBudget::setBudget(0);
+	}
+	else if (budget_mb == 0)
+	{
+		LLMemoryBudget::setBudget(getDefaultBudget());
+	}
+	else
+	{
+		LLMemoryBudget::setBudget((S64)budget_mb << 20);
+	}
+}
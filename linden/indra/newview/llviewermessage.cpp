@@ -61,6 +61,7 @@
 #include "lltransactionflags.h"
 #include "llxfermanager.h"
 #include "message.h"
+#include "llmessagedecoders.h"
 #include "sound_ids.h"
 #include "lltimer.h"
 #include "llmd5.h"
@@ -4145,11 +4146,17 @@ void process_kill_object(LLMessageSystem *mesgsys, void **user_data)
 	S32			i;
 	S32			num_objects;
 
-	num_objects = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
+	LLMsgKillObject kill;
+	if (!kill.decode(mesgsys))
+	{
+		LL_WARNS("Messaging") << "Malformed KillObject from " << mesgsys->getSender() << LL_ENDL;
+		return;
+	}
+	num_objects = kill.getObjectDataCount();
 
 	for (i = 0; i < num_objects; i++)
 	{
-		mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+		local_id = kill.getObjectData(i).getID();
 
 		LLViewerObjectList::getUUIDFromLocal(id,
 											local_id,
@@ -4210,15 +4217,21 @@ void process_time_synch(LLMessageSystem *mesgsys, void **user_data)
     U32 seconds_per_day;
     U32 seconds_per_year;
 
-	// "SimulatorViewerTimeMessage"
-	mesgsys->getU64Fast(_PREHASH_TimeInfo, _PREHASH_UsecSinceStart, space_time_usec);
-	mesgsys->getU32Fast(_PREHASH_TimeInfo, _PREHASH_SecPerDay, seconds_per_day);
-	mesgsys->getU32Fast(_PREHASH_TimeInfo, _PREHASH_SecPerYear, seconds_per_year);
+	LLMsgSimulatorViewerTimeMessage time_message;
+	if (!time_message.decode(mesgsys))
+	{
+		LL_WARNS("Messaging") << "Malformed SimulatorViewerTimeMessage from " << mesgsys->getSender() << LL_ENDL;
+		return;
+	}
+	const LLMsgSimulatorViewerTimeMessage::TimeInfoBlock& time_info = time_message.getTimeInfo();
+	space_time_usec = time_info.getUsecSinceStart();
+	seconds_per_day = time_info.getSecPerDay();
+	seconds_per_year = time_info.getSecPerYear();
 
 	// This should eventually be moved to an "UpdateHeavenlyBodies" message
-	mesgsys->getF32Fast(_PREHASH_TimeInfo, _PREHASH_SunPhase, phase);
-	mesgsys->getVector3Fast(_PREHASH_TimeInfo, _PREHASH_SunDirection, sun_direction);
-	mesgsys->getVector3Fast(_PREHASH_TimeInfo, _PREHASH_SunAngVelocity, sun_ang_velocity);
+	phase = time_info.getSunPhase();
+	sun_direction = time_info.getSunDirection();
+	sun_ang_velocity = time_info.getSunAngVelocity();
 
 	LLWorld::getInstance()->setSpaceTimeUSec(space_time_usec);
 
@@ -4589,7 +4602,13 @@ void process_avatar_animation(LLMessageSystem *mesgsys, void **user_data)
 	S32		anim_sequence_id;
 	LLVOAvatar *avatarp;
 	
-	mesgsys->getUUIDFast(_PREHASH_Sender, _PREHASH_ID, uuid);
+	LLMsgAvatarAnimation animation;
+	if (!animation.decode(mesgsys))
+	{
+		LL_WARNS("Messaging") << "Malformed AvatarAnimation from " << mesgsys->getSender() << LL_ENDL;
+		return;
+	}
+	uuid = animation.getSender().getID();
 
 	//clear animation flags
 	avatarp = (LLVOAvatar *)gObjectList.findObject(uuid);
@@ -4601,8 +4620,8 @@ void process_avatar_animation(LLMessageSystem *mesgsys, void **user_data)
 		return;
 	}
 
-	S32 num_blocks = mesgsys->getNumberOfBlocksFast(_PREHASH_AnimationList);
-	S32 num_source_blocks = mesgsys->getNumberOfBlocksFast(_PREHASH_AnimationSourceList);
+	S32 num_blocks = animation.getAnimationListCount();
+	S32 num_source_blocks = animation.getAnimationSourceListCount();
 
 	avatarp->mSignaledAnimations.clear();
 	
@@ -4612,8 +4631,8 @@ void process_avatar_animation(LLMessageSystem *mesgsys, void **user_data)
 
 		for( S32 i = 0; i < num_blocks; i++ )
 		{
-			mesgsys->getUUIDFast(_PREHASH_AnimationList, _PREHASH_AnimID, animation_id, i);
-			mesgsys->getS32Fast(_PREHASH_AnimationList, _PREHASH_AnimSequenceID, anim_sequence_id, i);
+			animation_id = animation.getAnimationList(i).getAnimID();
+			anim_sequence_id = animation.getAnimationList(i).getAnimSequenceID();
 
 			LL_DEBUGS("Messaging") << "Animation id " << animation_id 
 								   << " from self using sequence id " << anim_sequence_id << LL_ENDL;
@@ -4622,7 +4641,7 @@ void process_avatar_animation(LLMessageSystem *mesgsys, void **user_data)
 
 			if (i < num_source_blocks)
 			{
-				mesgsys->getUUIDFast(_PREHASH_AnimationSourceList, _PREHASH_ObjectID, object_id, i);
+				object_id = animation.getAnimationSourceList(i).getObjectID();
 			
 				LLViewerObject* object = gObjectList.findObject(object_id);
 				if (object)
@@ -4652,8 +4671,8 @@ void process_avatar_animation(LLMessageSystem *mesgsys, void **user_data)
 	{
 		for( S32 i = 0; i < num_blocks; i++ )
 		{
-			mesgsys->getUUIDFast(_PREHASH_AnimationList, _PREHASH_AnimID, animation_id, i);
-			mesgsys->getS32Fast(_PREHASH_AnimationList, _PREHASH_AnimSequenceID, anim_sequence_id, i);
+			animation_id = animation.getAnimationList(i).getAnimID();
+			anim_sequence_id = animation.getAnimationList(i).getAnimSequenceID();
 			avatarp->mSignaledAnimations[animation_id] = anim_sequence_id;
 			LL_DEBUGS("Messaging") << "Received animation id " << animation_id 
 								   << " from " << uuid 
@@ -457,6 +457,7 @@ void LLViewerObject::initVOClasses()
 
 void LLViewerObject::cleanupVOClasses()
 {
+	LLVOVolume::cleanupClass();
 	LLVOGrass::cleanupClass();
 	LLVOWater::cleanupClass();
 	LLVOTree::cleanupClass();
@@ -35,6 +35,7 @@
 #include "llviewerobjectlist.h"
 
 #include "message.h"
+#include "llmessagedecoders.h"
 #include "timing.h"
 #include "llfasttimer.h"
 #include "llrender.h"
@@ -295,12 +296,66 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 	LLPCode		pcode = 0;
 	LLUUID		fullid;
 	S32			i;
+	U64			region_handle;
+
+	// The per-object fields read here come straight out of the packet;
+	// the objects still read their own through mesgsys in
+	// LLViewerObject::processUpdateMessage()
+	static LLMsgObjectUpdate full_update;
+	static LLMsgObjectUpdateCompressed compressed_update;
+	static LLMsgObjectUpdateCached cached_update;
+	static LLMsgImprovedTerseObjectUpdate terse_update;
+	BOOL decoded;
+	if (cached)
+	{
+		decoded = cached_update.decode(mesgsys);
+	}
+	else if (compressed && update_type == OUT_TERSE_IMPROVED)
+	{
+		decoded = terse_update.decode(mesgsys);
+	}
+	else if (compressed)
+	{
+		decoded = compressed_update.decode(mesgsys);
+	}
+	else
+	{
+		decoded = full_update.decode(mesgsys);
+	}
+
+	// The getters below read through the decoded segment offsets, which
+	// are only valid for this packet if the decode succeeded
+	if (!decoded)
+	{
+		llwarns << "Malformed object update from " << mesgsys->getSender() << llendl;
+		return;
+	}
+
+	if (cached)
+	{
+		num_objects = cached_update.getObjectDataCount();
+		region_handle = cached_update.getRegionData().getRegionHandle();
+	}
+	else if (compressed && update_type == OUT_TERSE_IMPROVED)
+	{
+		num_objects = terse_update.getObjectDataCount();
+		region_handle = terse_update.getRegionData().getRegionHandle();
+	}
+	else if (compressed)
+	{
+		num_objects = compressed_update.getObjectDataCount();
+		region_handle = compressed_update.getRegionData().getRegionHandle();
+	}
+	else
+	{
+		num_objects = full_update.getObjectDataCount();
+		region_handle = full_update.getRegionData().getRegionHandle();
+	}
 
 	// figure out which simulator these are from and get it's index
 	// Coordinates in simulators are region-local
 	// Until we get region-locality working on viewer we
 	// have to transform to absolute coordinates.
-	num_objects = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
 
 	if (!cached && !compressed && update_type != OUT_FULL)
 	{
@@ -332,8 +387,6 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		gFullObjectUpdates += num_objects;
 	}
 
-	U64 region_handle;
-	mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
 	LLViewerRegion *regionp = LLWorld::getInstance()->getRegionFromHandle(region_handle);
 
 	if (!regionp)
@@ -353,10 +406,8 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 
 		if (cached)
 		{
-			U32 id;
-			U32 crc;
-			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, id, i);
-			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_CRC, crc, i);
+			U32 id = cached_update.getObjectData(i).getID();
+			U32 crc = cached_update.getObjectData(i).getCRC();
 		
 			// Lookup data packer and add this id to cache miss lists if necessary.
 			cached_dpp = regionp->getDP(id, crc);
@@ -381,15 +432,26 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			compressed_dp.reset();
 
 			U32 flags = 0;
+			const U8* data;
+			S32 data_size;
 			if (update_type != OUT_TERSE_IMPROVED)
 			{
-				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+				const LLMsgObjectUpdateCompressed::ObjectDataBlock& block = compressed_update.getObjectData(i);
+				flags = block.getUpdateFlags();
+				data = block.getData();
+				data_size = block.getDataSize();
+			}
+			else
+			{
+				const LLMsgImprovedTerseObjectUpdate::ObjectDataBlock& block = terse_update.getObjectData(i);
+				data = block.getData();
+				data_size = block.getDataSize();
 			}
 			
 			if (flags & FLAGS_ZLIB_COMPRESSED)
 			{
-				compressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
-				mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compbuffer, 0, i);
+				compressed_length = llmin(data_size, (S32)sizeof(compbuffer));
+				memcpy(compbuffer, data, compressed_length);
 				uncompressed_length = 2048;
 				uncompress(compressed_dpbuffer, (unsigned long *)&uncompressed_length,
 						   compbuffer, compressed_length);
@@ -397,8 +459,8 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			}
 			else
 			{
-				uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
-				mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i);
+				uncompressed_length = llmin(data_size, (S32)sizeof(compressed_dpbuffer));
+				memcpy(compressed_dpbuffer, data, uncompressed_length);
 				compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
 			}
 
@@ -425,7 +487,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		}
 		else if (update_type != OUT_FULL)
 		{
-			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+			local_id = full_update.getObjectData(i).getID();
 			getUUIDFromLocal(fullid,
 							local_id,
 							gMessageSystem->getSenderIP(),
@@ -438,8 +500,8 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		}
 		else
 		{
-			mesgsys->getUUIDFast(_PREHASH_ObjectData, _PREHASH_FullID, fullid, i);
-			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+			fullid = full_update.getObjectData(i).getFullID();
+			local_id = full_update.getObjectData(i).getID();
 		//	llinfos << "Full Update, obj " << local_id << ", global ID" << fullid << "from " << mesgsys->getSender() << llendl;
 		}
 		objectp = findObject(fullid);
@@ -490,7 +552,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 					continue;
 				}
 
-				mesgsys->getU8Fast(_PREHASH_ObjectData, _PREHASH_PCode, pcode, i);
+				pcode = full_update.getObjectData(i).getPCode();
 			}
 #ifdef IGNORE_DEAD
 			if (mDeadObjects.find(fullid) != mDeadObjects.end())
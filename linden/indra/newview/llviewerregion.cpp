@@ -67,11 +67,6 @@
 #include "llspatialpartition.h"
 #include "llviewerparcelmgr.h"
 
-// Viewer object cache version, change if object update
-// format changes. JC
-const U32 INDRA_OBJECT_CACHE_VERSION = 14;
-
-
 extern BOOL gNoRender;
 
 const F32 WATER_TEXTURE_SCALE = 8.f;			//  Number of times to repeat the water texture across a region
@@ -281,6 +276,12 @@ LLViewerRegion::~LLViewerRegion()
 }
 
 
+std::string LLViewerRegion::getCacheFilename() const
+{
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
+		llformat("objects_%d_%d.slc", U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
+}
+
 void LLViewerRegion::loadCache()
 {
 	if (mCacheLoaded)
@@ -291,78 +292,11 @@ void LLViewerRegion::loadCache()
 	// Presume success.  If it fails, we don't want to try again.
 	mCacheLoaded = TRUE;
 
-	LLVOCacheEntry *entry;
-
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc",U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
-	if (!fp)
-	{
-		// might not have a file, which is normal
-		return;
-	}
-
-	U32 zero;
-	size_t nread;
-	nread = fread(&zero, sizeof(U32), 1, fp);
-	if (nread != 1 || zero)
-	{
-		// a non-zero value here means bad things!
-		// skip reading the cached values
-		llinfos << "Cache file invalid" << llendl;
-		fclose(fp);
-		return;
-	}
-
-	U32 version;
-	nread = fread(&version, sizeof(U32), 1, fp);
-	if (nread != 1 || version != INDRA_OBJECT_CACHE_VERSION)
-	{
-		// a version mismatch here means we've changed the binary format!
-		// skip reading the cached values
-		llinfos << "Cache version changed, discarding" << llendl;
-		fclose(fp);
-		return;
-	}
-
-	LLUUID cache_id;
-	nread = fread(&cache_id.mData, 1, UUID_BYTES, fp);
-	if (nread != (size_t)UUID_BYTES || mCacheID != cache_id)
-	{
-		llinfos << "Cache ID doesn't match for this region, discarding"
-			<< llendl;
-		fclose(fp);
-		return;
-	}
-
-	S32 num_entries;
-	nread = fread(&num_entries, sizeof(S32), 1, fp);
-	if (nread != 1)
+	// Only maps the file, entries are read as their objects come in
+	if (mCacheFile.open(getCacheFilename(), mCacheID))
 	{
-		llinfos << "Short read, discarding" << llendl;
-		fclose(fp);
-		return;
+		mCacheEntriesCount += mCacheFile.getCount();
 	}
-	
-	S32 i;
-	for (i = 0; i < num_entries; i++)
-	{
-		entry = new LLVOCacheEntry(fp);
-		if (!entry->getLocalID())
-		{
-			llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
-			delete entry;
-			entry = NULL;
-			break;
-		}
-		mCacheEnd.insert(*entry);
-		mCacheMap[entry->getLocalID()] = entry;
-		mCacheEntriesCount++;
-	}
-
-	fclose(fp);
 }
 
 
@@ -379,56 +313,25 @@ void LLViewerRegion::saveCache()
 		return;
 	}
 
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc", U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "wb");		/* Flawfinder: ignore */
-	if (!fp)
-	{
-		llwarns << "Unable to write cache file " << filename << llendl;
-		return;
-	}
-
-	// write out zero to indicate a version cache file
-	U32 zero = 0;
-	if (fwrite(&zero, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	// write out version number
-	U32 version = INDRA_OBJECT_CACHE_VERSION;
-	if (fwrite(&version, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	// write the cache id for this sim
-	if (fwrite(&mCacheID.mData, 1, UUID_BYTES, fp) != (size_t)UUID_BYTES)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	if (fwrite(&num_entries, sizeof(S32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
+	std::vector<LLVOCacheEntry*> entries;
+	entries.reserve(mCacheMap.size());
 	LLVOCacheEntry *entry;
 
 	for (entry = mCacheStart.getNext(); entry && (entry != &mCacheEnd); entry = entry->getNext())
 	{
-		entry->writeToFile(fp);
+		entries.push_back(entry);
 	}
 
+	// Builds the file in memory and hands it to the cache write thread
+	mCacheFile.save(getCacheFilename(), mCacheID, entries);
+	mCacheFile.close();
+
 	mCacheMap.clear();
 	mCacheEnd.unlink();
 	mCacheEnd.init();
 	mCacheStart.deleteAll();
 	mCacheStart.init();
-
-	fclose(fp);
+	mCacheEntriesCount = 0;
 }
 
 void LLViewerRegion::sendMessage()
@@ -1098,6 +1001,24 @@ void LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinary
 
 	LLVOCacheEntry* entry = get_if_there(mCacheMap, local_id, (LLVOCacheEntry*)NULL);
 
+	if (!entry)
+	{
+		const LLVOCacheFile::IndexEntry* index = mCacheFile.find(local_id);
+		if (index)
+		{
+			// Cached last session. Replacing it does not change the count.
+			entry = mCacheFile.materialize(index);
+			mCacheEnd.insert(*entry);
+			mCacheMap[local_id] = entry;
+			if (entry->getCRC() != crc)
+			{
+				// Keeps the hit, dupe and CRC change counts of the entry
+				entry->assignCRC(crc, dp);
+				return;
+			}
+		}
+	}
+
 	if (entry)
 	{
 		// we've seen this object before
@@ -1123,9 +1044,12 @@ void LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinary
 		// Create new entry and add to map
 		if (mCacheEntriesCount > MAX_OBJECT_CACHE_ENTRIES)
 		{
-			entry = mCacheStart.getNext();
-			mCacheMap.erase(entry->getLocalID());
-			delete entry;
+			if (!mCacheFile.dropOne())
+			{
+				entry = mCacheStart.getNext();
+				mCacheMap.erase(entry->getLocalID());
+				delete entry;
+			}
 			mCacheEntriesCount--;
 		}
 		entry = new LLVOCacheEntry(local_id, crc, dp);
@@ -1145,6 +1069,23 @@ LLDataPacker *LLViewerRegion::getDP(U32 local_id, U32 crc)
 
 	LLVOCacheEntry* entry = get_if_there(mCacheMap, local_id, (LLVOCacheEntry*)NULL);
 
+	if (!entry)
+	{
+		// Only materialize file entries that are going to be used
+		const LLVOCacheFile::IndexEntry* index = mCacheFile.find(local_id);
+		if (index && index->mCRC == crc)
+		{
+			entry = mCacheFile.materialize(index);
+			mCacheEnd.insert(*entry);
+			mCacheMap[local_id] = entry;
+		}
+		else if (index)
+		{
+			mCacheMissCRC.put(local_id);
+			return NULL;
+		}
+	}
+
 	if (entry)
 	{
 		// we've seen this object before
@@ -1250,6 +1191,22 @@ void LLViewerRegion::requestCacheMisses()
 	// llinfos << "KILLDEBUG Sent cache miss full " << full_count << " crc " << crc_count << llendl;
 }
 
+S32 LLViewerRegion::trimCache(S32 bytes)
+{
+	S32 freed = 0;
+	LLVOCacheEntry* entry = mCacheStart.getNext();
+	while (freed < bytes && entry && entry != &mCacheEnd)
+	{
+		LLVOCacheEntry* next = entry->getNext();
+		freed += entry->getDataSize();
+		mCacheMap.erase(entry->getLocalID());
+		delete entry;
+		mCacheEntriesCount--;
+		entry = next;
+	}
+	return freed;
+}
+
 void LLViewerRegion::dumpCache()
 {
 	const S32 BINS = 4;
@@ -272,6 +272,9 @@ public:
 	LLDataPacker *getDP(U32 local_id, U32 crc);
 	void requestCacheMisses();
 	void addCacheMissFull(const U32 local_id);
+	// Drops least recently used cache entries holding about bytes of data,
+	// returns the bytes released
+	S32 trimCache(S32 bytes);
 
 	void dumpCache();
 
@@ -301,6 +304,7 @@ protected:
 	void disconnectAllNeighbors();
 	void initStats();
 	void setFlags(BOOL b, U32 flags);
+	std::string getCacheFilename() const;
 
 public:
 	LLWind  mWind;
@@ -387,6 +391,7 @@ private:
 	cache_map_t			  				 	mCacheMap;
 	LLVOCacheEntry							mCacheStart;
 	LLVOCacheEntry							mCacheEnd;
+	LLVOCacheFile							mCacheFile; // entries not seen yet this session
 	U32										mCacheEntriesCount;
 	LLDynamicArray<U32>						mCacheMissFull;
 	LLDynamicArray<U32>						mCacheMissCRC;
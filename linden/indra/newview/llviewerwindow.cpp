@@ -435,6 +435,11 @@ public:
 			addText(xpos, ypos, llformat("%d Vertex Buffer Sets", LLVertexBuffer::sSetCount));
 			ypos += y_inc;
 
+			addText(xpos, ypos, llformat("%d KB Streamed, %d Stream Stalls (%.2f ms), %d Unstreamed",
+										 LLVertexBuffer::sStreamBytes/1024, LLVertexBuffer::sStreamStallCount,
+										 LLVertexBuffer::sStreamStallTime*1000.f, LLVertexBuffer::sStreamFallbackCount));
+			ypos += y_inc;
+
 			addText(xpos, ypos, llformat("%d Texture Binds", LLImageGL::sBindCount));
 			ypos += y_inc;
 
@@ -444,6 +449,12 @@ public:
 			addText(xpos, ypos, llformat("%d Render Calls", gPipeline.mBatchCount));
             ypos += y_inc;
 
+			addText(xpos, ypos, llformat("%d Draw Infos, %d after batching (%d built, %d cached, %d KB)",
+										 LLDrawBatcher::sDrawInfoCount, LLDrawBatcher::sDrawCallCount,
+										 LLDrawBatcher::sBuildCount, gPipeline.getDrawBatcher().getCacheCount(),
+										 gPipeline.getDrawBatcher().getCacheBytes()/1024));
+			ypos += y_inc;
+
 			addText(xpos, ypos, llformat("%d Matrix Ops", gPipeline.mMatrixOpCount));
 			ypos += y_inc;
 
@@ -480,6 +491,11 @@ public:
 			LLVertexBuffer::sBindCount = LLImageGL::sBindCount = 
 				LLVertexBuffer::sSetCount = LLImageGL::sUniqueCount = 
 				gPipeline.mNumVisibleNodes = LLPipeline::sVisibleLightCount = 0;
+			LLVertexBuffer::sStreamBytes = LLVertexBuffer::sStreamStallCount =
+				LLVertexBuffer::sStreamFallbackCount = 0;
+			LLVertexBuffer::sStreamStallTime = 0.f;
+			LLDrawBatcher::sDrawInfoCount = LLDrawBatcher::sDrawCallCount =
+				LLDrawBatcher::sBuildCount = 0;
 		}
 		if (gSavedSettings.getBOOL("DebugShowRenderMatrices"))
 		{
@@ -1316,7 +1332,8 @@ LLViewerWindow::LLViewerWindow(
 	{
 		gSavedSettings.setBOOL("RenderVBOEnable", FALSE);
 	}
-	LLVertexBuffer::initClass(gSavedSettings.getBOOL("RenderVBOEnable") && gGLManager.mHasVertexBufferObject);
+	LLVertexBuffer::initClass(gSavedSettings.getBOOL("RenderVBOEnable") && gGLManager.mHasVertexBufferObject,
+							  gSavedSettings.getBOOL("RenderStreamRing"));
 
 	if (LLFeatureManager::getInstance()->isSafe()
 		|| (gSavedSettings.getS32("LastFeatureVersion") != LLFeatureManager::getInstance()->getVersion())
@@ -4814,6 +4814,72 @@ BOOL LLVOAvatar::needsRenderBeam()
 	return is_touching_or_grabbing || (mState & AGENT_STATE_EDITING && LLSelectMgr::getInstance()->shouldShowSelection());
 }
 
+//-----------------------------------------------------------------------------
+// beginSkin()
+//-----------------------------------------------------------------------------
+BOOL LLVOAvatar::beginSkin()
+{
+	// Your own avatar's head depends on the camera mode and impostors are
+	// only skinned when they are regenerated, so leave those to renderSkinned()
+	if (!mIsBuilt || mIsSelf || isDead() || !isVisible() || isImpostor()
+		|| LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) > 0)
+	{
+		return FALSE;
+	}
+
+	if (mDirtyMesh || mDrawable->isState(LLDrawable::REBUILD_GEOMETRY))
+	{	//LOD changed or new mesh created, allocate new vertex buffer if needed
+		updateMeshData();
+		mDirtyMesh = FALSE;
+		mNeedsSkin = TRUE;
+		mDrawable->clearState(LLDrawable::REBUILD_GEOMETRY);
+	}
+
+	LLFace* face = mDrawable->getFace(0);
+	if (!mNeedsSkin || !face || face->mVertexBuffer.isNull())
+	{
+		return FALSE;
+	}
+
+	// Map it here so that skinMeshes() never has to touch GL
+	return face->mVertexBuffer->mapBuffer() != NULL;
+}
+
+//-----------------------------------------------------------------------------
+// skinMeshes()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::skinMeshes()
+{
+	//generate animated mesh
+	mMeshLOD[MESH_ID_LOWER_BODY]->updateJointGeometry();
+	mMeshLOD[MESH_ID_UPPER_BODY]->updateJointGeometry();
+
+	if( isWearingWearableType( WT_SKIRT ) )
+	{
+		mMeshLOD[MESH_ID_SKIRT]->updateJointGeometry();
+	}
+
+	if (!mIsSelf || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
+	{
+		mMeshLOD[MESH_ID_EYELASH]->updateJointGeometry();
+		mMeshLOD[MESH_ID_HEAD]->updateJointGeometry();
+		mMeshLOD[MESH_ID_HAIR]->updateJointGeometry();
+	}
+	mNeedsSkin = FALSE;
+}
+
+//-----------------------------------------------------------------------------
+// endSkin()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::endSkin()
+{
+	LLVertexBuffer* vb = mDrawable->getFace(0)->mVertexBuffer;
+	if (vb)
+	{
+		vb->setBuffer(0);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // renderSkinned()
 //-----------------------------------------------------------------------------
@@ -4838,28 +4904,10 @@ U32 LLVOAvatar::renderSkinned(EAvatarRenderPass pass)
 	{
 		if (mNeedsSkin)
 		{
-			//generate animated mesh
-			mMeshLOD[MESH_ID_LOWER_BODY]->updateJointGeometry();
-			mMeshLOD[MESH_ID_UPPER_BODY]->updateJointGeometry();
-
-			if( isWearingWearableType( WT_SKIRT ) )
-			{
-				mMeshLOD[MESH_ID_SKIRT]->updateJointGeometry();
-			}
-
-			if (!mIsSelf || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
-			{
-				mMeshLOD[MESH_ID_EYELASH]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HEAD]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HAIR]->updateJointGeometry();
-			}
-			mNeedsSkin = FALSE;
-
-			LLVertexBuffer* vb = mDrawable->getFace(0)->mVertexBuffer;
-			if (vb)
-			{
-				vb->setBuffer(0);
-			}
+			//not skinned ahead by the skin queue (self, impostor updates,
+			//or no worker threads)
+			skinMeshes();
+			endSkin();
 		}
 	}
 	else
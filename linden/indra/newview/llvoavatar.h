@@ -133,6 +133,13 @@ public:
 	U32 renderImpostor(LLColor4U color = LLColor4U(255,255,255,255));
 	U32 renderRigid();
 	U32 renderSkinned(EAvatarRenderPass pass);
+	// Skinning ahead of rendering, see LLAvatarSkinQueue. beginSkin() maps
+	// the vertex buffer and returns TRUE if the meshes need skinning this
+	// frame; skinMeshes() may then run on any thread, and endSkin() unmaps
+	// the buffer again.
+	BOOL beginSkin();
+	void skinMeshes();
+	void endSkin();
 	U32 renderTransparent(BOOL first_pass);
 	void renderCollisionVolumes();
 	
@@ -34,12 +34,25 @@
 
 #include "llvocache.h"
 
+#include <algorithm>
+
+#include "llappviewer.h"
 #include "llerror.h"
+#include "lllfsthread.h"
+
+// Viewer object cache version, change if object update
+// format changes. JC
+// Version 15: memory mapped format with an index sorted by local ID
+const U32 INDRA_OBJECT_CACHE_VERSION = 15;
+const S32 MAX_CACHE_ENTRY_SIZE = 10000;
 
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
 //---------------------------------------------------------------------------
 
+//static
+S32 LLVOCacheEntry::sAllocatedBytes = 0;
+
 LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp)
 {
 	mLocalID = local_id;
@@ -50,6 +63,7 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mBuffer = new U8[dp.getBufferSize()];
 	mDP.assignBuffer(mBuffer, dp.getBufferSize());
 	mDP = dp;
+	sAllocatedBytes += dp.getBufferSize();
 }
 
 LLVOCacheEntry::LLVOCacheEntry()
@@ -64,48 +78,24 @@ LLVOCacheEntry::LLVOCacheEntry()
 }
 
 
-static inline void checkedRead(LLFILE *fp, void *data, size_t nbytes)
-{
-	if (fread(data, 1, nbytes, fp) != nbytes)
-	{
-		llwarns << "Short read" << llendl;
-		memset(data, 0, nbytes);
-	}
-}
-
-LLVOCacheEntry::LLVOCacheEntry(LLFILE *fp)
+LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, S32 hits, S32 dupes, S32 crc_changes, const U8* data, S32 size)
 {
-	S32 size;
-	checkedRead(fp, &mLocalID, sizeof(U32));
-	checkedRead(fp, &mCRC, sizeof(U32));
-	checkedRead(fp, &mHitCount, sizeof(S32));
-	checkedRead(fp, &mDupeCount, sizeof(S32));
-	checkedRead(fp, &mCRCChangeCount, sizeof(S32));
-
-	checkedRead(fp, &size, sizeof(S32));
-
-	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
-	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-		llwarns << "Bogus cache entry, size " << size << ", aborting!" << llendl;
-		mLocalID = 0;
-		mCRC = 0;
-		mBuffer = NULL;
-		return;
-	}
-
+	mLocalID = local_id;
+	mCRC = crc;
+	mHitCount = hits;
+	mDupeCount = dupes;
+	mCRCChangeCount = crc_changes;
 	mBuffer = new U8[size];
-	checkedRead(fp, mBuffer, size);
+	memcpy(mBuffer, data, size);		/* Flawfinder: ignore */
 	mDP.assignBuffer(mBuffer, size);
+	sAllocatedBytes += size;
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
 {
 	if (mBuffer)
 	{
+		sAllocatedBytes -= mDP.getBufferSize();
 		delete [] mBuffer;
 	}
 }
@@ -121,6 +111,7 @@ void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 		mHitCount = 0;
 		mCRCChangeCount++;
 
+		sAllocatedBytes += dp.getBufferSize() - mDP.getBufferSize();
 		mDP.freeBuffer();
 		mBuffer = new U8[dp.getBufferSize()];
 		mDP.assignBuffer(mBuffer, dp.getBufferSize());
@@ -157,22 +148,299 @@ void LLVOCacheEntry::dump() const
 		<< llendl;
 }
 
-static inline void checkedWrite(LLFILE *fp, const void *data, size_t nbytes)
+//---------------------------------------------------------------------------
+// LLVOCacheFile
+//---------------------------------------------------------------------------
+
+namespace
+{
+	// Renames the temporary file over the cache file once the cache write
+	// thread has written it, and owns the file image until then
+	class LLVOCacheWriteResponder : public LLLFSThread::Responder
+	{
+	public:
+		LLVOCacheWriteResponder(const std::string& filename, const std::string& temp_filename,
+								U8* data, S32 size)
+			: mFilename(filename),
+			  mTempFilename(temp_filename),
+			  mData(data),
+			  mSize(size)
+		{
+		}
+
+		/*virtual*/ void completed(S32 bytes)
+		{
+			if (bytes == mSize)
+			{
+				commit(mFilename, mTempFilename);
+			}
+			else
+			{
+				llwarns << "Unable to write cache file " << mFilename << llendl;
+				LLFile::remove(mTempFilename);
+			}
+			delete [] mData;
+			mData = NULL;
+		}
+
+		static void commit(const std::string& filename, const std::string& temp_filename)
+		{
+#if LL_WINDOWS
+			// rename() does not replace an existing file on Windows
+			LLFile::remove(filename);
+#endif
+			if (LLFile::rename(temp_filename, filename) != 0)
+			{
+				llwarns << "Unable to replace cache file " << filename << llendl;
+				LLFile::remove(temp_filename);
+			}
+		}
+
+	protected:
+		~LLVOCacheWriteResponder()
+		{
+			delete [] mData;
+		}
+
+	private:
+		std::string mFilename;
+		std::string mTempFilename;
+		U8* mData;
+		S32 mSize;
+	};
+
+	bool local_id_less(const LLVOCacheFile::IndexEntry& lhs, const LLVOCacheFile::IndexEntry& rhs)
+	{
+		return lhs.mLocalID < rhs.mLocalID;
+	}
+}
+
+LLVOCacheFile::LLVOCacheFile()
+	: mIndex(NULL),
+	  mNumEntries(0),
+	  mCount(0),
+	  mDropCursor(0)
+{
+}
+
+bool LLVOCacheFile::open(const std::string& filename, const LLUUID& cache_id)
+{
+	close();
+
+	if (!LLFile::isfile(filename))
+	{
+		// might not have a file, which is normal
+		return false;
+	}
+	if (!mFile.map(filename, U32_MAX, true))
+	{
+		return false;
+	}
+
+	const U8* data = mFile.getData();
+	const size_t size = mFile.getSize();
+	if (size < sizeof(Header))
+	{
+		llinfos << "Cache file invalid" << llendl;
+		close();
+		return false;
+	}
+
+	const Header* header = (const Header*)data;
+	if (header->mZero || header->mVersion != INDRA_OBJECT_CACHE_VERSION)
+	{
+		// a version mismatch here means we've changed the binary format!
+		llinfos << "Cache version changed, discarding" << llendl;
+		close();
+		return false;
+	}
+	if (memcmp(header->mCacheID, cache_id.mData, UUID_BYTES))
+	{
+		llinfos << "Cache ID doesn't match for this region, discarding" << llendl;
+		close();
+		return false;
+	}
+	if (header->mNumEntries > (size - sizeof(Header)) / sizeof(IndexEntry))
+	{
+		llwarns << "Truncated cache file " << filename << ", discarding" << llendl;
+		close();
+		return false;
+	}
+
+	// Check the whole index up front, lookups trust it afterwards
+	const IndexEntry* index = (const IndexEntry*)(data + sizeof(Header));
+	for (U32 i = 0; i < header->mNumEntries; ++i)
+	{
+		const IndexEntry& entry = index[i];
+		if (!entry.mLocalID
+			|| (i > 0 && entry.mLocalID <= index[i - 1].mLocalID)
+			|| entry.mSize < 1 || entry.mSize > (U32)MAX_CACHE_ENTRY_SIZE
+			|| entry.mOffset > size || entry.mSize > size - entry.mOffset)
+		{
+			llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
+			close();
+			return false;
+		}
+	}
+
+	mIndex = index;
+	mNumEntries = header->mNumEntries;
+	mDropped.assign(mNumEntries, false);
+	mCount = mNumEntries;
+	return true;
+}
+
+void LLVOCacheFile::close()
 {
-	if (fwrite(data, 1, nbytes, fp) != nbytes)
+	mFile.unmap();
+	mIndex = NULL;
+	mNumEntries = 0;
+	mDropped.clear();
+	mCount = 0;
+	mDropCursor = 0;
+}
+
+const LLVOCacheFile::IndexEntry* LLVOCacheFile::find(U32 local_id) const
+{
+	if (!mCount)
+	{
+		return NULL;
+	}
+	IndexEntry key;
+	key.mLocalID = local_id;
+	const IndexEntry* end = mIndex + mNumEntries;
+	const IndexEntry* iter = std::lower_bound(mIndex, end, key, local_id_less);
+	if (iter == end || iter->mLocalID != local_id || mDropped[iter - mIndex])
 	{
-		llwarns << "Short write" << llendl;
+		return NULL;
 	}
+	return iter;
+}
+
+LLVOCacheEntry* LLVOCacheFile::materialize(const IndexEntry* index)
+{
+	LLVOCacheEntry* entry = new LLVOCacheEntry(index->mLocalID, index->mCRC,
+											   index->mHitCount, index->mDupeCount, index->mCRCChangeCount,
+											   mFile.getData() + index->mOffset, index->mSize);
+	drop(index);
+	return entry;
+}
+
+void LLVOCacheFile::drop(const IndexEntry* index)
+{
+	U32 i = index - mIndex;
+	llassert(i < mNumEntries && !mDropped[i]);
+	mDropped[i] = true;
+	mCount--;
 }
 
-void LLVOCacheEntry::writeToFile(LLFILE *fp) const
+bool LLVOCacheFile::dropOne()
 {
-	checkedWrite(fp, &mLocalID, sizeof(U32));
-	checkedWrite(fp, &mCRC, sizeof(U32));
-	checkedWrite(fp, &mHitCount, sizeof(S32));
-	checkedWrite(fp, &mDupeCount, sizeof(S32));
-	checkedWrite(fp, &mCRCChangeCount, sizeof(S32));
-	S32 size = mDP.getBufferSize();
-	checkedWrite(fp, &size, sizeof(S32));
-	checkedWrite(fp, mBuffer, size);
+	while (mDropCursor < mNumEntries)
+	{
+		U32 i = mDropCursor++;
+		if (!mDropped[i])
+		{
+			drop(mIndex + i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void LLVOCacheFile::save(const std::string& filename, const LLUUID& cache_id,
+						 const std::vector<LLVOCacheEntry*>& entries) const
+{
+	// Until the layout is known, mOffset holds the position of the entry's
+	// data pointer in sources
+	std::vector<IndexEntry> index;
+	std::vector<const U8*> sources;
+	index.reserve(entries.size() + mCount);
+	for (std::vector<LLVOCacheEntry*>::const_iterator iter = entries.begin();
+		 iter != entries.end(); ++iter)
+	{
+		const LLVOCacheEntry* entry = *iter;
+		S32 size = entry->getDataSize();
+		if (!entry->getLocalID() || size < 1 || size > MAX_CACHE_ENTRY_SIZE)
+		{
+			continue;
+		}
+		IndexEntry out;
+		out.mLocalID = entry->getLocalID();
+		out.mCRC = entry->getCRC();
+		out.mHitCount = entry->getHitCount();
+		out.mDupeCount = entry->getDupeCount();
+		out.mCRCChangeCount = entry->getCRCChangeCount();
+		out.mOffset = (U32)index.size();
+		out.mSize = (U32)size;
+		index.push_back(out);
+		sources.push_back(entry->getData());
+	}
+	for (U32 i = 0; i < mNumEntries; ++i)
+	{
+		if (!mDropped[i])
+		{
+			IndexEntry out = mIndex[i];
+			out.mOffset = (U32)index.size();
+			index.push_back(out);
+			sources.push_back(mFile.getData() + mIndex[i].mOffset);
+		}
+	}
+	if (index.empty())
+	{
+		return;
+	}
+	std::sort(index.begin(), index.end(), local_id_less);
+
+	// Lay out and fill in the file image
+	U32 total = sizeof(Header) + index.size() * sizeof(IndexEntry);
+	for (std::vector<IndexEntry>::iterator iter = index.begin(); iter != index.end(); ++iter)
+	{
+		total += iter->mSize;
+	}
+	U8* data = new U8[total];
+	Header* header = (Header*)data;
+	header->mZero = 0;
+	header->mVersion = INDRA_OBJECT_CACHE_VERSION;
+	memcpy(header->mCacheID, cache_id.mData, UUID_BYTES);		/* Flawfinder: ignore */
+	header->mNumEntries = index.size();
+	IndexEntry* out_index = (IndexEntry*)(data + sizeof(Header));
+	U32 offset = sizeof(Header) + index.size() * sizeof(IndexEntry);
+	for (U32 i = 0; i < index.size(); ++i)
+	{
+		out_index[i] = index[i];
+		out_index[i].mOffset = offset;
+		memcpy(data + offset, sources[index[i].mOffset], index[i].mSize);		/* Flawfinder: ignore */
+		offset += index[i].mSize;
+	}
+
+	// Write to a temporary file and swap it in, so that a crash (or a slow
+	// write still pending when the region comes back) never leaves a torn
+	// cache file behind
+	std::string temp_filename = filename + ".tmp";
+	LLFile::remove(temp_filename);
+	LLLFSThread* write_thread = LLAppViewer::getCacheWriteThread();
+	if (write_thread)
+	{
+		write_thread->write(temp_filename, data, 0, total,
+							new LLVOCacheWriteResponder(filename, temp_filename, data, total));
+	}
+	else
+	{
+		LLFILE* fp = LLFile::fopen(temp_filename, "wb");		/* Flawfinder: ignore */
+		bool ok = fp && fwrite(data, 1, total, fp) == total;
+		if (fp)
+		{
+			fclose(fp);
+		}
+		if (ok)
+		{
+			LLVOCacheWriteResponder::commit(filename, temp_filename);
+		}
+		else
+		{
+			llwarns << "Unable to write cache file " << filename << llendl;
+		}
+		delete [] data;
+	}
 }
@@ -33,9 +33,12 @@
 #ifndef LL_LLVOCACHE_H
 #define LL_LLVOCACHE_H
 
+#include <vector>
+
 #include "lluuid.h"
 #include "lldatapacker.h"
 #include "lldlinked.h"
+#include "llmappedfile.h"
 
 
 //---------------------------------------------------------------------------
@@ -46,22 +49,26 @@ class LLVOCacheEntry : public LLDLinked<LLVOCacheEntry>
 {
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLFILE *fp);
+	LLVOCacheEntry(U32 local_id, U32 crc, S32 hits, S32 dupes, S32 crc_changes, const U8* data, S32 size);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
 	U32 getLocalID() const			{ return mLocalID; }
 	U32 getCRC() const				{ return mCRC; }
 	S32 getHitCount() const			{ return mHitCount; }
+	S32 getDupeCount() const		{ return mDupeCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
+	const U8* getData() const		{ return mBuffer; }
+	S32 getDataSize() const			{ return mDP.getBufferSize(); }
 
 	void dump() const;
-	void writeToFile(LLFILE *fp) const;
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
 	LLDataPackerBinaryBuffer *getDP(U32 crc);
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
 
+	static S32 sAllocatedBytes; // data held by all entries, MAIN THREAD
+
 protected:
 	U32							mLocalID;
 	U32							mCRC;
@@ -72,4 +79,73 @@ protected:
 	U8							*mBuffer;
 };
 
+//---------------------------------------------------------------------------
+// Cache file
+//
+// Layout of objects_<x>_<y>.slc:
+//   Header
+//   IndexEntry[mNumEntries], sorted by local ID
+//   packed object data, at the offsets given by the index
+//
+// The file is memory mapped when the region is loaded. An entry only becomes
+// an LLVOCacheEntry (and leaves the file) when its object is seen again, so
+// a region with thousands of cached objects loads in the time it takes to
+// check the index.
+
+class LLVOCacheFile
+{
+public:
+	struct Header
+	{
+		U32 mZero; // always 0, older files started with an entry count
+		U32 mVersion;
+		U8 mCacheID[UUID_BYTES];
+		U32 mNumEntries;
+	};
+
+	struct IndexEntry
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		S32 mHitCount;
+		S32 mDupeCount;
+		S32 mCRCChangeCount;
+		U32 mOffset; // from the start of the file
+		U32 mSize;
+	};
+
+	LLVOCacheFile();
+
+	// Maps filename, returns false if it is missing, corrupt, of an older
+	// version or belongs to another region
+	bool open(const std::string& filename, const LLUUID& cache_id);
+	void close();
+
+	// Entries still in the file, i.e. neither materialized nor dropped
+	U32 getCount() const { return mCount; }
+	const IndexEntry* find(U32 local_id) const;
+
+	// Moves an entry out of the file into a new LLVOCacheEntry
+	LLVOCacheEntry* materialize(const IndexEntry* index);
+	void drop(const IndexEntry* index);
+	// Drops the entry with the lowest local ID, returns false if there is none.
+	// Entries still in the file have not been seen this session, so they
+	// are evicted before anything in the region's LRU list.
+	bool dropOne();
+
+	// Writes entries plus the entries still in this file to filename. The
+	// file image is built here, the disk write happens on the cache write
+	// thread (LLAppViewer::getCacheWriteThread()).
+	void save(const std::string& filename, const LLUUID& cache_id,
+			  const std::vector<LLVOCacheEntry*>& entries) const;
+
+private:
+	LLMappedFile mFile;
+	const IndexEntry* mIndex;
+	U32 mNumEntries;
+	std::vector<bool> mDropped;
+	U32 mCount;
+	U32 mDropCursor; // entries below this are all dropped
+};
+
 #endif
@@ -0,0 +1,222 @@
+/**
+ * @file llvolumebuildqueue.cpp
+ * @brief Generates volume LODs and sculpts on the shared thread pool.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llvolumebuildqueue.h"
+
+#include "llimage.h"
+#include "llprimitive.h"
+#include "llvolumemgr.h"
+#include "llvovolume.h"
+
+//----------------------------------------------------------------------------
+
+LLVolumeBuildQueue::BuildRequest::BuildRequest(handle_t handle, U32 priority,
+											   const LLVolumeParams& params, F32 detail,
+											   LLImageRaw* sculpt_image, S32 sculpt_level)
+	: LLQueuedThread::QueuedRequest(handle, priority),
+	  mParams(params),
+	  mDetail(detail),
+	  mSculptLevel(sculpt_level)
+{
+	if (sculpt_image && sculpt_image->getData())
+	{
+		// The texture's cached raw image may be replaced while we work
+		mSculptImage = new LLImageRaw(sculpt_image->getData(), sculpt_image->getWidth(),
+									  sculpt_image->getHeight(), sculpt_image->getComponents());
+	}
+}
+
+LLVolumeBuildQueue::BuildRequest::~BuildRequest()
+{
+}
+
+// WORKER THREAD
+bool LLVolumeBuildQueue::BuildRequest::processRequest()
+{
+	LLPointer<LLVolume> volumep = new LLVolume(mParams, mDetail);
+	if (mParams.getSculptID().notNull())
+	{
+		// Same as LLVOVolume::sculpt(), which does this on the main thread
+		if (mSculptImage.notNull())
+		{
+			volumep->sculpt(mSculptImage->getWidth(), mSculptImage->getHeight(),
+							mSculptImage->getComponents(), mSculptImage->getData(), mSculptLevel);
+		}
+		else
+		{
+			volumep->sculpt(0, 0, 0, NULL, mSculptLevel);
+		}
+	}
+	mVolume = volumep;
+	return true;
+}
+
+// MAIN THREAD
+LLPointer<LLVolume> LLVolumeBuildQueue::BuildRequest::takeVolume()
+{
+	LLPointer<LLVolume> volumep = mVolume;
+	mVolume = NULL;
+	mSculptImage = NULL;
+	return volumep;
+}
+
+//----------------------------------------------------------------------------
+
+LLVolumeBuildQueue::LLVolumeBuildQueue()
+	: LLQueuedThread("Volume build", false)
+{
+}
+
+LLVolumeBuildQueue::~LLVolumeBuildQueue()
+{
+	shutdown();
+}
+
+// MAIN THREAD
+void LLVolumeBuildQueue::shutdown()
+{
+	// Unfinished requests are deleted here, on the main thread
+	LLQueuedThread::shutdown();
+	mBuilds.clear();
+}
+
+void LLVolumeBuildQueue::requestLOD(LLVOVolume* object, const LLVolumeParams& params, S32 detail,
+									LLImageRaw* sculpt_image, S32 sculpt_level)
+{
+	build_key key;
+	key.mParams = params;
+	key.mDetail = detail;
+	key.mTarget = NULL;
+	addBuild(object, key, LLVolumeLODGroup::getVolumeScaleFromDetail(detail), NULL,
+			 sculpt_image, sculpt_level);
+}
+
+void LLVolumeBuildQueue::requestSculpt(LLVOVolume* object, LLVolume* target,
+									   LLImageRaw* sculpt_image, S32 sculpt_level)
+{
+	build_key key;
+	key.mParams = target->getParams();
+	key.mDetail = -1;
+	key.mTarget = target;
+	addBuild(object, key, target->getDetail(), target, sculpt_image, sculpt_level);
+}
+
+void LLVolumeBuildQueue::addBuild(LLVOVolume* object, const build_key& key, F32 detail, LLVolume* target,
+								  LLImageRaw* sculpt_image, S32 sculpt_level)
+{
+	// Bigger objects first
+	U32 priority = LLQueuedThread::PRIORITY_NORMAL |
+		llmin((U32)llmax(object->getPixelArea(), 0.f), (U32)LLQueuedThread::PRIORITY_LOWBITS);
+
+	build_map_t::iterator iter = mBuilds.find(key);
+	if (iter != mBuilds.end())
+	{
+		// Already building, wait for that one
+		pending_build& build = iter->second;
+		if (std::find(build.mWaiters.begin(), build.mWaiters.end(), object) == build.mWaiters.end())
+		{
+			build.mWaiters.push_back(object);
+			setPriority(build.mHandle, priority);
+		}
+		return;
+	}
+
+	handle_t handle = generateHandle();
+	BuildRequest* req = new BuildRequest(handle, priority, key.mParams, detail, sculpt_image, sculpt_level);
+	pending_build& build = mBuilds[key];
+	build.mHandle = handle;
+	build.mTarget = target;
+	build.mWaiters.push_back(object);
+	addRequest(req);
+}
+
+// MAIN THREAD
+S32 LLVolumeBuildQueue::updateBuilds()
+{
+	for (build_map_t::iterator iter = mBuilds.begin(); iter != mBuilds.end(); )
+	{
+		build_map_t::iterator cur = iter++;
+		handle_t handle = cur->second.mHandle;
+		status_t status = getRequestStatus(handle);
+		if (status == STATUS_COMPLETE || status == STATUS_ABORTED)
+		{
+			LLPointer<LLVolume> volumep;
+			BuildRequest* req = (BuildRequest*)getRequest(handle);
+			if (req)
+			{
+				volumep = req->takeVolume();
+				completeRequest(handle);
+			}
+			finishBuild(cur->first, cur->second, volumep);
+			mBuilds.erase(cur);
+		}
+		else if (status == STATUS_EXPIRED)
+		{
+			mBuilds.erase(cur);
+		}
+	}
+	return (S32)mBuilds.size();
+}
+
+// MAIN THREAD
+void LLVolumeBuildQueue::finishBuild(const build_key& key, pending_build& build, LLVolume* volumep)
+{
+	BOOL sculpt = build.mTarget.notNull();
+	if (volumep)
+	{
+		if (sculpt)
+		{
+			// Refine the volume in place, as LLVOVolume::sculpt() would
+			if (build.mTarget->getSculptLevel() != volumep->getSculptLevel())
+			{
+				build.mTarget->swapGeometry(*volumep);
+			}
+		}
+		else
+		{
+			// Fails harmlessly if nothing uses the group any more, or the
+			// LOD was built synchronously in the meantime
+			LLPrimitive::getVolumeManager()->insertVolume(volumep, key.mDetail);
+		}
+	}
+
+	for (U32 i = 0; i < build.mWaiters.size(); i++)
+	{
+		LLVOVolume* object = build.mWaiters[i];
+		if (!object->isDead())
+		{
+			object->onVolumeBuilt(sculpt);
+		}
+	}
+}
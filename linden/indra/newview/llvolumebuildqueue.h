@@ -0,0 +1,139 @@
+/**
+ * @file llvolumebuildqueue.h
+ * @brief Generates volume LODs and sculpts on the shared thread pool.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMEBUILDQUEUE_H
+#define LL_LLVOLUMEBUILDQUEUE_H
+
+#include <map>
+#include <vector>
+
+#include "llqueuedthread.h"
+#include "llvolume.h"
+
+class LLImageRaw;
+class LLVOVolume;
+
+// Builds LLVolumes off the main thread. An object asks for a LOD its volume
+// group doesn't have yet, or for its sculpt to be regenerated from a better
+// sculpt texture, and keeps drawing its current volume meanwhile.
+// updateBuilds() hands finished volumes to the volume manager on the main
+// thread and marks the waiting objects for a rebuild, which regenerates their
+// faces and vertex buffers through the pipeline's normal build queue.
+//
+// Volumes are only ever destroyed on the main thread: LLVolume's destructor
+// is not thread safe (see profile_delete_lock).
+class LLVolumeBuildQueue : public LLQueuedThread
+{
+public:
+	class BuildRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~BuildRequest(); // use deleteRequest()
+
+	public:
+		BuildRequest(handle_t handle, U32 priority,
+					 const LLVolumeParams& params, F32 detail,
+					 LLImageRaw* sculpt_image, S32 sculpt_level);
+
+		/*virtual*/ bool processRequest();
+
+		// MAIN THREAD, once complete: takes the generated volume, leaving
+		// nothing for the request to release on a worker
+		LLPointer<LLVolume> takeVolume();
+
+	private:
+		// input
+		LLVolumeParams mParams;
+		F32 mDetail; // volume detail scale, see LLVolumeLODGroup
+		LLPointer<LLImageRaw> mSculptImage; // private copy, NULL for no sculpt data
+		S32 mSculptLevel;
+		// output
+		LLPointer<LLVolume> mVolume;
+	};
+
+public:
+	// Has no thread of its own, attach it to an LLThreadPool
+	LLVolumeBuildQueue();
+	virtual ~LLVolumeBuildQueue();
+	/*virtual*/ void shutdown();
+
+	// Generates LOD detail of params for the volume manager. sculpt_image is
+	// copied, so may be NULL or change after the call.
+	void requestLOD(LLVOVolume* object, const LLVolumeParams& params, S32 detail,
+					LLImageRaw* sculpt_image, S32 sculpt_level);
+	// Regenerates the sculpt of target, a volume in use, at sculpt_level.
+	void requestSculpt(LLVOVolume* object, LLVolume* target,
+					   LLImageRaw* sculpt_image, S32 sculpt_level);
+
+	// MAIN THREAD: applies finished builds and notifies waiting objects.
+	// Returns the number of builds still pending.
+	S32 updateBuilds();
+
+	S32 getPendingBuilds() const { return (S32)mBuilds.size(); }
+
+private:
+	struct build_key
+	{
+		LLVolumeParams mParams;
+		S32 mDetail; // LOD, -1 for a sculpt
+		LLVolume* mTarget; // NULL for a new LOD
+
+		bool operator<(const build_key& rhs) const
+		{
+			if (mTarget != rhs.mTarget)
+			{
+				return mTarget < rhs.mTarget;
+			}
+			if (mDetail != rhs.mDetail)
+			{
+				return mDetail < rhs.mDetail;
+			}
+			return mParams < rhs.mParams;
+		}
+	};
+
+	struct pending_build
+	{
+		handle_t mHandle;
+		LLPointer<LLVolume> mTarget; // keeps the key's target alive
+		std::vector<LLPointer<LLVOVolume> > mWaiters;
+	};
+
+	void addBuild(LLVOVolume* object, const build_key& key, F32 detail, LLVolume* target,
+				  LLImageRaw* sculpt_image, S32 sculpt_level);
+	void finishBuild(const build_key& key, pending_build& build, LLVolume* volumep);
+
+	typedef std::map<build_key, pending_build> build_map_t;
+	build_map_t mBuilds;
+};
+
+#endif // LL_LLVOLUMEBUILDQUEUE_H
@@ -0,0 +1,431 @@
+/**
+ * @file llvolumecache.cpp
+ * @brief Disk cache of generated prim and sculpt geometry.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llvolumecache.h"
+
+#include <algorithm>
+#if LL_WINDOWS
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include "llappviewer.h"
+#include "lldir.h"
+#include "llerror.h"
+#include "lllfsthread.h"
+#include "llmappedfile.h"
+#include "llmd5.h"
+
+// Version 1: one memory mapped file per volume
+const U32 LL_VOLUME_CACHE_VERSION = 1;
+const F32 VOLUME_CACHE_TRIM_TARGET = 0.8f; // fraction of the maximum size left after a trim
+
+static const char* const VOLUME_CACHE_SUBDIRS = "0123456789abcdef";
+
+LLVolumeCache* LLVolumeCache::sInstance = NULL;
+
+namespace
+{
+	// Renames the temporary file over the cache file once the cache write
+	// thread has written it, and owns the file data until then
+	class LLVolumeCacheWriteResponder : public LLLFSThread::Responder
+	{
+	public:
+		LLVolumeCacheWriteResponder(const std::string& filename, const std::string& temp_filename,
+									U8* data, S32 size)
+			: mFilename(filename),
+			  mTempFilename(temp_filename),
+			  mData(data),
+			  mSize(size)
+		{
+		}
+
+		/*virtual*/ void completed(S32 bytes)
+		{
+			if (bytes == mSize)
+			{
+				commit(mFilename, mTempFilename);
+			}
+			else
+			{
+				LLFile::remove(mTempFilename);
+			}
+			delete [] mData;
+			mData = NULL;
+		}
+
+		static void commit(const std::string& filename, const std::string& temp_filename)
+		{
+#if LL_WINDOWS
+			// rename() does not replace an existing file on Windows
+			LLFile::remove(filename);
+#endif
+			if (LLFile::rename(temp_filename, filename) != 0)
+			{
+				LLFile::remove(temp_filename);
+			}
+		}
+
+	protected:
+		~LLVolumeCacheWriteResponder()
+		{
+			delete [] mData;
+		}
+
+	private:
+		std::string mFilename;
+		std::string mTempFilename;
+		U8* mData;
+		S32 mSize;
+	};
+
+	// Sets the modification time of filename to now
+	void touch_file(const std::string& filename)
+	{
+#if LL_WINDOWS
+		llutf16string utf16filename = utf8str_to_utf16str(filename);
+		_wutime(utf16filename.c_str(), NULL);
+#else
+		utime(filename.c_str(), NULL);
+#endif
+	}
+
+	struct cache_file
+	{
+		std::string mName;
+		S64 mSize;
+		time_t mTime;
+
+		bool operator<(const cache_file& rhs) const
+		{
+			return mTime < rhs.mTime;
+		}
+	};
+}
+
+//---------------------------------------------------------------------------
+
+//static
+void LLVolumeCache::initClass(const std::string& dirname, S64 max_size, bool read_only)
+{
+	llassert(!sInstance);
+	sInstance = new LLVolumeCache(dirname, max_size, read_only);
+	LLVolume::setGeometryCache(sInstance);
+}
+
+//static
+void LLVolumeCache::cleanupClass()
+{
+	if (sInstance)
+	{
+		LLVolume::setGeometryCache(NULL);
+		llinfos << "Volume cache hits: " << sInstance->getHits()
+				<< " misses: " << sInstance->getMisses() << llendl;
+		sInstance->update(); // the cache write thread finishes the writes
+		delete sInstance;
+		sInstance = NULL;
+	}
+}
+
+//static
+void LLVolumeCache::purgeFiles(const std::string& dirname)
+{
+	std::string delem = gDirUtilp->getDirDelimiter();
+	for (S32 i = 0; i < 16; i++)
+	{
+		std::string subdirname = dirname + delem + VOLUME_CACHE_SUBDIRS[i];
+		gDirUtilp->deleteFilesInDir(subdirname, delem + "*");
+	}
+}
+
+LLVolumeCache::LLVolumeCache(const std::string& dirname, S64 max_size, bool read_only)
+	: mDirName(dirname),
+	  mMaxSize(max_size),
+	  mSize(0),
+	  mReadOnly(read_only),
+	  mWriteCount(0)
+{
+	mFull = 0;
+	mHits = 0;
+	mMisses = 0;
+
+	if (!mReadOnly)
+	{
+		LLFile::mkdir(mDirName);
+		std::string delem = gDirUtilp->getDirDelimiter();
+		for (S32 i = 0; i < 16; i++)
+		{
+			LLFile::mkdir(mDirName + delem + VOLUME_CACHE_SUBDIRS[i]);
+		}
+		trim();
+	}
+}
+
+LLVolumeCache::~LLVolumeCache()
+{
+	for (std::vector<PendingWrite>::iterator iter = mPending.begin(); iter != mPending.end(); ++iter)
+	{
+		delete [] iter->mData;
+	}
+}
+
+//static
+void LLVolumeCache::makeKey(const LLVolume* volume, S32 sculpt_level, U32 sculpt_crc, Key& key)
+{
+	// Zero the padding too, the key is hashed and compared bytewise
+	memset(&key, 0, sizeof(Key));
+
+	const LLVolumeParams& params = volume->getParams();
+	const LLProfileParams& profile = params.getProfileParams();
+	const LLPathParams& path = params.getPathParams();
+	key.mProfileCurve = profile.getCurveType();
+	key.mPathCurve = path.getCurveType();
+	key.mSculptType = params.getSculptType();
+	key.mProfileBegin = profile.getBegin();
+	key.mProfileEnd = profile.getEnd();
+	key.mHollow = profile.getHollow();
+	key.mPathBegin = path.getBegin();
+	key.mPathEnd = path.getEnd();
+	key.mScale[0] = path.getScaleX();
+	key.mScale[1] = path.getScaleY();
+	key.mShear[0] = path.getShearX();
+	key.mShear[1] = path.getShearY();
+	key.mTwistBegin = path.getTwistBegin();
+	key.mTwistEnd = path.getTwist();
+	key.mRadiusOffset = path.getRadiusOffset();
+	key.mTaper[0] = path.getTaperX();
+	key.mTaper[1] = path.getTaperY();
+	key.mRevolutions = path.getRevolutions();
+	key.mSkew = path.getSkew();
+	memcpy(key.mSculptID, params.getSculptID().mData, UUID_BYTES);		/* Flawfinder: ignore */
+	key.mDetail = volume->getDetail();
+	key.mSculptLevel = sculpt_level;
+	key.mSculptCRC = sculpt_crc;
+}
+
+std::string LLVolumeCache::getFilename(const Key& key) const
+{
+	LLMD5 md5;
+	md5.update((const unsigned char*)&key, sizeof(Key));
+	md5.finalize();
+	char digest[33];		/* Flawfinder: ignore */
+	md5.hex_digest(digest);
+
+	std::string delem = gDirUtilp->getDirDelimiter();
+	return mDirName + delem + digest[0] + delem + digest + ".vol";
+}
+
+BOOL LLVolumeCache::loadGeometry(LLVolume* volume, S32 sculpt_level, U32 sculpt_crc)
+{
+	Key key;
+	makeKey(volume, sculpt_level, sculpt_crc, key);
+	std::string filename = getFilename(key);
+	if (!LLFile::isfile(filename))
+	{
+		mMisses++;
+		return FALSE;
+	}
+
+	BOOL loaded = FALSE;
+	BOOL stale = TRUE;
+	LLMappedFile file;
+	if (file.map(filename, U32_MAX, true) && file.getSize() >= sizeof(Header))
+	{
+		const Header* header = (const Header*)file.getData();
+		if (header->mVersion == LL_VOLUME_CACHE_VERSION &&
+			header->mGeometryVersion == LLVolume::GEOMETRY_VERSION &&
+			header->mSize == file.getSize() - sizeof(Header))
+		{
+			// A different key with the same hash is not stale, just unlucky
+			stale = FALSE;
+			if (!memcmp(&header->mKey, &key, sizeof(Key)))
+			{
+				loaded = volume->unpackGeometry(file.getData() + sizeof(Header), header->mSize);
+				stale = !loaded;
+			}
+		}
+	}
+	file.unmap();
+
+	if (stale && !mReadOnly)
+	{
+		LL_DEBUGS("VolumeCache") << "Removing stale cache file " << filename << LL_ENDL;
+		LLFile::remove(filename);
+	}
+	if (loaded)
+	{
+		mHits++;
+		if (!mReadOnly)
+		{
+			// trim() goes by modification time, so that is the last use
+			touch_file(filename);
+		}
+	}
+	else
+	{
+		mMisses++;
+	}
+	return loaded;
+}
+
+void LLVolumeCache::storeGeometry(const LLVolume* volume, U32 sculpt_crc)
+{
+	if (mReadOnly || mFull)
+	{
+		return;
+	}
+
+	Key key;
+	makeKey(volume, volume->getSculptLevel(), sculpt_crc, key);
+	std::vector<U8> geometry;
+	volume->packGeometry(geometry);
+
+	PendingWrite write;
+	write.mFilename = getFilename(key);
+	write.mSize = sizeof(Header) + geometry.size();
+	write.mData = new U8[write.mSize];
+	Header* header = (Header*)write.mData;
+	header->mVersion = LL_VOLUME_CACHE_VERSION;
+	header->mGeometryVersion = LLVolume::GEOMETRY_VERSION;
+	header->mSize = geometry.size();
+	header->mKey = key;
+	if (!geometry.empty())
+	{
+		memcpy(write.mData + sizeof(Header), &geometry[0], geometry.size());		/* Flawfinder: ignore */
+	}
+
+	LLMutexLock lock(&mPendingMutex);
+	mPending.push_back(write);
+}
+
+// MAIN THREAD
+S32 LLVolumeCache::update()
+{
+	std::vector<PendingWrite> writes;
+	mPendingMutex.lock();
+	writes.swap(mPending);
+	mPendingMutex.unlock();
+
+	for (std::vector<PendingWrite>::iterator iter = writes.begin(); iter != writes.end(); ++iter)
+	{
+		PendingWrite& write = *iter;
+		if (mSize + write.mSize > mMaxSize)
+		{
+			llinfos << "Volume cache full at " << mSize / (1024 * 1024) << " MB" << llendl;
+			mFull = 1;
+			for ( ; iter != writes.end(); ++iter)
+			{
+				delete [] iter->mData;
+			}
+			break;
+		}
+		mSize += write.mSize;
+
+		// Concurrent writes of one volume each get their own temporary file
+		std::string temp_filename = write.mFilename + llformat(".%u.tmp", mWriteCount++);
+		LLLFSThread* write_thread = LLAppViewer::getCacheWriteThread();
+		if (write_thread)
+		{
+			write_thread->write(temp_filename, write.mData, 0, write.mSize,
+								new LLVolumeCacheWriteResponder(write.mFilename, temp_filename,
+																write.mData, write.mSize));
+		}
+		else
+		{
+			LLFILE* fp = LLFile::fopen(temp_filename, "wb");		/* Flawfinder: ignore */
+			bool ok = fp && fwrite(write.mData, 1, write.mSize, fp) == (size_t)write.mSize;
+			if (fp)
+			{
+				fclose(fp);
+			}
+			if (ok)
+			{
+				LLVolumeCacheWriteResponder::commit(write.mFilename, temp_filename);
+			}
+			else
+			{
+				LLFile::remove(temp_filename);
+			}
+			delete [] write.mData;
+		}
+	}
+	return (S32)writes.size();
+}
+
+// MAIN THREAD
+void LLVolumeCache::trim()
+{
+	std::vector<cache_file> files;
+	mSize = 0;
+	std::string delem = gDirUtilp->getDirDelimiter();
+	for (S32 i = 0; i < 16; i++)
+	{
+		std::string subdirname = mDirName + delem + VOLUME_CACHE_SUBDIRS[i];
+		// Left behind by a session that quit with writes pending
+		gDirUtilp->deleteFilesInDir(subdirname, delem + "*.tmp");
+
+		std::string name;
+		while (gDirUtilp->getNextFileInDir(subdirname, "*.vol", name, false))
+		{
+			cache_file file;
+			file.mName = subdirname + delem + name;
+			llstat file_stat;
+			if (LLFile::stat(file.mName, &file_stat) == 0)
+			{
+				file.mSize = file_stat.st_size;
+				file.mTime = file_stat.st_mtime;
+				mSize += file.mSize;
+				files.push_back(file);
+			}
+		}
+	}
+
+	if (mSize <= mMaxSize)
+	{
+		return;
+	}
+
+	// Least recently used first
+	std::sort(files.begin(), files.end());
+	S64 target = (S64)(mMaxSize * VOLUME_CACHE_TRIM_TARGET);
+	S32 removed = 0;
+	for (std::vector<cache_file>::iterator iter = files.begin(); iter != files.end() && mSize > target; ++iter)
+	{
+		LLFile::remove(iter->mName);
+		mSize -= iter->mSize;
+		removed++;
+	}
+	llinfos << "Volume cache trimmed by " << removed << " files to " << mSize / (1024 * 1024) << " MB" << llendl;
+}
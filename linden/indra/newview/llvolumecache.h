@@ -0,0 +1,142 @@
+/**
+ * @file llvolumecache.h
+ * @brief Disk cache of generated prim and sculpt geometry.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMECACHE_H
+#define LL_LLVOLUMECACHE_H
+
+#include <string>
+#include <vector>
+
+#include "llapr.h"
+#include "llthread.h"
+#include "lluuid.h"
+#include "llvolume.h"
+
+// Keeps the geometry LLVolume generates, so that shapes and sculpts seen in
+// an earlier session are loaded rather than tessellated again.
+//
+// Layout: cache/volumes/[0-f]/<MD5 of the key>.vol, one file per volume:
+//   Header, including the full key
+//   LLVolume::packGeometry() output
+//
+// Files are memory mapped to load them. New geometry is packed by whichever
+// thread generated it, and update() hands it to the cache write thread
+// (LLAppViewer::getCacheWriteThread()). A file with another cache or
+// geometry version fails its header check and is removed. Loading a file
+// touches it, and the cache is trimmed back to size, least recently used
+// files first, when the viewer starts; during a session it stops growing
+// once it is full.
+class LLVolumeCache : public LLVolumeGeometryCache
+{
+public:
+	// The key: everything the generated geometry depends on
+	struct Key
+	{
+		U8 mProfileCurve;
+		U8 mPathCurve;
+		U8 mSculptType;
+		U8 mPad;
+		F32 mProfileBegin;
+		F32 mProfileEnd;
+		F32 mHollow;
+		F32 mPathBegin;
+		F32 mPathEnd;
+		F32 mScale[2];
+		F32 mShear[2];
+		F32 mTwistBegin;
+		F32 mTwistEnd;
+		F32 mRadiusOffset;
+		F32 mTaper[2];
+		F32 mRevolutions;
+		F32 mSkew;
+		U8 mSculptID[UUID_BYTES];
+		F32 mDetail;
+		S32 mSculptLevel;
+		U32 mSculptCRC;
+	};
+
+	struct Header
+	{
+		U32 mVersion;			// LL_VOLUME_CACHE_VERSION
+		U32 mGeometryVersion;	// LLVolume::GEOMETRY_VERSION
+		U32 mSize;				// bytes of geometry after the header
+		Key mKey;
+	};
+
+	// Read only caches only load, for a second viewer sharing the cache
+	static void initClass(const std::string& dirname, S64 max_size, bool read_only);
+	static void cleanupClass();
+	static LLVolumeCache* getInstance() { return sInstance; }
+	// Removes every cache file in dirname, which need not be in use
+	static void purgeFiles(const std::string& dirname);
+
+	/*virtual*/ BOOL loadGeometry(LLVolume* volume, S32 sculpt_level, U32 sculpt_crc);
+	/*virtual*/ void storeGeometry(const LLVolume* volume, U32 sculpt_crc);
+
+	// MAIN THREAD: hands the geometry stored since the last call to the
+	// cache write thread. Returns the number of files queued.
+	S32 update();
+
+	U32 getHits() { return mHits; }
+	U32 getMisses() { return mMisses; }
+
+private:
+	LLVolumeCache(const std::string& dirname, S64 max_size, bool read_only);
+	~LLVolumeCache();
+
+	static void makeKey(const LLVolume* volume, S32 sculpt_level, U32 sculpt_crc, Key& key);
+	std::string getFilename(const Key& key) const;
+	void trim(); // MAIN THREAD
+
+	struct PendingWrite
+	{
+		std::string mFilename;
+		U8* mData;
+		S32 mSize;
+	};
+
+	static LLVolumeCache* sInstance;
+
+	std::string mDirName;
+	S64 mMaxSize;
+	S64 mSize; // on disk, as of the last trim plus what was written since
+	bool mReadOnly;
+	LLAtomicU32 mFull; // nonzero once the cache has reached mMaxSize
+	LLAtomicU32 mHits;
+	LLAtomicU32 mMisses;
+	U32 mWriteCount;
+
+	LLMutex mPendingMutex;
+	std::vector<PendingWrite> mPending;
+};
+
+#endif // LL_LLVOLUMECACHE_H
@@ -44,6 +44,7 @@
 #include "llvolume.h"
 #include "llvolumemgr.h"
 #include "llvolumemessage.h"
+#include "llvolumebuildqueue.h"
 #include "material_codes.h"
 #include "message.h"
 #include "object_flags.h"
@@ -56,6 +57,7 @@
 #include "llflexibleobject.h"
 #include "llsky.h"
 #include "lltexturefetch.h"
+#include "llthreadpool.h"
 #include "llviewercamera.h"
 #include "llviewerimagelist.h"
 #include "llviewerregion.h"
@@ -71,6 +73,7 @@
 const S32 MIN_QUIET_FRAMES_COALESCE = 30;
 const F32 FORCE_SIMPLE_RENDER_AREA = 512.f;
 const F32 FORCE_CULL_AREA = 8.f;
+const F32 MIN_OCCLUDER_RADIUS = 2.f;
 		
 BOOL gAnimateTextures = TRUE;
 extern BOOL gHideSelectedObjects;
@@ -79,6 +82,7 @@ F32 LLVOVolume::sLODFactor = 1.f;
 F32	LLVOVolume::sLODSlopDistanceFactor = 0.5f; //Changing this to zero, effectively disables the LOD transition slop 
 F32 LLVOVolume::sDistanceFactor = 1.0f;
 S32 LLVOVolume::sNumLODChanges = 0;
+LLVolumeBuildQueue* LLVOVolume::sVolumeBuildQueue = NULL;
 
 LLVOVolume::LLVOVolume(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp)
 	: LLViewerObject(id, pcode, regionp),
@@ -94,6 +98,7 @@ LLVOVolume::LLVOVolume(const LLUUID &id, const LLPCode pcode, LLViewerRegion *re
 	mNumFaces = 0;
 	mLODChanged = FALSE;
 	mSculptChanged = FALSE;
+	mSculptRebuilt = FALSE;
 	mIndexInTex = 0;
 }
 
@@ -123,6 +128,22 @@ void LLVOVolume::markDead()
 // static
 void LLVOVolume::initClass()
 {
+	if (gSavedSettings.getBOOL("RenderAsyncVolumeBuild") && LLThreadPool::getShared())
+	{
+		sVolumeBuildQueue = new LLVolumeBuildQueue();
+		LLThreadPool::getShared()->addQueue(sVolumeBuildQueue, LLThreadPool::AFFINITY_ANY, 0);
+	}
+}
+
+// static
+void LLVOVolume::cleanupClass()
+{
+	if (sVolumeBuildQueue)
+	{
+		sVolumeBuildQueue->shutdown();
+		delete sVolumeBuildQueue;
+		sVolumeBuildQueue = NULL;
+	}
 }
 
 
@@ -756,12 +777,8 @@ void LLVOVolume::sculpt()
 		S8 sculpt_components = 0;
 		const U8* sculpt_data = NULL;
 	
-		S32 discard_level = mSculptTexture->getDiscardLevel() ;
+		S32 discard_level = getSculptDiscardLevel();
 		LLImageRaw* raw_image = mSculptTexture->getCachedRawImage() ;
-		
-		S32 max_discard = mSculptTexture->getMaxDiscardLevel();
-		if (discard_level > max_discard)
-			discard_level = max_discard;    // clamp to the best we can do
 
 		S32 current_discard = getVolume()->getSculptLevel();
 		if(current_discard < -2)
@@ -800,16 +817,99 @@ void LLVOVolume::sculpt()
 		}
 		getVolume()->sculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level);
 
-		//notify rebuild any other VOVolumes that reference this sculpty volume
-		for (S32 i = 0; i < mSculptTexture->getNumVolumes(); ++i)
+		markSculptUsersForRebuild();
+	}
+}
+
+S32 LLVOVolume::getSculptDiscardLevel() const
+{
+	S32 discard_level = mSculptTexture->getDiscardLevel();
+	S32 max_discard = mSculptTexture->getMaxDiscardLevel();
+	if (discard_level > max_discard)
+	{
+		discard_level = max_discard;    // clamp to the best we can do
+	}
+	return discard_level;
+}
+
+//notify rebuild any other VOVolumes that reference this sculpty volume
+void LLVOVolume::markSculptUsersForRebuild()
+{
+	for (S32 i = 0; i < mSculptTexture->getNumVolumes(); ++i)
+	{
+		LLVOVolume* volume = (*(mSculptTexture->getVolumeList()))[i];
+		if (volume && volume != this && volume->getVolume() == getVolume())
 		{
-			LLVOVolume* volume = (*(mSculptTexture->getVolumeList()))[i];
-			if (volume && volume != this && volume->getVolume() == getVolume())
-			{
-				gPipeline.markRebuild(volume->mDrawable, LLDrawable::REBUILD_GEOMETRY, FALSE);
-			}
+			gPipeline.markRebuild(volume->mDrawable, LLDrawable::REBUILD_GEOMETRY, FALSE);
+		}
+	}
+}
+
+BOOL LLVOVolume::deferVolumeBuild()
+{
+	LLVolume* volumep = getVolume();
+	if (!sVolumeBuildQueue || !volumep || volumep->isUnique())
+	{
+		// Nothing to show meanwhile, or not a volume the manager shares
+		return FALSE;
+	}
+
+	LLImageRaw* sculpt_image = NULL;
+	S32 sculpt_level = -2;
+	if (isSculpted())
+	{
+		if (mSculptTexture.isNull())
+		{
+			return FALSE;
+		}
+		sculpt_image = mSculptTexture->getCachedRawImage();
+		sculpt_level = getSculptDiscardLevel();
+	}
+
+	const LLVolumeParams& volume_params = volumep->getParams();
+	if (mLODChanged)
+	{
+		if (volumep->getDetail() == LLVolumeLODGroup::getVolumeScaleFromDetail(mLOD) ||
+			LLPrimitive::getVolumeManager()->hasVolume(volume_params, mLOD))
+		{
+			// Switching is cheap, the LOD is already generated
+			return FALSE;
+		}
+		sVolumeBuildQueue->requestLOD(this, volume_params, mLOD, sculpt_image, sculpt_level);
+		return TRUE;
+	}
+
+	if (mSculptChanged && sculpt_image && volumep->getSculptLevel() != sculpt_level)
+	{
+		sVolumeBuildQueue->requestSculpt(this, volumep, sculpt_image, sculpt_level);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+void LLVOVolume::onVolumeBuilt(BOOL sculpt)
+{
+	if (mDrawable.isNull())
+	{
+		return;
+	}
+	if (sculpt)
+	{
+		// Our volume has been regenerated in place
+		mSculptChanged = TRUE;
+		mSculptRebuilt = TRUE;
+		mSculptSurfaceArea = getVolume()->sculptGetSurfaceArea();
+		if (mSculptTexture.notNull())
+		{
+			markSculptUsersForRebuild();
 		}
 	}
+	else
+	{
+		// The LOD is now in the volume manager, setVolume() will pick it up
+		mLODChanged = TRUE;
+	}
+	gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_VOLUME, FALSE);
 }
 
 S32	LLVOVolume::computeLODDetail(F32 distance, F32 radius)
@@ -1185,10 +1285,24 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 		old_num_faces = old_volumep->getNumFaces() ;
 		old_volumep = NULL ;
 
+		BOOL deferred = FALSE;
 		{
 			LLFastTimer ftm(LLFastTimer::FTM_GEN_VOLUME);
-			LLVolumeParams volume_params = getVolume()->getParams();
-			setVolume(volume_params, 0);
+			if (mSculptRebuilt)
+			{
+				// The volume was regenerated in place, only a LOD change
+				// still needs setVolume()
+				if (mLODChanged)
+				{
+					LLVolumeParams volume_params = getVolume()->getParams();
+					setVolume(volume_params, 0);
+				}
+			}
+			else if (!(deferred = deferVolumeBuild()))
+			{
+				LLVolumeParams volume_params = getVolume()->getParams();
+				setVolume(volume_params, 0);
+			}
 		}
 
 		new_volumep = getVolume();
@@ -1196,7 +1310,7 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 		new_num_faces = new_volumep->getNumFaces() ;
 		new_volumep = NULL ;
 
-		if ((new_lod != old_lod) || mSculptChanged)
+		if (!deferred && ((new_lod != old_lod) || mSculptChanged))
 		{
 			compiled = TRUE;
 			sNumLODChanges += new_num_faces ;
@@ -1233,6 +1347,7 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 	mVolumeChanged = FALSE;
 	mLODChanged = FALSE;
 	mSculptChanged = FALSE;
+	mSculptRebuilt = FALSE;
 	mFaceMappingChanged = FALSE;
 
 	return LLViewerObject::updateGeometry(drawable);
@@ -1248,7 +1363,7 @@ void LLVOVolume::updateFaceSize(S32 idx)
 	else
 	{
 		const LLVolumeFace& vol_face = getVolume()->getVolumeFace(idx);
-		facep->setSize(vol_face.mVertices.size(), vol_face.mIndices.size());
+		facep->setSize(vol_face.getNumVertices(), vol_face.mIndices.size());
 	}
 }
 
@@ -1663,6 +1778,24 @@ BOOL LLVOVolume::isSculpted() const
 	return FALSE;
 }
 
+BOOL LLVOVolume::isSolidBox() const
+{
+	LLVolume* volume = getVolume();
+	if (!volume || isFlexible() || isSculpted())
+	{
+		return FALSE;
+	}
+
+	const LLProfileParams& profile = volume->getParams().getProfileParams();
+	const LLPathParams& path = volume->getParams().getPathParams();
+	return (profile.getCurveType() & LL_PCODE_PROFILE_MASK) == LL_PCODE_PROFILE_SQUARE &&
+		profile.getBegin() == 0.f && profile.getEnd() == 1.f && profile.getHollow() == 0.f &&
+		path.getCurveType() == LL_PCODE_PATH_LINE &&
+		path.getBegin() == 0.f && path.getEnd() == 1.f &&
+		path.getScale() == LLVector2(1.f, 1.f) && path.getShear().isExactlyZero() &&
+		path.getTwistBegin() == 0.f && path.getTwist() == 0.f;
+}
+
 BOOL LLVOVolume::isVolumeGlobal() const
 {
 	if (mVolumeImpl)
@@ -1817,6 +1950,13 @@ const LLMatrix4 LLVOVolume::getRenderMatrix() const
 void LLVOVolume::preUpdateGeom()
 {
 	sNumLODChanges = 0;
+
+	if (sVolumeBuildQueue)
+	{
+		// Objects whose volumes are done get marked for rebuild here, in
+		// time for this frame's geometry update
+		sVolumeBuildQueue->updateBuilds();
+	}
 }
 
 void LLVOVolume::parameterChanged(U16 param_type, bool local_origin)
@@ -2280,6 +2420,7 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 	LLFastTimer ftm2(LLFastTimer::FTM_REBUILD_VOLUME_VB);
 
 	group->clearDrawMap();
+	group->mOccluders.clear();
 
 	mFaceList.clear();
 
@@ -2323,6 +2464,11 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 		vobj->updateTextureVirtualSize();
 		vobj->preRebuild();
 
+		if (!drawablep->isActive() && drawablep->getRadius() > MIN_OCCLUDER_RADIUS && vobj->isSolidBox())
+		{ //candidate for the software occlusion buffer, see LLPipeline::updateOcclusionBuffer
+			group->mOccluders.push_back(drawablep);
+		}
+
 		//for each face
 		for (S32 i = 0; i < drawablep->getNumFaces(); i++)
 		{
@@ -2642,6 +2788,13 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 			geom_count += facep->getGeomCount();
 		}
 	
+		//small opaque buffers are kept in client memory for LLDrawBatcher
+		U32 usage = group->mBufferUsage;
+		if (!distance_sort && LLDrawBatcher::useSourceBuffer(group, usage, geom_count))
+		{
+			usage = 0;
+		}
+
 		//create/delete/resize vertex buffer if needed
 		LLVertexBuffer* buffer = NULL;
 		LLSpatialGroup::buffer_texture_map_t::iterator found_iter = group->mBufferMap[mask].find(tex);
@@ -2656,16 +2809,15 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 						
 		if (!buffer)
 		{ //create new buffer if needed
-			buffer = createVertexBuffer(mask, 
-											group->mBufferUsage);
+			buffer = createVertexBuffer(mask, usage);
 			buffer->allocateBuffer(geom_count, index_count, TRUE);
 		}
 		else 
 		{
-			if (LLVertexBuffer::sEnableVBOs && buffer->getUsage() != group->mBufferUsage)
+			if (LLVertexBuffer::sEnableVBOs && buffer->getUsage() != (S32) usage)
 			{
 				buffer = createVertexBuffer(group->mSpatialPartition->mVertexDataMask, 
-											group->mBufferUsage);
+											usage);
 				buffer->allocateBuffer(geom_count, index_count, TRUE);
 			}
 			else
@@ -42,6 +42,7 @@
 class LLViewerTextureAnim;
 class LLDrawPool;
 class LLSelectNode;
+class LLVolumeBuildQueue;
 
 enum LLVolumeInterfaceType
 {
@@ -78,6 +79,7 @@ protected:
 
 public:
 	static		void	initClass();
+	static		void	cleanupClass();
 	static 		void 	preUpdateGeom();
 	
 	enum 
@@ -175,6 +177,9 @@ public:
 				void	updateSculptTexture();
 				void    setIndexInTex(S32 index) { mIndexInTex = index ;}
 				void	sculpt();
+				// Called by LLVolumeBuildQueue when a volume requested by
+				// deferVolumeBuild() is ready
+				void	onVolumeBuilt(BOOL sculpt);
 				void	updateRelativeXform();
 	/*virtual*/ BOOL	updateGeometry(LLDrawable *drawable);
 	/*virtual*/ void	updateFaceSize(S32 idx);
@@ -215,6 +220,9 @@ public:
 	BOOL canBeFlexible() const;
 	BOOL setIsFlexible(BOOL is_flexible);
 
+	// Plain unhollowed, uncut, untapered cube: its bounding box is its shape
+	BOOL isSolidBox() const;
+
 	// tag: vaa emerald local_asset_browser
 	void setSculptChanged(BOOL has_changed) { mSculptChanged = has_changed; }
 			
@@ -223,6 +231,12 @@ protected:
 	BOOL calcLOD();
 	LLFace* addFace(S32 face_index);
 	void updateTEData();
+	// Queues generation of the volume for a LOD or sculpt change on the
+	// shared thread pool, keeping the current one until it is done.
+	// Returns FALSE if it should be generated right away instead.
+	BOOL deferVolumeBuild();
+	S32 getSculptDiscardLevel() const;
+	void markSculptUsersForRebuild();
 
 public:
 	LLViewerTextureAnim *mTextureAnimp;
@@ -235,6 +249,7 @@ private:
 	S32			mLOD;
 	BOOL		mLODChanged;
 	BOOL		mSculptChanged;
+	BOOL		mSculptRebuilt;		// the sculpt was regenerated in place off the main thread
 	LLMatrix4	mRelativeXform;
 	LLMatrix3	mRelativeXformInvTrans;
 	BOOL		mVolumeChanged;
@@ -251,6 +266,7 @@ public:
 		
 protected:
 	static S32 sNumLODChanges;
+	static LLVolumeBuildQueue* sVolumeBuildQueue; // NULL if volumes are only built synchronously
 	
 	friend class LLVolumeImplFlexible;
 };
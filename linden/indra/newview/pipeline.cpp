@@ -52,9 +52,11 @@
 #include "llui.h" 
 #include "llglheaders.h"
 #include "llrender.h"
+#include "llthreadpool.h"
 
 // newview includes
 #include "llagent.h"
+#include "llavatarskinqueue.h"
 #include "lldrawable.h"
 #include "lldrawpoolalpha.h"
 #include "lldrawpoolavatar.h"
@@ -240,6 +242,7 @@ BOOL	LLPipeline::sRenderBeacons = FALSE;
 BOOL	LLPipeline::sRenderHighlight = TRUE;
 BOOL	LLPipeline::sForceOldBakedUpload = FALSE;
 S32		LLPipeline::sUseOcclusion = 0;
+BOOL	LLPipeline::sUseSoftwareOcclusion = FALSE;
 BOOL	LLPipeline::sDelayVBUpdate = TRUE;
 BOOL	LLPipeline::sFastAlpha = TRUE;
 BOOL	LLPipeline::sDisableShaders = FALSE;
@@ -302,6 +305,9 @@ LLPipeline::LLPipeline() :
 	mRenderDebugFeatureMask(0),
 	mRenderDebugMask(0),
 	mOldRenderDebugMask(0),
+	mCullQueue(NULL),
+	mSkinQueue(NULL),
+	mOcclusionBufferActive(FALSE),
 	mLastRebuildPool(NULL),
 	mAlphaPool(NULL),
 	mSkyPool(NULL),
@@ -329,6 +335,8 @@ void LLPipeline::init()
 	sRenderBump = gSavedSettings.getBOOL("RenderObjectBump");
 	sRenderAttachedLights = gSavedSettings.getBOOL("RenderAttachedLights");
 	sRenderAttachedParticles = gSavedSettings.getBOOL("RenderAttachedParticles");
+	LLDrawBatcher::sEnabled = gSavedSettings.getBOOL("RenderBatchStatic");
+	LLDrawBatcher::sMaxSourceVertices = gSavedSettings.getS32("RenderBatchMaxVertices");
 
 	mInitialized = TRUE;
 	
@@ -361,6 +369,18 @@ void LLPipeline::init()
 
 	mBackfaceCull = TRUE;
 
+	if (gSavedSettings.getBOOL("RenderParallelCull") && LLThreadPool::getShared())
+	{
+		mCullQueue = new LLCullQueue();
+		LLThreadPool::getShared()->addQueue(mCullQueue, LLThreadPool::AFFINITY_ANY, 0);
+	}
+
+	if (gSavedSettings.getBOOL("RenderParallelSkinning") && LLThreadPool::getShared())
+	{
+		mSkinQueue = new LLAvatarSkinQueue();
+		LLThreadPool::getShared()->addQueue(mSkinQueue, LLThreadPool::AFFINITY_ANY, 0);
+	}
+
 	stop_glerror();
 	
 	// Enable features
@@ -379,6 +399,24 @@ void LLPipeline::cleanup()
 {
 	assertInitialized();
 
+	if (mCullQueue)
+	{
+		mCullQueue->shutdown();
+		delete mCullQueue;
+		mCullQueue = NULL;
+	}
+
+	if (mSkinQueue)
+	{
+		mSkinQueue->shutdown();
+		delete mSkinQueue;
+		mSkinQueue = NULL;
+	}
+
+	mOccluders.clear();
+
+	mDrawBatcher.clear();
+
 	for(pool_set_t::iterator iter = mPools.begin();
 		iter != mPools.end(); )
 	{
@@ -1370,6 +1408,14 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 
 	sCull->clear();
 
+	if (sUseSoftwareOcclusion && sUseOcclusion &&
+		!hasRenderType(LLPipeline::RENDER_TYPE_HUD) &&
+		!sReflectionRender &&
+		!sShadowRender)
+	{
+		updateOcclusionBuffer(camera);
+	}
+
 	BOOL to_texture =	LLPipeline::sUseOcclusion > 1 &&
 						!hasRenderType(LLPipeline::RENDER_TYPE_HUD) && 
 						!sReflectionRender &&
@@ -1413,6 +1459,11 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 			camera.disableUserClipPlane();
 		}
 
+		if (mCullQueue)
+		{
+			mCullQueue->setCamera(camera);
+		}
+
 		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
 		{
 			LLSpatialPartition* part = region->getSpatialPartition(i);
@@ -1420,12 +1471,24 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 			{
 				if (hasRenderType(part->mDrawableType))
 				{
-					part->cull(camera);
+					if (mCullQueue)
+					{
+						mCullQueue->addPartition(part);
+					}
+					else
+					{
+						part->cull(camera);
+					}
 				}
 			}
 		}
 	}
 
+	if (mCullQueue)
+	{
+		mCullQueue->cull();
+	}
+
 	camera.disableUserClipPlane();
 
 	// Render non-windlight sky.
@@ -1465,6 +1528,96 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 	{
 		glFlush();
 	}
+
+	mOcclusionBufferActive = FALSE;
+}
+
+// TRUE if drawable currently renders as a solid, opaque box
+static BOOL is_opaque_occluder(LLDrawable* drawable)
+{
+	if (drawable->isDead() ||
+		drawable->isState(LLDrawable::INVISIBLE | LLDrawable::FORCE_INVISIBLE) ||
+		!drawable->getSpatialGroup() ||
+		drawable->getNumFaces() == 0)
+	{
+		return FALSE;
+	}
+
+	LLViewerObject* vobj = drawable->getVObj();
+	if (!vobj || (gHideSelectedObjects && vobj->isSelected()))
+	{
+		return FALSE;
+	}
+
+	for (S32 i = 0; i < drawable->getNumFaces(); i++)
+	{
+		LLFace* facep = drawable->getFace(i);
+		LLViewerImage* tex = facep->getTexture();
+		if (!tex ||
+			tex->getPrimaryFormat() == GL_ALPHA ||
+			LLPipeline::getPoolTypeFromTE(facep->getTextureEntry(), tex) == LLDrawPool::POOL_ALPHA)
+		{ //see through, or an invisiprim
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static bool compare_occluder_score(const std::pair<F32, LLDrawable*>& lhs, const std::pair<F32, LLDrawable*>& rhs)
+{
+	return lhs.first > rhs.first;
+}
+
+void LLPipeline::updateOcclusionBuffer(LLCamera& camera)
+{
+	LLFastTimer t(LLFastTimer::FTM_RENDER_OCCLUSION);
+
+	const U32 BUFFER_WIDTH = 256;
+	const F32 MIN_OCCLUDER_SCORE = 0.0025f;
+	static S32* sMaxOccluders = rebind_llcontrol<S32>("RenderSoftwareOcclusionMaxOccluders", &gSavedSettings, true);
+
+	//rank the occluders seen last frame by the (rough) solid angle they cover
+	std::vector<std::pair<F32, LLDrawable*> > ranked;
+	ranked.reserve(mOccluders.size());
+	for (U32 i = 0; i < mOccluders.size(); i++)
+	{
+		LLDrawable* drawable = mOccluders[i];
+		if (!is_opaque_occluder(drawable))
+		{
+			continue;
+		}
+
+		F32 radius = drawable->getRadius();
+		F32 dist_squared = (drawable->getPositionAgent() - camera.getOrigin()).magVecSquared();
+		F32 score = radius * radius / llmax(dist_squared, 0.01f);
+		if (score > MIN_OCCLUDER_SCORE)
+		{
+			ranked.push_back(std::make_pair(score, drawable));
+		}
+	}
+
+	U32 count = llmin((U32) ranked.size(), (U32) llmax(*sMaxOccluders, 0));
+	std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), compare_occluder_score);
+
+	U32 height = llclamp(llround(BUFFER_WIDTH / camera.getAspect()), 32, (S32) BUFFER_WIDTH);
+	mOcclusionBuffer.clear(camera, BUFFER_WIDTH, height);
+	for (U32 i = 0; i < count; i++)
+	{
+		LLDrawable* drawable = ranked[i].second;
+		LLVector3 scale = drawable->getVObj()->getScale() * 0.5f;
+		const LLQuaternion& rot = drawable->getWorldRotation();
+		LLVector3 axes[3] =
+		{
+			LLVector3(scale.mV[VX], 0.f, 0.f) * rot,
+			LLVector3(0.f, scale.mV[VY], 0.f) * rot,
+			LLVector3(0.f, 0.f, scale.mV[VZ]) * rot
+		};
+		mOcclusionBuffer.addBox(drawable->getPositionAgent(), axes);
+	}
+	mOcclusionBuffer.build();
+
+	mOcclusionBufferActive = TRUE;
 }
 
 void LLPipeline::markNotCulled(LLSpatialGroup* group, LLCamera& camera)
@@ -2214,6 +2367,8 @@ void LLPipeline::postSort(LLCamera& camera)
 	sCull->assertDrawMapsEmpty();
 
 	LLSpatialGroup::sNoDelete = FALSE;
+	mDrawBatcher.expire();
+
 	for (LLCullResult::sg_list_t::iterator i = sCull->beginVisibleGroups(); i != sCull->endVisibleGroups(); ++i)
 	{
 		LLSpatialGroup* group = *i;
@@ -2243,6 +2398,16 @@ void LLPipeline::postSort(LLCamera& camera)
 		bin_size[j] = 0;
 	}
 
+	//gather next frame's software occluders from what the main camera sees
+	BOOL gather_occluders = sUseSoftwareOcclusion &&
+							!hasRenderType(LLPipeline::RENDER_TYPE_HUD) &&
+							!sReflectionRender &&
+							!sShadowRender;
+	if (gather_occluders || !sUseSoftwareOcclusion)
+	{
+		mOccluders.clear();
+	}
+
 	//build render map
 	for (LLCullResult::sg_list_t::iterator i = sCull->beginVisibleGroups(); i != sCull->endVisibleGroups(); ++i)
 	{
@@ -2252,6 +2417,11 @@ void LLPipeline::postSort(LLCamera& camera)
 		{
 			continue;
 		}
+
+		if (gather_occluders)
+		{
+			mOccluders.insert(mOccluders.end(), group->mOccluders.begin(), group->mOccluders.end());
+		}
 		
 		for (LLSpatialGroup::draw_map_t::iterator j = group->mDrawMap.begin(); j != group->mDrawMap.end(); ++j)
 		{
@@ -2290,20 +2460,23 @@ void LLPipeline::postSort(LLCamera& camera)
 		
 	if (!sShadowRender)
 	{
-		//sort by texture or bump map
+		//sort by bump map, texture and buffer, then merge what shares state
 		for (U32 i = 0; i < LLRenderPass::NUM_RENDER_TYPES; ++i)
 		{
-			if (i == LLRenderPass::PASS_BUMP)
+			std::sort(sCull->beginRenderMap(i), sCull->endRenderMap(i), LLDrawInfo::CompareBatch());
+			if (i != LLRenderPass::PASS_ALPHA)
 			{
-				std::sort(sCull->beginRenderMap(i), sCull->endRenderMap(i), LLDrawInfo::CompareBump());
+				mDrawBatcher.batch(sCull, i);
 			}
-			else 
-			{
-				std::sort(sCull->beginRenderMap(i), sCull->endRenderMap(i), LLDrawInfo::CompareTexturePtrMatrix());
-			}	
 		}
 
 		std::sort(sCull->beginAlphaGroups(), sCull->endAlphaGroups(), LLSpatialGroup::CompareDepthGreater());
+
+		//skin every visible avatar before the first one is drawn
+		if (mSkinQueue)
+		{
+			mSkinQueue->skin();
+		}
 	}
 	
 	static BOOL* sBeaconsEnabled = rebind_llcontrol<BOOL>("BeaconsEnabled", &gSavedSettings, true);
@@ -4862,9 +5035,34 @@ void LLPipeline::resetVertexBuffers(LLDrawable* drawable)
 	}
 }
 
+S32 LLPipeline::evictVertexBuffers(S32 bytes)
+{
+	// Groups out of view for this many frames are unlikely to be needed soon
+	const S32 MIN_IDLE_FRAMES = 100;
+
+	S32 freed = 0;
+	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
+			iter != LLWorld::getInstance()->getRegionList().end() && freed < bytes; ++iter)
+	{
+		LLViewerRegion* region = *iter;
+		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS && freed < bytes; i++)
+		{
+			LLSpatialPartition* part = region->getSpatialPartition(i);
+			if (part)
+			{
+				freed += part->evictVertexBuffers(bytes - freed, MIN_IDLE_FRAMES);
+			}
+		}
+	}
+	return freed;
+}
+
 void LLPipeline::resetVertexBuffers()
 {
 	sRenderBump = gSavedSettings.getBOOL("RenderObjectBump");
+	LLDrawBatcher::sEnabled = gSavedSettings.getBOOL("RenderBatchStatic");
+	LLDrawBatcher::sMaxSourceVertices = gSavedSettings.getS32("RenderBatchMaxVertices");
+	mDrawBatcher.clear();
 
 	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
 			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
@@ -4934,7 +5132,8 @@ void LLPipeline::setUseVBO(BOOL use_vbo)
 		}
 		
 		resetVertexBuffers();
-		LLVertexBuffer::initClass(use_vbo && gGLManager.mHasVertexBufferObject);
+		LLVertexBuffer::initClass(use_vbo && gGLManager.mHasVertexBufferObject,
+								  gSavedSettings.getBOOL("RenderStreamRing"));
 	}
 }
 
@@ -39,6 +39,7 @@
 #include "llstat.h"
 #include "lldrawpool.h"
 #include "llspatialpartition.h"
+#include "llocclusionbuffer.h"
 #include "m4math.h"
 #include "llmemory.h"
 #include "lldrawpool.h"
@@ -56,6 +57,8 @@ class LLTextureEntry;
 class LLRenderFunc;
 class LLCubeMap;
 class LLCullResult;
+class LLCullQueue;
+class LLAvatarSkinQueue;
 class LLVOAvatar;
 class LLGLSLShader;
 
@@ -93,6 +96,9 @@ public:
 	void allocateScreenBuffer(U32 resX, U32 resY);
 
 	void resetVertexBuffers(LLDrawable* drawable);
+	// Releases about bytes of vertex buffers that have not been drawn for a
+	// while, for LLMemoryBudget. Returns the bytes released.
+	S32 evictVertexBuffers(S32 bytes);
 	void setUseVBO(BOOL use_vbo);
 	void generateImpostor(LLVOAvatar* avatar);
 	void bindScreenToTexture();
@@ -180,6 +186,8 @@ public:
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	BOOL getVisibleExtents(LLCamera& camera, LLVector3 &min, LLVector3& max);
 	void updateCull(LLCamera& camera, LLCullResult& result, S32 water_clip = 0);  //if water_clip is 0, ignore water plane, 1, cull to above plane, -1, cull to below plane
+	void updateOcclusionBuffer(LLCamera& camera); //rasterize last frame's occluders for software occlusion
+	const LLOcclusionBuffer* getOcclusionBuffer() const { return mOcclusionBufferActive ? &mOcclusionBuffer : NULL; } //NULL unless the cull in progress uses it
 	void createObjects(F32 max_dtime);
 	void createObject(LLViewerObject* vobj);
 	void updateGeom(F32 max_dtime);
@@ -241,6 +249,7 @@ public:
 	LLCullResult::drawinfo_list_t::iterator endRenderMap(U32 type);
 	LLCullResult::sg_list_t::iterator beginAlphaGroups();
 	LLCullResult::sg_list_t::iterator endAlphaGroups();
+	const LLDrawBatcher& getDrawBatcher() const		{ return mDrawBatcher; }
 	
 	void addTrianglesDrawn(S32 count);
 	BOOL hasRenderType(const U32 type) const				{ return (type && (mRenderTypeMask & (1<<type))) ? TRUE : FALSE; }
@@ -397,6 +406,7 @@ public:
 	static BOOL				sShowHUDAttachments;
 	static BOOL				sForceOldBakedUpload; // If true will not use capabilities to upload baked textures.
 	static S32				sUseOcclusion;  // 0 = no occlusion, 1 = read only, 2 = read/write
+	static BOOL				sUseSoftwareOcclusion; // if TRUE, occlusion is tested on the CPU (sUseOcclusion is 1)
 	static BOOL				sDelayVBUpdate;
 	static BOOL				sFastAlpha;
 	static BOOL				sDisableShaders; // if TRUE, rendering will be done without shaders
@@ -459,6 +469,13 @@ protected:
 	U32						mRenderDebugMask;
 
 	U32						mOldRenderDebugMask;
+
+	LLCullQueue*			mCullQueue; // NULL if culling runs on the main thread only
+	LLAvatarSkinQueue*		mSkinQueue; // NULL if avatars are skinned as they are drawn
+	LLOcclusionBuffer		mOcclusionBuffer;
+	BOOL					mOcclusionBufferActive;
+	std::vector<LLPointer<LLDrawable> > mOccluders; // gathered from the main camera's visible groups each frame
+	LLDrawBatcher			mDrawBatcher;
 	
 	/////////////////////////////////////////////
 	//
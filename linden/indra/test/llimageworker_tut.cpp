@@ -0,0 +1,177 @@
+/** 
+ * @file llimageworker_tut.cpp
+ * @brief Tests and throughput benchmark for the image decode thread pool.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+
+#include "llimage.h"
+#include "llimagej2c.h"
+#include "llimageworker.h"
+#include "llrand.h"
+#include "llsys.h"
+#include "lltimer.h"
+
+namespace tut
+{
+	const S32 TEST_IMAGE_SIZE = 256;
+	const S32 TEST_IMAGE_COUNT = 32;
+
+	class test_responder : public LLImageDecodeThread::Responder
+	{
+	public:
+		test_responder(LLAtomicS32* completed, LLAtomicS32* succeeded)
+			: mCompleted(completed), mSucceeded(succeeded)
+		{
+		}
+		virtual void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
+		{
+			if (success && raw && raw->getWidth() == TEST_IMAGE_SIZE && raw->getHeight() == TEST_IMAGE_SIZE)
+			{
+				(*mSucceeded)++;
+			}
+			(*mCompleted)++;
+		}
+	private:
+		LLAtomicS32* mCompleted;
+		LLAtomicS32* mSucceeded;
+	};
+
+	struct imagedecodepool_test
+	{
+		imagedecodepool_test()
+		{
+			LLImage::initClass(false);
+
+			// Smooth gradient plus noise, so the codestream is not trivially small
+			LLPointer<LLImageRaw> raw = new LLImageRaw(TEST_IMAGE_SIZE, TEST_IMAGE_SIZE, 3);
+			U8* data = raw->getData();
+			for (S32 y = 0; y < TEST_IMAGE_SIZE; ++y)
+			{
+				for (S32 x = 0; x < TEST_IMAGE_SIZE; ++x)
+				{
+					U8* pixel = data + (y * TEST_IMAGE_SIZE + x) * 3;
+					pixel[0] = (U8)x;
+					pixel[1] = (U8)y;
+					pixel[2] = (U8)ll_rand(256);
+				}
+			}
+			mEncoded = new LLImageJ2C;
+			mEncoded->encode(raw, 0.0f);
+		}
+
+		~imagedecodepool_test()
+		{
+			mEncoded = NULL;
+			LLImage::cleanupClass();
+		}
+
+		// Decodes TEST_IMAGE_COUNT copies of the test image and returns the
+		// number of successful decodes. Each request gets its own copy since
+		// decoding updates the state of the formatted image.
+		S32 decodeAll(U32 pool_size, F64& megapixels_per_second)
+		{
+			LLAtomicS32 completed;
+			LLAtomicS32 succeeded;
+			completed = 0;
+			succeeded = 0;
+
+			LLImageDecodeThread* thread = new LLImageDecodeThread(true, pool_size);
+			LLTimer timer;
+			for (S32 i = 0; i < TEST_IMAGE_COUNT; ++i)
+			{
+				LLPointer<LLImageJ2C> image = new LLImageJ2C;
+				U8* data = new U8[mEncoded->getDataSize()];
+				memcpy(data, mEncoded->getData(), mEncoded->getDataSize());
+				image->setData(data, mEncoded->getDataSize());
+				image->updateData();
+				thread->decodeImage(image, LLQueuedThread::PRIORITY_NORMAL, 0, FALSE,
+									new test_responder(&completed, &succeeded));
+			}
+			while (completed < TEST_IMAGE_COUNT && timer.getElapsedTimeF64() < 60.0)
+			{
+				thread->update(1);
+				ms_sleep(1);
+			}
+			F64 elapsed = timer.getElapsedTimeF64();
+			thread->shutdown();
+			delete thread;
+
+			F64 megapixels = (F64)TEST_IMAGE_COUNT * TEST_IMAGE_SIZE * TEST_IMAGE_SIZE / 1000000.0;
+			megapixels_per_second = elapsed > 0.0 ? megapixels / elapsed : 0.0;
+			return succeeded;
+		}
+
+		LLPointer<LLImageJ2C> mEncoded;
+	};
+	typedef test_group<imagedecodepool_test> imagedecodepool_group_t;
+	typedef imagedecodepool_group_t::object imagedecodepool_object_t;
+	tut::imagedecodepool_group_t imagedecodepool_instance("imagedecodepool");
+
+	template<> template<>
+	void imagedecodepool_object_t::test<1>()
+	{
+		ensure("encoded test image", mEncoded->getDataSize() > 0);
+
+		F64 rate;
+		ensure_equals("all decodes complete with a pool of 4", decodeAll(4, rate), TEST_IMAGE_COUNT);
+		ensure_equals("all decodes complete with a single thread", decodeAll(1, rate), TEST_IMAGE_COUNT);
+	}
+
+#if LL_BENCHMARKS
+	struct imagedecodepool_benchmark : public imagedecodepool_test { };
+	typedef test_group<imagedecodepool_benchmark> imagedecodepool_benchmark_t;
+	typedef imagedecodepool_benchmark_t::object imagedecodepool_benchmark_object_t;
+	tut::imagedecodepool_benchmark_t imagedecodepool_benchmark_instance("imagedecodepool benchmark");
+
+	// Decoded megapixels per second against the pool size
+	template<> template<>
+	void imagedecodepool_benchmark_object_t::test<1>()
+	{
+		U32 num_cpus = gSysCPU.getNumCPUs();
+		for (U32 pool_size = 1; ; pool_size *= 2)
+		{
+			pool_size = llmin(pool_size, num_cpus);
+			F64 rate;
+			S32 succeeded = decodeAll(pool_size, rate);
+			ensure_equals("all decodes complete", succeeded, TEST_IMAGE_COUNT);
+			std::cout << llformat("Image decode pool: %d thread(s) of %d core(s): %.2f MP/s",
+								  pool_size, num_cpus, rate) << std::endl;
+			if (pool_size >= num_cpus)
+			{
+				break;
+			}
+		}
+	}
+#endif // LL_BENCHMARKS
+}
@@ -0,0 +1,193 @@
+/** 
+ * @file llmemorybudget_tut.cpp
+ * @brief Tests for LLMemoryBudget.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llmemorybudget.h"
+
+namespace tut
+{
+	// Holds a fixed number of bytes, trim() releases up to mCanFree of them
+	class budget_pool : public LLMemoryBudget::Pool
+	{
+	public:
+		budget_pool(const std::string& name, S32 priority, S64 usage, S64 can_free)
+			: LLMemoryBudget::Pool(name, priority),
+			  mBytes(usage),
+			  mCanFree(can_free),
+			  mAsked(0),
+			  mRelaxed(0)
+		{
+		}
+		/*virtual*/ S64 getUsage() { return mBytes; }
+		/*virtual*/ S64 trim(S64 bytes)
+		{
+			mAsked += bytes;
+			S64 freed = llmin(bytes, mCanFree);
+			mCanFree -= freed;
+			mBytes -= freed;
+			return freed;
+		}
+		/*virtual*/ void relax() { mRelaxed++; }
+
+		S64 mBytes;
+		S64 mCanFree;
+		S64 mAsked;
+		S32 mRelaxed;
+	};
+
+	struct memorybudget_test
+	{
+		~memorybudget_test()
+		{
+			LLMemoryBudget::setBudget(0);
+		}
+	};
+	typedef test_group<memorybudget_test> memorybudget_group_t;
+	typedef memorybudget_group_t::object memorybudget_object_t;
+	tut::memorybudget_group_t memorybudget_instance("memorybudget");
+
+	template<> template<>
+	void memorybudget_object_t::test<1>()
+	{
+		// Accounting, and no pressure while under budget
+		budget_pool a("a", 0, 300, 300);
+		budget_pool b("b", 1, 500, 500);
+		LLMemoryBudget::setBudget(1000);
+		LLMemoryBudget::update(true);
+		ensure_equals("total", LLMemoryBudget::getTotalUsage(), (S64)800);
+		ensure("under budget", !LLMemoryBudget::isOverBudget());
+		ensure_equals("a untouched", a.mAsked, (S64)0);
+		ensure_equals("b untouched", b.mAsked, (S64)0);
+
+		LLSD stats = LLMemoryBudget::getStats();
+		ensure_equals("stats budget", stats["budget"].asReal(), 1000.0);
+		ensure_equals("stats usage", stats["pools"]["b"]["usage"].asReal(), 500.0);
+	}
+
+	template<> template<>
+	void memorybudget_object_t::test<2>()
+	{
+		// Over budget, each pool is asked for its share of what it takes to
+		// get usage back to TRIM_TARGET of the budget
+		budget_pool textures("textures", 2, 600, 600);
+		budget_pool cache("cache", 0, 300, 100);
+		budget_pool buffers("buffers", 1, 300, 300);
+		LLMemoryBudget::setBudget(1000);
+		LLMemoryBudget::update(true);
+		// 1200 used, target 950: 250 split 2:1:1
+		ensure_equals("textures asked for half", textures.mAsked, (S64)125);
+		ensure_equals("cache asked for a quarter", cache.mAsked, (S64)62);
+		ensure_equals("buffers asked for a quarter", buffers.mAsked, (S64)62);
+		ensure("cache trimming", cache.isTrimming());
+		ensure("textures trimming", textures.isTrimming());
+
+		LLMemoryBudget::update(true);
+		ensure_equals("total after trim", LLMemoryBudget::getTotalUsage(), (S64)951);
+		ensure("no more pressure", !LLMemoryBudget::isOverBudget());
+	}
+
+	template<> template<>
+	void memorybudget_object_t::test<6>()
+	{
+		// A large pool that only releases over the next frames doesn't get
+		// the small pools emptied in its place
+		budget_pool textures("textures", 3, 1800, 0);
+		budget_pool cache("cache", 0, 200, 200);
+		LLMemoryBudget::setBudget(1000);
+		for (S32 i = 0; i < 10; i++)
+		{
+			LLMemoryBudget::update(true);
+			// The textures come down a bit every update
+			textures.mBytes -= 80;
+		}
+		// 2000 used, target 950: the cache's tenth of the excess, once
+		ensure("textures trimming", textures.isTrimming());
+		ensure_equals("cache asked once", cache.mAsked, (S64)105);
+		ensure_equals("cache kept the rest", cache.mBytes, (S64)95);
+
+		// Growing back while still over budget is trimmed again
+		cache.mBytes = 150;
+		LLMemoryBudget::update(true);
+		ensure("cache asked again", cache.mAsked > 105);
+	}
+
+	template<> template<>
+	void memorybudget_object_t::test<3>()
+	{
+		// Pools relax once usage is well under the budget again
+		budget_pool a("a", 0, 1200, 0);
+		LLMemoryBudget::setBudget(1000);
+		LLMemoryBudget::update(true);
+		ensure("trimming", a.isTrimming());
+		a.mBytes = 900;
+		LLMemoryBudget::update(true);
+		ensure_equals("still close to the budget", a.mRelaxed, 0);
+		a.mBytes = 500;
+		LLMemoryBudget::update(true);
+		ensure_equals("relaxed", a.mRelaxed, 1);
+		ensure("not trimming", !a.isTrimming());
+	}
+
+	template<> template<>
+	void memorybudget_object_t::test<4>()
+	{
+		// A pool over its own limit is trimmed even without a total budget
+		budget_pool a("a", 0, 400, 400);
+		a.setLimit(250);
+		LLMemoryBudget::update(true);
+		ensure_equals("trimmed to limit", a.mBytes, (S64)250);
+		ensure_equals("asked for the excess only", a.mAsked, (S64)150);
+		ensure("trimming", a.isTrimming());
+
+		// and relaxes once well under it again
+		a.mBytes = 100;
+		LLMemoryBudget::update(true);
+		ensure_equals("relaxed", a.mRelaxed, 1);
+		ensure("not trimming", !a.isTrimming());
+	}
+
+	template<> template<>
+	void memorybudget_object_t::test<5>()
+	{
+		// Destroyed pools unregister
+		{
+			budget_pool a("a", 0, 400, 400);
+			LLMemoryBudget::update(true);
+			ensure_equals("registered", LLMemoryBudget::getTotalUsage(), (S64)400);
+		}
+		LLMemoryBudget::update(true);
+		ensure_equals("unregistered", LLMemoryBudget::getTotalUsage(), (S64)0);
+		ensure_equals("no pools in stats", LLMemoryBudget::getStats()["pools"].size(), 0);
+	}
+}
@@ -0,0 +1,589 @@
+/**
+ * @file llmessagedecoder_tut.cpp
+ * @brief Tests for the generated message decoders against LLTemplateMessageReader.
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "llmessagedecodergenerator.h"
+#include "llmessagedecoders.h"
+#include "llmessagetemplate.h"
+#include "llmessagetemplateparser.h"
+#include "lltemplatemessagebuilder.h"
+#include "lltemplatemessagereader.h"
+#include "lltimer.h"
+#include "message_prehash.h"
+
+// Compare a decoded field with what the reader makes of the same packet
+#define CHECK_FIELD(type, reader_get, decoded, block, var, i) \
+	{ \
+		type expected; \
+		mReader->reader_get(_PREHASH_##block, _PREHASH_##var, expected, i); \
+		ensure_equals(#block "." #var, decoded.get##var(), expected); \
+	}
+#define CHECK_BYTES(decoded, block, var, i, size) \
+	checkBytes(_PREHASH_##block, _PREHASH_##var, i, decoded.get##var(), size)
+#define CHECK_VARIABLE(decoded, block, var, i) \
+	checkBytes(_PREHASH_##block, _PREHASH_##var, i, decoded.get##var(), decoded.get##var##Size())
+
+namespace tut
+{
+	std::string get_source_path(const std::string& path)
+	{
+		std::string file(__FILE__);
+		std::string::size_type slash = file.find_last_of("/\\");
+		return (slash == std::string::npos ? std::string(".") : file.substr(0, slash)) + "/" + path;
+	}
+
+	struct messagedecoder_data
+	{
+		messagedecoder_data() : mSeed(1), mReader(NULL)
+		{
+			mReader = new LLTemplateMessageReader(getNumbers());
+		}
+
+		~messagedecoder_data()
+		{
+			delete mReader;
+		}
+
+		// The real template, parsed once for all the tests
+		static const LLTemplateParser& getParser()
+		{
+			static LLTemplateParser* parser = NULL;
+			if (!parser)
+			{
+				std::string body;
+				_read_file_into_string(body, get_source_path("../../scripts/messages/message_template.msg"));
+				LLTemplateTokenizer tokens(body);
+				parser = new LLTemplateParser(tokens);
+			}
+			return *parser;
+		}
+
+		static LLTemplateMessageReader::message_template_number_map_t& getNumbers()
+		{
+			static LLTemplateMessageReader::message_template_number_map_t numbers;
+			if (numbers.empty())
+			{
+				for (LLTemplateParser::message_iterator iter = getParser().getMessagesBegin();
+					 iter != getParser().getMessagesEnd(); ++iter)
+				{
+					numbers[(*iter)->mMessageNumber] = *iter;
+				}
+			}
+			return numbers;
+		}
+
+		static LLTemplateMessageBuilder::message_template_name_map_t& getNames()
+		{
+			static LLTemplateMessageBuilder::message_template_name_map_t names;
+			if (names.empty())
+			{
+				for (LLTemplateParser::message_iterator iter = getParser().getMessagesBegin();
+					 iter != getParser().getMessagesEnd(); ++iter)
+				{
+					names[(*iter)->mName] = *iter;
+				}
+			}
+			return names;
+		}
+
+		static const LLMessageTemplate* getTemplate(const char* name)
+		{
+			return getNames()[LLMessageStringTable::getInstance()->getString(name)];
+		}
+
+		U32 rand(U32 range)
+		{
+			// Fixed LCG so every run builds the same packets
+			mSeed = mSeed * 1103515245 + 12345;
+			return ((mSeed >> 8) & 0xffff) % range;
+		}
+
+		// Builds the named message with random contents into mBuffer and
+		// returns its size. Variable blocks get up to max_blocks entries and
+		// variable fields up to max_data bytes. Fixed fields get bytes below
+		// 0x80, which keeps floats finite.
+		S32 buildMessage(const char* name, S32 max_blocks, S32 max_data)
+		{
+			const LLMessageTemplate* message = getTemplate(name);
+			LLTemplateMessageBuilder builder(getNames());
+			builder.newMessage(message->mName);
+			for (LLMessageTemplate::message_block_map_t::const_iterator iter = message->mMemberBlocks.begin();
+				 iter != message->mMemberBlocks.end(); ++iter)
+			{
+				const LLMessageBlock* block = *iter;
+				S32 count = block->mType == MBT_SINGLE ? 1 :
+					(block->mType == MBT_MULTIPLE ? block->mNumber : rand(max_blocks + 1));
+				for (S32 i = 0; i < count; i++)
+				{
+					builder.nextBlock(block->mName);
+					for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = block->mMemberVariables.begin();
+						 var_iter != block->mMemberVariables.end(); ++var_iter)
+					{
+						const LLMessageVariable* var = *var_iter;
+						bool variable = var->getType() == MVT_VARIABLE;
+						S32 size = variable ? rand(max_data + 1) : var->getSize();
+						U8 data[256];
+						for (S32 j = 0; j < size; j++)
+						{
+							data[j] = (U8)rand(variable ? 256 : 128);
+						}
+						builder.addBinaryData(var->getName(), data, size);
+					}
+				}
+			}
+			memset(mBuffer, 0, sizeof(mBuffer));
+			return builder.buildMessage(mBuffer, sizeof(mBuffer), 0);
+		}
+
+		BOOL readMessage(S32 size)
+		{
+			mReader->clearMessage();
+			return mReader->validateMessage(mBuffer, size, LLHost(), true, TRUE)
+				&& mReader->decodeData(mBuffer, LLHost(), TRUE);
+		}
+
+		// Offsets a sender with an older template could stop the body at:
+		// anywhere but inside a fixed field or a length prefix
+		void getCutPoints(const char* name, const U8* body, S32 size, std::vector<S32>& cuts)
+		{
+			const LLMessageTemplate* message = getTemplate(name);
+			std::vector<bool> inside(size + 1, false);
+			S32 pos = 0;
+			for (LLMessageTemplate::message_block_map_t::const_iterator iter = message->mMemberBlocks.begin();
+				 iter != message->mMemberBlocks.end(); ++iter)
+			{
+				const LLMessageBlock* block = *iter;
+				S32 count = block->mType == MBT_SINGLE ? 1 :
+					(block->mType == MBT_MULTIPLE ? block->mNumber : body[pos++]);
+				for (S32 i = 0; i < count; i++)
+				{
+					for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = block->mMemberVariables.begin();
+						 var_iter != block->mMemberVariables.end(); ++var_iter)
+					{
+						const LLMessageVariable* var = *var_iter;
+						for (S32 j = 1; j < var->getSize(); j++)
+						{
+							inside[pos + j] = true;
+						}
+						if (var->getType() == MVT_VARIABLE)
+						{
+							pos += var->getSize() + LLMessageDecoder::readVariableSize(body + pos, var->getSize());
+						}
+						else
+						{
+							pos += var->getSize();
+						}
+					}
+				}
+			}
+			for (S32 i = 0; i <= size; i++)
+			{
+				if (!inside[i])
+				{
+					cuts.push_back(i);
+				}
+			}
+		}
+
+		void checkBytes(const char* block, const char* var, S32 i, const U8* decoded, S32 size)
+		{
+			std::string name = std::string(block) + "." + var;
+			ensure_equals((name + " size").c_str(), size, mReader->getSize(block, i, var));
+			std::vector<U8> expected(size + 1);
+			if (size)
+			{
+				mReader->getBinaryData(block, var, &expected[0], size, i);
+			}
+			ensure(name, !size || !memcmp(decoded, &expected[0], size));
+		}
+
+		template <class D>
+		void checkRegionData(const D& decoded)
+		{
+			CHECK_FIELD(U64, getU64, decoded.getRegionData(), RegionData, RegionHandle, 0);
+			CHECK_FIELD(U16, getU16, decoded.getRegionData(), RegionData, TimeDilation, 0);
+		}
+
+		void checkCount(const char* block, S32 count)
+		{
+			ensure_equals((std::string(block) + " count").c_str(), count, mReader->getNumberOfBlocks(block));
+		}
+
+		void checkMessage(const LLMsgObjectUpdate& msg)
+		{
+			checkRegionData(msg);
+			checkCount(_PREHASH_ObjectData, msg.getObjectDataCount());
+			for (S32 i = 0; i < msg.getObjectDataCount(); i++)
+			{
+				const LLMsgObjectUpdate::ObjectDataBlock& data = msg.getObjectData(i);
+				CHECK_FIELD(U32, getU32, data, ObjectData, ID, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, State, i);
+				CHECK_FIELD(LLUUID, getUUID, data, ObjectData, FullID, i);
+				CHECK_FIELD(U32, getU32, data, ObjectData, CRC, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, PCode, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, Material, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, ClickAction, i);
+				CHECK_FIELD(LLVector3, getVector3, data, ObjectData, Scale, i);
+				CHECK_VARIABLE(data, ObjectData, ObjectData, i);
+				CHECK_FIELD(U32, getU32, data, ObjectData, ParentID, i);
+				CHECK_FIELD(U32, getU32, data, ObjectData, UpdateFlags, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, PathCurve, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, ProfileCurve, i);
+				CHECK_FIELD(U16, getU16, data, ObjectData, PathBegin, i);
+				CHECK_FIELD(U16, getU16, data, ObjectData, PathEnd, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, PathScaleX, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, PathScaleY, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, PathShearX, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, PathShearY, i);
+				CHECK_FIELD(S8, getS8, data, ObjectData, PathTwist, i);
+				CHECK_FIELD(S8, getS8, data, ObjectData, PathTwistBegin, i);
+				CHECK_FIELD(S8, getS8, data, ObjectData, PathRadiusOffset, i);
+				CHECK_FIELD(S8, getS8, data, ObjectData, PathTaperX, i);
+				CHECK_FIELD(S8, getS8, data, ObjectData, PathTaperY, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, PathRevolutions, i);
+				CHECK_FIELD(S8, getS8, data, ObjectData, PathSkew, i);
+				CHECK_FIELD(U16, getU16, data, ObjectData, ProfileBegin, i);
+				CHECK_FIELD(U16, getU16, data, ObjectData, ProfileEnd, i);
+				CHECK_FIELD(U16, getU16, data, ObjectData, ProfileHollow, i);
+				CHECK_VARIABLE(data, ObjectData, TextureEntry, i);
+				CHECK_VARIABLE(data, ObjectData, TextureAnim, i);
+				CHECK_VARIABLE(data, ObjectData, NameValue, i);
+				CHECK_VARIABLE(data, ObjectData, Data, i);
+				CHECK_VARIABLE(data, ObjectData, Text, i);
+				CHECK_BYTES(data, ObjectData, TextColor, i, 4);
+				CHECK_VARIABLE(data, ObjectData, MediaURL, i);
+				CHECK_VARIABLE(data, ObjectData, PSBlock, i);
+				CHECK_VARIABLE(data, ObjectData, ExtraParams, i);
+				CHECK_FIELD(LLUUID, getUUID, data, ObjectData, Sound, i);
+				CHECK_FIELD(LLUUID, getUUID, data, ObjectData, OwnerID, i);
+				CHECK_FIELD(F32, getF32, data, ObjectData, Gain, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, Flags, i);
+				CHECK_FIELD(F32, getF32, data, ObjectData, Radius, i);
+				CHECK_FIELD(U8, getU8, data, ObjectData, JointType, i);
+				CHECK_FIELD(LLVector3, getVector3, data, ObjectData, JointPivot, i);
+				CHECK_FIELD(LLVector3, getVector3, data, ObjectData, JointAxisOrAnchor, i);
+
+				// The reader runs on past unterminated strings
+				if (memchr(data.getText(), 0, data.getTextSize()))
+				{
+					std::string text;
+					std::string expected;
+					data.getText(text);
+					mReader->getString(_PREHASH_ObjectData, _PREHASH_Text, expected, i);
+					ensure_equals("ObjectData.Text string", text, expected);
+				}
+			}
+		}
+
+		void checkMessage(const LLMsgObjectUpdateCompressed& msg)
+		{
+			checkRegionData(msg);
+			checkCount(_PREHASH_ObjectData, msg.getObjectDataCount());
+			for (S32 i = 0; i < msg.getObjectDataCount(); i++)
+			{
+				const LLMsgObjectUpdateCompressed::ObjectDataBlock& data = msg.getObjectData(i);
+				CHECK_FIELD(U32, getU32, data, ObjectData, UpdateFlags, i);
+				CHECK_VARIABLE(data, ObjectData, Data, i);
+			}
+		}
+
+		void checkMessage(const LLMsgObjectUpdateCached& msg)
+		{
+			checkRegionData(msg);
+			checkCount(_PREHASH_ObjectData, msg.getObjectDataCount());
+			for (S32 i = 0; i < msg.getObjectDataCount(); i++)
+			{
+				const LLMsgObjectUpdateCached::ObjectDataBlock& data = msg.getObjectData(i);
+				CHECK_FIELD(U32, getU32, data, ObjectData, ID, i);
+				CHECK_FIELD(U32, getU32, data, ObjectData, CRC, i);
+				CHECK_FIELD(U32, getU32, data, ObjectData, UpdateFlags, i);
+			}
+		}
+
+		void checkMessage(const LLMsgImprovedTerseObjectUpdate& msg)
+		{
+			checkRegionData(msg);
+			checkCount(_PREHASH_ObjectData, msg.getObjectDataCount());
+			for (S32 i = 0; i < msg.getObjectDataCount(); i++)
+			{
+				const LLMsgImprovedTerseObjectUpdate::ObjectDataBlock& data = msg.getObjectData(i);
+				CHECK_VARIABLE(data, ObjectData, Data, i);
+				CHECK_VARIABLE(data, ObjectData, TextureEntry, i);
+			}
+		}
+
+		void checkMessage(const LLMsgKillObject& msg)
+		{
+			checkCount(_PREHASH_ObjectData, msg.getObjectDataCount());
+			for (S32 i = 0; i < msg.getObjectDataCount(); i++)
+			{
+				CHECK_FIELD(U32, getU32, msg.getObjectData(i), ObjectData, ID, i);
+			}
+		}
+
+		void checkMessage(const LLMsgSimulatorViewerTimeMessage& msg)
+		{
+			const LLMsgSimulatorViewerTimeMessage::TimeInfoBlock& data = msg.getTimeInfo();
+			CHECK_FIELD(U64, getU64, data, TimeInfo, UsecSinceStart, 0);
+			CHECK_FIELD(U32, getU32, data, TimeInfo, SecPerDay, 0);
+			CHECK_FIELD(U32, getU32, data, TimeInfo, SecPerYear, 0);
+			CHECK_FIELD(LLVector3, getVector3, data, TimeInfo, SunDirection, 0);
+			CHECK_FIELD(F32, getF32, data, TimeInfo, SunPhase, 0);
+			CHECK_FIELD(LLVector3, getVector3, data, TimeInfo, SunAngVelocity, 0);
+		}
+
+		void checkMessage(const LLMsgAvatarAnimation& msg)
+		{
+			CHECK_FIELD(LLUUID, getUUID, msg.getSender(), Sender, ID, 0);
+			checkCount(_PREHASH_AnimationList, msg.getAnimationListCount());
+			for (S32 i = 0; i < msg.getAnimationListCount(); i++)
+			{
+				CHECK_FIELD(LLUUID, getUUID, msg.getAnimationList(i), AnimationList, AnimID, i);
+				CHECK_FIELD(S32, getS32, msg.getAnimationList(i), AnimationList, AnimSequenceID, i);
+			}
+			checkCount(_PREHASH_AnimationSourceList, msg.getAnimationSourceListCount());
+			for (S32 i = 0; i < msg.getAnimationSourceListCount(); i++)
+			{
+				CHECK_FIELD(LLUUID, getUUID, msg.getAnimationSourceList(i), AnimationSourceList, ObjectID, i);
+			}
+			checkCount(_PREHASH_PhysicalAvatarEventList, msg.getPhysicalAvatarEventListCount());
+			for (S32 i = 0; i < msg.getPhysicalAvatarEventListCount(); i++)
+			{
+				CHECK_VARIABLE(msg.getPhysicalAvatarEventList(i), PhysicalAvatarEventList, TypeData, i);
+			}
+		}
+
+		// Decodes random messages, whole and cut short, both ways
+		template <class D>
+		void checkDecoder(const char* name)
+		{
+			for (S32 n = 0; n < 50; n++)
+			{
+				S32 size = buildMessage(name, 4, 40);
+				readMessage(size);
+				ensure_equals((std::string(name) + " number").c_str(), mReader->getMessageNumber(), (U32)D::MESSAGE_NUMBER);
+				S32 header_size = size - mReader->getMessageBodySize();
+
+				std::vector<U8> body(mReader->getMessageBody(), mReader->getMessageBody() + mReader->getMessageBodySize());
+				std::vector<S32> cuts;
+				getCutPoints(name, &body[0], (S32)body.size(), cuts);
+				for (S32 c = 0; c < 5 && !cuts.empty(); c++)
+				{
+					S32 cut = c ? cuts[rand(cuts.size())] : (S32)body.size();
+					memset(mBuffer + header_size + cut, 0, sizeof(mBuffer) - header_size - cut);
+					BOOL read = readMessage(header_size + cut);
+
+					D* decoded = new D;
+					ensure_equals((std::string(name) + " decodes like the reader").c_str(), decoded->decode(mReader->getMessageBody(), cut), read);
+					if (read)
+					{
+						checkMessage(*decoded);
+					}
+					delete decoded;
+				}
+			}
+		}
+
+		U32 mSeed;
+		LLTemplateMessageReader* mReader;
+		U8 mBuffer[MAX_BUFFER_SIZE];
+	};
+
+	typedef test_group<messagedecoder_data> messagedecoder_test_t;
+	typedef messagedecoder_test_t::object messagedecoder_object_t;
+	tut::messagedecoder_test_t tut_messagedecoder_test("messagedecoder");
+
+	template<> template<>
+	void messagedecoder_object_t::test<1>()
+	{
+		// The checked in decoders are what the generator makes of the
+		// template in the tree
+		ensure("template parsed", getParser().getMessagesBegin() != getParser().getMessagesEnd());
+
+		LLMessageDecoderGenerator generator(getParser());
+		ensure("default messages in template", generator.addDefaultMessages());
+
+		std::ostringstream header;
+		std::ostringstream source;
+		generator.writeHeader(header);
+		generator.writeSource(source);
+
+		std::string checked_in;
+		ensure("read llmessagedecoders.h", _read_file_into_string(checked_in, get_source_path("../llmessage/llmessagedecoders.h")));
+		ensure("llmessagedecoders.h up to date, run msgdecodergen", checked_in == header.str());
+		ensure("read llmessagedecoders.cpp", _read_file_into_string(checked_in, get_source_path("../llmessage/llmessagedecoders.cpp")));
+		ensure("llmessagedecoders.cpp up to date, run msgdecodergen", checked_in == source.str());
+	}
+
+	template<> template<>
+	void messagedecoder_object_t::test<2>()
+	{
+		checkDecoder<LLMsgObjectUpdate>("ObjectUpdate");
+		checkDecoder<LLMsgObjectUpdateCompressed>("ObjectUpdateCompressed");
+		checkDecoder<LLMsgObjectUpdateCached>("ObjectUpdateCached");
+		checkDecoder<LLMsgImprovedTerseObjectUpdate>("ImprovedTerseObjectUpdate");
+		checkDecoder<LLMsgKillObject>("KillObject");
+		checkDecoder<LLMsgSimulatorViewerTimeMessage>("SimulatorViewerTimeMessage");
+		checkDecoder<LLMsgAvatarAnimation>("AvatarAnimation");
+	}
+
+	template<> template<>
+	void messagedecoder_object_t::test<3>()
+	{
+		// Cut short fields read as zeros, as from the reader's zeroed
+		// buffer, and nothing is read past the end of the packet
+		LLMsgImprovedTerseObjectUpdate terse;
+		U8 short_data[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 200, 1, 2, 3 };
+		ensure("short data", terse.decode(short_data, sizeof(short_data)));
+		ensure_equals("short data size", terse.getObjectData().getDataSize(), 200);
+		ensure("short data bytes", terse.getObjectData().getData()[2] == 3 && terse.getObjectData().getData()[3] == 0);
+		ensure_equals("missing field", terse.getObjectData().getTextureEntrySize(), 0);
+
+		U8 corrupt[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0xff, 0xff, 1, 2, 3 };
+		ensure("length past any padding", !terse.decode(corrupt, sizeof(corrupt)));
+
+		// Non-finite floats read as zero, like the reader's getters
+		U8 time_info[44];
+		memset(time_info, 0, sizeof(time_info));
+		memset(time_info + 28, 0xff, 4);
+		LLMsgSimulatorViewerTimeMessage time_message;
+		ensure("time message", time_message.decode(time_info, sizeof(time_info)));
+		ensure_equals("NaN sun phase", time_message.getTimeInfo().getSunPhase(), 0.f);
+
+		U8 empty[] = { 0 };
+		LLMsgKillObject kill;
+		ensure("no blocks", !kill.decode(empty, sizeof(empty)));
+		ensure("another message", !kill.decode((LLMessageSystem*)NULL));
+	}
+
+#if LL_BENCHMARKS
+	struct messagedecoder_benchmark : public messagedecoder_data { };
+	typedef test_group<messagedecoder_benchmark> messagedecoder_benchmark_t;
+	typedef messagedecoder_benchmark_t::object messagedecoder_benchmark_object_t;
+	tut::messagedecoder_benchmark_t tut_messagedecoder_benchmark("messagedecoder benchmark");
+
+	template<> template<>
+	void messagedecoder_benchmark_object_t::test<1>()
+	{
+		// Handler throughput on object update traffic: the named lookups of
+		// the reader against the generated offsets, both after the reader has
+		// decoded the packet for dispatch
+		const S32 PASSES = 2000;
+		const char* names[] = { "ObjectUpdate", "ImprovedTerseObjectUpdate" };
+		for (S32 m = 0; m < 2; m++)
+		{
+			S32 size;
+			do
+			{
+				size = buildMessage(names[m], m ? 12 : 4, 40);
+			}
+			while (!readMessage(size));
+
+			F64 elapsed[2];
+			U32 checksum[2] = { 0, 0 };
+			for (S32 pass = 0; pass < 2; pass++)
+			{
+				LLTimer timer;
+				for (S32 n = 0; n < PASSES; n++)
+				{
+					if (m == 0 && pass == 0)
+					{
+						S32 count = mReader->getNumberOfBlocks(_PREHASH_ObjectData);
+						for (S32 i = 0; i < count; i++)
+						{
+							U32 id;
+							LLUUID full_id;
+							U8 pcode;
+							LLVector3 scale;
+							mReader->getU32(_PREHASH_ObjectData, _PREHASH_ID, id, i);
+							mReader->getUUID(_PREHASH_ObjectData, _PREHASH_FullID, full_id, i);
+							mReader->getU8(_PREHASH_ObjectData, _PREHASH_PCode, pcode, i);
+							mReader->getVector3(_PREHASH_ObjectData, _PREHASH_Scale, scale, i);
+							checksum[pass] += id + full_id.mData[0] + pcode
+								+ mReader->getSize(_PREHASH_ObjectData, i, _PREHASH_TextureEntry);
+						}
+					}
+					else if (m == 0)
+					{
+						LLMsgObjectUpdate msg;
+						msg.decode(mReader->getMessageBody(), mReader->getMessageBodySize());
+						for (S32 i = 0; i < msg.getObjectDataCount(); i++)
+						{
+							const LLMsgObjectUpdate::ObjectDataBlock& data = msg.getObjectData(i);
+							LLVector3 scale = data.getScale();
+							checksum[pass] += data.getID() + data.getFullID().mData[0] + data.getPCode()
+								+ data.getTextureEntrySize();
+						}
+					}
+					else if (pass == 0)
+					{
+						S32 count = mReader->getNumberOfBlocks(_PREHASH_ObjectData);
+						for (S32 i = 0; i < count; i++)
+						{
+							U8 data[256];
+							S32 data_size = mReader->getSize(_PREHASH_ObjectData, i, _PREHASH_Data);
+							mReader->getBinaryData(_PREHASH_ObjectData, _PREHASH_Data, data, 0, i, sizeof(data));
+							checksum[pass] += data_size + mReader->getSize(_PREHASH_ObjectData, i, _PREHASH_TextureEntry);
+						}
+					}
+					else
+					{
+						LLMsgImprovedTerseObjectUpdate msg;
+						msg.decode(mReader->getMessageBody(), mReader->getMessageBodySize());
+						for (S32 i = 0; i < msg.getObjectDataCount(); i++)
+						{
+							U8 data[256];
+							const LLMsgImprovedTerseObjectUpdate::ObjectDataBlock& block = msg.getObjectData(i);
+							S32 data_size = llmin(block.getDataSize(), (S32)sizeof(data));
+							memcpy(data, block.getData(), data_size);
+							checksum[pass] += data_size + block.getTextureEntrySize();
+						}
+					}
+				}
+				elapsed[pass] = timer.getElapsedTimeF64();
+			}
+
+			ensure_equals((std::string(names[m]) + " same fields read").c_str(), checksum[1], checksum[0]);
+			std::cout << names[m] << " handler fields, " << mReader->getNumberOfBlocks(_PREHASH_ObjectData)
+					  << " objects, " << PASSES << " packets: reader " << (S32) (PASSES / elapsed[0])
+					  << " packets/s, decoder " << (S32) (PASSES / elapsed[1]) << " packets/s" << std::endl;
+		}
+	}
+#endif // LL_BENCHMARKS
+}
@@ -0,0 +1,292 @@
+/**
+ * @file llocclusionbuffer_tut.cpp
+ * @brief Tests for LLOcclusionBuffer and a rasterization benchmark.
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <vector>
+
+#include "lltimer.h"
+#include "llcamera.h"
+#include "llquaternion.h"
+#include "v3math.h"
+#include "llocclusionbuffer.h"
+
+namespace tut
+{
+	struct occluder_box
+	{
+		LLVector3 mCenter;
+		LLVector3 mAxes[3];
+	};
+
+	struct occlusion_data
+	{
+		occlusion_data() : mSeed(1)
+		{
+			// 60 degree vertical field of view at 2:1, looking down +X
+			mCamera.setView(F_PI / 3.f);
+			mCamera.setAspect(2.f);
+			mCamera.setNear(0.1f);
+			mCamera.lookAt(LLVector3(0.f, 0.f, 2.f), LLVector3(10.f, 0.f, 2.f));
+		}
+
+		F32 frand(F32 low, F32 high)
+		{
+			// Fixed LCG so every run sees the same scene
+			mSeed = mSeed * 1103515245 + 12345;
+			return low + (high - low) * ((mSeed >> 8) & 0xffff) / 65536.f;
+		}
+
+		occluder_box randomBox(F32 x_low, F32 x_high, F32 size_low, F32 size_high)
+		{
+			occluder_box box;
+			box.mCenter.setVec(frand(x_low, x_high), frand(-15.f, 15.f), frand(-8.f, 12.f));
+			LLVector3 axis(frand(-1.f, 1.f), frand(-1.f, 1.f), frand(0.1f, 1.f));
+			axis.normVec();
+			LLQuaternion rot(frand(0.f, F_TWO_PI), axis);
+			box.mAxes[0] = LLVector3(frand(size_low, size_high), 0.f, 0.f) * rot;
+			box.mAxes[1] = LLVector3(0.f, frand(size_low, size_high), 0.f) * rot;
+			box.mAxes[2] = LLVector3(0.f, 0.f, frand(size_low, size_high)) * rot;
+			return box;
+		}
+
+		bool inView(const LLVector3& point) const
+		{
+			LLVector3 d = point - mCamera.getOrigin();
+			F32 z = d * mCamera.getAtAxis();
+			F32 tan_y = tanf(mCamera.getView() * 0.5f);
+			return z > mCamera.getNear()
+				&& fabsf(d * mCamera.getLeftAxis()) <= z * tan_y * mCamera.getAspect()
+				&& fabsf(d * mCamera.getUpAxis()) <= z * tan_y;
+		}
+
+		// True if the segment from the eye to point passes through box
+		static bool hides(const occluder_box& box, const LLVector3& eye, const LLVector3& point)
+		{
+			F32 t_min = 0.f;
+			F32 t_max = 1.f;
+			LLVector3 dir = point - eye;
+			for (U32 i = 0; i < 3; i++)
+			{
+				F32 half = box.mAxes[i].magVec();
+				LLVector3 axis = box.mAxes[i] / half;
+				F32 o = (eye - box.mCenter) * axis;
+				F32 d = dir * axis;
+				if (fabsf(d) < 1e-6f)
+				{
+					if (fabsf(o) > half)
+					{
+						return false;
+					}
+					continue;
+				}
+				F32 t0 = (-half - o) / d;
+				F32 t1 = (half - o) / d;
+				t_min = llmax(t_min, llmin(t0, t1));
+				t_max = llmin(t_max, llmax(t0, t1));
+				if (t_min > t_max)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		U32 mSeed;
+		LLCamera mCamera;
+		LLOcclusionBuffer mBuffer;
+	};
+
+	typedef test_group<occlusion_data> occlusion_test_t;
+	typedef occlusion_test_t::object occlusion_object_t;
+	tut::occlusion_test_t tut_occlusion_test("occlusion buffer");
+
+	template<> template<>
+	void occlusion_object_t::test<1>()
+	{
+		// A wall in front of the camera
+		mBuffer.clear(mCamera, 256, 128);
+		mBuffer.build();
+		ensure("empty buffer hides nothing", !mBuffer.isOccluded(LLVector3(20.f, 0.f, 2.f), LLVector3(1.f, 1.f, 1.f)));
+
+		mBuffer.clear(mCamera, 256, 128);
+		LLVector3 wall[3] = { LLVector3(0.5f, 0.f, 0.f), LLVector3(0.f, 5.f, 0.f), LLVector3(0.f, 0.f, 5.f) };
+		mBuffer.addBox(LLVector3(10.f, 0.f, 2.f), wall);
+		mBuffer.build();
+		ensure_equals("wall rasterized", mBuffer.getOccluderCount(), (U32) 1);
+		ensure_equals("pyramid levels", mBuffer.getLevelCount(), (U32) 9);
+
+		ensure("box behind the wall", mBuffer.isOccluded(LLVector3(20.f, 0.f, 2.f), LLVector3(1.f, 1.f, 1.f)));
+		ensure("box beside the wall", !mBuffer.isOccluded(LLVector3(20.f, 15.f, 2.f), LLVector3(1.f, 1.f, 1.f)));
+		ensure("box in front of the wall", !mBuffer.isOccluded(LLVector3(5.f, 0.f, 2.f), LLVector3(1.f, 1.f, 1.f)));
+		ensure("box poking over the wall", !mBuffer.isOccluded(LLVector3(20.f, 0.f, 12.f), LLVector3(1.f, 1.f, 1.f)));
+		ensure("box through the wall", !mBuffer.isOccluded(LLVector3(10.f, 0.f, 2.f), LLVector3(1.f, 1.f, 1.f)));
+		ensure("box around the camera", !mBuffer.isOccluded(LLVector3(0.f, 0.f, 2.f), LLVector3(1.f, 1.f, 1.f)));
+		ensure("box behind the camera", !mBuffer.isOccluded(LLVector3(-20.f, 0.f, 2.f), LLVector3(1.f, 1.f, 1.f)));
+
+		// From inside a box all its faces are seen from behind
+		mBuffer.clear(mCamera, 256, 128);
+		LLVector3 room[3] = { LLVector3(4.f, 0.f, 0.f), LLVector3(0.f, 4.f, 0.f), LLVector3(0.f, 0.f, 4.f) };
+		mBuffer.addBox(LLVector3(0.f, 0.f, 2.f), room);
+		mBuffer.build();
+		ensure("inside a box", mBuffer.isEmpty());
+		ensure("nothing hidden from inside a box", !mBuffer.isOccluded(LLVector3(20.f, 0.f, 2.f), LLVector3(1.f, 1.f, 1.f)));
+	}
+
+	template<> template<>
+	void occlusion_object_t::test<2>()
+	{
+		// Any box reported as occluded really is hidden from the eye at
+		// every point sampled over its surface
+		const U32 SCENES = 20;
+		const U32 SAMPLES = 5;
+		U32 tested = 0;
+		U32 occluded = 0;
+		for (U32 scene = 0; scene < SCENES; scene++)
+		{
+			std::vector<occluder_box> occluders;
+			mBuffer.clear(mCamera, 128, 64);
+			for (U32 i = 0; i < 40; i++)
+			{
+				occluders.push_back(randomBox(4.f, 30.f, 0.5f, 5.f));
+				mBuffer.addBox(occluders.back().mCenter, occluders.back().mAxes);
+			}
+			mBuffer.build();
+
+			for (U32 i = 0; i < 200; i++)
+			{
+				LLVector3 center(frand(8.f, 60.f), frand(-20.f, 20.f), frand(-10.f, 14.f));
+				LLVector3 radius(frand(0.1f, 3.f), frand(0.1f, 3.f), frand(0.1f, 3.f));
+				tested++;
+				if (!mBuffer.isOccluded(center, radius))
+				{
+					continue;
+				}
+				occluded++;
+
+				for (U32 axis = 0; axis < 3; axis++)
+				{
+					U32 u = (axis + 1) % 3;
+					U32 v = (axis + 2) % 3;
+					for (S32 side = -1; side <= 1; side += 2)
+					{
+						for (U32 su = 0; su < SAMPLES; su++)
+						{
+							for (U32 sv = 0; sv < SAMPLES; sv++)
+							{
+								LLVector3 point = center;
+								point.mV[axis] += side * radius.mV[axis];
+								point.mV[u] += radius.mV[u] * (2.f * su / (SAMPLES - 1) - 1.f);
+								point.mV[v] += radius.mV[v] * (2.f * sv / (SAMPLES - 1) - 1.f);
+
+								if (!inView(point))
+								{
+									// Only what the camera sees needs hiding
+									continue;
+								}
+
+								bool hidden = false;
+								for (U32 o = 0; o < occluders.size() && !hidden; o++)
+								{
+									hidden = hides(occluders[o], mCamera.getOrigin(), point);
+								}
+								ensure("occluded box is hidden", hidden);
+							}
+						}
+					}
+				}
+			}
+		}
+		ensure("some boxes occluded", occluded > 0);
+		ensure("not every box occluded", occluded < tested);
+	}
+
+#if LL_BENCHMARKS
+	struct occlusion_benchmark : public occlusion_data { };
+	typedef test_group<occlusion_benchmark> occlusion_benchmark_t;
+	typedef occlusion_benchmark_t::object occlusion_benchmark_object_t;
+	tut::occlusion_benchmark_t tut_occlusion_benchmark("occlusion buffer benchmark");
+
+	template<> template<>
+	void occlusion_benchmark_object_t::test<1>()
+	{
+		// Benchmark: a frame's worth of occluders and octree node tests
+		const U32 FRAMES = 50;
+		const U32 OCCLUDERS = 256;
+		const U32 TESTS = 4000;
+
+		std::vector<occluder_box> occluders;
+		for (U32 i = 0; i < OCCLUDERS; i++)
+		{
+			occluders.push_back(randomBox(4.f, 120.f, 0.5f, 8.f));
+		}
+		std::vector<LLVector3> boxes;
+		for (U32 i = 0; i < TESTS; i++)
+		{
+			boxes.push_back(LLVector3(frand(8.f, 200.f), frand(-60.f, 60.f), frand(-20.f, 30.f)));
+			boxes.push_back(LLVector3(frand(0.5f, 8.f), frand(0.5f, 8.f), frand(0.5f, 8.f)));
+		}
+
+		F64 raster_time = 0.0;
+		F64 test_time = 0.0;
+		U32 occluded = 0;
+		for (U32 frame = 0; frame < FRAMES; frame++)
+		{
+			LLTimer timer;
+			mBuffer.clear(mCamera, 256, 128);
+			for (U32 i = 0; i < OCCLUDERS; i++)
+			{
+				mBuffer.addBox(occluders[i].mCenter, occluders[i].mAxes);
+			}
+			mBuffer.build();
+			raster_time += timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (U32 i = 0; i < boxes.size(); i += 2)
+			{
+				occluded += mBuffer.isOccluded(boxes[i], boxes[i + 1]) ? 1 : 0;
+			}
+			test_time += timer.getElapsedTimeF64();
+		}
+
+		ensure("something occluded", occluded > 0);
+
+		std::cout << "LLOcclusionBuffer 256x128, " << OCCLUDERS << " box occluders: "
+				  << raster_time * 1000.0 / FRAMES << " ms/frame to build, "
+				  << (S32) (FRAMES * TESTS / test_time) << " box tests/s, "
+				  << occluded * 100 / (FRAMES * TESTS) << "% occluded" << std::endl;
+	}
+#endif // LL_BENCHMARKS
+}
@@ -0,0 +1,373 @@
+/**
+ * @file lloctree_tut.cpp
+ * @brief Tests for LLOctreeNode element storage and a culling benchmark.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "llmemory.h"
+#include "lltimer.h"
+#include "v3dmath.h"
+#include "v4math.h"
+#include "lloctree.h"
+
+namespace tut
+{
+	// Stands in for LLDrawable: just enough to be binned in an octree
+	class oct_element : public LLRefCount
+	{
+	public:
+		oct_element(const LLVector3d& pos, F64 radius)
+			: mPositionGroup(pos), mBinRadius(radius), mBinIndex(-1)
+		{
+		}
+
+		const LLVector3d& getPositionGroup() const	{ return mPositionGroup; }
+		F64 getBinRadius() const					{ return mBinRadius; }
+		S32 getBinIndex() const						{ return mBinIndex; }
+		void setBinIndex(S32 index) const			{ mBinIndex = index; }
+
+	private:
+		LLVector3d mPositionGroup;
+		F64 mBinRadius;
+		mutable S32 mBinIndex;
+	};
+
+	typedef LLOctreeNode<oct_element> oct_node;
+	typedef LLOctreeRoot<oct_element> oct_root;
+	typedef std::vector<LLPointer<oct_element> > element_vec_t;
+
+	// Copy of an octree's shape with its elements held in an L, so element
+	// layouts can be compared on otherwise identical trees
+	template <class L>
+	struct layout_node
+	{
+		LLVector3d mCenter;
+		LLVector3d mSize;
+		L mData;
+		std::vector<layout_node<L>*> mChild;
+
+		layout_node(const oct_node* node)
+			: mCenter(node->getCenter()), mSize(node->getSize())
+		{
+			for (oct_node::const_element_iter i = node->getData().begin(); i != node->getData().end(); ++i)
+			{
+				mData.insert(mData.end(), *i);
+			}
+			for (U32 i = 0; i < node->getChildCount(); i++)
+			{
+				mChild.push_back(new layout_node<L>(node->getChild(i)));
+			}
+		}
+
+		~layout_node()
+		{
+			for (U32 i = 0; i < mChild.size(); i++)
+			{
+				delete mChild[i];
+			}
+		}
+	};
+
+	typedef layout_node<std::vector<LLPointer<oct_element> > > vector_node;
+	typedef layout_node<std::set<LLPointer<oct_element> > > set_node;
+
+	// Six plane view frustum, planes stored as (normal, d) with the
+	// inside on the positive side
+	class cull_frustum
+	{
+	public:
+		cull_frustum(const LLVector3d& origin, F64 far_clip)
+		{
+			// 90 degree frustum looking down +X
+			setPlane(0, LLVector3d(1, 0, 0), origin);
+			setPlane(1, LLVector3d(-1, 0, 0), origin + LLVector3d(far_clip, 0, 0));
+			setPlane(2, LLVector3d(1, 1, 0), origin);
+			setPlane(3, LLVector3d(1, -1, 0), origin);
+			setPlane(4, LLVector3d(1, 0, 1), origin);
+			setPlane(5, LLVector3d(1, 0, -1), origin);
+		}
+
+		bool boxVisible(const LLVector3d& center, const LLVector3d& size) const
+		{
+			for (U32 i = 0; i < 6; i++)
+			{
+				const LLVector4& p = mPlanes[i];
+				F64 r = fabs(p.mV[0] * size.mdV[0]) + fabs(p.mV[1] * size.mdV[1]) + fabs(p.mV[2] * size.mdV[2]);
+				if (distance(p, center) < -r)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool sphereVisible(const LLVector3d& center, F64 radius) const
+		{
+			for (U32 i = 0; i < 6; i++)
+			{
+				if (distance(mPlanes[i], center) < -radius)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		void setPlane(U32 i, LLVector3d normal, const LLVector3d& point)
+		{
+			normal.normVec();
+			mPlanes[i].setVec((F32) normal.mdV[0], (F32) normal.mdV[1], (F32) normal.mdV[2], (F32) -(normal * point));
+		}
+
+		static F64 distance(const LLVector4& p, const LLVector3d& v)
+		{
+			return p.mV[0] * v.mdV[0] + p.mV[1] * v.mdV[1] + p.mV[2] * v.mdV[2] + p.mV[3];
+		}
+
+		LLVector4 mPlanes[6];
+	};
+
+	template <class L>
+	U32 cull_layout(const layout_node<L>* node, const cull_frustum& frustum)
+	{
+		if (!frustum.boxVisible(node->mCenter, node->mSize))
+		{
+			return 0;
+		}
+		U32 visible = 0;
+		for (typename L::const_iterator i = node->mData.begin(); i != node->mData.end(); ++i)
+		{
+			const oct_element* element = *i;
+			if (frustum.sphereVisible(element->getPositionGroup(), element->getBinRadius()))
+			{
+				visible++;
+			}
+		}
+		for (U32 i = 0; i < node->mChild.size(); i++)
+		{
+			visible += cull_layout(node->mChild[i], frustum);
+		}
+		return visible;
+	}
+
+	class oct_validator : public LLOctreeTraveler<oct_element>
+	{
+	public:
+		oct_validator() : mCount(0), mValid(true) { }
+
+		virtual void visit(const oct_node* branch)
+		{
+			const oct_node::element_list& data = branch->getData();
+			for (U32 i = 0; i < data.size(); i++)
+			{
+				if (data[i]->getBinIndex() != (S32) i)
+				{
+					mValid = false;
+				}
+			}
+			mCount += data.size();
+		}
+
+		U32 mCount;
+		bool mValid;
+	};
+
+	struct octree_data
+	{
+		octree_data() : mSeed(1) { }
+
+		F64 frand(F64 range)
+		{
+			// Fixed LCG so every run bins the same region
+			mSeed = mSeed * 1103515245 + 12345;
+			return range * ((mSeed >> 8) & 0xffff) / 65536.0;
+		}
+
+		oct_root* createRoot()
+		{
+			return new oct_root(LLVector3d(128, 128, 128), LLVector3d(128, 128, 128), NULL);
+		}
+
+		// A region's worth of prims: mostly small, a few large, clustered
+		// near the ground
+		void populate(oct_root* root, U32 count)
+		{
+			for (U32 i = 0; i < count; i++)
+			{
+				F64 radius = (i % 50 == 0) ? 4.0 + frand(28.0) : 0.1 + frand(2.0);
+				LLVector3d pos(frand(256.0), frand(256.0), 20.0 + frand(40.0));
+				oct_element* element = new oct_element(pos, radius);
+				mElements.push_back(element);
+				root->insert(element);
+			}
+		}
+
+		U32 mSeed;
+		element_vec_t mElements;
+	};
+
+	typedef test_group<octree_data> octree_test_t;
+	typedef octree_test_t::object octree_object_t;
+	tut::octree_test_t tut_octree_test("octree");
+
+	template<> template<>
+	void octree_object_t::test<1>()
+	{
+		// Every element knows its slot, across inserts and swap removes
+		oct_root* root = createRoot();
+		populate(root, 15000);
+
+		oct_validator validator;
+		validator.traverse(root);
+		ensure_equals("all elements binned", validator.mCount, (U32) 15000);
+		ensure("bin indices after insert", validator.mValid);
+
+		for (U32 i = 0; i < mElements.size(); i += 2)
+		{
+			ensure("remove", root->remove(mElements[i]));
+			ensure_equals("removed element unbinned", mElements[i]->getBinIndex(), -1);
+		}
+
+		oct_validator after;
+		after.traverse(root);
+		ensure_equals("half the elements left", after.mCount, (U32) 7500);
+		ensure("bin indices after remove", after.mValid);
+
+		delete root;
+	}
+
+	template<> template<>
+	void octree_object_t::test<2>()
+	{
+		// Rebuilding a tree reuses the pooled nodes of the one before it
+		oct_root* root = createRoot();
+		populate(root, 15000);
+		delete root;
+		U32 pool_size = oct_node::getPoolSize();
+		ensure("nodes pooled", pool_size > 0);
+		ensure_equals("all nodes returned", oct_node::getPoolFreeCount(), pool_size);
+
+		mSeed = 1;
+		mElements.clear();
+		root = createRoot();
+		populate(root, 15000);
+		ensure_equals("pool reused", oct_node::getPoolSize(), pool_size);
+		delete root;
+	}
+
+	template<> template<>
+	void octree_object_t::test<3>()
+	{
+		// The flat element arrays cull to the same visible set as the
+		// std::set layout they replaced
+		oct_root* root = createRoot();
+		populate(root, 15000);
+		vector_node* vector_root = new vector_node(root);
+		set_node* set_root = new set_node(root);
+
+		for (U32 i = 0; i < 8; i++)
+		{
+			cull_frustum frustum(LLVector3d(frand(128.0), frand(256.0), 30.0), 64.0 + frand(192.0));
+			U32 visible = cull_layout(vector_root, frustum);
+			ensure_equals("same visible set", visible, cull_layout(set_root, frustum));
+			if (i == 0)
+			{
+				ensure("something visible", visible > 0);
+			}
+		}
+
+		delete vector_root;
+		delete set_root;
+		delete root;
+	}
+
+#if LL_BENCHMARKS
+	struct octree_benchmark_data : public octree_data { };
+	typedef test_group<octree_benchmark_data> octree_benchmark_t;
+	typedef octree_benchmark_t::object octree_benchmark_object_t;
+	tut::octree_benchmark_t tut_octree_benchmark("octree benchmark");
+
+	template<> template<>
+	void octree_benchmark_object_t::test<1>()
+	{
+		// Cull benchmark over a synthetic 15k drawable region, comparing the
+		// flat element arrays against the std::set layout they replaced
+		const U32 PASSES = 200;
+
+		oct_root* root = createRoot();
+		populate(root, 15000);
+		vector_node* vector_root = new vector_node(root);
+		set_node* set_root = new set_node(root);
+
+		std::vector<cull_frustum> frusta;
+		for (U32 i = 0; i < 8; i++)
+		{
+			frusta.push_back(cull_frustum(LLVector3d(frand(128.0), frand(256.0), 30.0), 64.0 + frand(192.0)));
+		}
+
+		F64 elapsed[2];
+		U32 visible[2] = { 0, 0 };
+		for (U32 pass = 0; pass < 2; pass++)
+		{
+			LLTimer timer;
+			for (U32 n = 0; n < PASSES; n++)
+			{
+				const cull_frustum& frustum = frusta[n % frusta.size()];
+				if (pass == 0)
+				{
+					visible[pass] += cull_layout(vector_root, frustum);
+				}
+				else
+				{
+					visible[pass] += cull_layout(set_root, frustum);
+				}
+			}
+			elapsed[pass] = timer.getElapsedTimeF64();
+		}
+
+		ensure_equals("same visible set", visible[0], visible[1]);
+
+		std::cout << "LLOctreeNode cull, 15000 elements, " << PASSES << " passes: vector "
+				  << (S32) (PASSES / elapsed[0]) << " culls/s, set "
+				  << (S32) (PASSES / elapsed[1]) << " culls/s" << std::endl;
+
+		delete vector_root;
+		delete set_root;
+		delete root;
+	}
+#endif // LL_BENCHMARKS
+}
@@ -0,0 +1,296 @@
+/**
+ * @file llpacketack_tut.cpp
+ * @brief Tests for LLReliablePacketRing and the reliable packet pool.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#if !LL_WINDOWS
+#include <netinet/in.h>
+#else
+#include "winsock2.h"
+#endif
+
+#include "lltimer.h"
+#include "llpacketack.h"
+#include "message.h"
+
+namespace tut
+{
+	struct packetack_data
+	{
+		LLReliablePacket* createPacket(TPACKETID id, S32 retries = 3, S32 size = 64)
+		{
+			U8 buffer[MAX_BUFFER_SIZE];
+			memset(buffer, 0, size);
+			U32 net_id = htonl(id);
+			memcpy(&buffer[PHL_PACKET_ID], &net_id, sizeof(net_id));
+			LLReliablePacketParams params;
+			params.mRetries = retries;
+			return LLReliablePacket::create(0, buffer, size, &params);
+		}
+
+		// Ids of the packets in a ring, in walk order
+		std::vector<TPACKETID> walk(const LLReliablePacketRing& ring)
+		{
+			std::vector<TPACKETID> ids;
+			for (LLReliablePacket* packetp = ring.getFirst(); packetp; packetp = ring.getNext(packetp->getPacketID()))
+			{
+				ids.push_back(packetp->getPacketID());
+			}
+			return ids;
+		}
+
+		void releaseAll(LLReliablePacketRing& ring)
+		{
+			LLReliablePacket* packetp;
+			while ((packetp = ring.getFirst()))
+			{
+				ring.remove(packetp->getPacketID());
+				LLReliablePacket::release(packetp);
+			}
+		}
+
+		// Sends packets with in_flight of them unacked, acks arriving in
+		// order except for every 16th which comes a window late, using
+		// pooled packets in a ring or heap allocated packets in a std::map.
+		// Returns the number of packets acked.
+		S32 sendAndAck(bool use_ring, TPACKETID in_flight, TPACKETID packets)
+		{
+			const TPACKETID start = LL_PACKET_ID_MASK - packets / 2;
+
+			U8 buffer[128];
+			memset(buffer, 0, sizeof(buffer));
+			LLReliablePacketParams params;
+			params.mRetries = 3;
+
+			LLReliablePacketRing ring;
+			std::map<TPACKETID, LLReliablePacket*> map;
+			S32 acked = 0;
+			for (TPACKETID n = 0; n < packets + in_flight * 2; n++)
+			{
+				if (n < packets)
+				{
+					U32 net_id = htonl((start + n) & LL_PACKET_ID_MASK);
+					memcpy(&buffer[PHL_PACKET_ID], &net_id, sizeof(net_id));
+					if (use_ring)
+					{
+						ring.insert(LLReliablePacket::create(0, buffer, sizeof(buffer), &params));
+					}
+					else
+					{
+						LLReliablePacket* packetp = new LLReliablePacket(0, buffer, sizeof(buffer), &params);
+						map[packetp->getPacketID()] = packetp;
+					}
+				}
+
+				TPACKETID back = (n % 16) ? in_flight : in_flight * 2;
+				if (n >= back && n - back < packets)
+				{
+					TPACKETID id = (start + n - back) & LL_PACKET_ID_MASK;
+					if (use_ring)
+					{
+						LLReliablePacket* packetp = ring.remove(id);
+						if (packetp)
+						{
+							LLReliablePacket::release(packetp);
+							acked++;
+						}
+					}
+					else
+					{
+						std::map<TPACKETID, LLReliablePacket*>::iterator iter = map.find(id);
+						if (iter != map.end())
+						{
+							delete iter->second;
+							map.erase(iter);
+							acked++;
+						}
+					}
+				}
+			}
+			ensure("ring drained", ring.isEmpty());
+			ensure("map drained", map.empty());
+			return acked;
+		}
+	};
+
+	typedef test_group<packetack_data> packetack_test_t;
+	typedef packetack_test_t::object packetack_object_t;
+	tut::packetack_test_t tut_packetack_test("packetack");
+
+	template<> template<>
+	void packetack_object_t::test<1>()
+	{
+		// A window straddling the wrap of the 24 bit id space is walked oldest
+		// first, and removes from either end shrink it
+		LLReliablePacketRing ring;
+		const TPACKETID first = LL_PACKET_ID_MASK - 99;
+		for (TPACKETID i = 0; i < 200; i++)
+		{
+			ring.insert(createPacket((first + i) & LL_PACKET_ID_MASK));
+		}
+		ensure_equals("size", ring.size(), 200);
+		ensure_equals("oldest", ring.getOldestID(), first);
+		ensure("find before wrap", ring.find(LL_PACKET_ID_MASK) != NULL);
+		ensure("find after wrap", ring.find(99) != NULL);
+		ensure("outside window", ring.find(100) == NULL);
+		ensure("before window", ring.find(first - 1) == NULL);
+
+		std::vector<TPACKETID> ids = walk(ring);
+		ensure_equals("walked all", ids.size(), (size_t) 200);
+		for (U32 i = 0; i < ids.size(); i++)
+		{
+			ensure_equals("walk order", ids[i], (first + i) & LL_PACKET_ID_MASK);
+		}
+
+		LLReliablePacket* packetp = ring.remove(first);
+		ensure("remove oldest", packetp != NULL);
+		LLReliablePacket::release(packetp);
+		ensure("removed once", ring.remove(first) == NULL);
+		ensure_equals("window moves up", ring.getOldestID(), first + 1);
+
+		// Final retry moves can add a packet older than the window
+		ring.insert(createPacket(first));
+		ensure_equals("window moves down", ring.getOldestID(), first);
+		ensure_equals("size after reinsert", ring.size(), 200);
+
+		releaseAll(ring);
+		ensure("empty", ring.isEmpty());
+		ensure("nothing left", ring.getFirst() == NULL);
+	}
+
+	template<> template<>
+	void packetack_object_t::test<2>()
+	{
+		// A walk can remove the packet it is on, and packets added while it
+		// walks past the old newest one are visited too
+		LLReliablePacketRing ring;
+		for (TPACKETID i = 1000; i < 1100; i++)
+		{
+			ring.insert(createPacket(i));
+		}
+
+		U32 visited = 0;
+		TPACKETID id;
+		for (LLReliablePacket* packetp = ring.getFirst(); packetp; packetp = ring.getNext(id))
+		{
+			id = packetp->getPacketID();
+			visited++;
+			if (id % 2 == 0)
+			{
+				ring.remove(id);
+				LLReliablePacket::release(packetp);
+			}
+			if (id == 1050)
+			{
+				// Grows the slot array mid walk
+				for (TPACKETID j = 1100; j < 1200; j++)
+				{
+					ring.insert(createPacket(j));
+				}
+			}
+		}
+		ensure_equals("visited all", visited, (U32) 200);
+		ensure_equals("odd ones left", ring.size(), 100);
+		ensure("capacity grew", ring.getCapacity() >= 200);
+
+		// Emptying a ring mid walk ends the walk
+		visited = 0;
+		for (LLReliablePacket* packetp = ring.getFirst(); packetp; packetp = ring.getNext(id))
+		{
+			id = packetp->getPacketID();
+			visited++;
+			releaseAll(ring);
+		}
+		ensure_equals("walk ended", visited, (U32) 1);
+	}
+
+	template<> template<>
+	void packetack_object_t::test<3>()
+	{
+		// Released packets are reused along with their buffers
+		LLReliablePacket* packetp = createPacket(1, 3, 512);
+		LLReliablePacket::release(packetp);
+		U32 pool_size = LLReliablePacket::getPoolSize();
+		U32 free_count = LLReliablePacket::getPoolFreeCount();
+		ensure("packet pooled", free_count > 0);
+
+		LLReliablePacket* reused = createPacket(2, 3, 128);
+		ensure("same packet", reused == packetp);
+		ensure_equals("id", reused->getPacketID(), (TPACKETID) 2);
+		ensure_equals("no new packets", LLReliablePacket::getPoolSize(), pool_size);
+		ensure_equals("taken from the free list", LLReliablePacket::getPoolFreeCount(), free_count - 1);
+		LLReliablePacket::release(reused);
+	}
+
+	template<> template<>
+	void packetack_object_t::test<4>()
+	{
+		// Every packet of a stream straddling the id wrap is acked, with a
+		// window late acks mixed in, and the ring and map both drain
+		ensure_equals("every packet acked", sendAndAck(true, 2000, 40000), 40000);
+		ensure_equals("same acks with a map", sendAndAck(false, 2000, 40000), 40000);
+	}
+
+#if LL_BENCHMARKS
+	struct packetack_benchmark : public packetack_data { };
+	typedef test_group<packetack_benchmark> packetack_benchmark_t;
+	typedef packetack_benchmark_t::object packetack_benchmark_object_t;
+	tut::packetack_benchmark_t tut_packetack_benchmark("packetack benchmark");
+
+	template<> template<>
+	void packetack_benchmark_object_t::test<1>()
+	{
+		// Send/ack benchmark with 2000 packets in flight. Compares pooled
+		// packets in a ring against the heap allocated packets in a std::map
+		// they replaced.
+		const TPACKETID IN_FLIGHT = 2000;
+		const TPACKETID PACKETS = 400000;
+
+		F64 elapsed[2];
+		for (U32 pass = 0; pass < 2; pass++)
+		{
+			LLTimer timer;
+			ensure_equals("every packet acked", sendAndAck(pass == 0, IN_FLIGHT, PACKETS), (S32) PACKETS);
+			elapsed[pass] = timer.getElapsedTimeF64();
+		}
+
+		std::cout << "LLReliablePacketRing, " << IN_FLIGHT << " in flight: ring "
+				  << (S32) (PACKETS / elapsed[0]) << " packets/s, map "
+				  << (S32) (PACKETS / elapsed[1]) << " packets/s" << std::endl;
+	}
+#endif // LL_BENCHMARKS
+}
@@ -0,0 +1,219 @@
+/**
+ * @file llpacketcapture_tut.cpp
+ * @brief Tests for packet captures and replaying them through LLPacketRing
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <vector>
+
+#include "llpacketcapture.h"
+#include "llpacketring.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "net.h"
+
+namespace tut
+{
+	struct packet_capture_data
+	{
+		packet_capture_data()
+		{
+			LLUUID random;
+			random.generate();
+			mFileName = std::string(LLFile::tmpdir()) + "packet-capture-test-" + random.asString() + ".pcap";
+		}
+
+		~packet_capture_data()
+		{
+			LLFile::remove(mFileName);
+		}
+
+		// Packet i is i + 1 bytes of i
+		static void makePacket(U32 i, U8* data, S32& size)
+		{
+			size = (S32)(i % NET_BUFFER_SIZE) + 1;
+			memset(data, (U8)i, size);
+		}
+
+		static LLHost makeHost(U32 i)
+		{
+			return LLHost(0x0100000a + ((i % 3) << 24), 12035 + (i % 3));
+		}
+
+		void writeCapture(U32 count)
+		{
+			LLPacketCaptureWriter writer;
+			ensure("create", writer.open(mFileName));
+			U8 data[NET_BUFFER_SIZE];
+			S32 size;
+			for (U32 i = 0; i < count; i++)
+			{
+				makePacket(i, data, size);
+				ensure("write", writer.write(1000000 + i * 100, makeHost(i), LLHost(0x0100007f, 13000), data, size));
+			}
+			ensure_equals("packets written", writer.getPacketCount(), count);
+		}
+
+		std::string mFileName;
+	};
+
+	typedef test_group<packet_capture_data> packet_capture_test_t;
+	typedef packet_capture_test_t::object packet_capture_object_t;
+	tut::packet_capture_test_t tut_packet_capture_test("packet_capture");
+
+	template<> template<>
+	void packet_capture_object_t::test<1>()
+	{
+		// Packets read back as written, twice over with a rewind
+		const U32 COUNT = 3000;
+		writeCapture(COUNT);
+
+		LLPacketCaptureReader reader;
+		ensure("open", reader.open(mFileName));
+		U8 expected[NET_BUFFER_SIZE];
+		U8 data[NET_BUFFER_SIZE];
+		for (U32 pass = 0; pass < 2; pass++)
+		{
+			for (U32 i = 0; i < COUNT; i++)
+			{
+				U64 time;
+				LLHost sender;
+				LLHost receiving_if;
+				S32 expected_size;
+				makePacket(i, expected, expected_size);
+				ensure_equals("size", reader.read(time, sender, receiving_if, data), expected_size);
+				ensure("data", !memcmp(data, expected, expected_size));
+				ensure_equals("time", time, (U64)(1000000 + i * 100));
+				ensure("sender", sender == makeHost(i));
+				ensure("receiving interface", receiving_if == LLHost(0x0100007f, 13000));
+			}
+			U64 time;
+			LLHost sender;
+			LLHost receiving_if;
+			ensure_equals("end of capture", reader.read(time, sender, receiving_if, data), 0);
+			ensure_equals("packets read", reader.getPacketCount(), COUNT);
+			reader.rewind();
+		}
+	}
+
+	template<> template<>
+	void packet_capture_object_t::test<2>()
+	{
+		// A capture cut off mid packet ends at the last whole one, and
+		// files that aren't captures are refused
+		writeCapture(10);
+		std::vector<char> contents(64 * 1024);
+		LLFILE* fp = LLFile::fopen(mFileName, "rb");
+		contents.resize(fread(&contents[0], 1, contents.size(), fp));
+		fclose(fp);
+		fp = LLFile::fopen(mFileName, "wb");
+		fwrite(&contents[0], 1, contents.size() - 5, fp);
+		fclose(fp);
+
+		LLPacketCaptureReader reader;
+		ensure("open", reader.open(mFileName));
+		U64 time;
+		LLHost sender;
+		LLHost receiving_if;
+		U8 data[NET_BUFFER_SIZE];
+		while (reader.read(time, sender, receiving_if, data))
+		{
+		}
+		ensure_equals("whole packets", reader.getPacketCount(), (U32) 9);
+		reader.close();
+
+		fp = LLFile::fopen(mFileName, "wb");
+		fputs("<?xml version=\"1.0\" ?>", fp);
+		fclose(fp);
+		ensure("not a capture", !reader.open(mFileName));
+		ensure("closed", !reader.isOpen());
+	}
+
+	template<> template<>
+	void packet_capture_object_t::test<3>()
+	{
+		// Packets received off the socket are captured, and replay through
+		// the ring in order without touching the socket
+		S32 socket = 0;
+		S32 port = NET_USE_OS_ASSIGNED_PORT;
+		ensure("socket open", start_net(socket, port) == 0);
+
+		const U32 COUNT = 200;
+		U32 loopback = ip_string_to_u32(LOOPBACK_ADDRESS_STRING);
+		U8 data[NET_BUFFER_SIZE];
+		S32 size;
+		{
+			LLPacketRing ring;
+			ensure("start capture", ring.startCapture(mFileName));
+			for (U32 i = 0; i < COUNT; i++)
+			{
+				makePacket(i, data, size);
+				send_packet(socket, (char*)data, size, loopback, port);
+			}
+			U32 received = 0;
+			LLTimer timer;
+			while (received < COUNT && timer.getElapsedTimeF32() < 5.f)
+			{
+				if (ring.receivePacket(socket, (char*)data))
+				{
+					received++;
+				}
+			}
+			ensure_equals("received", received, COUNT);
+			ring.stopCapture();
+			ensure("capture stopped", !ring.isCapturing());
+		}
+
+		LLPacketRing ring;
+		ensure("start replay", ring.startReplay(mFileName));
+		U8 expected[NET_BUFFER_SIZE];
+		for (U32 i = 0; i < COUNT; i++)
+		{
+			makePacket(i, expected, size);
+			ensure_equals("replayed size", ring.receivePacket(socket, (char*)data), size);
+			ensure("replayed data", !memcmp(data, expected, size));
+			ensure("replayed sender", ring.getLastSender() == LLHost(loopback, port));
+		}
+		ensure("not finished", !ring.isReplayFinished());
+		ensure_equals("end of replay", ring.receivePacket(socket, (char*)data), 0);
+		ensure("finished", ring.isReplayFinished());
+
+		// Sending goes nowhere while replaying
+		ensure("send", ring.sendPacket(socket, (char*)expected, 20, LLHost(loopback, port)));
+		ring.stopReplay();
+		ms_sleep(50);
+		ensure_equals("nothing sent", receive_packet(socket, (char*)data), 0);
+
+		end_net(socket);
+	}
+}
@@ -0,0 +1,177 @@
+/**
+ * @file llpacketreceivethread_tut.cpp
+ * @brief Tests for the packet receive thread and its ring
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llpacketbuffer.h"
+#include "llpacketreceivethread.h"
+#include "lltimer.h"
+#include "net.h"
+
+namespace tut
+{
+	struct packet_thread_data
+	{
+		packet_thread_data() : mSocket(0), mPort(NET_USE_OS_ASSIGNED_PORT)
+		{
+			mStarted = (start_net(mSocket, mPort) == 0);
+		}
+
+		~packet_thread_data()
+		{
+			if (mStarted)
+			{
+				end_net(mSocket);
+			}
+		}
+
+		// Sends packets first..first+count-1 to ourselves, each carrying
+		// its number
+		void sendPackets(U32 first, U32 count)
+		{
+			U32 loopback = ip_string_to_u32(LOOPBACK_ADDRESS_STRING);
+			char data[64];
+			memset(data, 0, sizeof(data));
+			for (U32 i = first; i < first + count; i++)
+			{
+				memcpy(data, &i, sizeof(i));
+				send_packet(mSocket, data, sizeof(data), loopback, mPort);
+			}
+		}
+
+		// Waits for the thread to have read count packets off the socket
+		bool waitForPackets(LLPacketReceiveThread& thread, U32 count)
+		{
+			LLTimer timer;
+			while (thread.getPacketCount() < count)
+			{
+				if (timer.getElapsedTimeF32() > 5.f)
+				{
+					return false;
+				}
+				ms_sleep(1);
+			}
+			return true;
+		}
+
+		static U32 getNumber(const LLPacketBuffer* packetp)
+		{
+			U32 number;
+			memcpy(&number, packetp->getData(), sizeof(number));
+			return number;
+		}
+
+		S32 mSocket;
+		S32 mPort;
+		bool mStarted;
+	};
+
+	typedef test_group<packet_thread_data> packet_thread_test_t;
+	typedef packet_thread_test_t::object packet_thread_object_t;
+	tut::packet_thread_test_t tut_packet_thread_test("packet_receive_thread");
+
+	template<> template<>
+	void packet_thread_object_t::test<1>()
+	{
+		// Packets come out in order, with their sender and arrival time,
+		// while the thread keeps reading
+		ensure("socket open", mStarted);
+
+		LLPacketReceiveThread thread(mSocket, 64);
+		ensure_equals("capacity", thread.getCapacity(), (U32) 64);
+		thread.start();
+
+		const U32 COUNT = 1000;
+		U32 next = 0;
+		U64 last_time = 0;
+		LLTimer timer;
+		for (U32 sent = 0; next < COUNT && timer.getElapsedTimeF32() < 10.f; )
+		{
+			if (sent < COUNT && sent - next < 32)
+			{
+				sendPackets(sent, 8);
+				sent += 8;
+			}
+			while (thread.getQueueDepth())
+			{
+				const LLPacketBuffer* packetp = thread.getPacket(0);
+				ensure_equals("in order", getNumber(packetp), next);
+				ensure_equals("size", packetp->getSize(), (S32) 64);
+				ensure_equals("sender", packetp->getHost().getPort(), (U32) mPort);
+				ensure("arrival time", packetp->getReceiveTime() >= last_time);
+				last_time = packetp->getReceiveTime();
+				thread.popPacket();
+				next++;
+			}
+		}
+
+		ensure_equals("all received", next, COUNT);
+		ensure_equals("none dropped", thread.getDroppedCount(), (U32) 0);
+		ensure("queue depth tracked", thread.getMaxQueueDepth() > 0 && thread.getMaxQueueDepth() <= 64);
+	}
+
+	template<> template<>
+	void packet_thread_object_t::test<2>()
+	{
+		// Packets that arrive while the ring is full are read and dropped,
+		// keeping the ones already queued
+		ensure("socket open", mStarted);
+
+		LLPacketReceiveThread thread(mSocket, 10);
+		ensure_equals("capacity rounded up", thread.getCapacity(), (U32) 16);
+		thread.start();
+
+		sendPackets(0, 40);
+		ensure("packets read", waitForPackets(thread, 40));
+		ensure_equals("queue full", thread.getQueueDepth(), (U32) 16);
+		ensure_equals("max depth", thread.getMaxQueueDepth(), (U32) 16);
+		ensure_equals("dropped", thread.getDroppedCount(), (U32) 24);
+
+		for (U32 i = 0; i < 16; i++)
+		{
+			ensure_equals("oldest kept", getNumber(thread.getPacket(0)), i);
+			thread.popPacket();
+		}
+
+		// Room again
+		sendPackets(100, 4);
+		ensure("more packets read", waitForPackets(thread, 44));
+		ensure_equals("queued after drain", thread.getQueueDepth(), (U32) 4);
+		ensure_equals("next packet", getNumber(thread.getPacket(0)), (U32) 100);
+		ensure_equals("no more dropped", thread.getDroppedCount(), (U32) 24);
+
+		thread.resetMaxQueueDepth();
+		ensure_equals("max depth reset", thread.getMaxQueueDepth(), (U32) 0);
+	}
+}
@@ -0,0 +1,210 @@
+/** 
+ * @file llqueuedthread_tut.cpp
+ * @brief Tests and contention benchmark for the LLQueuedThread request queue.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <vector>
+
+#include "llqueuedthread.h"
+#include "lltimer.h"
+
+namespace tut
+{
+	class test_queue : public LLQueuedThread
+	{
+	public:
+		class TestRequest : public QueuedRequest
+		{
+		public:
+			TestRequest(handle_t handle, U32 priority, test_queue* queue)
+				: QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+				  mQueue(queue)
+			{
+			}
+			/*virtual*/ bool processRequest()
+			{
+				mQueue->processed(getHashKey());
+				return true;
+			}
+		private:
+			test_queue* mQueue;
+		};
+
+		test_queue(bool threaded)
+			: LLQueuedThread("testqueue", threaded)
+		{
+			mProcessed = 0;
+		}
+
+		handle_t add(U32 priority)
+		{
+			handle_t handle = generateHandle();
+			addRequest(new TestRequest(handle, priority, this));
+			return handle;
+		}
+
+		void processed(handle_t handle)
+		{
+			if (!mThreaded)
+			{
+				mOrder.push_back(handle);
+			}
+			mProcessed++;
+		}
+
+		LLAtomicU32 mProcessed;
+		std::vector<handle_t> mOrder; // only recorded when not threaded
+	};
+
+	class producer_thread : public LLThread
+	{
+	public:
+		producer_thread(test_queue* queue, S32 count)
+			: LLThread("producer"),
+			  mQueue(queue),
+			  mCount(count)
+		{
+		}
+		/*virtual*/ void run()
+		{
+			for (S32 i = 0; i < mCount; ++i)
+			{
+				mQueue->add(LLQueuedThread::PRIORITY_NORMAL | (i & LLQueuedThread::PRIORITY_LOWBITS));
+			}
+		}
+	private:
+		test_queue* mQueue;
+		S32 mCount;
+	};
+
+	struct queuedthread_test
+	{
+		// Has producers threads add per_producer requests each to a
+		// threaded queue, returns how many were processed
+		S32 produce(S32 producers, S32 per_producer, F64& elapsed)
+		{
+			test_queue queue(true);
+			std::vector<producer_thread*> threads;
+			for (S32 i = 0; i < producers; ++i)
+			{
+				threads.push_back(new producer_thread(&queue, per_producer));
+			}
+			LLTimer timer;
+			for (S32 i = 0; i < producers; ++i)
+			{
+				threads[i]->start();
+			}
+			while ((S32)queue.mProcessed < per_producer * producers && timer.getElapsedTimeF64() < 60.0)
+			{
+				queue.update(0);
+				ms_sleep(1);
+			}
+			elapsed = timer.getElapsedTimeF64();
+			for (S32 i = 0; i < producers; ++i)
+			{
+				delete threads[i];
+			}
+			return (S32)queue.mProcessed;
+		}
+	};
+	typedef test_group<queuedthread_test> queuedthread_group_t;
+	typedef queuedthread_group_t::object queuedthread_object_t;
+	tut::queuedthread_group_t queuedthread_instance("queuedthread");
+
+	template<> template<>
+	void queuedthread_object_t::test<1>()
+	{
+		// Requests are processed highest priority first
+		test_queue queue(false);
+		LLQueuedThread::handle_t low = queue.add(LLQueuedThread::PRIORITY_LOW);
+		LLQueuedThread::handle_t high = queue.add(LLQueuedThread::PRIORITY_HIGH);
+		LLQueuedThread::handle_t normal = queue.add(LLQueuedThread::PRIORITY_NORMAL);
+		ensure_equals("pending", queue.getPending(), 3);
+		queue.update(0);
+		ensure_equals("pending after update", queue.getPending(), 0);
+		ensure_equals("processed", queue.mOrder.size(), (size_t)3);
+		ensure("high first", queue.mOrder[0] == high);
+		ensure("normal second", queue.mOrder[1] == normal);
+		ensure("low last", queue.mOrder[2] == low);
+	}
+
+	template<> template<>
+	void queuedthread_object_t::test<2>()
+	{
+		// Bulk reprioritization reorders queued requests
+		test_queue queue(false);
+		LLQueuedThread::handle_t first = queue.add(LLQueuedThread::PRIORITY_HIGH);
+		LLQueuedThread::handle_t second = queue.add(LLQueuedThread::PRIORITY_NORMAL);
+		LLQueuedThread::handle_t third = queue.add(LLQueuedThread::PRIORITY_LOW);
+		LLQueuedThread::priority_list_t priorities;
+		priorities.push_back(std::make_pair(third, (U32)LLQueuedThread::PRIORITY_URGENT));
+		priorities.push_back(std::make_pair(first, (U32)LLQueuedThread::PRIORITY_LOW));
+		queue.setPriorities(priorities);
+		queue.update(0);
+		ensure_equals("processed", queue.mOrder.size(), (size_t)3);
+		ensure("raised first", queue.mOrder[0] == third);
+		ensure("unchanged second", queue.mOrder[1] == second);
+		ensure("lowered last", queue.mOrder[2] == first);
+	}
+
+	template<> template<>
+	void queuedthread_object_t::test<3>()
+	{
+		// Requests added from several threads at once all get processed
+		F64 elapsed;
+		ensure_equals("all requests processed", produce(4, 4096, elapsed), 4 * 4096);
+	}
+
+#if LL_BENCHMARKS
+	struct queuedthread_benchmark : public queuedthread_test { };
+	typedef test_group<queuedthread_benchmark> queuedthread_benchmark_t;
+	typedef queuedthread_benchmark_t::object queuedthread_benchmark_object_t;
+	tut::queuedthread_benchmark_t queuedthread_benchmark_instance("queuedthread benchmark");
+
+	// Throughput with 1 to 16 threads adding requests concurrently
+	template<> template<>
+	void queuedthread_benchmark_object_t::test<1>()
+	{
+		const S32 TOTAL_REQUESTS = 64 * 1024;
+		for (S32 producers = 1; producers <= 16; producers *= 2)
+		{
+			S32 per_producer = TOTAL_REQUESTS / producers;
+			F64 elapsed;
+			ensure_equals("all requests processed", produce(producers, per_producer, elapsed), per_producer * producers);
+			std::cout << "LLQueuedThread: " << producers << " producer(s): "
+					  << (S32)(per_producer * producers / elapsed) << " requests/s" << std::endl;
+		}
+	}
+#endif // LL_BENCHMARKS
+}
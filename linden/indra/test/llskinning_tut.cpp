@@ -0,0 +1,281 @@
+/** 
+ * @file llskinning_tut.cpp
+ * @brief Tests and benchmark for vertex skinning and LLSkinQueue.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <vector>
+
+#include "llrand.h"
+#include "llskinning.h"
+#include "llthreadpool.h"
+#include "lltimer.h"
+#include "m3math.h"
+#include "m4math.h"
+#include "v3math.h"
+
+namespace tut
+{
+	// Stand-in for an avatar: a skeleton of joint matrices and a few meshes
+	// skinned against it, the way LLViewerJointMesh::updateGeometryOriginal()
+	// skins each LLPolyMesh
+	struct skin_avatar
+	{
+		enum { JOINTS = 20 };
+
+		struct mesh
+		{
+			std::vector<F32> mWeights;
+			std::vector<LLVector3> mCoords;
+			std::vector<LLVector3> mNormals;
+			std::vector<LLVector3> mOutVertices;
+			std::vector<LLVector3> mOutNormals;
+		};
+
+		skin_avatar(U32 meshes, U32 vertices)
+			: mSkinCount(0)
+		{
+			for (U32 j = 0; j < JOINTS; ++j)
+			{
+				LLMatrix3 rot(ll_frand(F_TWO_PI), LLVector3(ll_frand(), ll_frand(), 1.f));
+				mJointRot[j] = rot;
+				mJointMat[j] = LLMatrix4(rot);
+				mJointMat[j].setTranslation(ll_frand(2.f), ll_frand(2.f), ll_frand(2.f));
+			}
+			mMeshes.resize(meshes);
+			for (U32 m = 0; m < meshes; ++m)
+			{
+				mesh& me = mMeshes[m];
+				F32 weight = 0.f;
+				for (U32 i = 0; i < vertices; ++i)
+				{
+					// runs of equal weights, like real meshes
+					if (i % 4 == 0)
+					{
+						weight = (F32)ll_rand(JOINTS - 1) + ll_frand();
+					}
+					me.mWeights.push_back(weight);
+					me.mCoords.push_back(LLVector3(ll_frand(), ll_frand(), ll_frand()));
+					me.mNormals.push_back(LLVector3(ll_frand(), ll_frand(), ll_frand()));
+				}
+				me.mOutVertices.resize(vertices);
+				me.mOutNormals.resize(vertices);
+			}
+		}
+
+		// ANY THREAD, like LLVOAvatar::skinMeshes()
+		void skin()
+		{
+			for (U32 m = 0; m < mMeshes.size(); ++m)
+			{
+				mesh& me = mMeshes[m];
+				LLStrider<LLVector3> vertices;
+				LLStrider<LLVector3> normals;
+				vertices = &me.mOutVertices[0];
+				normals = &me.mOutNormals[0];
+				ll_skin_vertices(mJointMat, mJointRot, &me.mWeights[0], &me.mCoords[0], &me.mNormals[0],
+								 me.mWeights.size(), vertices, normals);
+			}
+			mSkinCount++;
+		}
+
+		LLMatrix4 mJointMat[JOINTS];
+		LLMatrix3 mJointRot[JOINTS];
+		std::vector<mesh> mMeshes;
+		LLAtomicU32 mSkinCount;
+	};
+
+	class avatar_queue : public LLSkinQueue
+	{
+	public:
+		avatar_queue(std::vector<skin_avatar*>& avatars)
+			: LLSkinQueue("skin test"),
+			  mAvatars(avatars)
+		{
+		}
+
+		void skin() { skinAll(mAvatars.size()); }
+
+	protected:
+		/*virtual*/ void skinOne(U32 index)
+		{
+			mAvatars[index]->skin();
+		}
+
+	private:
+		std::vector<skin_avatar*>& mAvatars;
+	};
+
+	struct skinning_data
+	{
+		~skinning_data()
+		{
+			for (U32 i = 0; i < mAvatars.size(); ++i)
+			{
+				delete mAvatars[i];
+			}
+		}
+
+		void makeAvatars(U32 count, U32 meshes, U32 vertices)
+		{
+			for (U32 i = 0; i < count; ++i)
+			{
+				mAvatars.push_back(new skin_avatar(meshes, vertices));
+			}
+		}
+
+		std::vector<skin_avatar*> mAvatars;
+	};
+	typedef test_group<skinning_data> skinning_t;
+	typedef skinning_t::object skinning_object_t;
+	tut::skinning_t tut_skinning("skinning");
+
+	template<> template<>
+	void skinning_object_t::test<1>()
+	{
+		// Blending between two translations, through an interleaved buffer
+		LLMatrix4 joint_mat[3];
+		LLMatrix3 joint_rot[3];
+		joint_mat[1].setTranslation(1.f, 0.f, 0.f);
+		joint_mat[2].setTranslation(3.f, 0.f, 0.f);
+
+		const F32 weights[] = { 1.5f, 1.5f, 1.f, 1.25f };
+		const LLVector3 coords[] = { LLVector3(0.f, 0.f, 0.f), LLVector3(1.f, 1.f, 1.f),
+									 LLVector3(0.f, 2.f, 0.f), LLVector3(0.f, 0.f, 0.f) };
+		const LLVector3 normals[] = { LLVector3::x_axis, LLVector3::y_axis,
+									  LLVector3::z_axis, LLVector3::x_axis };
+		LLVector3 out[8];
+		LLStrider<LLVector3> vertices;
+		LLStrider<LLVector3> out_normals;
+		vertices = &out[0];
+		vertices.setStride(2 * sizeof(LLVector3));
+		out_normals = &out[1];
+		out_normals.setStride(2 * sizeof(LLVector3));
+		ll_skin_vertices(joint_mat, joint_rot, weights, coords, normals, 4, vertices, out_normals);
+
+		ensure_equals("halfway", out[0], LLVector3(2.f, 0.f, 0.f));
+		ensure_equals("same weight again", out[2], LLVector3(3.f, 1.f, 1.f));
+		ensure_equals("on a joint", out[4], LLVector3(1.f, 2.f, 0.f));
+		ensure_equals("quarter way", out[6], LLVector3(1.5f, 0.f, 0.f));
+		ensure_equals("normal", out[1], LLVector3::x_axis);
+		ensure_equals("normal after repeat", out[3], LLVector3::y_axis);
+		ensure_equals("normal on a joint", out[5], LLVector3::z_axis);
+	}
+
+	template<> template<>
+	void skinning_object_t::test<2>()
+	{
+		// Skinning on a pool gives exactly what skinning serially does, and
+		// skins every avatar once
+		makeAvatars(37, 3, 200);
+
+		avatar_queue serial(mAvatars);
+		serial.skin();
+		std::vector<std::vector<LLVector3> > expected;
+		for (U32 i = 0; i < mAvatars.size(); ++i)
+		{
+			ensure_equals("skinned once serially", (U32)mAvatars[i]->mSkinCount, 1U);
+			for (U32 m = 0; m < mAvatars[i]->mMeshes.size(); ++m)
+			{
+				expected.push_back(mAvatars[i]->mMeshes[m].mOutVertices);
+				expected.push_back(mAvatars[i]->mMeshes[m].mOutNormals);
+				mAvatars[i]->mMeshes[m].mOutVertices.assign(200, LLVector3::zero);
+				mAvatars[i]->mMeshes[m].mOutNormals.assign(200, LLVector3::zero);
+			}
+		}
+		serial.shutdown();
+
+		LLThreadPool pool("skin test", 3);
+		avatar_queue pooled(mAvatars);
+		pool.addQueue(&pooled, LLThreadPool::AFFINITY_ANY, 0);
+		pooled.skin();
+		U32 n = 0;
+		for (U32 i = 0; i < mAvatars.size(); ++i)
+		{
+			ensure_equals("skinned once on the pool", (U32)mAvatars[i]->mSkinCount, 2U);
+			for (U32 m = 0; m < mAvatars[i]->mMeshes.size(); ++m)
+			{
+				ensure("vertices match", expected[n++] == mAvatars[i]->mMeshes[m].mOutVertices);
+				ensure("normals match", expected[n++] == mAvatars[i]->mMeshes[m].mOutNormals);
+			}
+		}
+
+		// Nothing to skin returns straight away
+		pooled.skinAll(0);
+		pooled.shutdown();
+	}
+
+#if LL_BENCHMARKS
+	struct skinning_benchmark : public skinning_data { };
+	typedef test_group<skinning_benchmark> skinning_benchmark_t;
+	typedef skinning_benchmark_t::object skinning_benchmark_object_t;
+	tut::skinning_benchmark_t tut_skinning_benchmark("skinning benchmark");
+
+	// A frame's worth of avatars skinned on the calling thread versus on a
+	// default sized pool, six meshes of about an avatar's vertex count each
+	template<> template<>
+	void skinning_benchmark_object_t::test<1>()
+	{
+		const U32 FRAMES = 20;
+		const U32 MAX_AVATARS = 96;
+		makeAvatars(MAX_AVATARS, 6, 1200);
+
+		LLThreadPool pool("skin bench");
+		const U32 counts[] = { 1, 8, 32, MAX_AVATARS };
+		for (U32 c = 0; c < LL_ARRAY_SIZE(counts); ++c)
+		{
+			std::vector<skin_avatar*> avatars(mAvatars.begin(), mAvatars.begin() + counts[c]);
+			F64 rate[2];
+			for (S32 pass = 0; pass < 2; ++pass)
+			{
+				avatar_queue queue(avatars);
+				if (pass == 1)
+				{
+					pool.addQueue(&queue, LLThreadPool::AFFINITY_ANY, 0);
+				}
+				LLTimer timer;
+				for (U32 frame = 0; frame < FRAMES; ++frame)
+				{
+					queue.skin();
+				}
+				rate[pass] = FRAMES * counts[c] / timer.getElapsedTimeF64();
+				queue.shutdown();
+			}
+			std::cout << "LLSkinQueue: " << counts[c] << " avatars, serial "
+					  << (S32)rate[0] << " avatars/s, pool of " << pool.getSize() << " "
+					  << (S32)rate[1] << " avatars/s" << std::endl;
+		}
+	}
+#endif // LL_BENCHMARKS
+}
@@ -0,0 +1,295 @@
+/** 
+ * @file llthreadpool_tut.cpp
+ * @brief Tests and benchmark for the shared LLThreadPool.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <vector>
+
+#include "llqueuedthread.h"
+#include "llthreadpool.h"
+#include "lltimer.h"
+
+namespace tut
+{
+	class pool_queue : public LLQueuedThread
+	{
+	public:
+		class TestRequest : public QueuedRequest
+		{
+		public:
+			TestRequest(handle_t handle, U32 priority, pool_queue* queue, U32 work)
+				: QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+				  mQueue(queue),
+				  mWork(work)
+			{
+			}
+			/*virtual*/ bool processRequest()
+			{
+				mQueue->process(mWork);
+				return true;
+			}
+		private:
+			pool_queue* mQueue;
+			U32 mWork;
+		};
+
+		// Not threaded: either attached to a pool, or given its own thread
+		// with threaded = true for comparison
+		pool_queue(const std::string& name, bool threaded = false)
+			: LLQueuedThread(name, threaded),
+			  mSleepMS(0),
+			  mBlock(false)
+		{
+			mProcessed = 0;
+			mActive = 0;
+			mMaxActive = 0;
+			mBlocked = 0;
+		}
+
+		handle_t add(U32 priority, U32 work = 0)
+		{
+			handle_t handle = generateHandle();
+			addRequest(new TestRequest(handle, priority, this, work));
+			return handle;
+		}
+
+		void process(U32 work)
+		{
+			U32 active = mActive++ + 1;
+			{
+				LLMutexLock lock(&mMutex);
+				mOrder.push_back(sSequence++);
+				mMaxActive = llmax((U32)mMaxActive, active);
+			}
+			while (mBlock)
+			{
+				mBlocked = 1;
+				ms_sleep(1);
+			}
+			if (mSleepMS)
+			{
+				ms_sleep(mSleepMS);
+			}
+			// busy work for the benchmark
+			U32 sum = 0;
+			for (U32 i = 0; i < work; ++i)
+			{
+				sum = sum * 31 + i;
+			}
+			mSum += sum;
+			mActive--;
+			mProcessed++;
+		}
+
+		bool waitProcessed(U32 count)
+		{
+			LLTimer timer;
+			while ((U32)mProcessed < count && timer.getElapsedTimeF64() < 30.0)
+			{
+				update(0);
+				ms_sleep(1);
+			}
+			return (U32)mProcessed == count;
+		}
+
+		LLAtomicU32 mProcessed;
+		LLAtomicU32 mActive;
+		LLAtomicU32 mMaxActive;
+		LLAtomicU32 mBlocked;
+		LLAtomicU32 mSum;
+		U32 mSleepMS;
+		volatile bool mBlock; // hold the thread processing the next request
+		LLMutex mMutex;
+		std::vector<U32> mOrder; // position of each request among all queues
+
+		static LLAtomicU32 sSequence;
+	};
+	LLAtomicU32 pool_queue::sSequence(0);
+
+	struct threadpool_test
+	{
+	};
+	typedef test_group<threadpool_test> threadpool_group_t;
+	typedef threadpool_group_t::object threadpool_object_t;
+	tut::threadpool_group_t threadpool_instance("threadpool");
+
+	template<> template<>
+	void threadpool_object_t::test<1>()
+	{
+		// Every request completes, and max_workers = 1 queues are never
+		// processed by two threads at once
+		LLThreadPool pool("test", 4);
+		pool_queue serial("serial");
+		pool_queue parallel("parallel");
+		pool.addQueue(&serial, LLThreadPool::AFFINITY_ANY, 1);
+		pool.addQueue(&parallel, LLThreadPool::AFFINITY_ANY, 0);
+		ensure("attached queue is threaded", serial.getThreaded());
+		ensure("attached queue knows its pool", serial.getThreadPool() == &pool);
+		serial.mSleepMS = 1;
+		parallel.mSleepMS = 1;
+		const U32 COUNT = 100;
+		for (U32 i = 0; i < COUNT; ++i)
+		{
+			serial.add(LLQueuedThread::PRIORITY_NORMAL);
+			parallel.add(LLQueuedThread::PRIORITY_NORMAL);
+		}
+		ensure("serial queue processed", serial.waitProcessed(COUNT));
+		ensure("parallel queue processed", parallel.waitProcessed(COUNT));
+		ensure_equals("serial queue concurrency", (U32)serial.mMaxActive, (U32)1);
+		ensure("processed count", pool.getProcessedCount() >= COUNT * 2);
+		serial.shutdown();
+		parallel.shutdown();
+		ensure("detached", serial.getThreadPool() == NULL);
+	}
+
+	template<> template<>
+	void threadpool_object_t::test<2>()
+	{
+		// Across queues, the request with the highest priority runs first
+		LLThreadPool pool("test", 1);
+		pool_queue blocker("blocker");
+		pool_queue low("low");
+		pool_queue high("high");
+		pool.addQueue(&blocker);
+		pool.addQueue(&low);
+		pool.addQueue(&high);
+
+		// Keep the only worker busy while the other requests are queued
+		blocker.mBlock = true;
+		blocker.add(LLQueuedThread::PRIORITY_NORMAL);
+		LLTimer timer;
+		while (!blocker.mBlocked && timer.getElapsedTimeF64() < 10.0)
+		{
+			ms_sleep(1);
+		}
+		ensure("blocker running", (U32)blocker.mBlocked == 1);
+		low.add(LLQueuedThread::PRIORITY_LOW);
+		high.add(LLQueuedThread::PRIORITY_HIGH);
+		low.add(LLQueuedThread::PRIORITY_LOW);
+		blocker.mBlock = false;
+
+		ensure("blocker processed", blocker.waitProcessed(1));
+		ensure("low processed", low.waitProcessed(2));
+		ensure("high processed", high.waitProcessed(1));
+		ensure("high before low", high.mOrder[0] < low.mOrder[0]);
+		ensure("blocker before high", blocker.mOrder[0] < high.mOrder[0]);
+		blocker.shutdown();
+		low.shutdown();
+		high.shutdown();
+	}
+
+	template<> template<>
+	void threadpool_object_t::test<3>()
+	{
+		// A queue with affinity to worker 0 still gets help from idle workers
+		LLThreadPool pool("test", 2);
+		pool_queue queue("affine");
+		pool.addQueue(&queue, 1, 0);
+		queue.mSleepMS = 5;
+		const U32 COUNT = 40;
+		for (U32 i = 0; i < COUNT; ++i)
+		{
+			queue.add(LLQueuedThread::PRIORITY_NORMAL);
+		}
+		ensure("processed", queue.waitProcessed(COUNT));
+		ensure("stolen by the other worker", pool.getStolenCount() > 0);
+		queue.shutdown();
+	}
+
+	template<> template<>
+	void threadpool_object_t::test<4>()
+	{
+		// Paused queues are skipped until the next update()
+		LLThreadPool pool("test", 2);
+		pool_queue queue("paused");
+		pool.addQueue(&queue);
+		queue.pause();
+		queue.add(LLQueuedThread::PRIORITY_NORMAL);
+		ms_sleep(20);
+		ensure_equals("not processed while paused", (U32)queue.mProcessed, (U32)0);
+		ensure("processed after update", queue.waitProcessed(1));
+		queue.shutdown();
+	}
+
+#if LL_BENCHMARKS
+	struct threadpool_benchmark : public threadpool_test { };
+	typedef test_group<threadpool_benchmark> threadpool_benchmark_t;
+	typedef threadpool_benchmark_t::object threadpool_benchmark_object_t;
+	tut::threadpool_benchmark_t threadpool_benchmark_instance("threadpool benchmark");
+
+	// Five queues of CPU bound requests, each on its own thread versus
+	// sharing a default sized pool
+	template<> template<>
+	void threadpool_benchmark_object_t::test<1>()
+	{
+		const S32 QUEUES = 5;
+		const U32 COUNT = 4000;
+		const U32 WORK = 20000;
+		for (S32 pass = 0; pass < 2; ++pass)
+		{
+			bool pooled = pass == 1;
+			LLThreadPool* pool = pooled ? new LLThreadPool("bench") : NULL;
+			std::vector<pool_queue*> queues;
+			for (S32 i = 0; i < QUEUES; ++i)
+			{
+				pool_queue* queue = new pool_queue(llformat("bench %d", i), !pooled);
+				if (pool)
+				{
+					pool->addQueue(queue, LLThreadPool::AFFINITY_ANY, i == 0 ? 0 : 1);
+				}
+				queues.push_back(queue);
+			}
+			LLTimer timer;
+			for (U32 n = 0; n < COUNT; ++n)
+			{
+				queues[n % QUEUES]->add(LLQueuedThread::PRIORITY_NORMAL, WORK);
+			}
+			for (S32 i = 0; i < QUEUES; ++i)
+			{
+				ensure("benchmark processed", queues[i]->waitProcessed(COUNT / QUEUES));
+			}
+			F64 elapsed = timer.getElapsedTimeF64();
+			for (S32 i = 0; i < QUEUES; ++i)
+			{
+				queues[i]->shutdown();
+				delete queues[i];
+			}
+			std::cout << "LLThreadPool: " << QUEUES << " queues, "
+					  << (pooled ? llformat("pool of %d", pool->getSize()) : std::string("own threads")) << ": "
+					  << (S32)(COUNT / elapsed) << " requests/s" << std::endl;
+			delete pool;
+		}
+	}
+#endif // LL_BENCHMARKS
+}
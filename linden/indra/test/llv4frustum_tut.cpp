@@ -0,0 +1,286 @@
+/**
+ * @file llv4frustum_tut.cpp
+ * @brief Tests for the batched AABB frustum tests and a culling benchmark.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <vector>
+
+#include "llcamera.h"
+#include "lltimer.h"
+#include "llv4frustum.h"
+#include "v3math.h"
+
+namespace tut
+{
+	// Copy of AABBSphereIntersectR2() from llspatialpartition.cpp, which
+	// lives in the viewer
+	S32 sphere_intersect_ref(const LLVector3& min, const LLVector3& max, const LLVector3 &origin, F32 r)
+	{
+		F32 d = 0.f;
+		F32 t;
+
+		if ((min-origin).magVecSquared() < r &&
+			(max-origin).magVecSquared() < r)
+		{
+			return 2;
+		}
+
+		for (U32 i = 0; i < 3; i++)
+		{
+			if (origin.mV[i] < min.mV[i])
+			{
+				t = min.mV[i] - origin.mV[i];
+				d += t*t;
+			}
+			else if (origin.mV[i] > max.mV[i])
+			{
+				t = origin.mV[i] - max.mV[i];
+				d += t*t;
+			}
+
+			if (d > r)
+			{
+				return 0;
+			}
+		}
+
+		return 1;
+	}
+
+	struct frustum_data
+	{
+		frustum_data() : mSeed(1) { }
+
+		F32 frand(F32 range)
+		{
+			// Fixed LCG so every run tests the same boxes
+			mSeed = mSeed * 1103515245 + 12345;
+			return range * ((mSeed >> 8) & 0xffff) / 65536.f;
+		}
+
+		// Points the camera along its x axis from origin and derives the
+		// agent space corners the way LLViewerCamera::calcProjection() does:
+		// near plane bottom left, bottom right, top right, top left, then
+		// the same on the far plane
+		void setupCamera(LLCamera& camera, const LLVector3& origin, F32 yaw)
+		{
+			camera.setOrigin(origin);
+			camera.setAxes(LLVector3(cosf(yaw), sinf(yaw), 0.f),
+						   LLVector3(-sinf(yaw), cosf(yaw), 0.f),
+						   LLVector3(0.f, 0.f, 1.f));
+
+			F32 tan_v = tanf(camera.getView() * 0.5f);
+			F32 tan_h = tan_v * camera.getAspect();
+			static const F32 sx[] = { -1.f, 1.f, 1.f, -1.f };
+			static const F32 sy[] = { -1.f, -1.f, 1.f, 1.f };
+
+			LLVector3 frust[8];
+			for (U32 i = 0; i < 8; i++)
+			{
+				F32 dist = i < 4 ? camera.getNear() : camera.getFar();
+				frust[i] = origin + dist * (camera.getAtAxis()
+											- sx[i % 4] * tan_h * camera.getLeftAxis()
+											+ sy[i % 4] * tan_v * camera.getUpAxis());
+			}
+			camera.calcAgentFrustumPlanes(frust);
+		}
+
+		// Mostly prim sized boxes, some region sized ones and a few larger
+		// than the frustum
+		void makeBoxes(const LLVector3& origin, U32 count)
+		{
+			mBoxes.resize(count * 2);
+			mExtents.resize(count * 2);
+			for (U32 i = 0; i < count; i++)
+			{
+				F32 size = (i % 97 == 0) ? 200.f + frand(400.f) : ((i % 13 == 0) ? 8.f + frand(64.f) : 0.2f + frand(4.f));
+				LLVector3 center = origin + LLVector3(frand(512.f) - 256.f, frand(512.f) - 256.f, frand(128.f) - 64.f);
+				LLVector3 radius(frand(size), frand(size), frand(size));
+				mBoxes[i * 2] = center;
+				mBoxes[i * 2 + 1] = radius;
+				mExtents[i * 2] = center - radius;
+				mExtents[i * 2 + 1] = center + radius;
+			}
+
+			mBounds.resize(count);
+			mExtentPtrs.resize(count);
+			for (U32 i = 0; i < count; i++)
+			{
+				mBounds[i] = &mBoxes[i * 2];
+				mExtentPtrs[i] = &mExtents[i * 2];
+			}
+		}
+
+		U32 mSeed;
+		std::vector<LLVector3> mBoxes;
+		std::vector<LLVector3> mExtents;
+		std::vector<const LLVector3*> mBounds;
+		std::vector<const LLVector3*> mExtentPtrs;
+	};
+
+	typedef test_group<frustum_data> frustum_test_t;
+	typedef frustum_test_t::object frustum_object_t;
+	tut::frustum_test_t tut_frustum_test("v4frustum");
+
+	template<> template<>
+	void frustum_object_t::test<1>()
+	{
+		// Batched results match LLCamera box for box, for every batch tail
+		const U32 COUNT = 4099;
+		U32 seen[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+
+		for (U32 c = 0; c < 8; c++)
+		{
+			LLCamera camera(1.0f + frand(1.f), 1.25f + frand(0.5f), 768, 0.5f, 64.f + frand(448.f));
+			LLVector3 origin(frand(256.f), frand(256.f), 20.f + frand(40.f));
+			setupCamera(camera, origin, frand(F_TWO_PI));
+			makeBoxes(origin, COUNT);
+
+			for (U32 far_clip = 0; far_clip < 2; far_clip++)
+			{
+				LLV4Frustum frustum;
+				frustum.setCamera(camera, far_clip);
+
+				std::vector<S32> simd(COUNT), scalar(COUNT);
+				frustum.AABBInFrustum(&mBounds[0], COUNT, &simd[0]);
+				frustum.AABBInFrustumScalar(&mBounds[0], COUNT, &scalar[0]);
+
+				for (U32 i = 0; i < COUNT; i++)
+				{
+					S32 expected = far_clip ? camera.AABBInFrustum(mBoxes[i * 2], mBoxes[i * 2 + 1])
+											: camera.AABBInFrustumNoFarClip(mBoxes[i * 2], mBoxes[i * 2 + 1]);
+					ensure_equals("scalar matches camera", scalar[i], expected);
+					ensure_equals("batched matches camera", simd[i], expected);
+					seen[far_clip][expected]++;
+				}
+
+				// short lists take the padded tail path only
+				for (U32 n = 1; n < 8; n++)
+				{
+					frustum.AABBInFrustum(&mBounds[0], n, &simd[0]);
+					for (U32 i = 0; i < n; i++)
+					{
+						ensure_equals("short batch", simd[i], scalar[i]);
+					}
+				}
+			}
+
+			LLV4Frustum frustum;
+			frustum.setCamera(camera, TRUE);
+			std::vector<S32> simd(COUNT), scalar(COUNT);
+			frustum.AABBSphereIntersect(&mExtentPtrs[0], COUNT, &simd[0]);
+			frustum.AABBSphereIntersectScalar(&mExtentPtrs[0], COUNT, &scalar[0]);
+			F32 r2 = camera.mFrustumCornerDist * camera.mFrustumCornerDist;
+			for (U32 i = 0; i < COUNT; i++)
+			{
+				S32 expected = sphere_intersect_ref(mExtents[i * 2], mExtents[i * 2 + 1], origin, r2);
+				ensure_equals("scalar sphere", scalar[i], expected);
+				ensure_equals("batched sphere", simd[i], expected);
+			}
+		}
+
+		for (U32 far_clip = 0; far_clip < 2; far_clip++)
+		{
+			ensure("some boxes outside", seen[far_clip][0] > 0);
+			ensure("some boxes partly in", seen[far_clip][1] > 0);
+			ensure("some boxes fully in", seen[far_clip][2] > 0);
+		}
+	}
+
+#if LL_BENCHMARKS
+	struct frustum_benchmark : public frustum_data { };
+	typedef test_group<frustum_benchmark> frustum_benchmark_t;
+	typedef frustum_benchmark_t::object frustum_benchmark_object_t;
+	tut::frustum_benchmark_t tut_frustum_benchmark("v4frustum benchmark");
+
+	template<> template<>
+	void frustum_benchmark_object_t::test<1>()
+	{
+		// Cull benchmark: one LLCamera call per box against the scalar and
+		// batched kernels over the same boxes
+		const U32 COUNT = 16384;
+		const U32 PASSES = 200;
+
+		LLCamera camera(1.2f, 1.5f, 768, 0.5f, 256.f);
+		LLVector3 origin(128.f, 128.f, 30.f);
+		setupCamera(camera, origin, 0.7f);
+		makeBoxes(origin, COUNT);
+
+		LLV4Frustum frustum;
+		frustum.setCamera(camera, FALSE);
+		std::vector<S32> results(COUNT);
+
+		F64 elapsed[3];
+		U32 visible[3] = { 0, 0, 0 };
+		for (U32 method = 0; method < 3; method++)
+		{
+			LLTimer timer;
+			for (U32 pass = 0; pass < PASSES; pass++)
+			{
+				if (method == 0)
+				{
+					for (U32 i = 0; i < COUNT; i++)
+					{
+						results[i] = camera.AABBInFrustumNoFarClip(mBoxes[i * 2], mBoxes[i * 2 + 1]);
+					}
+				}
+				else if (method == 1)
+				{
+					frustum.AABBInFrustumScalar(&mBounds[0], COUNT, &results[0]);
+				}
+				else
+				{
+					frustum.AABBInFrustum(&mBounds[0], COUNT, &results[0]);
+				}
+			}
+			elapsed[method] = timer.getElapsedTimeF64();
+
+			for (U32 i = 0; i < COUNT; i++)
+			{
+				visible[method] += results[i] ? 1 : 0;
+			}
+		}
+
+		ensure_equals("scalar visible set", visible[1], visible[0]);
+		ensure_equals("batched visible set", visible[2], visible[0]);
+
+		F64 boxes = (F64) COUNT * PASSES;
+		std::cout << "AABB frustum test, " << COUNT << " boxes, " << PASSES << " passes (LL_VECTORIZE "
+				  << LL_VECTORIZE << "): LLCamera " << (S32) (boxes / elapsed[0] / 1000.0)
+				  << "k boxes/s, scalar " << (S32) (boxes / elapsed[1] / 1000.0)
+				  << "k boxes/s, batched " << (S32) (boxes / elapsed[2] / 1000.0)
+				  << "k boxes/s" << std::endl;
+	}
+#endif // LL_BENCHMARKS
+}
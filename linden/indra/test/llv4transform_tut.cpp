@@ -0,0 +1,197 @@
+/**
+ * @file llv4transform_tut.cpp
+ * @brief Tests for the batched vertex transforms and a rebuild benchmark.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <vector>
+
+#include "lltimer.h"
+#include "llv4math.h"
+#include "llv4transform.h"
+#include "llvolume.h"
+#include "llquaternion.h"
+#include "m3math.h"
+#include "m4math.h"
+
+namespace tut
+{
+	// One vertex of an interleaved vertex buffer, like LLVertexBuffer's
+	// position, normal, binormal and texcoord layout
+	struct buffer_vertex
+	{
+		LLVector3 mPosition;
+		LLVector3 mNormal;
+		LLVector3 mBinormal;
+		LLVector2 mTexCoord;
+	};
+
+	struct transform_data
+	{
+		transform_data()
+		{
+			LLQuaternion rot(0.7f, LLVector3(0.3f, 0.8f, 0.5f));
+			mMatrix.initAll(LLVector3(1.5f, 0.25f, 3.f), rot, LLVector3(128.f, 64.f, 22.f));
+			mNormalMatrix = rot.getMatrix3();
+		}
+
+		LLVolume* makeVolume(F32 detail)
+		{
+			LLVolumeParams params;
+			params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+			params.setBeginAndEndS(0.f, 1.f);
+			params.setBeginAndEndT(0.f, 1.f);
+			params.setRatio(1.f, 0.5f);
+			return new LLVolume(params, detail);
+		}
+
+		void rebuild(const LLVolumeFace& face, std::vector<buffer_vertex>& buffer, bool batched)
+		{
+			U32 count = face.getNumVertices();
+			buffer.resize(count);
+			LLStrider<LLVector3> positions, normals, binormals;
+			positions = &buffer[0].mPosition;
+			normals = &buffer[0].mNormal;
+			binormals = &buffer[0].mBinormal;
+			positions.setStride(sizeof(buffer_vertex));
+			normals.setStride(sizeof(buffer_vertex));
+			binormals.setStride(sizeof(buffer_vertex));
+
+			if (batched)
+			{
+				llv4transform_positions(mMatrix, &face.mPositions[0], count, positions);
+				llv4transform_normals(mNormalMatrix, &face.mNormals[0], count, normals);
+				llv4transform_normals(mNormalMatrix, &face.mBinormals[0], count, binormals);
+			}
+			else
+			{
+				llv4transform_positions_scalar(mMatrix, &face.mPositions[0], count, positions);
+				llv4transform_normals_scalar(mNormalMatrix, &face.mNormals[0], count, normals);
+				llv4transform_normals_scalar(mNormalMatrix, &face.mBinormals[0], count, binormals);
+			}
+		}
+
+		LLMatrix4 mMatrix;
+		LLMatrix3 mNormalMatrix;
+	};
+
+	typedef test_group<transform_data> transform_test_t;
+	typedef transform_test_t::object transform_object_t;
+	tut::transform_test_t tut_transform_test("v4transform");
+
+	template<> template<>
+	void transform_object_t::test<1>()
+	{
+		// Face streams are aligned and batched transforms match the scalar
+		// operators exactly, including the odd vertices at the end
+		LLPointer<LLVolume> volume = makeVolume(4.f);
+		ensure("volume has faces", volume->getNumVolumeFaces() > 0);
+
+		for (S32 f = 0; f < volume->getNumVolumeFaces(); f++)
+		{
+			LLVolumeFace& face = const_cast<LLVolumeFace&>(volume->getVolumeFace(f));
+			face.createBinormals();
+			U32 count = face.getNumVertices();
+			ensure("face has vertices", count > 0);
+			ensure_equals("streams sized together", (U32) face.mNormals.size(), count);
+			ensure_equals("binormals sized", (U32) face.mBinormals.size(), count);
+			ensure_equals("texcoords sized", (U32) face.mTexCoords.size(), count);
+			ensure("positions aligned", ((size_t) &face.mPositions[0] & 15) == 0);
+			ensure("normals aligned", ((size_t) &face.mNormals[0] & 15) == 0);
+
+			std::vector<buffer_vertex> batched, scalar;
+			rebuild(face, batched, true);
+			rebuild(face, scalar, false);
+
+			for (U32 i = 0; i < count; i++)
+			{
+				LLVector3 position = face.mPositions[i] * mMatrix;
+				LLVector3 normal = face.mNormals[i] * mNormalMatrix;
+				normal.normVec();
+				ensure("scalar position", scalar[i].mPosition == position);
+				ensure("scalar normal", scalar[i].mNormal == normal);
+				ensure("batched position", batched[i].mPosition == position);
+				ensure("batched normal", batched[i].mNormal == normal);
+				ensure("batched binormal", batched[i].mBinormal == scalar[i].mBinormal);
+			}
+		}
+
+		// degenerate normals come out as zero, as from normVec()
+		std::vector<LLVector3, LLV4Allocator<LLVector3> > zero(5);
+		std::vector<LLVector3> out(5, LLVector3(1.f, 1.f, 1.f));
+		LLStrider<LLVector3> strider;
+		strider = &out[0];
+		llv4transform_normals(mNormalMatrix, &zero[0], 5, strider);
+		for (U32 i = 0; i < 5; i++)
+		{
+			ensure("zero normal", out[i].isExactlyZero());
+		}
+	}
+
+#if LL_BENCHMARKS
+	struct transform_benchmark : public transform_data { };
+	typedef test_group<transform_benchmark> transform_benchmark_t;
+	typedef transform_benchmark_t::object transform_benchmark_object_t;
+	tut::transform_benchmark_t tut_transform_benchmark("v4transform benchmark");
+
+	template<> template<>
+	void transform_benchmark_object_t::test<1>()
+	{
+		// Rebuild benchmark: positions, normals and binormals of a high
+		// detail prim into an interleaved buffer, per vertex against batched
+		const U32 PASSES = 2000;
+
+		LLPointer<LLVolume> volume = makeVolume(4.f);
+		LLVolumeFace& face = const_cast<LLVolumeFace&>(volume->getVolumeFace(0));
+		face.createBinormals();
+
+		F64 elapsed[2];
+		std::vector<buffer_vertex> buffer;
+		for (U32 method = 0; method < 2; method++)
+		{
+			LLTimer timer;
+			for (U32 pass = 0; pass < PASSES; pass++)
+			{
+				rebuild(face, buffer, method == 1);
+			}
+			elapsed[method] = timer.getElapsedTimeF64();
+		}
+
+		F64 vertices = (F64) face.getNumVertices() * PASSES;
+		std::cout << "LLVolumeFace rebuild, " << face.getNumVertices() << " vertices, " << PASSES
+				  << " passes (LL_VECTORIZE " << LL_VECTORIZE << "): scalar "
+				  << (S32) (vertices / elapsed[0] / 1000.0) << "k vertices/s, batched "
+				  << (S32) (vertices / elapsed[1] / 1000.0) << "k vertices/s" << std::endl;
+	}
+#endif // LL_BENCHMARKS
+}
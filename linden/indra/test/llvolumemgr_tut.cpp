@@ -0,0 +1,257 @@
+/**
+ * @file llvolumemgr_tut.cpp
+ * @brief Tests for handing volumes built off the main thread to LLVolumeMgr.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <map>
+
+#include "llthread.h"
+#include "lltimer.h"
+#include "llvolume.h"
+#include "llvolumemgr.h"
+
+namespace tut
+{
+	// Generates a volume on a thread of its own
+	class volume_thread : public LLThread
+	{
+	public:
+		volume_thread(const LLVolumeParams& params, F32 detail)
+			: LLThread("Volume test"), mParams(params), mDetail(detail)
+		{
+			mDone = 0;
+		}
+
+		/*virtual*/ void run()
+		{
+			mVolume = new LLVolume(mParams, mDetail);
+			mDone = 1;
+		}
+
+		LLVolume* build()
+		{
+			start();
+			while (!mDone)
+			{
+				ms_sleep(1);
+			}
+			return mVolume.get();
+		}
+
+		LLVolumeParams mParams;
+		F32 mDetail;
+		LLPointer<LLVolume> mVolume;
+		LLAtomicS32 mDone;
+	};
+
+	// Keeps packed geometry in memory, keyed on detail and sculpt CRC
+	class memory_geometry_cache : public LLVolumeGeometryCache
+	{
+	public:
+		memory_geometry_cache() : mLoads(0), mHits(0) { }
+
+		/*virtual*/ BOOL loadGeometry(LLVolume* volume, S32 sculpt_level, U32 sculpt_crc)
+		{
+			mLoads++;
+			entry_map_t::iterator iter = mEntries.find(std::make_pair(volume->getDetail(), sculpt_crc));
+			if (iter == mEntries.end() || iter->second.empty())
+			{
+				return FALSE;
+			}
+			BOOL loaded = volume->unpackGeometry(&iter->second[0], iter->second.size());
+			if (loaded)
+			{
+				mHits++;
+			}
+			return loaded;
+		}
+
+		/*virtual*/ void storeGeometry(const LLVolume* volume, U32 sculpt_crc)
+		{
+			volume->packGeometry(mEntries[std::make_pair(volume->getDetail(), sculpt_crc)]);
+		}
+
+		typedef std::map<std::pair<F32, U32>, std::vector<U8> > entry_map_t;
+		entry_map_t mEntries;
+		U32 mLoads;
+		U32 mHits;
+	};
+
+	void ensure_same_geometry(const LLVolume* a, const LLVolume* b)
+	{
+		ensure_equals("same faces", a->getNumVolumeFaces(), b->getNumVolumeFaces());
+		ensure_equals("same mesh", a->getMesh().size(), b->getMesh().size());
+		for (S32 i = 0; i < a->getNumVolumeFaces(); i++)
+		{
+			const LLVolumeFace& fa = a->getVolumeFace(i);
+			const LLVolumeFace& fb = b->getVolumeFace(i);
+			ensure_equals("same face type", fa.mTypeMask, fb.mTypeMask);
+			ensure_equals("same vertices", fa.getNumVertices(), fb.getNumVertices());
+			ensure("same indices", fa.mIndices == fb.mIndices);
+			ensure("same edges", fa.mEdge == fb.mEdge);
+			for (U32 v = 0; v < fa.getNumVertices(); v++)
+			{
+				ensure("same position", fa.mPositions[v] == fb.mPositions[v]);
+				ensure("same normal", fa.mNormals[v] == fb.mNormals[v]);
+				ensure("same texcoord", fa.mTexCoords[v] == fb.mTexCoords[v]);
+			}
+		}
+	}
+
+	struct volumemgr_data
+	{
+		volumemgr_data()
+		{
+			mParams.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+			mParams.setBeginAndEndS(0.f, 1.f);
+			mParams.setBeginAndEndT(0.f, 1.f);
+			mParams.setRatio(1.f, 0.5f);
+		}
+
+		LLVolumeParams mParams;
+	};
+
+	typedef test_group<volumemgr_data> volumemgr_test_t;
+	typedef volumemgr_test_t::object volumemgr_object_t;
+	tut::volumemgr_test_t tut_volumemgr_test("volumemgr");
+
+	template<> template<>
+	void volumemgr_object_t::test<1>()
+	{
+		// A LOD built on another thread is adopted by its group
+		LLVolumeMgr mgr;
+		LLPointer<LLVolume> low = mgr.refVolume(mParams, 0);
+		ensure("low LOD generated", mgr.hasVolume(mParams, 0));
+		ensure("high LOD not generated", !mgr.hasVolume(mParams, 3));
+
+		volume_thread thread(mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		LLPointer<LLVolume> built = thread.build();
+		ensure("built", built.notNull());
+		ensure("inserted", mgr.insertVolume(built, 3));
+		ensure("high LOD generated", mgr.hasVolume(mParams, 3));
+		ensure("slot taken", !mgr.insertVolume(built, 3));
+
+		LLPointer<LLVolume> high = mgr.refVolume(mParams, 3);
+		ensure("refVolume returns the built volume", high == built);
+
+		LLPointer<LLVolume> sync = new LLVolume(mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		ensure_equals("same faces", built->getNumVolumeFaces(), sync->getNumVolumeFaces());
+		for (S32 i = 0; i < sync->getNumVolumeFaces(); i++)
+		{
+			ensure_equals("same vertices", built->getVolumeFace(i).getNumVertices(), sync->getVolumeFace(i).getNumVertices());
+			ensure_equals("same indices", built->getVolumeFace(i).mIndices.size(), sync->getVolumeFace(i).mIndices.size());
+		}
+
+		mgr.unrefVolume(high);
+		mgr.unrefVolume(low);
+		ensure("group released", mgr.getGroup(mParams) == NULL);
+
+		LLVolumeParams other = mParams;
+		other.setRatio(0.5f, 0.5f);
+		LLPointer<LLVolume> orphan = new LLVolume(other, 1.f);
+		ensure("no group to insert into", !mgr.insertVolume(orphan, 0));
+	}
+
+	template<> template<>
+	void volumemgr_object_t::test<2>()
+	{
+		// Geometry swapped into a volume in use
+		F32 detail = LLVolumeLODGroup::getVolumeScaleFromDetail(1);
+		LLPointer<LLVolume> target = new LLVolume(mParams, detail);
+		LLPointer<LLVolume> built = new LLVolume(mParams, detail);
+		std::vector<U32> vertices;
+		for (S32 i = 0; i < built->getNumVolumeFaces(); i++)
+		{
+			vertices.push_back(built->getVolumeFace(i).getNumVertices());
+		}
+		U32 mesh_size = built->getMesh().size();
+
+		target->resizePath(0);
+		ensure_equals("target emptied", target->getNumVolumeFaces(), 0);
+		target->swapGeometry(*built);
+
+		ensure_equals("faces swapped", target->getNumVolumeFaces(), (S32)vertices.size());
+		ensure_equals("mesh swapped", (U32)target->getMesh().size(), mesh_size);
+		for (U32 i = 0; i < vertices.size(); i++)
+		{
+			ensure_equals("vertices swapped", target->getVolumeFace(i).getNumVertices(), vertices[i]);
+		}
+		ensure_equals("old geometry given back", built->getNumVolumeFaces(), 0);
+	}
+
+	template<> template<>
+	void volumemgr_object_t::test<3>()
+	{
+		// Packed geometry unpacks to the same volume, and damaged data is
+		// rejected without touching the volume
+		F32 detail = LLVolumeLODGroup::getVolumeScaleFromDetail(2);
+		LLPointer<LLVolume> source = new LLVolume(mParams, detail);
+		std::vector<U8> data;
+		source->packGeometry(data);
+		ensure("packed", !data.empty());
+
+		LLPointer<LLVolume> target = new LLVolume(mParams, detail);
+		target->resizePath(0);
+		ensure("unpacked", target->unpackGeometry(&data[0], data.size()));
+		ensure_same_geometry(source, target);
+
+		LLPointer<LLVolume> damaged = new LLVolume(mParams, detail);
+		ensure("truncated data rejected", !damaged->unpackGeometry(&data[0], data.size() - 1));
+		ensure("header only rejected", !damaged->unpackGeometry(&data[0], 8));
+		std::vector<U8> padded(data);
+		padded.push_back(0);
+		ensure("trailing data rejected", !damaged->unpackGeometry(&padded[0], padded.size()));
+		ensure_same_geometry(source, damaged);
+	}
+
+	template<> template<>
+	void volumemgr_object_t::test<4>()
+	{
+		// Volumes store what they generate and load it the next time round
+		memory_geometry_cache cache;
+		LLVolume::setGeometryCache(&cache);
+		F32 detail = LLVolumeLODGroup::getVolumeScaleFromDetail(3);
+		LLPointer<LLVolume> generated = new LLVolume(mParams, detail);
+		ensure_equals("miss", cache.mHits, (U32)0);
+		ensure_equals("stored", cache.mEntries.size(), (size_t)1);
+
+		LLPointer<LLVolume> loaded = new LLVolume(mParams, detail);
+		ensure_equals("hit", cache.mHits, (U32)1);
+		ensure_same_geometry(generated, loaded);
+
+		U32 loads = cache.mLoads;
+		LLPointer<LLVolume> unique = new LLVolume(mParams, detail, FALSE, TRUE);
+		ensure_equals("unique volumes bypass the cache", cache.mLoads, loads);
+		LLVolume::setGeometryCache(NULL);
+	}
+}
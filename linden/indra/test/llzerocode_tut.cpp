@@ -0,0 +1,282 @@
+/**
+ * @file llzerocode_tut.cpp
+ * @brief Tests for zero coding against the byte at a time versions it replaced.
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <iostream>
+#include <vector>
+
+#include "lltimer.h"
+#include "llzerocode.h"
+
+namespace tut
+{
+	// The encoder from LLTemplateMessageBuilder, without the packet header
+	S32 reference_encode(const U8* inptr, S32 count, U8* outptr)
+	{
+		U8* start = outptr;
+		U8 num_zeroes = 0;
+		while (count--)
+		{
+			if (!(*inptr))
+			{
+				if (num_zeroes)
+				{
+					if (++num_zeroes > 254)
+					{
+						*outptr++ = num_zeroes;
+						num_zeroes = 0;
+					}
+				}
+				else
+				{
+					*outptr++ = 0;
+					num_zeroes = 1;
+				}
+				inptr++;
+			}
+			else
+			{
+				if (num_zeroes)
+				{
+					*outptr++ = num_zeroes;
+					num_zeroes = 0;
+				}
+				*outptr++ = *inptr++;
+			}
+		}
+		if (num_zeroes)
+		{
+			*outptr++ = num_zeroes;
+		}
+		return (S32)(outptr - start);
+	}
+
+	// LLMessageSystem::zeroCodeExpand(), without the packet header or the
+	// buffer checks
+	S32 reference_expand(const U8* inptr, S32 count, U8* outptr)
+	{
+		U8* start = outptr;
+		while (count--)
+		{
+			if (!((*outptr++ = *inptr++)))
+			{
+				while (((count--)) && (!(*inptr)))
+				{
+					*outptr++ = *inptr++;
+					memset(outptr, 0, 255);
+					outptr += 255;
+				}
+				if (count < 0)
+				{
+					break;
+				}
+				else
+				{
+					memset(outptr, 0, (*inptr) - 1);
+					outptr += ((*inptr) - 1);
+					inptr++;
+				}
+			}
+		}
+		return (S32)(outptr - start);
+	}
+
+	struct zerocode_data
+	{
+		zerocode_data() : mSeed(1) { }
+
+		U32 rand(U32 range)
+		{
+			// Fixed LCG so every run sees the same packets
+			mSeed = mSeed * 1103515245 + 12345;
+			return ((mSeed >> 8) & 0xffff) % range;
+		}
+
+		// A message body like an object update: literal runs broken up by
+		// runs of zeros, now and then a long one
+		void makeBody(std::vector<U8>& body, S32 size)
+		{
+			body.clear();
+			while ((S32)body.size() < size)
+			{
+				S32 literals = rand(40);
+				for (S32 i = 0; i < literals; i++)
+				{
+					body.push_back((U8)(1 + rand(255)));
+				}
+				S32 zeros = rand(20) ? 1 + rand(24) : 200 + rand(400);
+				body.insert(body.end(), zeros, 0);
+			}
+			body.resize(size);
+		}
+
+		U32 mSeed;
+	};
+
+	typedef test_group<zerocode_data> zerocode_test_t;
+	typedef zerocode_test_t::object zerocode_object_t;
+	tut::zerocode_test_t tut_zerocode_test("zerocode");
+
+	template<> template<>
+	void zerocode_object_t::test<1>()
+	{
+		// Encoding matches the old encoder byte for byte, and expands back
+		std::vector<U8> body;
+		std::vector<U8> encoded(2 * 4096);
+		std::vector<U8> expected(2 * 4096);
+		std::vector<U8> expanded(4096);
+		for (S32 n = 0; n < 3000; n++)
+		{
+			S32 size = rand(n < 100 ? 40 : 1400);
+			makeBody(body, size);
+			if (n % 3 == 0)
+			{
+				// Dense zeros, with runs ending right at the end
+				for (S32 i = 0; i < size; i++)
+				{
+					body[i] = rand(4) ? 0 : (U8)(1 + rand(255));
+				}
+			}
+			const U8* in = body.empty() ? NULL : &body[0];
+
+			S32 encoded_size = zero_code_encode(in, size, &encoded[0]);
+			S32 expected_size = reference_encode(in, size, &expected[0]);
+			ensure_equals("encoded size", encoded_size, expected_size);
+			ensure("encoded bytes", !memcmp(&encoded[0], &expected[0], encoded_size));
+			ensure_equals("size without encoding", zero_code_encoded_size(in, size), encoded_size);
+
+			ensure_equals("round trip size", zero_code_expand(&encoded[0], encoded_size, &expanded[0], 4096), size);
+			ensure("round trip bytes", !size || !memcmp(&expanded[0], in, size));
+		}
+	}
+
+	template<> template<>
+	void zerocode_object_t::test<2>()
+	{
+		// Expanding arbitrary input, including zeros where a length should be
+		// and a zero at the very end, matches the old expander, and refuses
+		// exactly what would not fit
+		std::vector<U8> encoded;
+		std::vector<U8> expanded(8192);
+		std::vector<U8> expected(1400 * 256 + 256);
+		for (S32 n = 0; n < 5000; n++)
+		{
+			S32 size = rand(n < 100 ? 20 : 1400);
+			encoded.resize(size + 1);
+			S32 zero_odds = 2 + rand(30);
+			for (S32 i = 0; i < size; i++)
+			{
+				encoded[i] = rand(zero_odds) ? (U8)(1 + rand(255)) : 0;
+			}
+			S32 max_size = rand(2) ? 8192 - 256 : rand(8192);
+
+			S32 expanded_size = zero_code_expand(&encoded[0], size, &expanded[0], max_size);
+			S32 expected_size = reference_expand(&encoded[0], size, &expected[0]);
+			if (expected_size > max_size)
+			{
+				ensure_equals("too big to expand", expanded_size, -1);
+			}
+			else
+			{
+				ensure_equals("expanded size", expanded_size, expected_size);
+				ensure("expanded bytes", !memcmp(&expanded[0], &expected[0], expanded_size));
+			}
+		}
+	}
+
+#if LL_BENCHMARKS
+	struct zerocode_benchmark : public zerocode_data { };
+	typedef test_group<zerocode_benchmark> zerocode_benchmark_t;
+	typedef zerocode_benchmark_t::object zerocode_benchmark_object_t;
+	tut::zerocode_benchmark_t tut_zerocode_benchmark("zerocode benchmark");
+
+	template<> template<>
+	void zerocode_benchmark_object_t::test<1>()
+	{
+		// Throughput over object update sized packets
+		const S32 PACKETS = 500;
+		const S32 PASSES = 40;
+		std::vector<std::vector<U8> > bodies(PACKETS);
+		std::vector<std::vector<U8> > packets(PACKETS);
+		S32 total_bytes = 0;
+		for (S32 i = 0; i < PACKETS; i++)
+		{
+			makeBody(bodies[i], 200 + rand(1000));
+			packets[i].resize(2 * bodies[i].size());
+			packets[i].resize(zero_code_encode(&bodies[i][0], bodies[i].size(), &packets[i][0]));
+			total_bytes += bodies[i].size();
+		}
+
+		std::vector<U8> out(2 * 4096);
+		F64 elapsed[4];
+		S32 check[4] = { 0, 0, 0, 0 };
+		for (S32 way = 0; way < 4; way++)
+		{
+			LLTimer timer;
+			for (S32 pass = 0; pass < PASSES; pass++)
+			{
+				for (S32 i = 0; i < PACKETS; i++)
+				{
+					switch (way)
+					{
+					case 0:
+						check[way] += reference_expand(&packets[i][0], packets[i].size(), &out[0]);
+						break;
+					case 1:
+						check[way] += zero_code_expand(&packets[i][0], packets[i].size(), &out[0], 4096);
+						break;
+					case 2:
+						check[way] += reference_encode(&bodies[i][0], bodies[i].size(), &out[0]);
+						break;
+					default:
+						check[way] += zero_code_encode(&bodies[i][0], bodies[i].size(), &out[0]);
+						break;
+					}
+				}
+			}
+			elapsed[way] = timer.getElapsedTimeF64();
+		}
+
+		ensure_equals("same expanded size", check[1], check[0]);
+		ensure_equals("same encoded size", check[3], check[2]);
+
+		F64 megabytes = (F64)total_bytes * PASSES / (1024.0 * 1024.0);
+		std::cout << "Zero coding, " << PACKETS << " packets of " << total_bytes / PACKETS << " bytes: expand "
+				  << (S32)(megabytes / elapsed[0]) << " MB/s byte at a time, " << (S32)(megabytes / elapsed[1])
+				  << " MB/s now; encode " << (S32)(megabytes / elapsed[2]) << " MB/s byte at a time, "
+				  << (S32)(megabytes / elapsed[3]) << " MB/s now" << std::endl;
+	}
+#endif // LL_BENCHMARKS
+}
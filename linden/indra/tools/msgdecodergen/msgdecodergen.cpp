@@ -0,0 +1,88 @@
+/**
+ * @file msgdecodergen.cpp
+ * @brief Writes llmessagedecoders.h/.cpp from message_template.msg
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <iostream>
+
+#include "llfile.h"
+#include "llmessagedecodergenerator.h"
+#include "llmessagetemplateparser.h"
+
+// Usage: msgdecodergen <message_template.msg> <output directory> [message ...]
+// With no messages listed, writes the viewer's default set.
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "usage: " << argv[0] << " <message_template.msg> <output directory> [message ...]" << std::endl;
+		return 1;
+	}
+
+	std::string template_body;
+	if (!_read_file_into_string(template_body, argv[1]))
+	{
+		std::cerr << "Failed to open template: " << argv[1] << std::endl;
+		return 1;
+	}
+
+	LLTemplateTokenizer tokens(template_body);
+	LLTemplateParser parser(tokens);
+	LLMessageDecoderGenerator generator(parser);
+
+	BOOL found = TRUE;
+	if (argc == 3)
+	{
+		found = generator.addDefaultMessages();
+	}
+	for (S32 i = 3; i < argc; i++)
+	{
+		found = generator.addMessage(argv[i]) && found;
+	}
+	if (!found)
+	{
+		return 1;
+	}
+
+	std::string dir(argv[2]);
+	llofstream header((dir + "/llmessagedecoders.h").c_str(), std::ios::binary);
+	llofstream source((dir + "/llmessagedecoders.cpp").c_str(), std::ios::binary);
+	if (!header.is_open() || !source.is_open())
+	{
+		std::cerr << "Failed to write to " << dir << std::endl;
+		return 1;
+	}
+	generator.writeHeader(header);
+	generator.writeSource(source);
+	return 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * @file msgreplay.cpp
+ * @brief Replays a packet capture through the message system and times it
+ *
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "aiaprpool.h"
+#include "llmessagedecoders.h"
+#include "llmessagereader.h"
+#include "llmessagetemplate.h"
+#include "llpacketcapture.h"
+#include "lltimer.h"
+#include "llversionviewer.h"
+#include "message.h"
+#include "message_prehash.h"
+
+// Folded over everything the handlers read, so two replays of the same
+// capture can be checked for decoding the same data
+static U32 sDigest = 0;
+
+static void digest(U32 value)
+{
+	sDigest = (sDigest ^ value) * 16777619;
+}
+
+static void digest(const U8* data, S32 size)
+{
+	for (S32 i = 0; i < size; i++)
+	{
+		digest(data[i]);
+	}
+}
+
+// The handlers read what the viewer's handlers read, and no more, so the
+// time spent in them is the message system's share of the viewer's.
+static void replay_object_update(LLMessageSystem* msg, void**)
+{
+	static LLMsgObjectUpdate update;
+	if (!update.decode(msg))
+	{
+		return;
+	}
+	digest((U32)update.getRegionData().getRegionHandle());
+	for (S32 i = 0; i < update.getObjectDataCount(); i++)
+	{
+		const LLMsgObjectUpdate::ObjectDataBlock& block = update.getObjectData(i);
+		digest(block.getID());
+		digest(block.getFullID().mData, UUID_BYTES);
+		digest(block.getPCode());
+		digest(block.getObjectData(), block.getObjectDataSize());
+		digest(block.getTextureEntry(), block.getTextureEntrySize());
+		digest(block.getNameValue(), block.getNameValueSize());
+		digest(block.getExtraParams(), block.getExtraParamsSize());
+	}
+}
+
+static void replay_object_update_compressed(LLMessageSystem* msg, void**)
+{
+	static LLMsgObjectUpdateCompressed update;
+	if (!update.decode(msg))
+	{
+		return;
+	}
+	for (S32 i = 0; i < update.getObjectDataCount(); i++)
+	{
+		const LLMsgObjectUpdateCompressed::ObjectDataBlock& block = update.getObjectData(i);
+		digest(block.getUpdateFlags());
+		digest(block.getData(), block.getDataSize());
+	}
+}
+
+static void replay_object_update_cached(LLMessageSystem* msg, void**)
+{
+	static LLMsgObjectUpdateCached update;
+	if (!update.decode(msg))
+	{
+		return;
+	}
+	for (S32 i = 0; i < update.getObjectDataCount(); i++)
+	{
+		digest(update.getObjectData(i).getID());
+		digest(update.getObjectData(i).getCRC());
+	}
+}
+
+static void replay_terse_object_update(LLMessageSystem* msg, void**)
+{
+	static LLMsgImprovedTerseObjectUpdate update;
+	if (!update.decode(msg))
+	{
+		return;
+	}
+	for (S32 i = 0; i < update.getObjectDataCount(); i++)
+	{
+		const LLMsgImprovedTerseObjectUpdate::ObjectDataBlock& block = update.getObjectData(i);
+		digest(block.getData(), block.getDataSize());
+		digest(block.getTextureEntry(), block.getTextureEntrySize());
+	}
+}
+
+// ImageData, ImagePacket and LayerData: copy the payload out like the
+// texture fetcher and the terrain decoder do
+static void replay_binary_data(LLMessageSystem* msg, void** user_data)
+{
+	const char* block = (const char*)user_data;
+	static std::vector<U8> data;
+	S32 size = msg->getSizeFast(block, _PREHASH_Data);
+	if (size <= 0)
+	{
+		return;
+	}
+	data.resize(size);
+	msg->getBinaryDataFast(block, _PREHASH_Data, &data[0], size);
+	digest(&data[0], size);
+}
+
+// Usage: msgreplay <message_template.msg> <capture> [passes]
+// Captures are made by running the viewer with PacketCaptureFile set.
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "usage: " << argv[0] << " <message_template.msg> <capture> [passes]" << std::endl;
+		return 1;
+	}
+	S32 passes = (argc > 3) ? llmax(atoi(argv[3]), 1) : 1;
+
+	ll_init_apr();
+
+	// Every sender gets a circuit, as the regions did in the session
+	LLPacketCaptureReader reader;
+	if (!reader.open(argv[2]))
+	{
+		std::cerr << "Failed to open capture: " << argv[2] << std::endl;
+		return 1;
+	}
+	std::set<LLHost> hosts;
+	U64 first_time = 0;
+	U64 last_time = 0;
+	U64 total_bytes = 0;
+	U64 receive_time;
+	LLHost sender;
+	LLHost receiving_if;
+	U8 buffer[NET_BUFFER_SIZE];
+	while (S32 size = reader.read(receive_time, sender, receiving_if, buffer))
+	{
+		if (reader.getPacketCount() == 1)
+		{
+			first_time = receive_time;
+		}
+		last_time = receive_time;
+		total_bytes += size;
+		hosts.insert(sender);
+	}
+	U32 packets = reader.getPacketCount();
+	reader.close();
+	std::cout << argv[2] << ": " << packets << " packets, " << total_bytes << " bytes from "
+			  << hosts.size() << " hosts over " << (F64)(last_time - first_time) * SEC_PER_USEC << " seconds" << std::endl;
+
+	if (!start_messaging_system(argv[1], NET_USE_OS_ASSIGNED_PORT,
+								LL_VERSION_MAJOR, LL_VERSION_MINOR, LL_VERSION_PATCH,
+								FALSE, "", NULL, false, 5.f, 100.f))
+	{
+		std::cerr << "Failed to start the message system with " << argv[1] << std::endl;
+		return 1;
+	}
+	LLMessageSystem* msg = gMessageSystem;
+
+	// Leave the message system's own handlers (acks, pings, circuits) be
+	for (LLMessageSystem::message_template_name_map_t::iterator it = msg->mMessageTemplates.begin();
+		 it != msg->mMessageTemplates.end(); ++it)
+	{
+		if (!it->second->hasHandlerFunc())
+		{
+			msg->setHandlerFuncFast(it->first, null_message_callback);
+		}
+	}
+	msg->setHandlerFuncFast(_PREHASH_ObjectUpdate, replay_object_update);
+	msg->setHandlerFuncFast(_PREHASH_ObjectUpdateCompressed, replay_object_update_compressed);
+	msg->setHandlerFuncFast(_PREHASH_ObjectUpdateCached, replay_object_update_cached);
+	msg->setHandlerFuncFast(_PREHASH_ImprovedTerseObjectUpdate, replay_terse_object_update);
+	msg->setHandlerFuncFast(_PREHASH_ImageData, replay_binary_data, (void**)_PREHASH_ImageData);
+	msg->setHandlerFuncFast(_PREHASH_ImagePacket, replay_binary_data, (void**)_PREHASH_ImageData);
+	msg->setHandlerFuncFast(_PREHASH_LayerData, replay_binary_data, (void**)_PREHASH_LayerData);
+	LLMessageReader::setTimeDecodes(TRUE);
+
+	F64 best = 0.0;
+	for (S32 pass = 0; pass < passes; pass++)
+	{
+		// Fresh circuits each pass, so packet ids start over
+		for (std::set<LLHost>::iterator it = hosts.begin(); it != hosts.end(); ++it)
+		{
+			msg->mCircuitInfo.removeCircuitData(*it);
+			msg->enableCircuit(*it, TRUE);
+		}
+		if (!msg->mPacketRing.startReplay(argv[2]))
+		{
+			return 1;
+		}
+
+		sDigest = 2166136261U;
+		LLTimer timer;
+		S64 frame = 0;
+		while (!msg->mPacketRing.isReplayFinished())
+		{
+			// Like a viewer frame, minus the time cap
+			while (msg->checkMessages(frame))
+			{
+			}
+			msg->processAcks();
+			frame++;
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+		msg->mPacketRing.stopReplay();
+
+		best = (pass && best < elapsed) ? best : elapsed;
+		std::cout << "pass " << pass + 1 << ": " << elapsed << " seconds, " << (S32)(packets / elapsed)
+				  << " packets/s, digest " << std::hex << sDigest << std::dec << std::endl;
+	}
+	std::cout << "best: " << best << " seconds, " << (S32)(packets / best) << " packets/s, "
+			  << (total_bytes / (1024.0 * 1024.0)) / best << " MB/s" << std::endl;
+
+	// Per message decode times, summed over all passes
+	std::ostringstream summary;
+	msg->summarizeLogs(summary);
+	std::cout << summary.str();
+
+	end_messaging_system(false);
+	return 0;
+}